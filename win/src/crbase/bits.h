@@ -10,6 +10,12 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "crbase/build_config.h"
+
+#if defined(MINI_CHROMIUM_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
 namespace cr {
 namespace bits {
 
@@ -40,6 +46,37 @@ inline int Log2Ceiling(uint32_t n) {
   }
 }
 
+// Returns the number of zero bits below the lowest set bit of |n|, which must
+// not be zero.
+inline int CountTrailingZeroBits64(uint64_t n) {
+#if defined(MINI_CHROMIUM_COMPILER_MSVC)
+  unsigned long index;
+#if defined(MINI_CHROMIUM_ARCH_CPU_64_BITS)
+  _BitScanForward64(&index, n);
+  return static_cast<int>(index);
+#else
+  if (static_cast<uint32_t>(n)) {
+    _BitScanForward(&index, static_cast<uint32_t>(n));
+    return static_cast<int>(index);
+  }
+  _BitScanForward(&index, static_cast<uint32_t>(n >> 32));
+  return 32 + static_cast<int>(index);
+#endif
+#else
+  return __builtin_ctzll(n);
+#endif
+}
+
+// Returns the integer i such as 2^i <= n < 2^(i+1) for a 64-bit |n|.
+inline int Log2Floor64(uint64_t n) {
+  if (n == 0)
+    return -1;
+  uint32_t high = static_cast<uint32_t>(n >> 32);
+  if (high)
+    return 32 + Log2Floor(high);
+  return Log2Floor(static_cast<uint32_t>(n));
+}
+
 // Round up |size| to a multiple of alignment, which must be a power of two.
 inline size_t Align(size_t size, size_t alignment) {
   return (size + alignment - 1) & ~(alignment - 1);
@@ -25,7 +25,7 @@
 #endif
 
 #if defined(MINI_CHROMIUM_OS_LINUX)
-#define MINI_CHROMIUM_OS_POXI 1
+#define MINI_CHROMIUM_OS_POSIX 1
 #endif
 
 // compiler
@@ -0,0 +1,143 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_CONTAINERS_MPSC_QUEUE_H_
+#define MINI_CHROMIUM_SRC_CRBASE_CONTAINERS_MPSC_QUEUE_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "crbase/logging.h"
+
+namespace cr {
+
+// Link embedded in every element of an MpscQueue.
+class MpscQueueNode {
+ public:
+  MpscQueueNode() : next_(nullptr) {}
+  MpscQueueNode(const MpscQueueNode&) = delete;
+  MpscQueueNode& operator=(const MpscQueueNode&) = delete;
+
+ private:
+  template <typename T> friend class MpscQueue;
+
+  std::atomic<MpscQueueNode*> next_;
+};
+
+// An intrusive, unbounded, lock-free multi-producer/single-consumer FIFO
+// queue (D. Vyukov's algorithm).  Push() may be called from any thread and is
+// wait-free: one atomic exchange plus one store.  Pop() must only be called
+// from a single consumer thread at a time.
+//
+// The queue never allocates and does not own its elements: T must derive from
+// MpscQueueNode and each element may be in at most one queue at a time.
+//
+// Pop() is not linearizable with respect to a Push() that is still in
+// progress: a producer that has swapped the tail but not yet linked its node
+// hides that node, and everything pushed after it, until it finishes.  Pop()
+// then returns null although the queue is not empty.  Callers that put the
+// consumer to sleep on an empty Pop() must therefore have producers check
+// whether the consumer needs a wakeup *after* Push() returns.
+//
+//   struct Item : public MpscQueueNode { int value; };
+//
+//   MpscQueue<Item> queue;
+//   queue.Push(new Item);               // Any thread.
+//   while (Item* item = queue.Pop())    // Consumer thread.
+//     delete item;
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {
+    static_assert(std::is_base_of<MpscQueueNode, T>::value,
+                  "T must derive from MpscQueueNode");
+  }
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue() {
+    CR_DCHECK(head_ == &stub_ && tail_.load() == &stub_)
+        << "MpscQueue destroyed while not empty";
+  }
+
+  // Appends |node| to the queue.  May be called from any thread.
+  void Push(T* node) { PushNode(node); }
+
+  // Appends the |count| elements of |nodes|, in order, with a single atomic
+  // exchange.  The consumer sees either none or all of them.  May be called
+  // from any thread.
+  void PushBatch(T* const* nodes, size_t count) {
+    if (!count)
+      return;
+    for (size_t i = 0; i + 1 < count; ++i)
+      nodes[i]->next_.store(nodes[i + 1], std::memory_order_relaxed);
+    MpscQueueNode* last = nodes[count - 1];
+    last->next_.store(nullptr, std::memory_order_relaxed);
+    MpscQueueNode* prev = tail_.exchange(last, std::memory_order_acq_rel);
+    prev->next_.store(nodes[0], std::memory_order_release);
+  }
+
+  // Removes and returns the oldest element, or null if there is none that
+  // can be taken without waiting for a producer.  Consumer thread only.
+  T* Pop() {
+    MpscQueueNode* head = head_;
+    MpscQueueNode* next = head->next_.load(std::memory_order_acquire);
+    if (head == &stub_) {
+      if (!next)
+        return nullptr;
+      head_ = next;
+      head = next;
+      next = next->next_.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+      head_ = next;
+      return static_cast<T*>(head);
+    }
+
+    // |head| is the last linked node.  If it is not the tail, a producer is
+    // in the middle of a Push().
+    if (head != tail_.load(std::memory_order_acquire))
+      return nullptr;
+
+    // Put the stub back behind the last node so that it can be handed out.
+    PushNode(&stub_);
+    next = head->next_.load(std::memory_order_acquire);
+    if (next) {
+      head_ = next;
+      return static_cast<T*>(head);
+    }
+    return nullptr;
+  }
+
+  // Returns true if no element is visible to the consumer.  Consumer thread
+  // only; see the class comment about pushes in progress.
+  bool IsEmpty() const {
+    MpscQueueNode* head = head_;
+    if (head != &stub_)
+      return false;
+    return head->next_.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  void PushNode(MpscQueueNode* node) {
+    node->next_.store(nullptr, std::memory_order_relaxed);
+    MpscQueueNode* prev = tail_.exchange(node, std::memory_order_acq_rel);
+    prev->next_.store(node, std::memory_order_release);
+  }
+
+  // Consumer end.  Only touched by the consumer thread.
+  MpscQueueNode* head_;
+
+  // Producer end.
+  std::atomic<MpscQueueNode*> tail_;
+
+  MpscQueueNode stub_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_CONTAINERS_MPSC_QUEUE_H_
@@ -249,7 +249,7 @@ inline void DispatchToMethodImpl(ObjT* obj,
                                  Method method,
                                  const Tuple<Ts...>& arg,
                                  IndexSequence<Ns...>) {
-  (obj->*method)(cr::internal::UnwrapTraits<Ts>::Unwrap(get<Ns>(arg))...);
+  (obj->*method)(cr::internal::Unwrap(get<Ns>(arg))...);
 }
 
 template <typename ObjT, typename Method, typename... Ts>
@@ -265,7 +265,7 @@ template <typename Function, typename... Ts, size_t... Ns>
 inline void DispatchToFunctionImpl(Function function,
                                    const Tuple<Ts...>& arg,
                                    IndexSequence<Ns...>) {
-  (*function)(cr::internal::UnwrapTraits<Ts>::Unwrap(get<Ns>(arg))...);
+  (*function)(cr::internal::Unwrap(get<Ns>(arg))...);
 }
 
 template <typename Function, typename... Ts>
@@ -287,7 +287,7 @@ inline void DispatchToMethodImpl(ObjT* obj,
                                  Tuple<OutTs...>* out,
                                  IndexSequence<InNs...>,
                                  IndexSequence<OutNs...>) {
-  (obj->*method)(cr::internal::UnwrapTraits<InTs>::Unwrap(get<InNs>(in))...,
+  (obj->*method)(cr::internal::Unwrap(get<InNs>(in))...,
                  &get<OutNs>(*out)...);
 }
 
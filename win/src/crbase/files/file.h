@@ -30,6 +30,7 @@ namespace cr {
 typedef HANDLE PlatformFile;
 #elif defined(MINI_CHROMIUM_OS_POSIX)
 typedef int PlatformFile;
+typedef struct stat64 stat_wrapper_t;
 #endif
 
 // Thin wrapper around an OS-level file.
@@ -0,0 +1,34 @@
+// Copyright 2014 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/files/scoped_file.h"
+
+#include "crbase/logging.h"
+#include "crbase/build_config.h"
+
+#if defined(MINI_CHROMIUM_OS_POSIX)
+#include <errno.h>
+#include <unistd.h>
+
+#include "crbase/posix/eintr_wrapper.h"
+#endif
+
+namespace cr {
+namespace internal {
+
+#if defined(MINI_CHROMIUM_OS_POSIX)
+
+// static
+void ScopedFDCloseTraits::Free(int fd) {
+  // It's important to crash here.
+  // There are security implications to not closing a file descriptor
+  // properly. As file descriptors are "capabilities", keeping them open
+  // would make the current process keep access to a resource.
+  CR_PCHECK(0 == IGNORE_EINTR(close(fd)));
+}
+
+#endif  // MINI_CHROMIUM_OS_POSIX
+
+}  // namespace internal
+}  // namespace cr
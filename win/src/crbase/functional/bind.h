@@ -39,11 +39,13 @@ BindOnce(Functor&& functor, Args&&... args) {
   using PolymorphicInvoke = typename CallbackType::PolymorphicInvoke;
   PolymorphicInvoke invoke_func = &Invoker::RunOnce;
 
+  // A OnceCallback owns its BindState alone, so a small one is stored in the
+  // callback itself instead of on the heap.
   using InvokeFuncStorage = internal::BindStateBase::InvokeFuncStorage;
-  return CallbackType(new BindState(
-      reinterpret_cast<InvokeFuncStorage>(invoke_func),
-      std::forward<Functor>(functor),
-      std::forward<Args>(args)...));
+  return CallbackType(internal::BindStateInPlace<BindState>(),
+                      reinterpret_cast<InvokeFuncStorage>(invoke_func),
+                      std::forward<Functor>(functor),
+                      std::forward<Args>(args)...);
 }
 
 // Bind as RepeatingCallback.
@@ -7,8 +7,10 @@
 
 #include <stddef.h>
 
+#include <new>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 
 #include "crbase/functional/bind_helpers.h"
 #include "crbase/functional/callback_internal.h"
@@ -454,6 +456,16 @@ struct BindingCallbackWithNoArgs<Callback<Signature, copy_mode, repeat_mode>,
   static constexpr bool value = sizeof...(BoundArgs) == 0;
 };
 
+// True if every type in |Types| can be copied with memcpy().
+template <typename... Types>
+struct AreTriviallyCopyable : std::true_type {};
+
+template <typename Type, typename... Types>
+struct AreTriviallyCopyable<Type, Types...>
+    : std::integral_constant<bool,
+                             std::is_trivially_copyable<Type>::value &&
+                                 AreTriviallyCopyable<Types...>::value> {};
+
 // BindState<>
 //
 // This stores all the state passed into Bind().
@@ -481,10 +493,38 @@ struct BindState final : BindStateBase {
                   "base::Callback object");
   }
 
+  // Whether the BindState can be moved, which storing it inline in a
+  // OnceCallback requires.
+  static constexpr bool kIsMovable =
+      std::is_move_constructible<Functor>::value &&
+      std::is_move_constructible<std::tuple<BoundArgs...>>::value;
+
+  // Whether an inline BindState can be moved by copying its bytes, as for a
+  // method bound to Unretained() and plain values.
+  static constexpr bool kIsTriviallyRelocatable =
+      AreTriviallyCopyable<Functor, BoundArgs...>::value;
+
+  // Destroys the BindState stored inline in a callback at |self|, after
+  // moving it to |to| if |to| is non-null.  See CallbackBase.
+  static void ManageInline(BindStateBase* self, void* to) {
+    BindState* state = static_cast<BindState*>(self);
+    if (to)
+      ::new (to) BindState(std::move(*state));
+    state->ReleaseInlineRef();
+    state->~BindState();
+  }
+
   Functor functor_;
   std::tuple<BoundArgs...> bound_args_;
 
  private:
+  BindState(BindState&& other)
+      : BindStateBase(other.polymorphic_invoke_,
+                      other.destructor_,
+                      other.is_cancelled_),
+        functor_(std::move(other.functor_)),
+        bound_args_(std::move(other.bound_args_)) {}
+
   template <typename ForwardFunctor, typename... ForwardBoundArgs>
   explicit BindState(std::true_type,
                      BindStateBase::InvokeFuncStorage invoke_func,
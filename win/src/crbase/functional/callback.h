@@ -51,6 +51,18 @@ class Callback<R(Args...), copy_mode, repeat_mode>
       : internal::CallbackBase<copy_mode>(bind_state) {
   }
 
+  // Builds a BindStateType from |args|, stored inline in the callback when it
+  // is small enough.  Only for callbacks that do not share their BindState.
+  template <typename BindStateType, typename... BindStateArgs>
+  explicit Callback(internal::BindStateInPlace<BindStateType>,
+                    BindStateArgs&&... args)
+      : internal::CallbackBase<copy_mode>(nullptr) {
+    static_assert(copy_mode == internal::CopyMode::MoveOnly,
+                  "Copyable callbacks share their BindState.");
+    this->template EmplaceBindState<BindStateType>(
+        std::forward<BindStateArgs>(args)...);
+  }
+
   template <typename OtherCallback,
             typename = typename std::enable_if<
                 internal::IsCallbackConvertible<OtherCallback, Callback>::value
@@ -78,7 +90,7 @@ class Callback<R(Args...), copy_mode, repeat_mode>
 
     PolymorphicInvoke f =
         reinterpret_cast<PolymorphicInvoke>(this->polymorphic_invoke());
-    return f(this->bind_state_.get(), std::forward<Args>(args)...);
+    return f(this->bind_state(), std::forward<Args>(args)...);
   }
 
   R Run(Args... args) && {
@@ -89,7 +101,7 @@ class Callback<R(Args...), copy_mode, repeat_mode>
     Callback cb = std::move(*this);
     PolymorphicInvoke f =
         reinterpret_cast<PolymorphicInvoke>(cb.polymorphic_invoke());
-    return f(cb.bind_state_.get(), std::forward<Args>(args)...);
+    return f(cb.bind_state(), std::forward<Args>(args)...);
   }
 };
 
@@ -4,6 +4,10 @@
 
 #include "crbase/functional/callback_internal.h"
 
+#include <string.h>
+
+#include <utility>
+
 #include "crbase/logging.h"
 
 namespace cr {
@@ -33,65 +37,127 @@ BindStateBase::BindStateBase(InvokeFuncStorage polymorphic_invoke,
       destructor_(destructor),
       is_cancelled_(is_cancelled) {}
 
-CallbackBase<CopyMode::MoveOnly>::CallbackBase(CallbackBase&& c) = default;
+CallbackBase<CopyMode::MoveOnly>::CallbackBase(CallbackBase&& c)
+    : bind_state_(nullptr),
+      inline_manager_(nullptr) {
+  TakeBindState(&c);
+}
 
 CallbackBase<CopyMode::MoveOnly>&
-CallbackBase<CopyMode::MoveOnly>::operator=(CallbackBase&& c) = default;
+CallbackBase<CopyMode::MoveOnly>::operator=(CallbackBase&& c) {
+  if (this == &c)
+    return *this;
+  // Destroy the previous BindState last, see Reset().
+  CallbackBase previous(std::move(*this));
+  TakeBindState(&c);
+  return *this;
+}
 
 CallbackBase<CopyMode::MoveOnly>::CallbackBase(
     const CallbackBase<CopyMode::Copyable>& c)
-    : bind_state_(c.bind_state_) {}
+    : bind_state_(scoped_refptr<BindStateBase>(c.bind_state_).release()),
+      inline_manager_(nullptr) {
+  CR_DCHECK(!c.inline_manager_);
+}
 
 CallbackBase<CopyMode::MoveOnly>& CallbackBase<CopyMode::MoveOnly>::operator=(
     const CallbackBase<CopyMode::Copyable>& c) {
-  bind_state_ = c.bind_state_;
+  CR_DCHECK(!c.inline_manager_);
+  CallbackBase previous(std::move(*this));
+  bind_state_ = scoped_refptr<BindStateBase>(c.bind_state_).release();
   return *this;
 }
 
 CallbackBase<CopyMode::MoveOnly>::CallbackBase(
     CallbackBase<CopyMode::Copyable>&& c)
-    : bind_state_(std::move(c.bind_state_)) {}
+    : bind_state_(nullptr),
+      inline_manager_(nullptr) {
+  CR_DCHECK(!c.inline_manager_);
+  TakeBindState(&c);
+}
 
 CallbackBase<CopyMode::MoveOnly>& CallbackBase<CopyMode::MoveOnly>::operator=(
     CallbackBase<CopyMode::Copyable>&& c) {
-  bind_state_ = std::move(c.bind_state_);
+  CR_DCHECK(!c.inline_manager_);
+  CallbackBase previous(std::move(*this));
+  TakeBindState(&c);
   return *this;
 }
 
 void CallbackBase<CopyMode::MoveOnly>::Reset() {
-  // NULL the bind_state_ last, since it may be holding the last ref to whatever
-  // object owns us, and we may be deleted after that.
-  bind_state_ = nullptr;
+  // Destroy the BindState last, since it may be holding the last ref to
+  // whatever object owns us, and we may be deleted after that.  An inline
+  // BindState is moved out of this callback first for the same reason.
+  CallbackBase previous(std::move(*this));
 }
 
 bool CallbackBase<CopyMode::MoveOnly>::IsCancelled() const {
-  CR_DCHECK(bind_state_);
-  return bind_state_->IsCancelled();
+  CR_DCHECK(!is_null());
+  return bind_state()->IsCancelled();
 }
 
 bool CallbackBase<CopyMode::MoveOnly>::EqualsInternal(
     const CallbackBase& other) const {
-  return bind_state_ == other.bind_state_;
+  // An inline BindState is never shared, so its callback only equals itself.
+  return bind_state() == other.bind_state();
 }
 
 CallbackBase<CopyMode::MoveOnly>::CallbackBase(BindStateBase* bind_state)
-    : bind_state_(bind_state ? AdoptRef(bind_state) : nullptr) {
-  CR_DCHECK(!bind_state_.get() || bind_state_->HasOneRef());
+    : bind_state_(bind_state ? AdoptRef(bind_state).release() : nullptr),
+      inline_manager_(nullptr) {
+  CR_DCHECK(!bind_state_ || bind_state_->HasOneRef());
+}
+
+CallbackBase<CopyMode::MoveOnly>::~CallbackBase() {
+  if (inline_manager_)
+    inline_manager_(inline_bind_state(), nullptr);
+  else if (bind_state_)
+    bind_state_->Release();
 }
 
-CallbackBase<CopyMode::MoveOnly>::~CallbackBase() {}
+void CallbackBase<CopyMode::MoveOnly>::TakeBindState(CallbackBase* c) {
+  CR_DCHECK(is_null());
+  inline_manager_ = c->inline_manager_;
+  if (!inline_manager_) {
+    bind_state_ = c->bind_state_;
+    c->bind_state_ = nullptr;
+    return;
+  }
+
+  if (inline_manager_ == &DestroyTriviallyRelocatable) {
+    memcpy(inline_storage_.void_data(), c->inline_storage_.void_data(),
+           kInlineBindStateSize);
+  } else {
+    inline_manager_(c->inline_bind_state(), inline_storage_.void_data());
+  }
+  c->inline_manager_ = nullptr;
+  c->bind_state_ = nullptr;
+}
+
+// static
+void CallbackBase<CopyMode::MoveOnly>::DestroyTriviallyRelocatable(
+    BindStateBase* state,
+    void* to) {
+  CR_DCHECK(!to);
+  state->ReleaseInlineRef();
+  state->~BindStateBase();
+}
 
 CallbackBase<CopyMode::Copyable>::CallbackBase(
     const CallbackBase& c)
     : CallbackBase<CopyMode::MoveOnly>(nullptr) {
-  bind_state_ = c.bind_state_;
+  bind_state_ = scoped_refptr<BindStateBase>(c.bind_state_).release();
 }
 
 CallbackBase<CopyMode::Copyable>::CallbackBase(CallbackBase&& c) = default;
 
 CallbackBase<CopyMode::Copyable>&
 CallbackBase<CopyMode::Copyable>::operator=(const CallbackBase& c) {
-  bind_state_ = c.bind_state_;
+  // Take the new reference first so that self assignment works.
+  BindStateBase* previous = bind_state_;
+  bind_state_ = scoped_refptr<BindStateBase>(c.bind_state_).release();
+  if (previous)
+    previous->Release();
   return *this;
 }
 
@@ -8,9 +8,18 @@
 #ifndef MINI_CHROMIUM_CRBASE_FUNCTIONAL_CALLBACK_INTERNAL_H_
 #define MINI_CHROMIUM_CRBASE_FUNCTIONAL_CALLBACK_INTERNAL_H_
 
+#include <stddef.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
 #include "crbase/base_export.h"
 #include "crbase/functional/callback_forward.h"
+#include "crbase/logging.h"
 #include "crbase/macros.h"
+#include "crbase/memory/aligned_memory.h"
+#include "crbase/memory/pool_allocator.h"
 #include "crbase/memory/ref_counted.h"
 
 namespace cr {
@@ -52,6 +61,14 @@ class CRBASE_EXPORT BindStateBase
   BindStateBase(const BindStateBase&) = delete;
   BindStateBase& operator=(const BindStateBase&) = delete;
 
+  // BindStates are allocated from the pools of PoolAlloc(), since one is
+  // created for nearly every posted task.  The BindState is deleted through
+  // its own type by |destructor_|, so the size passed here is the right one.
+  static void* operator new(size_t size) { return PoolAlloc(size); }
+  static void operator delete(void* block, size_t size) {
+    PoolFree(block, size);
+  }
+
  private:
   BindStateBase(InvokeFuncStorage polymorphic_invoke,
                 void (*destructor)(const BindStateBase*));
@@ -76,6 +93,13 @@ class CRBASE_EXPORT BindStateBase
     return is_cancelled_(this);
   }
 
+  // Drops the only reference of a BindState stored inline in a callback,
+  // which is destroyed in place rather than deleted.
+  void ReleaseInlineRef() const {
+    if (!subtle::RefCountedThreadSafeBase::Release())
+      CR_NOTREACHED();
+  }
+
   // In C++, it is safe to cast function pointers to function pointers of
   // another type. It is not okay to use void*. We create a InvokeFuncStorage
   // that that can store our function pointer, and then cast it back to
@@ -89,6 +113,26 @@ class CRBASE_EXPORT BindStateBase
   ///DISALLOW_COPY_AND_ASSIGN(BindStateBase);
 };
 
+// A OnceCallback stores its BindState in the callback object itself, rather
+// than on the heap, when it is at most this large.  That is enough for a
+// method bound to an Unretained() or scoped_refptr receiver, or a function
+// with one pointer-sized argument, and keeps the callback at 8 pointers, one
+// cache line on 64-bit builds.  Methods bound to a WeakPtr go to the heap.
+const size_t kInlineBindStateSize = 7 * sizeof(void*);
+const size_t kInlineBindStateAlignment = 8;
+
+template <typename BindStateType>
+struct CanStoreBindStateInline
+    : std::integral_constant<
+          bool,
+          sizeof(BindStateType) <= kInlineBindStateSize &&
+          alignof(BindStateType) <= kInlineBindStateAlignment &&
+          BindStateType::kIsMovable> {};
+
+// Tag selecting the Callback constructor that builds the BindState in place.
+template <typename BindStateType>
+struct BindStateInPlace {};
+
 // Holds the Callback methods that don't require specialization to reduce
 // template bloat.
 // CallbackBase<MoveOnly> is a direct base class of MoveOnly callbacks, and
@@ -106,7 +150,7 @@ class CRBASE_EXPORT CallbackBase<CopyMode::MoveOnly> {
   CallbackBase& operator=(CallbackBase<CopyMode::Copyable>&& c);
 
   // Returns true if Callback is null (doesn't refer to anything).
-  bool is_null() const { return !bind_state_; }
+  bool is_null() const { return !inline_manager_ && !bind_state_; }
   explicit operator bool() const { return !is_null(); }
 
   // Returns true if the callback invocation will be nop due to an cancellation.
@@ -119,6 +163,10 @@ class CRBASE_EXPORT CallbackBase<CopyMode::MoveOnly> {
  protected:
   using InvokeFuncStorage = BindStateBase::InvokeFuncStorage;
 
+  // Destroys the BindState stored inline at |state|, after moving it to |to|
+  // if |to| is non-null.
+  using InlineManager = void (*)(BindStateBase* state, void* to);
+
   // Returns true if this callback equals |other|. |other| may be null.
   bool EqualsInternal(const CallbackBase& other) const;
 
@@ -126,8 +174,22 @@ class CRBASE_EXPORT CallbackBase<CopyMode::MoveOnly> {
   // initialization of the scoped_refptr.
   explicit CallbackBase(BindStateBase* bind_state);
 
+  // Builds a BindStateType from |args|, inline when it fits and on the heap
+  // otherwise.  The callback must be null.
+  template <typename BindStateType, typename... BindStateArgs>
+  void EmplaceBindState(BindStateArgs&&... args) {
+    CR_DCHECK(is_null());
+    EmplaceBindStateImpl<BindStateType>(
+        CanStoreBindStateInline<BindStateType>(),
+        std::forward<BindStateArgs>(args)...);
+  }
+
+  BindStateBase* bind_state() const {
+    return inline_manager_ ? inline_bind_state() : bind_state_;
+  }
+
   InvokeFuncStorage polymorphic_invoke() const {
-    return bind_state_->polymorphic_invoke_;
+    return bind_state()->polymorphic_invoke_;
   }
 
   // Force the destructor to be instantiated inside this translation unit so
@@ -135,7 +197,50 @@ class CRBASE_EXPORT CallbackBase<CopyMode::MoveOnly> {
   // bloat.
   ~CallbackBase();
 
-  scoped_refptr<BindStateBase> bind_state_;
+  union {
+    // The BindState when it is on the heap, holding one reference.  Copyable
+    // callbacks share their BindState, so they always keep it there.
+    BindStateBase* bind_state_;
+
+    // The BindState when |inline_manager_| is set.
+    AlignedMemory<kInlineBindStateSize, kInlineBindStateAlignment>
+        inline_storage_;
+  };
+
+  // Set when the BindState is stored in |inline_storage_|.
+  InlineManager inline_manager_;
+
+ private:
+  template <typename BindStateType, typename... BindStateArgs>
+  void EmplaceBindStateImpl(std::true_type, BindStateArgs&&... args) {
+    // The class-specific operator new of BindStateBase hides placement new.
+    BindStateType* state = ::new (inline_storage_.void_data())
+        BindStateType(std::forward<BindStateArgs>(args)...);
+    CR_DCHECK_EQ(static_cast<void*>(static_cast<BindStateBase*>(state)),
+                 inline_storage_.void_data());
+    inline_manager_ = BindStateType::kIsTriviallyRelocatable
+                          ? &DestroyTriviallyRelocatable
+                          : &BindStateType::ManageInline;
+  }
+
+  template <typename BindStateType, typename... BindStateArgs>
+  void EmplaceBindStateImpl(std::false_type, BindStateArgs&&... args) {
+    bind_state_ = AdoptRef(
+        new BindStateType(std::forward<BindStateArgs>(args)...)).release();
+  }
+
+  // The InlineManager of BindStates whose bound values can be moved by
+  // copying their bytes.  Moves of those callbacks copy |inline_storage_|
+  // instead of calling it, so it only destroys.
+  static void DestroyTriviallyRelocatable(BindStateBase* state, void* to);
+
+  BindStateBase* inline_bind_state() const {
+    return static_cast<BindStateBase*>(
+        const_cast<void*>(inline_storage_.void_data()));
+  }
+
+  // Moves the BindState of |c| to this callback, which must be null.
+  void TakeBindState(CallbackBase* c);
 };
 
 // CallbackBase<Copyable> is a direct base class of Copyable Callbacks.
@@ -319,10 +319,17 @@ const LogSeverity LOG_0 = LOG_ERROR;
 #define CR_SYSLOG_ASSERT(condition)                                          \
   CR_SYSLOG_IF(FATAL, !(condition)) << "Assert failed: " #condition ". "
 
+#if defined(MINI_CHROMIUM_OS_WIN)
 #define CR_PLOG_STREAM(severity)                                             \
   COMPACT_CR_LOG_EX_##severity(Win32ErrorLogMessage,                         \
                                cr_logging::GetLastSystemErrorCode())         \
       .stream()
+#elif defined(MINI_CHROMIUM_OS_POSIX)
+#define CR_PLOG_STREAM(severity)                                             \
+  COMPACT_CR_LOG_EX_##severity(ErrnoLogMessage,                              \
+                               cr_logging::GetLastSystemErrorCode())         \
+      .stream()
+#endif
 
 #define CR_PLOG(severity)                                                    \
   CR_LAZY_STREAM(CR_PLOG_STREAM(severity), CR_LOG_IS_ON(severity))
@@ -0,0 +1,181 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/memory/arena.h"
+
+#include <algorithm>
+
+#include "crbase/memory/aligned_memory.h"
+
+namespace cr {
+
+namespace {
+
+const size_t kChunkAlignment = 16;
+
+uintptr_t AlignUp(uintptr_t value, size_t alignment) {
+  return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+}
+
+}  // namespace
+
+struct Arena::Chunk {
+  Chunk* next;
+  size_t size;  // Including the header.
+};
+
+struct Arena::Destructor {
+  void (*destroy)(void*);
+  void* object;
+  Destructor* next;
+};
+
+// The allocations of a chunk start after its header, at kChunkAlignment.
+const size_t Arena::kChunkHeaderSize =
+    (sizeof(Arena::Chunk) + kChunkAlignment - 1) & ~(kChunkAlignment - 1);
+
+const size_t Arena::kDefaultAlignment;
+const size_t Arena::kDefaultChunkSize;
+const size_t Arena::kMaxChunkSize;
+
+Arena::Arena() : Arena(kDefaultChunkSize) {
+}
+
+Arena::Arena(size_t first_chunk_size)
+    : first_chunk_size_(first_chunk_size),
+      next_chunk_size_(first_chunk_size),
+      chunks_(nullptr),
+      position_(nullptr),
+      end_(nullptr),
+      destructors_(nullptr),
+      bytes_allocated_(0),
+      bytes_reserved_(0) {
+  CR_DCHECK_GT(first_chunk_size, 0U);
+}
+
+Arena::~Arena() {
+  RunDestructors();
+  while (chunks_) {
+    Chunk* chunk = chunks_;
+    chunks_ = chunk->next;
+    AlignedFree(chunk);
+  }
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  CR_DCHECK(alignment && !(alignment & (alignment - 1)));
+  uintptr_t address =
+      AlignUp(reinterpret_cast<uintptr_t>(position_), alignment);
+  if (!position_ || address > reinterpret_cast<uintptr_t>(end_) ||
+      size > reinterpret_cast<uintptr_t>(end_) - address) {
+    // Allocations larger than a quarter of a chunk get a chunk of their own,
+    // so the rest of the current chunk is not given up for them.  Arenas
+    // with small first chunks grow them to kDefaultChunkSize first.
+    if (size > std::max(next_chunk_size_, kDefaultChunkSize) / 4)
+      return AllocateInOwnChunk(size, alignment);
+    AddChunk(size, alignment);
+    address = AlignUp(reinterpret_cast<uintptr_t>(position_), alignment);
+  }
+
+  char* result = reinterpret_cast<char*>(address);
+  bytes_allocated_ += (result + size) - position_;
+  position_ = result + size;
+  return result;
+}
+
+void Arena::RegisterDestructor(void* object, void (*destroy)(void*)) {
+  Destructor* destructor = static_cast<Destructor*>(
+      Allocate(sizeof(Destructor), alignof(Destructor)));
+  destructor->destroy = destroy;
+  destructor->object = object;
+  destructor->next = destructors_;
+  destructors_ = destructor;
+}
+
+void Arena::Reset() {
+  RunDestructors();
+
+  // Keep the largest chunk, unless it was made for an allocation larger than
+  // kMaxChunkSize.
+  Chunk* kept = nullptr;
+  while (chunks_) {
+    Chunk* chunk = chunks_;
+    chunks_ = chunk->next;
+    if (chunk->size - kChunkHeaderSize <= kMaxChunkSize &&
+        (!kept || chunk->size > kept->size)) {
+      std::swap(chunk, kept);
+    }
+    if (chunk)
+      AlignedFree(chunk);
+  }
+
+  chunks_ = kept;
+  bytes_allocated_ = 0;
+  if (kept) {
+    kept->next = nullptr;
+    position_ = reinterpret_cast<char*>(kept) + kChunkHeaderSize;
+    end_ = reinterpret_cast<char*>(kept) + kept->size;
+    bytes_reserved_ = kept->size;
+  } else {
+    position_ = nullptr;
+    end_ = nullptr;
+    bytes_reserved_ = 0;
+    next_chunk_size_ = first_chunk_size_;
+  }
+}
+
+void Arena::AddChunk(size_t size, size_t alignment) {
+  // Room for |size| bytes however the chunk start is aligned.
+  CR_CHECK_LE(size, SIZE_MAX - alignment - kChunkHeaderSize);
+  Chunk* chunk = NewChunk(std::max(next_chunk_size_, size + alignment));
+  if (next_chunk_size_ < kMaxChunkSize)
+    next_chunk_size_ = std::min(next_chunk_size_ * 2, kMaxChunkSize);
+
+  chunk->next = chunks_;
+  chunks_ = chunk;
+
+  // The end of the previous chunk is given up.
+  position_ = reinterpret_cast<char*>(chunk) + kChunkHeaderSize;
+  end_ = reinterpret_cast<char*>(chunk) + chunk->size;
+}
+
+void* Arena::AllocateInOwnChunk(size_t size, size_t alignment) {
+  CR_CHECK_LE(size, SIZE_MAX - alignment - kChunkHeaderSize);
+  Chunk* chunk = NewChunk(size + alignment);
+
+  // Linked behind the current chunk, which later allocations keep using.
+  if (chunks_) {
+    chunk->next = chunks_->next;
+    chunks_->next = chunk;
+  } else {
+    chunk->next = nullptr;
+    chunks_ = chunk;
+  }
+
+  char* data = reinterpret_cast<char*>(chunk) + kChunkHeaderSize;
+  char* result = reinterpret_cast<char*>(
+      AlignUp(reinterpret_cast<uintptr_t>(data), alignment));
+  bytes_allocated_ += (result + size) - data;
+  return result;
+}
+
+Arena::Chunk* Arena::NewChunk(size_t data_size) {
+  CR_CHECK_LE(data_size, SIZE_MAX - kChunkHeaderSize);
+  Chunk* chunk = static_cast<Chunk*>(
+      AlignedAlloc(kChunkHeaderSize + data_size, kChunkAlignment));
+  chunk->next = nullptr;
+  chunk->size = kChunkHeaderSize + data_size;
+  bytes_reserved_ += chunk->size;
+  return chunk;
+}
+
+void Arena::RunDestructors() {
+  while (destructors_) {
+    Destructor* destructor = destructors_;
+    destructors_ = destructor->next;
+    destructor->destroy(destructor->object);
+  }
+}
+
+}  // namespace cr
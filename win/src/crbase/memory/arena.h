@@ -0,0 +1,186 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// An Arena hands out memory by bumping a pointer through chunks allocated
+// with AlignedAlloc(), and frees it all at once when it is reset or destroyed.
+// It suits the object graphs built for one request and dropped together, such
+// as parsed messages or Value trees:
+//
+//   Arena arena;
+//   Foo* foo = arena.New<Foo>(1, 2);  // ~Foo() runs when |arena| is reset.
+//   std::vector<int, ArenaAllocator<int>> ints{ArenaAllocator<int>(&arena)};
+//   ints.push_back(3);
+//
+// Objects with a non-trivial destructor created by New() have it run on
+// Reset() or destruction, in reverse order of creation.  Memory from
+// Allocate() is never freed individually.  An Arena is not thread-safe.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MEMORY_ARENA_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MEMORY_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "crbase/base_export.h"
+#include "crbase/logging.h"
+
+namespace cr {
+
+class CRBASE_EXPORT Arena {
+ public:
+  // Alignment of Allocate() when none is given, enough for any scalar type.
+  static const size_t kDefaultAlignment = 16;
+
+  // Size of the first chunk when none is given.  Chunks double in size up to
+  // kMaxChunkSize.  An allocation that does not fit the current chunk and is
+  // larger than a quarter of the next one, or of kDefaultChunkSize, gets a
+  // chunk of its own size instead.
+  static const size_t kDefaultChunkSize = 4096;
+  static const size_t kMaxChunkSize = 1024 * 1024;
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  Arena();
+  explicit Arena(size_t first_chunk_size);
+  ~Arena();
+
+  // Returns |size| bytes aligned to |alignment|, a power of two.  Never
+  // returns null.
+  void* Allocate(size_t size, size_t alignment = kDefaultAlignment);
+
+  // Constructs a T in the arena.  Its destructor, unless trivial, runs when
+  // the arena is reset or destroyed.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    void* memory = Allocate(sizeof(T), alignof(T));
+    T* object = ::new (memory) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value)
+      RegisterDestructor(object, &DestroyObject<T>);
+    return object;
+  }
+
+  // Returns uninitialized storage for |count| objects of trivial type T.
+  template <typename T>
+  T* NewArray(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "NewArray() does not run destructors.");
+    CR_CHECK_LE(count, SIZE_MAX / sizeof(T));
+    return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Runs |destroy|(|object|) when the arena is reset or destroyed.
+  void RegisterDestructor(void* object, void (*destroy)(void*));
+
+  // Runs the registered destructors and frees everything allocated so far.
+  // The largest chunk is kept for the next allocations.
+  void Reset();
+
+  // Bytes handed out by Allocate() since the last Reset(), padding included.
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+  // Bytes of the chunks currently held.
+  size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  struct Chunk;
+  struct Destructor;
+
+  static const size_t kChunkHeaderSize;
+
+  template <typename T>
+  static void DestroyObject(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  // Starts a new chunk that can hold |size| bytes aligned to |alignment|.
+  void AddChunk(size_t size, size_t alignment);
+
+  // Allocates |size| bytes in a chunk of their own, keeping the current
+  // chunk for the next allocations.
+  void* AllocateInOwnChunk(size_t size, size_t alignment);
+
+  // Allocates a chunk with |data_size| bytes after its header.
+  Chunk* NewChunk(size_t data_size);
+
+  void RunDestructors();
+
+  const size_t first_chunk_size_;
+  size_t next_chunk_size_;
+
+  // Most recent chunk first.  Allocation bumps |position_| towards |end_| in
+  // the first chunk.
+  Chunk* chunks_;
+  char* position_;
+  char* end_;
+
+  // Most recently registered first.
+  Destructor* destructors_;
+
+  size_t bytes_allocated_;
+  size_t bytes_reserved_;
+};
+
+// Resets |arena| when going out of scope, e.g. at the end of handling a
+// request:
+//
+//   void Server::HandleRequest(const Request& request) {
+//     ScopedArenaReset reset(&arena_);
+//     ...
+//   }
+class ScopedArenaReset {
+ public:
+  ScopedArenaReset(const ScopedArenaReset&) = delete;
+  ScopedArenaReset& operator=(const ScopedArenaReset&) = delete;
+
+  explicit ScopedArenaReset(Arena* arena) : arena_(arena) {}
+  ~ScopedArenaReset() { arena_->Reset(); }
+
+ private:
+  Arena* arena_;
+};
+
+// An STL allocator allocating from an Arena.  Deallocation does nothing; the
+// memory is reclaimed when the arena is reset, which the container must not
+// outlive.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t count) {
+    CR_CHECK_LE(count, SIZE_MAX / sizeof(T));
+    return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return !(a == b);
+}
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MEMORY_ARENA_H_
@@ -0,0 +1,172 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/memory/pool_allocator.h"
+
+#include <stdlib.h>
+
+#include "crbase/lazy_instance.h"
+#include "crbase/logging.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/threading/thread_cache_slot.h"
+
+namespace cr {
+
+namespace {
+
+const size_t kSizeClassCount = kPoolMaxSize / kPoolGranularity;
+
+// Size of the slabs blocks are carved from.
+const size_t kSlabSize = 16 * 1024;
+
+// Number of blocks moved at once between a thread cache and the central list.
+const size_t kTransferCount = 32;
+
+// A thread cache gives blocks back to the central list above this count.
+const size_t kMaxCachedBlocks = 2 * kTransferCount;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  FreeBlock* head;
+  size_t count;
+};
+
+size_t SizeClassIndex(size_t size) {
+  return size ? (size - 1) / kPoolGranularity : 0;
+}
+
+size_t SizeClassBlockSize(size_t index) {
+  return (index + 1) * kPoolGranularity;
+}
+
+// Moves up to |count| blocks from the front of |from| to the front of |to|.
+void TransferBlocks(FreeList* from, FreeList* to, size_t count) {
+  while (count-- && from->head) {
+    FreeBlock* block = from->head;
+    from->head = block->next;
+    --from->count;
+    block->next = to->head;
+    to->head = block;
+    ++to->count;
+  }
+}
+
+// The lists shared by all threads, one per size class.
+class CentralCache {
+ public:
+  CentralCache() {
+    for (size_t i = 0; i < kSizeClassCount; ++i) {
+      lists_[i].head = nullptr;
+      lists_[i].count = 0;
+    }
+  }
+
+  // Moves kTransferCount blocks of size class |index| to |list|, carving a
+  // new slab if needed.
+  void Refill(size_t index, FreeList* list) {
+    AutoLock lock(locks_[index]);
+    if (!lists_[index].head)
+      CarveSlab(index);
+    TransferBlocks(&lists_[index], list, kTransferCount);
+  }
+
+  // Takes back up to |count| blocks of size class |index| from |list|.
+  void Release(size_t index, FreeList* list, size_t count) {
+    AutoLock lock(locks_[index]);
+    TransferBlocks(list, &lists_[index], count);
+  }
+
+ private:
+  void CarveSlab(size_t index) {
+    locks_[index].AssertAcquired();
+    const size_t block_size = SizeClassBlockSize(index);
+    char* slab = static_cast<char*>(malloc(kSlabSize));
+    CR_CHECK(slab);
+    for (size_t offset = 0; offset + block_size <= kSlabSize;
+         offset += block_size) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + offset);
+      block->next = lists_[index].head;
+      lists_[index].head = block;
+      ++lists_[index].count;
+    }
+  }
+
+  Lock locks_[kSizeClassCount];
+  FreeList lists_[kSizeClassCount];
+};
+
+LazyInstance<CentralCache>::Leaky g_central_cache =
+    CR_LAZY_INSTANCE_INITIALIZER;
+
+// The free blocks cached by one thread.  They go back to the central lists
+// when the thread exits.
+struct ThreadCache {
+  ThreadCache() {
+    for (size_t i = 0; i < kSizeClassCount; ++i) {
+      lists[i].head = nullptr;
+      lists[i].count = 0;
+    }
+  }
+
+  ~ThreadCache() {
+    for (size_t i = 0; i < kSizeClassCount; ++i)
+      g_central_cache.Pointer()->Release(i, &lists[i], lists[i].count);
+  }
+
+  FreeList lists[kSizeClassCount];
+};
+
+LazyInstance<ThreadCacheSlot<ThreadCache>>::Leaky g_thread_cache_slot =
+    CR_LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+void* PoolAlloc(size_t size) {
+  if (size > kPoolMaxSize)
+    return ::operator new(size);
+
+  const size_t index = SizeClassIndex(size);
+  ThreadCache* cache = g_thread_cache_slot.Pointer()->GetOrCreate();
+  FreeList* list = &cache->lists[index];
+  if (!list->head)
+    g_central_cache.Pointer()->Refill(index, list);
+
+  FreeBlock* block = list->head;
+  list->head = block->next;
+  --list->count;
+  return block;
+}
+
+void PoolFree(void* block, size_t size) {
+  if (!block)
+    return;
+  if (size > kPoolMaxSize) {
+    ::operator delete(block);
+    return;
+  }
+
+  const size_t index = SizeClassIndex(size);
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+
+  // Threads that are exiting, or never allocated, give the block straight
+  // back to the central list.
+  ThreadCache* cache = g_thread_cache_slot.Pointer()->Get();
+  if (!cache) {
+    FreeList list = { free_block, 1 };
+    free_block->next = nullptr;
+    g_central_cache.Pointer()->Release(index, &list, 1);
+    return;
+  }
+
+  FreeList* list = &cache->lists[index];
+  free_block->next = list->head;
+  list->head = free_block;
+  if (++list->count > kMaxCachedBlocks)
+    g_central_cache.Pointer()->Release(index, list, kTransferCount);
+}
+
+}  // namespace cr
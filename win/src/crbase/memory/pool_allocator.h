@@ -0,0 +1,49 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// PoolAlloc() and PoolFree() serve the small, short-lived objects created for
+// every posted task (BindStates, queue nodes) from size-class pools instead of
+// the general purpose heap.
+//
+// Each thread keeps a cache of free blocks per size class, so that most
+// allocations and frees are a few instructions on a thread-local free list.
+// The caches exchange blocks in batches with central per size-class lists
+// protected by a lock, so memory freed on the thread that runs a task can be
+// reused by the thread that posts the next one.  Blocks are carved out of
+// slabs that are never returned to the system.
+//
+// The caller must pass the size of the allocation back to PoolFree(), which
+// lets classes use the pools through a class-specific sized operator delete:
+//
+//   class Node {
+//    public:
+//     static void* operator new(size_t size) { return PoolAlloc(size); }
+//     static void operator delete(void* p, size_t size) { PoolFree(p, size); }
+//   };
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MEMORY_POOL_ALLOCATOR_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MEMORY_POOL_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include "crbase/base_export.h"
+
+namespace cr {
+
+// Sizes are rounded up to a multiple of kPoolGranularity.  Larger allocations
+// than kPoolMaxSize are passed to operator new.
+const size_t kPoolGranularity = 16;
+const size_t kPoolMaxSize = 256;
+
+// Returns a block of at least |size| bytes, aligned like malloc() for objects
+// of that size.  Never returns null.
+CRBASE_EXPORT void* PoolAlloc(size_t size);
+
+// Frees |block|, which was returned by PoolAlloc(|size|).  May be called on
+// any thread.
+CRBASE_EXPORT void PoolFree(void* block, size_t size);
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MEMORY_POOL_ALLOCATOR_H_
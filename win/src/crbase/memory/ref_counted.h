@@ -465,6 +465,14 @@ class scoped_refptr {
 
   T* get() const { return ptr_; }
 
+  // Returns the pointer and gives up its reference without releasing it.  The
+  // caller takes over that reference.
+  T* release() {
+    T* ptr = ptr_;
+    ptr_ = nullptr;
+    return ptr;
+  }
+
   T& operator*() const {
     assert(ptr_ != nullptr);
     return *ptr_;
@@ -0,0 +1,79 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/memory/ref_counted_biased.h"
+
+#include "crbase/functional/bind.h"
+#include "crbase/threading/single_thread_task_runner.h"
+#include "crbase/threading/thread_task_runner_handle.h"
+#include "crbase/tracing/location.h"
+
+namespace cr {
+namespace subtle {
+
+const int32_t RefCountedBiasedBase::kMerged;
+const int32_t RefCountedBiasedBase::kMergeQueued;
+const int32_t RefCountedBiasedBase::kSharedOne;
+
+RefCountedBiasedBase::RefCountedBiasedBase()
+    : owner_thread_id_(kInvalidThreadId), biased_count_(0), shared_(kMerged) {
+  if (ThreadTaskRunnerHandle::IsSet()) {
+    owner_task_runner_ = ThreadTaskRunnerHandle::Get();
+    owner_thread_id_.store(PlatformThread::CurrentId(),
+                           std::memory_order_relaxed);
+    shared_.store(0, std::memory_order_relaxed);
+  }
+}
+
+RefCountedBiasedBase::~RefCountedBiasedBase() {
+  CR_DCHECK(shared_.load(std::memory_order_relaxed) & kMerged)
+      << "RefCountedBiased object deleted without calling Release()";
+}
+
+void RefCountedBiasedBase::PostMerge(
+    void (*merge_and_release)(const RefCountedBiasedBase*)) const {
+  // |this| holds the reference taken by ReleaseShared() for the task.
+  owner_task_runner_->PostTask(CR_FROM_HERE,
+                               BindOnce(merge_and_release, this));
+}
+
+bool RefCountedBiasedBase::Merge() const {
+  if (owner_thread_id_.load(std::memory_order_relaxed) == kInvalidThreadId)
+    return false;
+  CR_DCHECK(IsOwnerThread());
+
+  owner_thread_id_.store(kInvalidThreadId, std::memory_order_relaxed);
+  int32_t previous = shared_.fetch_add(biased_count_ * kSharedOne + kMerged,
+                                       std::memory_order_acq_rel);
+  CR_DCHECK(!(previous & kMerged));
+  int32_t count = SharedCount(previous) + biased_count_;
+  biased_count_ = 0;
+  CR_DCHECK_GE(count, 0);
+  return count == 0;
+}
+
+bool RefCountedBiasedBase::ReleaseShared(bool* merge_needed) const {
+  int32_t previous = shared_.load(std::memory_order_relaxed);
+  int32_t desired;
+  do {
+    desired = previous - kSharedOne;
+    // The owner may hold no reference anymore, so this may have been the last
+    // one.  Keep the reference for the merge task instead of dropping it, so
+    // that the object stays alive until the task runs.
+    if (!(previous & (kMerged | kMergeQueued)) && SharedCount(desired) <= 0)
+      desired = previous | kMergeQueued;
+  } while (!shared_.compare_exchange_weak(previous, desired,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+
+  if (previous & kMerged) {
+    CR_DCHECK_GE(SharedCount(desired), 0);
+    return SharedCount(desired) == 0;
+  }
+  *merge_needed = !(previous & kMergeQueued) && (desired & kMergeQueued);
+  return false;
+}
+
+}  // namespace subtle
+}  // namespace cr
@@ -0,0 +1,172 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MEMORY_REF_COUNTED_BIASED_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MEMORY_REF_COUNTED_BIASED_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "crbase/base_export.h"
+#include "crbase/memory/ref_counted.h"
+#include "crbase/threading/platform_thread.h"
+
+namespace cr {
+
+class SingleThreadTaskRunner;
+
+namespace subtle {
+
+// Biased reference counting: the thread that creates the object (its owner)
+// counts its AddRef() and Release() calls in a plain integer, and only other
+// threads pay for atomic operations on a shared count.  The object's count is
+// the sum of both.
+//
+// The two counts are merged on the owner thread, after which every thread
+// uses the shared count only:
+//  - when the owner's count drops to zero, or
+//  - when the shared count drops to zero or below on another thread, which
+//    means that thread may have released the last reference.  The merge is
+//    then posted to the owner's task runner.
+// The object can only be deleted once merged.
+class CRBASE_EXPORT RefCountedBiasedBase {
+ public:
+  RefCountedBiasedBase(const RefCountedBiasedBase&) = delete;
+  RefCountedBiasedBase& operator=(const RefCountedBiasedBase&) = delete;
+
+ protected:
+  RefCountedBiasedBase();
+  ~RefCountedBiasedBase();
+
+  void AddRef() const {
+    if (IsOwnerThread())
+      ++biased_count_;
+    else
+      shared_.fetch_add(kSharedOne, std::memory_order_relaxed);
+  }
+
+  // Returns true if the object should self-delete.  Sets |*merge_needed| if
+  // the caller must call PostMerge().
+  bool Release(bool* merge_needed) const {
+    *merge_needed = false;
+    if (IsOwnerThread()) {
+      CR_DCHECK_GT(biased_count_, 0);
+      if (--biased_count_)
+        return false;
+      return Merge();
+    }
+    return ReleaseShared(merge_needed);
+  }
+
+  // Posts |merge_and_release|(this) to the owner thread.  It must call
+  // Merge(), then Release() to drop the reference held for the task.
+  void PostMerge(
+      void (*merge_and_release)(const RefCountedBiasedBase*)) const;
+
+  // Folds the owner's count into the shared count, unless already done.
+  // Called on the owner thread.  Returns true if the object should
+  // self-delete.
+  bool Merge() const;
+
+ private:
+  // The shared count is kept in the high bits of |shared_|.
+  static const int32_t kMerged = 1;
+  static const int32_t kMergeQueued = 2;
+  static const int32_t kSharedOne = 4;
+
+  static int32_t SharedCount(int32_t shared) {
+    return (shared & ~(kMerged | kMergeQueued)) / kSharedOne;
+  }
+
+  // Relies on PlatformThread::CurrentId() being a cheap thread-local read,
+  // as GetCurrentThreadId() is.
+  bool IsOwnerThread() const {
+    return owner_thread_id_.load(std::memory_order_relaxed) ==
+           PlatformThread::CurrentId();
+  }
+
+  bool ReleaseShared(bool* merge_needed) const;
+
+  // kInvalidThreadId once merged.  Only written by the owner thread.
+  mutable std::atomic<PlatformThreadId> owner_thread_id_;
+
+  // Only accessed on the owner thread.
+  mutable int biased_count_;
+
+  mutable std::atomic<int32_t> shared_;
+
+  // Where merges are posted.  Objects created on a thread without a task
+  // runner start merged.
+  scoped_refptr<SingleThreadTaskRunner> owner_task_runner_;
+};
+
+}  // namespace subtle
+
+template <class T, typename Traits> class RefCountedBiased;
+
+// Default traits for RefCountedBiased<T>.  Deletes the object when its ref
+// count reaches 0.
+template <typename T>
+struct DefaultRefCountedBiasedTraits {
+  static void Destruct(const T* x) {
+    RefCountedBiased<T, DefaultRefCountedBiasedTraits>::DeleteInternal(x);
+  }
+};
+
+//
+// A variant of RefCountedThreadSafe<T> for objects referenced mostly on the
+// thread that creates them, such as IOBuffers: AddRef() and Release() on that
+// thread use no atomic operation.
+//
+//   class MyFoo : public cr::RefCountedBiased<MyFoo> {
+//    ...
+//    private:
+//     friend class cr::RefCountedBiased<MyFoo>;
+//     ~MyFoo();
+//   };
+//
+// References may still be taken and released on any thread.  If the last one
+// is released on another thread, the object is deleted after a task posted to
+// its creating thread, and leaked if that thread's MessageLoop is gone.
+template <class T, typename Traits = DefaultRefCountedBiasedTraits<T>>
+class RefCountedBiased : public subtle::RefCountedBiasedBase {
+ public:
+  static constexpr subtle::StartRefCountFromZeroTag kRefCountPreference =
+      subtle::kStartRefCountFromZeroTag;
+
+  RefCountedBiased() = default;
+
+  RefCountedBiased(const RefCountedBiased&) = delete;
+  RefCountedBiased& operator=(const RefCountedBiased&) = delete;
+
+  void AddRef() const {
+    subtle::RefCountedBiasedBase::AddRef();
+  }
+
+  void Release() const {
+    bool merge_needed;
+    if (subtle::RefCountedBiasedBase::Release(&merge_needed))
+      Traits::Destruct(static_cast<const T*>(this));
+    else if (merge_needed)
+      PostMerge(&MergeAndRelease);
+  }
+
+ protected:
+  ~RefCountedBiased() = default;
+
+ private:
+  friend struct DefaultRefCountedBiasedTraits<T>;
+  static void DeleteInternal(const T* x) { delete x; }
+
+  static void MergeAndRelease(const subtle::RefCountedBiasedBase* base) {
+    const RefCountedBiased* self = static_cast<const RefCountedBiased*>(base);
+    self->Merge();
+    self->Release();
+  }
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MEMORY_REF_COUNTED_BIASED_H_
@@ -0,0 +1,239 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/message_loop/delayed_task_wheel.h"
+
+#include <string.h>
+
+#include "crbase/bits.h"
+#include "crbase/logging.h"
+
+namespace cr {
+
+DelayedTaskWheel::Entry::Entry(PendingTask pending_task)
+    : pending_task(std::move(pending_task)),
+      tick(0),
+      prev(nullptr),
+      next(nullptr) {
+}
+
+DelayedTaskWheel::Entry::~Entry() {
+}
+
+DelayedTaskWheel::DelayedTaskWheel()
+    : origin_(TimeTicks::Now()),
+      current_tick_(0),
+      size_(0),
+      sweep_slot_(0),
+      purged_task_count_(0) {
+  memset(slots_, 0, sizeof(slots_));
+  memset(occupied_, 0, sizeof(occupied_));
+}
+
+DelayedTaskWheel::~DelayedTaskWheel() {
+  Clear();
+}
+
+bool DelayedTaskWheel::Push(PendingTask pending_task) {
+  CR_DCHECK(!pending_task.delayed_run_time.is_null());
+
+  bool is_earliest = empty() ||
+      pending_task.delayed_run_time < NextRunTime();
+
+  Entry* entry = new Entry(std::move(pending_task));
+  entry->tick = TimeToTick(entry->pending_task.delayed_run_time);
+  ++size_;
+  Insert(entry);
+  return is_earliest;
+}
+
+bool DelayedTaskWheel::AdvanceTo(TimeTicks now) {
+  uint64_t now_tick = TimeToTick(now);
+  if (now_tick > current_tick_) {
+    // Levels are numbered from the least significant group of tick bits.  The
+    // highest group that changed decides what has to move: below it every
+    // slot is now in the past, and at that level the slots behind the new
+    // position are in the past while the slot of the new position has to be
+    // spread over the lower levels.
+    int level = bits::Log2Floor64(now_tick ^ current_tick_) / kSlotBits;
+    current_tick_ = now_tick;
+
+    for (int i = 0; i < level; ++i) {
+      while (occupied_[i])
+        MoveSlotToReady(i, bits::CountTrailingZeroBits64(occupied_[i]));
+    }
+
+    int position =
+        static_cast<int>((now_tick >> (level * kSlotBits)) & kSlotMask);
+    uint64_t passed = occupied_[level] & ((uint64_t(1) << position) - 1);
+    while (passed) {
+      int slot = bits::CountTrailingZeroBits64(passed);
+      passed &= passed - 1;
+      MoveSlotToReady(level, slot);
+    }
+
+    Entry* entry = TakeSlot(level, position);
+    while (entry) {
+      Entry* next = entry->next;
+      Insert(entry);
+      entry = next;
+    }
+  }
+
+  return !ready_.empty() && ready_.top().delayed_run_time <= now;
+}
+
+PendingTask DelayedTaskWheel::Pop() {
+  CR_DCHECK(!ready_.empty());
+  PendingTask pending_task = std::move(const_cast<PendingTask&>(ready_.top()));
+  ready_.pop();
+  --size_;
+  return pending_task;
+}
+
+TimeTicks DelayedTaskWheel::NextRunTime() const {
+  CR_DCHECK(!empty());
+
+  // Everything in |ready_| comes before the tasks still in the wheel.
+  if (!ready_.empty())
+    return ready_.top().delayed_run_time;
+
+  // A lower level only holds tasks that run before those of a higher level,
+  // and the slots of a level are ordered, so the first occupied slot of the
+  // lowest occupied level holds the earliest task.
+  for (int level = 0; level < kLevels; ++level) {
+    if (!occupied_[level])
+      continue;
+    int shift = level * kSlotBits;
+    uint64_t slot = bits::CountTrailingZeroBits64(occupied_[level]);
+    uint64_t high_bits = shift + kSlotBits >= 64 ?
+        0 : (current_tick_ >> (shift + kSlotBits)) << (shift + kSlotBits);
+    return TickToTime(high_bits | (slot << shift));
+  }
+
+  CR_NOTREACHED();
+  return TimeTicks();
+}
+
+void DelayedTaskWheel::Clear() {
+  // Funnel everything through |ready_| so that the tasks are deleted in the
+  // order in which they would have run.
+  for (int level = 0; level < kLevels; ++level) {
+    while (occupied_[level]) {
+      MoveSlotToReady(level,
+                      bits::CountTrailingZeroBits64(occupied_[level]));
+    }
+  }
+  while (!ready_.empty())
+    Pop();
+  CR_DCHECK_EQ(0u, size_);
+}
+
+size_t DelayedTaskWheel::SweepCancelledTasks(size_t max_tasks) {
+  // Tasks in |ready_| are due and will be gone soon, so only the slots are
+  // looked at.
+  const int kTotalSlots = kLevels * kSlotsPerLevel;
+  size_t visited = 0;
+  size_t removed = 0;
+  for (int i = 0; i < kTotalSlots && visited < max_tasks; ++i) {
+    int level = sweep_slot_ / kSlotsPerLevel;
+    int slot = sweep_slot_ % kSlotsPerLevel;
+    sweep_slot_ = (sweep_slot_ + 1) % kTotalSlots;
+
+    Entry* entry = slots_[level][slot];
+    while (entry) {
+      Entry* next = entry->next;
+      ++visited;
+      if (entry->pending_task.task.IsCancelled()) {
+        UnlinkFromSlot(entry, level, slot);
+        delete entry;
+        --size_;
+        ++removed;
+      }
+      entry = next;
+    }
+  }
+  purged_task_count_ += removed;
+  return removed;
+}
+
+uint64_t DelayedTaskWheel::TimeToTick(TimeTicks time) const {
+  int64_t us = (time - origin_).InMicroseconds();
+  if (us <= 0)
+    return 0;
+  return static_cast<uint64_t>(us / kTickMicroseconds);
+}
+
+TimeTicks DelayedTaskWheel::TickToTime(uint64_t tick) const {
+  return origin_ + TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(tick) * kTickMicroseconds);
+}
+
+void DelayedTaskWheel::Insert(Entry* entry) {
+  if (entry->tick <= current_tick_) {
+    MoveToReady(entry);
+    return;
+  }
+
+  if (entry->pending_task.task.IsCancelled()) {
+    delete entry;
+    --size_;
+    ++purged_task_count_;
+    return;
+  }
+
+  int level = bits::Log2Floor64(entry->tick ^ current_tick_) / kSlotBits;
+  int slot =
+      static_cast<int>((entry->tick >> (level * kSlotBits)) & kSlotMask);
+  LinkToSlot(entry, level, slot);
+}
+
+void DelayedTaskWheel::LinkToSlot(Entry* entry, int level, int slot) {
+  Entry* head = slots_[level][slot];
+  entry->prev = nullptr;
+  entry->next = head;
+  if (head)
+    head->prev = entry;
+  slots_[level][slot] = entry;
+  occupied_[level] |= uint64_t(1) << slot;
+}
+
+void DelayedTaskWheel::UnlinkFromSlot(Entry* entry, int level, int slot) {
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    slots_[level][slot] = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  if (!slots_[level][slot])
+    occupied_[level] &= ~(uint64_t(1) << slot);
+}
+
+DelayedTaskWheel::Entry* DelayedTaskWheel::TakeSlot(int level, int slot) {
+  Entry* head = slots_[level][slot];
+  slots_[level][slot] = nullptr;
+  occupied_[level] &= ~(uint64_t(1) << slot);
+  return head;
+}
+
+void DelayedTaskWheel::MoveToReady(Entry* entry) {
+  if (!entry->pending_task.task.IsCancelled()) {
+    ready_.push(std::move(entry->pending_task));
+  } else {
+    --size_;
+    ++purged_task_count_;
+  }
+  delete entry;
+}
+
+void DelayedTaskWheel::MoveSlotToReady(int level, int slot) {
+  Entry* entry = TakeSlot(level, slot);
+  while (entry) {
+    Entry* next = entry->next;
+    MoveToReady(entry);
+    entry = next;
+  }
+}
+
+}  // namespace cr
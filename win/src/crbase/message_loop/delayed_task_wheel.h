@@ -0,0 +1,151 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_DELAYED_TASK_WHEEL_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_DELAYED_TASK_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crbase/base_export.h"
+#include "crbase/memory/pool_allocator.h"
+#include "crbase/threading/pending_task.h"
+#include "crbase/time/time.h"
+
+namespace cr {
+
+// A hierarchical timing wheel holding the delayed tasks of a MessageLoop, used
+// in place of DelayedTaskQueue when a loop keeps a very large number of
+// timeouts (see MessageLoop::EnableDelayedTaskWheel()).
+//
+// Time is cut into ticks of kTickMicroseconds.  Level 0 has one slot per tick,
+// and every level above it covers kSlotsPerLevel times the span of the level
+// below.  A task is filed at the lowest level whose slot tells its tick apart
+// from the current one, so Push() and the removal of a task are O(1).  As the
+// wheel advances, the tasks of a higher slot are cascaded down one level at a
+// time, so each task moves at most kLevels times before it is due.
+//
+// Due tasks are moved into a small heap ordered like DelayedTaskQueue, which
+// keeps the FIFO order of tasks that have the same |delayed_run_time|.
+//
+// Tasks whose callback reports IsCancelled() are deleted whenever the wheel
+// touches them instead of waiting for their run time, and
+// SweepCancelledTasks() looks for them in the slots that are not touched yet.
+//
+// This class is not thread-safe; it is only used on the MessageLoop thread.
+class CRBASE_EXPORT DelayedTaskWheel {
+ public:
+  // Length of a tick.  Tasks due within the same tick are ordered by the heap.
+  static const int64_t kTickMicroseconds = 1000;
+
+  DelayedTaskWheel(const DelayedTaskWheel&) = delete;
+  DelayedTaskWheel& operator=(const DelayedTaskWheel&) = delete;
+
+  DelayedTaskWheel();
+  ~DelayedTaskWheel();
+
+  // Adds |pending_task|, which must have a non-null |delayed_run_time|.
+  // Returns true if it runs before the NextRunTime() the wheel reported
+  // previously, i.e. if the loop has to wake up earlier than it planned.
+  bool Push(PendingTask pending_task);
+
+  // Moves every task that is due at |now| to the ready heap.  Returns true if
+  // the earliest task of the wheel can be run, i.e. Pop() can be called.
+  bool AdvanceTo(TimeTicks now);
+
+  // Removes and returns the earliest task.  Only valid after AdvanceTo()
+  // returned true.
+  PendingTask Pop();
+
+  // Returns the time at which the wheel should be advanced next.  This is the
+  // run time of the earliest task if it is known exactly, or else the start of
+  // the slot holding it, which is never later than the task's run time.
+  // Must not be called on an empty wheel.
+  TimeTicks NextRunTime() const;
+
+  // Deletes every task without running it, in the order they would have run.
+  void Clear();
+
+  // Looks at the tasks of the next slots, resuming where the previous call
+  // stopped, and deletes those whose callback reports IsCancelled().  Stops
+  // at the end of the slot in which |max_tasks| tasks have been looked at.
+  // Returns the number of deleted tasks.
+  size_t SweepCancelledTasks(size_t max_tasks);
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Number of cancelled tasks deleted before they were due.
+  size_t purged_task_count() const { return purged_task_count_; }
+
+ private:
+  static const int kSlotBits = 6;
+  static const int kSlotsPerLevel = 1 << kSlotBits;
+  static const uint64_t kSlotMask = kSlotsPerLevel - 1;
+  // Enough levels to cover all the 64 bits of a tick.
+  static const int kLevels = (64 + kSlotBits - 1) / kSlotBits;
+
+  struct Entry {
+    explicit Entry(PendingTask pending_task);
+    ~Entry();
+
+    // One is allocated per delayed task; see PoolAlloc().
+    static void* operator new(size_t size) { return PoolAlloc(size); }
+    static void operator delete(void* block, size_t size) {
+      PoolFree(block, size);
+    }
+
+    PendingTask pending_task;
+    uint64_t tick;
+    Entry* prev;
+    Entry* next;
+  };
+
+  // Returns the tick |time| falls in.
+  uint64_t TimeToTick(TimeTicks time) const;
+
+  // Returns the start time of |tick|.
+  TimeTicks TickToTime(uint64_t tick) const;
+
+  // Files |entry| in the wheel relative to |current_tick_|, or in the ready
+  // heap if it is due in the current tick.  Deletes it if it was cancelled.
+  void Insert(Entry* entry);
+
+  void LinkToSlot(Entry* entry, int level, int slot);
+  void UnlinkFromSlot(Entry* entry, int level, int slot);
+
+  // Detaches the whole list of a slot and returns its first entry.
+  Entry* TakeSlot(int level, int slot);
+
+  // Moves |entry| to the ready heap, or deletes it if it was cancelled.
+  void MoveToReady(Entry* entry);
+
+  // Moves every entry of the slot to the ready heap.
+  void MoveSlotToReady(int level, int slot);
+
+  // Origin of the ticks.
+  const TimeTicks origin_;
+
+  // Tick the wheel was last advanced to.
+  uint64_t current_tick_;
+
+  // Heads of the doubly-linked slot lists, and a bit per non-empty slot.
+  Entry* slots_[kLevels][kSlotsPerLevel];
+  uint64_t occupied_[kLevels];
+
+  // Tasks due in |current_tick_| or earlier, earliest on top.
+  DelayedTaskQueue ready_;
+
+  // Total number of tasks, in the wheel and in |ready_|.
+  size_t size_;
+
+  // Slot, counted across all levels, at which the next sweep starts.
+  int sweep_slot_;
+
+  size_t purged_task_count_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_DELAYED_TASK_WHEEL_H_
@@ -5,10 +5,12 @@
 #include "crbase/message_loop/incoming_task_queue.h"
 
 #include <limits>
+#include <memory>
 
 #include "crbase/tracing/location.h"
 #include "crbase/message_loop/message_loop.h"
 #include "crbase/synchronization/waitable_event.h"
+#include "crbase/threading/platform_thread.h"
 #include "crbase/time/time.h"
 #include "crbase/build_config.h"
 
@@ -30,13 +32,51 @@ bool AlwaysNotifyPump(MessageLoop::Type type) {
   return false;
 }
 
+// Set in |post_state_| once the message loop is being destroyed; the other
+// bits count the posts in progress.
+const int kPostStateClosed = 1 << 30;
+
 }  // namespace
 
+// Registers a post in progress for as long as it is in scope, so that
+// WillDestroyCurrentMessageLoop() can wait for it.  is_open() is false if the
+// queue no longer accepts tasks, in which case the post must fail.
+class IncomingTaskQueue::ScopedPost {
+ public:
+  ScopedPost(const ScopedPost&) = delete;
+  ScopedPost& operator=(const ScopedPost&) = delete;
+
+  explicit ScopedPost(IncomingTaskQueue* queue)
+      : queue_(queue),
+        is_open_(!(queue_->post_state_.fetch_add(
+                       1, std::memory_order_acquire) & kPostStateClosed)) {
+  }
+
+  ~ScopedPost() {
+    queue_->post_state_.fetch_sub(1, std::memory_order_release);
+  }
+
+  bool is_open() const { return is_open_; }
+
+ private:
+  IncomingTaskQueue* const queue_;
+  const bool is_open_;
+};
+
+IncomingTaskQueue::IncomingTask::IncomingTask(PendingTask pending_task)
+    : pending_task(std::move(pending_task)) {
+}
+
+IncomingTaskQueue::IncomingTask::~IncomingTask() {
+}
+
 IncomingTaskQueue::IncomingTaskQueue(MessageLoop* message_loop)
     : high_res_task_count_(0),
       message_loop_(message_loop),
+      post_state_(0),
       next_sequence_num_(0),
       message_loop_scheduled_(false),
+      record_queue_time_(false),
       always_schedule_work_(AlwaysNotifyPump(message_loop_->type())),
       is_ready_for_scheduling_(false) {
 }
@@ -45,75 +85,139 @@ bool IncomingTaskQueue::AddToIncomingQueue(
     const tracked_objects::Location& from_here,
     OnceClosure task,
     TimeDelta delay,
-    bool nestable) {
+    bool nestable,
+    TaskPriority priority) {
   CR_DLOG_IF(WARNING, delay.InSeconds() > kTaskDelayWarningThresholdInSeconds)
       << "Requesting super-long task delay period of " << delay.InSeconds()
       << " seconds from here: " << from_here.ToString();
 
-  AutoLock locked(incoming_queue_lock_);
-  PendingTask pending_task(
-      from_here, std::move(task), CalculateDelayedRuntime(delay), nestable);
+  ScopedPost post(this);
+  if (!post.is_open())
+    return false;
+
+  std::unique_ptr<IncomingTask> incoming_task(new IncomingTask(PendingTask(
+      from_here, std::move(task), CalculateDelayedRuntime(delay), nestable)));
+  incoming_task->pending_task.priority = priority;
+  if (incoming_task->pending_task.delayed_run_time.is_null() &&
+      record_queue_time_.load(std::memory_order_relaxed)) {
+    incoming_task->pending_task.queue_time = TimeTicks::Now();
+  }
 
+#if defined(MINI_CHROMIUM_OS_WIN)
   // We consider the task needs a high resolution timer if the delay is
   // more than 0 and less than 32ms. This caps the relative error to
   // less than 50% : a 33ms wait can wake at 48ms since the default
   // resolution on Windows is between 10 and 15ms.
   if (delay > TimeDelta() &&
       delay.InMilliseconds() < (2 * Time::kMinLowResolutionThresholdMs)) {
-    ++high_res_task_count_;
-    pending_task.is_high_res = true;
+    // Counted before the task becomes visible so that the loop never runs
+    // more high resolution tasks than it was told about.
+    high_res_task_count_.fetch_add(1, std::memory_order_relaxed);
+    incoming_task->pending_task.is_high_res = true;
   }
+#endif
 
-  return PostPendingTask(&pending_task);
+  return PostPendingTask(incoming_task.release());
+}
+
+bool IncomingTaskQueue::AddTasksToIncomingQueue(
+    const tracked_objects::Location& from_here,
+    std::vector<OnceClosure> tasks,
+    bool nestable,
+    TaskPriority priority) {
+  ScopedPost post(this);
+  if (!post.is_open())
+    return false;
+  if (tasks.empty())
+    return true;
+
+  TimeTicks queue_time;
+  if (record_queue_time_.load(std::memory_order_relaxed))
+    queue_time = TimeTicks::Now();
+  int sequence_num = next_sequence_num_.fetch_add(
+      static_cast<int>(tasks.size()), std::memory_order_relaxed);
+
+  std::vector<IncomingTask*> incoming_tasks;
+  incoming_tasks.reserve(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    IncomingTask* incoming_task = new IncomingTask(PendingTask(
+        from_here, std::move(tasks[i]), TimeTicks(), nestable));
+    incoming_task->pending_task.sequence_num = sequence_num++;
+    incoming_task->pending_task.priority = priority;
+    incoming_task->pending_task.queue_time = queue_time;
+    incoming_tasks.push_back(incoming_task);
+  }
+
+  incoming_queue_.PushBatch(incoming_tasks.data(), incoming_tasks.size());
+  ScheduleWorkIfNeeded();
+  return true;
 }
 
 bool IncomingTaskQueue::HasHighResolutionTasks() {
-  AutoLock lock(incoming_queue_lock_);
-  return high_res_task_count_ > 0;
+  return high_res_task_count_.load(std::memory_order_relaxed) > 0;
 }
 
 ///bool IncomingTaskQueue::IsIdleForTesting() {
-///  AutoLock lock(incoming_queue_lock_);
-///  return incoming_queue_.empty();
+///  return incoming_queue_.IsEmpty();
 ///}
 
-int IncomingTaskQueue::ReloadWorkQueue(TaskQueue* work_queue) {
-  // Make sure no tasks are lost.
-  CR_DCHECK(work_queue->empty());
-
-  // Acquire all we can from the inter-thread queue with one lock acquisition.
-  AutoLock lock(incoming_queue_lock_);
-  if (incoming_queue_.empty()) {
+int IncomingTaskQueue::ReloadWorkQueue(PrioritizedTaskQueue* work_queue) {
+  DrainIncomingQueue(work_queue);
+  if (work_queue->empty()) {
     // If the loop attempts to reload but there are no tasks in the incoming
     // queue, that means it will go to sleep waiting for more work. If the
     // incoming queue becomes nonempty we need to schedule it again.
-    message_loop_scheduled_ = false;
-  } else {
-    incoming_queue_.swap(*work_queue);
+    message_loop_scheduled_.store(false, std::memory_order_relaxed);
+
+    // Pairs with the fence in PostPendingTask(): a poster either sees the
+    // flag cleared and wakes us up, or its task is visible to this drain.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    DrainIncomingQueue(work_queue);
+    if (!work_queue->empty())
+      message_loop_scheduled_.store(true, std::memory_order_relaxed);
   }
-  // Reset the count of high resolution tasks since our queue is now empty.
-  int high_res_tasks = high_res_task_count_;
-  high_res_task_count_ = 0;
-  return high_res_tasks;
+
+  // Reset the count of high resolution tasks since they are now all counted
+  // by the loop.
+  return high_res_task_count_.exchange(0, std::memory_order_relaxed);
 }
 
 void IncomingTaskQueue::WillDestroyCurrentMessageLoop() {
-  AutoLock lock(incoming_queue_lock_);
-  message_loop_ = NULL;
+  // Posts from now on fail.  Wait for the ones already in progress: they
+  // have reported success, so their tasks must be in the queue before it is
+  // emptied below.
+  post_state_.fetch_or(kPostStateClosed, std::memory_order_acq_rel);
+  while (post_state_.load(std::memory_order_acquire) != kPostStateClosed)
+    PlatformThread::YieldCurrentThread();
+
+  {
+    AutoLock lock(incoming_queue_lock_);
+    message_loop_ = NULL;
+  }
+
+  // Delete the tasks that were posted after the loop's final cleanup here,
+  // on the loop's thread, rather than on whichever thread drops the last
+  // reference to |this|.  Deleting a task can only post more tasks to a
+  // closed queue, which fails.
+  while (IncomingTask* incoming_task = incoming_queue_.Pop())
+    delete incoming_task;
 }
 
 void IncomingTaskQueue::StartScheduling() {
   AutoLock lock(incoming_queue_lock_);
   CR_DCHECK(!is_ready_for_scheduling_);
-  CR_DCHECK(!message_loop_scheduled_);
   is_ready_for_scheduling_ = true;
-  if (!incoming_queue_.empty())
-    ScheduleWork();
+  // Tasks posted before now could not wake the loop up.
+  if (!incoming_queue_.IsEmpty()) {
+    message_loop_scheduled_.store(true, std::memory_order_relaxed);
+    message_loop_->ScheduleWork();
+  }
 }
 
 IncomingTaskQueue::~IncomingTaskQueue() {
   // Verify that WillDestroyCurrentMessageLoop() has been called.
   CR_DCHECK(!message_loop_);
+  CR_DCHECK(incoming_queue_.IsEmpty());
 }
 
 TimeTicks IncomingTaskQueue::CalculateDelayedRuntime(TimeDelta delay) {
@@ -126,48 +230,55 @@ TimeTicks IncomingTaskQueue::CalculateDelayedRuntime(TimeDelta delay) {
   return delayed_run_time;
 }
 
-bool IncomingTaskQueue::PostPendingTask(PendingTask* pending_task) {
+bool IncomingTaskQueue::PostPendingTask(IncomingTask* incoming_task) {
   // Warning: Don't try to short-circuit, and handle this thread's tasks more
   // directly, as it could starve handling of foreign threads.  Put every task
   // into this queue.
 
-  // This should only be called while the lock is taken.
-  incoming_queue_lock_.AssertAcquired();
-
-  if (!message_loop_) {
-    pending_task->task.Reset();
-    return false;
-  }
-
   // Initialize the sequence number. The sequence number is used for delayed
   // tasks (to facilitate FIFO sorting when two tasks have the same
   // delayed_run_time value) and for identifying the task in about:tracing.
-  pending_task->sequence_num = next_sequence_num_++;
+  incoming_task->pending_task.sequence_num =
+      next_sequence_num_.fetch_add(1, std::memory_order_relaxed);
 
   ///message_loop_->task_annotator()->DidQueueTask("MessageLoop::PostTask",
-  ///                                              *pending_task);
+  ///                                              incoming_task->pending_task);
 
-  bool was_empty = incoming_queue_.empty();
-  incoming_queue_.push(std::move(*pending_task));
+  incoming_queue_.Push(incoming_task);
+  ScheduleWorkIfNeeded();
+  return true;
+}
 
-  if (is_ready_for_scheduling_ &&
-      (always_schedule_work_ || (!message_loop_scheduled_ && was_empty))) {
+void IncomingTaskQueue::ScheduleWorkIfNeeded() {
+  // Pairs with the fence in ReloadWorkQueue().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (always_schedule_work_ ||
+      !message_loop_scheduled_.exchange(true, std::memory_order_relaxed)) {
     ScheduleWork();
   }
+}
 
-  return true;
+void IncomingTaskQueue::DrainIncomingQueue(PrioritizedTaskQueue* work_queue) {
+  while (IncomingTask* incoming_task = incoming_queue_.Pop()) {
+    work_queue->Push(std::move(incoming_task->pending_task));
+    delete incoming_task;
+  }
 }
 
 void IncomingTaskQueue::ScheduleWork() {
-  CR_DCHECK(is_ready_for_scheduling_);
-  // Wake up the message loop.
-  message_loop_->ScheduleWork();
   // After we've scheduled the message loop, we do not need to do so again
   // until we know it has processed all of the work in our queue and is
   // waiting for more work again. The message loop will always attempt to
-  // reload from the incoming queue before waiting again so we clear this flag
-  // in ReloadWorkQueue().
-  message_loop_scheduled_ = true;
+  // reload from the incoming queue before waiting again and clears
+  // |message_loop_scheduled_| in ReloadWorkQueue().
+  AutoLock lock(incoming_queue_lock_, CR_LOCK_FROM_HERE);
+  // Before StartScheduling() the loop has no pump yet; StartScheduling()
+  // takes care of the tasks posted so far.
+  if (message_loop_ && is_ready_for_scheduling_) {
+    // Wake up the message loop.
+    message_loop_->ScheduleWork();
+  }
 }
 
 }  // namespace internal
@@ -5,9 +5,15 @@
 #ifndef MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
 #define MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
 
+#include <atomic>
+#include <vector>
+
 #include "crbase/base_export.h"
+#include "crbase/containers/mpsc_queue.h"
 #include "crbase/macros.h"
+#include "crbase/memory/pool_allocator.h"
 #include "crbase/memory/ref_counted.h"
+#include "crbase/message_loop/prioritized_task_queue.h"
 #include "crbase/threading/pending_task.h"
 #include "crbase/synchronization/lock.h"
 #include "crbase/time/time.h"
@@ -22,6 +28,12 @@ namespace internal {
 // Implements a queue of tasks posted to the message loop running on the current
 // thread. This class takes care of synchronizing posting tasks from different
 // threads and together with MessageLoop ensures clean shutdown.
+//
+// Posting is lock-free: tasks are pushed onto an intrusive MPSC queue and the
+// message loop drains it from its own thread.  A poster only takes
+// |incoming_queue_lock_| when it finds the loop idle and has to wake it up.
+// As with a locked queue, a post either fails or its task is in the queue by
+// the time WillDestroyCurrentMessageLoop() returns.
 class CRBASE_EXPORT IncomingTaskQueue
     : public RefCountedThreadSafe<IncomingTaskQueue> {
  public:
@@ -40,7 +52,16 @@ class CRBASE_EXPORT IncomingTaskQueue
   bool AddToIncomingQueue(const tracked_objects::Location& from_here,
                           OnceClosure task,
                           TimeDelta delay,
-                          bool nestable);
+                          bool nestable,
+                          TaskPriority priority);
+
+  // Appends |tasks|, in order and without delay, as one batch: the tasks
+  // become visible to the message loop together, and the loop is woken up at
+  // most once for the whole batch.
+  bool AddTasksToIncomingQueue(const tracked_objects::Location& from_here,
+                               std::vector<OnceClosure> tasks,
+                               bool nestable,
+                               TaskPriority priority);
 
   // Returns true if the queue contains tasks that require higher than default
   // timer resolution. Currently only needed for Windows.
@@ -49,55 +70,96 @@ class CRBASE_EXPORT IncomingTaskQueue
   // Returns true if the message loop is "idle". Provided for testing.
   ///bool IsIdleForTesting();
 
-  // Loads tasks from the |incoming_queue_| into |*work_queue|. Must be called
-  // from the thread that is running the loop. Returns the number of tasks that
-  // require high resolution timers.
-  int ReloadWorkQueue(TaskQueue* work_queue);
+  // Loads tasks from the |incoming_queue_| into |*work_queue|, each in the
+  // queue of its priority. Must be called from the thread that is running the
+  // loop. Returns the number of tasks that require high resolution timers. If
+  // |*work_queue| is still empty the loop is flagged as idle so that the next
+  // poster wakes it up.
+  int ReloadWorkQueue(PrioritizedTaskQueue* work_queue);
 
-  // Disconnects |this| from the parent message loop.
+  // Disconnects |this| from the parent message loop: later posts fail, and
+  // the tasks still queued are deleted without being run.  Waits for the
+  // posts in progress on other threads to finish.
   void WillDestroyCurrentMessageLoop();
 
   // This should be called when the message loop becomes ready for
   // scheduling work.
   void StartScheduling();
 
+  // Makes posts stamp PendingTask::queue_time, at the cost of a
+  // TimeTicks::Now() per task.  May be called on any thread; posts in
+  // progress may or may not see the change.
+  void set_record_queue_time(bool record_queue_time) {
+    record_queue_time_.store(record_queue_time, std::memory_order_relaxed);
+  }
+
  private:
   friend class RefCountedThreadSafe<IncomingTaskQueue>;
+  class ScopedPost;
+
   virtual ~IncomingTaskQueue();
 
+  // A PendingTask on its way through |incoming_queue_|.
+  struct IncomingTask : public MpscQueueNode {
+    explicit IncomingTask(PendingTask pending_task);
+    ~IncomingTask();
+
+    // One is allocated per posted task; see PoolAlloc().
+    static void* operator new(size_t size) { return PoolAlloc(size); }
+    static void operator delete(void* block, size_t size) {
+      PoolFree(block, size);
+    }
+
+    PendingTask pending_task;
+  };
+
   // Calculates the time at which a PendingTask should run.
   TimeTicks CalculateDelayedRuntime(TimeDelta delay);
 
-  // Adds a task to |incoming_queue_|. The caller retains ownership of
-  // |pending_task|, but this function will reset the value of
-  // |pending_task->task|. This is needed to ensure that the posting call stack
-  // does not retain |pending_task->task| beyond this function call.
-  bool PostPendingTask(PendingTask* pending_task);
+  // Adds a task to |incoming_queue_| and wakes up the message loop if it is
+  // idle. Takes ownership of |incoming_task|.
+  bool PostPendingTask(IncomingTask* incoming_task);
+
+  // Wakes up the message loop after tasks were added to |incoming_queue_| if
+  // it may be idle.
+  void ScheduleWorkIfNeeded();
+
+  // Moves every task visible in |incoming_queue_| to |*work_queue|.
+  void DrainIncomingQueue(PrioritizedTaskQueue* work_queue);
 
   // Wakes up the message loop and schedules work.
   void ScheduleWork();
 
   // Number of tasks that require high resolution timing. This value is kept
   // so that ReloadWorkQueue() completes in constant time.
-  int high_res_task_count_;
+  std::atomic<int> high_res_task_count_;
 
-  // The lock that protects access to the members of this class.
+  // Protects |message_loop_| and |is_ready_for_scheduling_|.  Only taken to
+  // wake up the loop and on startup/shutdown, never on the posting fast path.
   cr::Lock incoming_queue_lock_;
 
-  // An incoming queue of tasks that are acquired under a mutex for processing
-  // on this instance's thread. These tasks have not yet been been pushed to
-  // |message_loop_|.
-  TaskQueue incoming_queue_;
+  // An incoming queue of tasks that are pushed lock-free by any thread and
+  // popped for processing on this instance's thread. These tasks have not yet
+  // been pushed to |message_loop_|.
+  MpscQueue<IncomingTask> incoming_queue_;
 
   // Points to the message loop that owns |this|.
   MessageLoop* message_loop_;
 
+  // Number of posts in progress, plus a flag set once the message loop is
+  // being destroyed; see ScopedPost.
+  std::atomic<int> post_state_;
+
   // The next sequence number to use for delayed tasks.
-  int next_sequence_num_;
+  std::atomic<int> next_sequence_num_;
 
   // True if our message loop has already been scheduled and does not need to be
-  // scheduled again until an empty reload occurs.
-  bool message_loop_scheduled_;
+  // scheduled again until an empty reload occurs. The poster that flips it
+  // from false to true is the one that wakes the loop up.
+  std::atomic<bool> message_loop_scheduled_;
+
+  // True if posts stamp the queue time of their tasks.
+  std::atomic<bool> record_queue_time_;
 
   // True if we always need to call ScheduleWork when receiving a new task, even
   // if the incoming queue was not empty.
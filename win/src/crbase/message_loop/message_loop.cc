@@ -20,7 +20,7 @@
 #include "crbase/build_config.h"
 
 #if defined(MINI_CHROMIUM_OS_POSIX)
-#include "crbase/message_loop/message_pump_libevent.h"
+#include "crbase/message_loop/message_pump_epoll.h"
 #endif
 
 namespace cr {
@@ -60,9 +60,19 @@ const int kNumberOfDistinctMessagesDisplayed = 1100;
 
 MessageLoop::MessagePumpFactory* message_pump_for_ui_factory_ = NULL;
 
+// Number of delayed tasks PurgeCancelledDelayedTasks() looks at each time the
+// loop goes idle, so that a large queue is swept over several idle passes.
+const size_t kMaxDelayedTasksToSweep = 64;
+
+#if defined(MINI_CHROMIUM_OS_WIN)
 MessagePumpForIO* ToPumpIO(MessagePump* pump) {
   return static_cast<MessagePumpForIO*>(pump);
 }
+#elif defined(MINI_CHROMIUM_OS_POSIX)
+MessagePumpEpoll* ToPumpIO(MessagePump* pump) {
+  return static_cast<MessagePumpEpoll*>(pump);
+}
+#endif
 
 
 std::unique_ptr<MessagePump> ReturnPump(std::unique_ptr<MessagePump> pump) {
@@ -165,7 +175,8 @@ bool MessageLoop::InitMessagePumpForUIFactory(MessagePumpFactory* factory) {
 std::unique_ptr<MessagePump> MessageLoop::CreateMessagePumpForType(Type type) {
   // TODO(rvargas): Get rid of the OS guards.
 #if defined(MINI_CHROMIUM_OS_LINUX)
-  typedef MessagePumpLibevent MessagePumpForUI;
+  typedef MessagePumpEpoll MessagePumpForUI;
+  typedef MessagePumpEpoll MessagePumpForIO;
 #endif
 
   #define MESSAGE_PUMP_UI std::unique_ptr<MessagePump>(new MessagePumpForUI())
@@ -223,6 +234,30 @@ void MessageLoop::PostNonNestableDelayedTask(
   task_runner_->PostNonNestableDelayedTask(from_here, std::move(task), delay);
 }
 
+void MessageLoop::PostTasks(
+    const tracked_objects::Location& from_here,
+    std::vector<OnceClosure> tasks) {
+  task_runner_->PostTasks(from_here, std::move(tasks));
+}
+
+void MessageLoop::PostTaskWithPriority(
+    const tracked_objects::Location& from_here,
+    OnceClosure task,
+    TaskPriority priority) {
+  PostDelayedTaskWithPriority(from_here, std::move(task), TimeDelta(),
+                              priority);
+}
+
+void MessageLoop::PostDelayedTaskWithPriority(
+    const tracked_objects::Location& from_here,
+    OnceClosure task,
+    TimeDelta delay,
+    TaskPriority priority) {
+  CR_DCHECK(!task.is_null()) << from_here.ToString();
+  incoming_task_queue_->AddToIncomingQueue(from_here, std::move(task), delay,
+                                           true, priority);
+}
+
 void MessageLoop::Run() {
   CR_DCHECK(pump_);
   RunLoop run_loop;
@@ -253,6 +288,44 @@ void MessageLoop::QuitNow() {
   }
 }
 
+void MessageLoop::EnableDelayedTaskWheel() {
+  CR_DCHECK_EQ(this, current());
+  CR_DCHECK(delayed_work_queue_.empty());
+  if (!delayed_task_wheel_)
+    delayed_task_wheel_.reset(new DelayedTaskWheel());
+}
+
+size_t MessageLoop::GetPurgedCancelledTaskCount() const {
+  size_t count = purged_task_count_;
+  if (delayed_task_wheel_)
+    count += delayed_task_wheel_->purged_task_count();
+  return count;
+}
+
+void MessageLoop::EnableQueueingDelayStats() {
+  CR_DCHECK_EQ(this, current());
+  if (queueing_delay_histograms_)
+    return;
+  queueing_delay_histograms_.reset(
+      new tracked_objects::LatencyHistogram[kTaskPriorityCount]);
+  UpdateRecordQueueTime();
+}
+
+tracked_objects::LatencyHistogramSnapshot
+MessageLoop::GetQueueingDelaySnapshot(TaskPriority priority) const {
+  if (!queueing_delay_histograms_)
+    return tracked_objects::LatencyHistogramSnapshot();
+  return queueing_delay_histograms_[static_cast<int>(priority)].GetSnapshot();
+}
+
+void MessageLoop::ResetQueueingDelayStats() {
+  CR_DCHECK_EQ(this, current());
+  if (!queueing_delay_histograms_)
+    return;
+  for (int i = 0; i < kTaskPriorityCount; ++i)
+    queueing_delay_histograms_[i].Reset();
+}
+
 bool MessageLoop::IsType(Type type) const {
   return type_ == type;
 }
@@ -286,11 +359,13 @@ bool MessageLoop::IsNested() {
 void MessageLoop::AddTaskObserver(TaskObserver* task_observer) {
   CR_DCHECK_EQ(this, current());
   task_observers_.AddObserver(task_observer);
+  UpdateRecordQueueTime();
 }
 
 void MessageLoop::RemoveTaskObserver(TaskObserver* task_observer) {
   CR_DCHECK_EQ(this, current());
   task_observers_.RemoveObserver(task_observer);
+  UpdateRecordQueueTime();
 }
 
 bool MessageLoop::is_running() const {
@@ -318,6 +393,7 @@ MessageLoop::MessageLoop(Type type, MessagePumpFactoryCallback pump_factory)
       in_high_res_mode_(false),
       os_modal_loop_(false),
 #endif
+      purged_task_count_(0),
       nestable_tasks_allowed_(true),
       pump_factory_(std::move(pump_factory)),
       run_loop_(NULL),
@@ -408,6 +484,16 @@ void MessageLoop::RunTask(PendingTask* pending_task) {
   }
 #endif
 
+  if (queueing_delay_histograms_) {
+    // A delayed task is ready from its run time on.
+    TimeTicks ready_time = pending_task->delayed_run_time.is_null() ?
+        pending_task->queue_time : pending_task->delayed_run_time;
+    if (!ready_time.is_null()) {
+      queueing_delay_histograms_[static_cast<int>(pending_task->priority)]
+          .Record(TimeTicks::Now() - ready_time);
+    }
+  }
+
   // Execute the task and assume the worst: It is probably not reentrant.
   nestable_tasks_allowed_ = false;
 
@@ -421,6 +507,11 @@ void MessageLoop::RunTask(PendingTask* pending_task) {
   nestable_tasks_allowed_ = true;
 }
 
+void MessageLoop::UpdateRecordQueueTime() {
+  incoming_task_queue_->set_record_queue_time(
+      queueing_delay_histograms_ || task_observers_.might_have_observers());
+}
+
 bool MessageLoop::DeferOrRunPendingTask(PendingTask pending_task) {
   if (pending_task.nestable || run_loop_->run_depth_ == 1) {
     RunTask(&pending_task);
@@ -435,16 +526,20 @@ bool MessageLoop::DeferOrRunPendingTask(PendingTask pending_task) {
   return false;
 }
 
-void MessageLoop::AddToDelayedWorkQueue(PendingTask pending_task) {
+bool MessageLoop::AddToDelayedWorkQueue(PendingTask pending_task) {
   // Move to the delayed work queue.
+  if (delayed_task_wheel_)
+    return delayed_task_wheel_->Push(std::move(pending_task));
+
+  int sequence_num = pending_task.sequence_num;
   delayed_work_queue_.push(std::move(pending_task));
+  return delayed_work_queue_.top().sequence_num == sequence_num;
 }
 
 bool MessageLoop::DeletePendingTasks() {
   bool did_work = !work_queue_.empty();
   while (!work_queue_.empty()) {
-    PendingTask pending_task = std::move(work_queue_.front());
-    work_queue_.pop();
+    PendingTask pending_task = work_queue_.Pop();
     if (!pending_task.delayed_run_time.is_null()) {
       // We want to delete delayed tasks in the same order in which they would
       // normally be deleted in case of any funny dependencies between delayed
@@ -457,6 +552,10 @@ bool MessageLoop::DeletePendingTasks() {
     deferred_non_nestable_work_queue_.pop();
   }
   did_work |= !delayed_work_queue_.empty();
+  if (delayed_task_wheel_) {
+    did_work |= !delayed_task_wheel_->empty();
+    delayed_task_wheel_->Clear();
+  }
 
   // Historically, we always delete the task regardless of valgrind status. It's
   // not completely clear why we want to leak them in the loops above.  This
@@ -470,18 +569,16 @@ bool MessageLoop::DeletePendingTasks() {
 }
 
 void MessageLoop::ReloadWorkQueue() {
-  // We can improve performance of our loading tasks from the incoming queue to
-  // |*work_queue| by waiting until the last minute (|*work_queue| is empty) to
-  // load. That reduces the number of locks-per-task significantly when our
-  // queues get large.
-  if (work_queue_.empty()) {
+  // The incoming queue is drained before every task, not only once
+  // |work_queue_| is empty, so that a task of a higher priority can overtake
+  // the tasks already loaded.  This is cheap since draining takes no lock, and
+  // checking an empty incoming queue is a single atomic load.
 #if defined(MINI_CHROMIUM_OS_WIN)
-    pending_high_res_tasks_ +=
-        incoming_task_queue_->ReloadWorkQueue(&work_queue_);
+  pending_high_res_tasks_ +=
+      incoming_task_queue_->ReloadWorkQueue(&work_queue_);
 #else
-    incoming_task_queue_->ReloadWorkQueue(&work_queue_);
+  incoming_task_queue_->ReloadWorkQueue(&work_queue_);
 #endif
-  }
 }
 
 void MessageLoop::ScheduleWork() {
@@ -499,22 +596,19 @@ bool MessageLoop::DoWork() {
     if (work_queue_.empty())
       break;
 
-    // Execute oldest task.
-    do {
-      PendingTask pending_task = std::move(work_queue_.front());
-      work_queue_.pop();
-      if (pending_task.task.IsCancelled()) {
-        // do nothing~
-      } else if (!pending_task.delayed_run_time.is_null()) {
-        AddToDelayedWorkQueue(std::move(pending_task));
-        // If we changed the topmost task, then it is time to reschedule.
-        if (delayed_work_queue_.top().task.Equals(pending_task.task))
-          pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
-      } else {
-        if (DeferOrRunPendingTask(std::move(pending_task)))
-          return true;
-      }
-    } while (!work_queue_.empty());
+    // Execute the oldest task of the highest priority.
+    PendingTask pending_task = work_queue_.Pop();
+    if (pending_task.task.IsCancelled()) {
+      // do nothing~
+    } else if (!pending_task.delayed_run_time.is_null()) {
+      TimeTicks delayed_run_time = pending_task.delayed_run_time;
+      // If we changed the topmost task, then it is time to reschedule.
+      if (AddToDelayedWorkQueue(std::move(pending_task)))
+        pump_->ScheduleDelayedWork(delayed_run_time);
+    } else {
+      if (DeferOrRunPendingTask(std::move(pending_task)))
+        return true;
+    }
   }
 
   // Nothing happened.
@@ -522,6 +616,9 @@ bool MessageLoop::DoWork() {
 }
 
 bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
+  if (delayed_task_wheel_)
+    return DoDelayedWorkFromWheel(next_delayed_work_time);
+
   if (!nestable_tasks_allowed_ || delayed_work_queue_.empty()) {
     recent_time_ = *next_delayed_work_time = TimeTicks();
     return false;
@@ -553,10 +650,57 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
   return DeferOrRunPendingTask(std::move(pending_task));
 }
 
+bool MessageLoop::DoDelayedWorkFromWheel(TimeTicks* next_delayed_work_time) {
+  if (!nestable_tasks_allowed_ || delayed_task_wheel_->empty()) {
+    recent_time_ = *next_delayed_work_time = TimeTicks();
+    return false;
+  }
+
+  // Same as above, Time::Now() is only called when the earliest task does
+  // not look due yet.
+  TimeTicks next_run_time = delayed_task_wheel_->NextRunTime();
+  if (next_run_time > recent_time_) {
+    recent_time_ = TimeTicks::Now();  // Get a better view of Now();
+    if (next_run_time > recent_time_) {
+      *next_delayed_work_time = next_run_time;
+      return false;
+    }
+  }
+
+  // |next_run_time| may only be the start of the slot holding the earliest
+  // task, or the due tasks may all have been cancelled.
+  if (!delayed_task_wheel_->AdvanceTo(recent_time_)) {
+    *next_delayed_work_time = delayed_task_wheel_->empty() ?
+        TimeTicks() : delayed_task_wheel_->NextRunTime();
+    return false;
+  }
+
+  PendingTask pending_task = delayed_task_wheel_->Pop();
+
+  if (!delayed_task_wheel_->empty())
+    *next_delayed_work_time = delayed_task_wheel_->NextRunTime();
+
+  return DeferOrRunPendingTask(std::move(pending_task));
+}
+
+void MessageLoop::PurgeCancelledDelayedTasks() {
+  if (delayed_task_wheel_) {
+    delayed_task_wheel_->SweepCancelledTasks(kMaxDelayedTasksToSweep);
+    return;
+  }
+  purged_task_count_ +=
+      delayed_work_queue_.SweepCancelledTasks(kMaxDelayedTasksToSweep);
+}
+
 bool MessageLoop::DoIdleWork() {
   if (ProcessNextDelayedNonNestableTask())
     return true;
 
+  // Cancelled delayed tasks would otherwise hold on to their bound state
+  // until their run time.  The next delayed wakeup may now be earlier than
+  // needed, which DoDelayedWork() copes with.
+  PurgeCancelledDelayedTasks();
+
   if (run_loop_->quit_when_idle_received_)
     pump_->Quit();
 
@@ -597,10 +741,10 @@ void MessageLoop::ReleaseSoonInternal(
 bool MessageLoopForUI::WatchFileDescriptor(
     int fd,
     bool persistent,
-    MessagePumpLibevent::Mode mode,
-    MessagePumpLibevent::FileDescriptorWatcher *controller,
-    MessagePumpLibevent::Watcher *delegate) {
-  return static_cast<MessagePumpLibevent*>(pump_.get())->WatchFileDescriptor(
+    MessagePumpEpoll::Mode mode,
+    MessagePumpEpoll::FileDescriptorWatcher *controller,
+    MessagePumpEpoll::Watcher *delegate) {
+  return static_cast<MessagePumpEpoll*>(pump_.get())->WatchFileDescriptor(
       fd,
       persistent,
       mode,
@@ -639,13 +783,15 @@ bool MessageLoopForIO::WatchFileDescriptor(int fd,
                                            bool persistent,
                                            Mode mode,
                                            FileDescriptorWatcher* controller,
-                                           Watcher* delegate) {
+                                           Watcher* delegate,
+                                           Trigger trigger) {
   return ToPumpIO(pump_.get())->WatchFileDescriptor(
       fd,
       persistent,
       mode,
       controller,
-      delegate);
+      delegate,
+      static_cast<MessagePumpEpoll::Trigger>(trigger));
 }
 #endif
 
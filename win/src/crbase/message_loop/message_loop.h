@@ -8,6 +8,7 @@
 #include <queue>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "crbase/base_export.h"
 #include "crbase/functional/callback_forward.h"
@@ -15,15 +16,18 @@
 #include "crbase/tracing/location.h"
 #include "crbase/macros.h"
 #include "crbase/memory/ref_counted.h"
+#include "crbase/message_loop/delayed_task_wheel.h"
 #include "crbase/message_loop/incoming_task_queue.h"
 #include "crbase/message_loop/message_loop_task_runner.h"
 #include "crbase/message_loop/message_pump.h"
+#include "crbase/message_loop/prioritized_task_queue.h"
 #include "crbase/message_loop/timer_slack.h"
 #include "crbase/observer_list.h"
 #include "crbase/threading/pending_task.h"
 #include "crbase/threading/sequenced_task_runner_helpers.h"
 #include "crbase/synchronization/lock.h"
 #include "crbase/time/time.h"
+#include "crbase/tracing/latency_histogram.h"
 #include "crbase/tracing/tracking_info.h"
 #include "crbase/build_config.h"
 
@@ -31,7 +35,7 @@
 #if defined(MINI_CHROMIUM_OS_WIN)
 #include "crbase/message_loop/message_pump_win.h"
 #elif defined(MINI_CHROMIUM_OS_POSIX)
-#include "crbase/message_loop/message_pump_libevent.h"
+#include "crbase/message_loop/message_pump_epoll.h"
 #endif
 
 namespace cr {
@@ -190,6 +194,25 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
                                   OnceClosure task,
                                   TimeDelta delay);
 
+  // Posts every task of |tasks|, in order, as one batch.  This costs a single
+  // wakeup of the loop instead of one per task.
+  void PostTasks(const tracked_objects::Location& from_here,
+                 std::vector<OnceClosure> tasks);
+
+  // Variants of PostTask and PostDelayedTask that queue the task with the
+  // given |priority|.  Once ready, a task runs before the ready tasks of lower
+  // priorities, but a lower priority is never starved for long; see
+  // PrioritizedTaskQueue.  Posting goes directly to this loop, bypassing a
+  // task runner set with SetTaskRunner().  May be called on any thread.
+  void PostTaskWithPriority(const tracked_objects::Location& from_here,
+                            OnceClosure task,
+                            TaskPriority priority);
+
+  void PostDelayedTaskWithPriority(const tracked_objects::Location& from_here,
+                                   OnceClosure task,
+                                   TimeDelta delay,
+                                   TaskPriority priority);
+
   // A variant on PostTask that deletes the given object.  This is useful
   // if the object needs to live until the next run of the MessageLoop (for
   // example, deleting a RenderProcessHost from within an IPC callback is not
@@ -274,6 +297,32 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
     pump_->SetTimerSlack(timer_slack);
   }
 
+  // Keeps the delayed tasks of this loop in a hierarchical timing wheel
+  // instead of a heap, making the queueing of a delayed task O(1).  Useful
+  // for loops that hold many timeouts.  Tasks with the same run time still
+  // run in the order they were posted.  Must be called on the thread of the
+  // loop before any delayed task reaches it.
+  void EnableDelayedTaskWheel();
+
+  // Returns the number of cancelled delayed tasks that were deleted before
+  // their run time, e.g. tasks bound to an invalidated WeakPtr or posted by a
+  // Timer that was stopped.  Provided for monitoring.
+  size_t GetPurgedCancelledTaskCount() const;
+
+  // Starts recording how long tasks wait before they run.  Off by default,
+  // since it reads the clock when each task is posted and when it runs.  Tasks
+  // posted without a delay before this call are not counted.
+  void EnableQueueingDelayStats();
+
+  // Returns the distribution of how long the tasks of |priority| waited
+  // between becoming ready (posted, or due for a delayed task) and starting
+  // to run, since EnableQueueingDelayStats() or ResetQueueingDelayStats() was
+  // called.  Empty while the stats are off.  May be called on any thread once
+  // EnableQueueingDelayStats() has returned.
+  tracked_objects::LatencyHistogramSnapshot GetQueueingDelaySnapshot(
+      TaskPriority priority) const;
+  void ResetQueueingDelayStats();
+
   // Returns true if this loop is |type|. This allows subclasses (especially
   // those in tests) to specialize how they are identified.
   virtual bool IsType(Type type) const;
@@ -365,11 +414,11 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
   void AddTaskObserver(TaskObserver* task_observer);
   void RemoveTaskObserver(TaskObserver* task_observer);
 
+#if defined(MINI_CHROMIUM_OS_WIN)
   void set_os_modal_loop(bool os_modal_loop) {
     os_modal_loop_ = os_modal_loop;
   }
 
-#if defined(MINI_CHROMIUM_OS_WIN)
   bool os_modal_loop() const {
     return os_modal_loop_;
   }
@@ -392,6 +441,11 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
   // Runs the specified PendingTask.
   void RunTask(PendingTask* pending_task);
 
+  // Tells |incoming_task_queue_| whether posted tasks need their queue time,
+  // which is the case while queueing delay stats are on or task observers
+  // are registered.
+  void UpdateRecordQueueTime();
+
   //----------------------------------------------------------------------------
  protected:
   std::unique_ptr<MessagePump> pump_;
@@ -441,16 +495,23 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
   // cannot be run right now.  Returns true if the task was run.
   bool DeferOrRunPendingTask(PendingTask pending_task);
 
-  // Adds the pending task to delayed_work_queue_.
-  void AddToDelayedWorkQueue(PendingTask pending_task);
+  // Adds the pending task to delayed_work_queue_ or delayed_task_wheel_.
+  // Returns true if the pump has to wake up earlier to run it.
+  bool AddToDelayedWorkQueue(PendingTask pending_task);
+
+  // DoDelayedWork() for loops that use |delayed_task_wheel_|.
+  bool DoDelayedWorkFromWheel(TimeTicks* next_delayed_work_time);
+
+  // Deletes some of the cancelled tasks of the delayed queue.  Called when
+  // the loop is idle, each call resuming where the previous one stopped.
+  void PurgeCancelledDelayedTasks();
 
   // Delete tasks that haven't run yet without running them.  Used in the
   // destructor to make sure all the task's destructors get called.  Returns
   // true if some work was done.
   bool DeletePendingTasks();
 
-  // Loads tasks from the incoming queue to |work_queue_| if the latter is
-  // empty.
+  // Loads the tasks of the incoming queue into |work_queue_|.
   void ReloadWorkQueue();
 
   // Wakes up the message pump. Can be called on any thread. The caller is
@@ -464,9 +525,15 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
 
   const Type type_;
 
-  // A list of tasks that need to be processed by this instance.  Note that
-  // this queue is only accessed (push/pop) by our current thread.
-  TaskQueue work_queue_;
+  // A list of tasks that need to be processed by this instance, queued by
+  // priority.  Note that this queue is only accessed (push/pop) by our current
+  // thread.
+  PrioritizedTaskQueue work_queue_;
+
+  // Queueing delay of the tasks run by this loop, one histogram per
+  // priority.  Null until EnableQueueingDelayStats() is called.
+  std::unique_ptr<tracked_objects::LatencyHistogram[]>
+      queueing_delay_histograms_;
 
 #if defined(MINI_CHROMIUM_OS_WIN)
   // How many high resolution tasks are in the pending task queue. This value
@@ -481,6 +548,13 @@ class CRBASE_EXPORT MessageLoop : public MessagePump::Delegate {
   // Contains delayed tasks, sorted by their 'delayed_run_time' property.
   DelayedTaskQueue delayed_work_queue_;
 
+  // If not null, holds the delayed tasks instead of |delayed_work_queue_|.
+  std::unique_ptr<DelayedTaskWheel> delayed_task_wheel_;
+
+  // Number of cancelled tasks PurgeCancelledDelayedTasks() deleted from
+  // |delayed_work_queue_|.  The wheel keeps its own count.
+  size_t purged_task_count_;
+
   // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
   TimeTicks recent_time_;
 
@@ -561,14 +635,14 @@ class CRBASE_EXPORT MessageLoopForUI : public MessageLoop {
     return loop && loop->type() == MessageLoop::TYPE_UI;
   }
 
-  #if defined(MINI_CHROMIUM_OS_LINUX) 
-  // Please see MessagePumpLibevent for definition.
+#if defined(MINI_CHROMIUM_OS_LINUX)
+  // Please see MessagePumpEpoll for definition.
   bool WatchFileDescriptor(
       int fd,
       bool persistent,
-      MessagePumpLibevent::Mode mode,
-      MessagePumpLibevent::FileDescriptorWatcher* controller,
-      MessagePumpLibevent::Watcher* delegate);
+      MessagePumpEpoll::Mode mode,
+      MessagePumpEpoll::FileDescriptorWatcher* controller,
+      MessagePumpEpoll::Watcher* delegate);
 #endif
 };
 
@@ -607,24 +681,39 @@ class CRBASE_EXPORT MessageLoopForIO : public MessageLoop {
   typedef MessagePumpForIO::IOContext IOContext;
   typedef MessagePumpForIO::IOObserver IOObserver;
 #elif defined(MINI_CHROMIUM_OS_POSIX)
-  typedef MessagePumpLibevent::Watcher Watcher;
-  typedef MessagePumpLibevent::FileDescriptorWatcher
+  typedef MessagePumpEpoll::Watcher Watcher;
+  typedef MessagePumpEpoll::FileDescriptorWatcher
       FileDescriptorWatcher;
-  typedef MessagePumpLibevent::IOObserver IOObserver;
+  typedef MessagePumpEpoll::IOObserver IOObserver;
 
   enum Mode {
-    WATCH_READ = MessagePumpLibevent::WATCH_READ,
-    WATCH_WRITE = MessagePumpLibevent::WATCH_WRITE,
-    WATCH_READ_WRITE = MessagePumpLibevent::WATCH_READ_WRITE
+    WATCH_READ = MessagePumpEpoll::WATCH_READ,
+    WATCH_WRITE = MessagePumpEpoll::WATCH_WRITE,
+    WATCH_READ_WRITE = MessagePumpEpoll::WATCH_READ_WRITE
+  };
+
+  enum Trigger {
+    TRIGGER_LEVEL = MessagePumpEpoll::TRIGGER_LEVEL,
+    TRIGGER_EDGE = MessagePumpEpoll::TRIGGER_EDGE
   };
 #endif
   void AddIOObserver(IOObserver* io_observer);
   void RemoveIOObserver(IOObserver* io_observer);
 
+#if defined(MINI_CHROMIUM_OS_WIN)
   // Please see MessagePumpWin for definitions of these methods.
   void RegisterIOHandler(HANDLE file, IOHandler* handler);
   bool RegisterJobObject(HANDLE job, IOHandler* handler);
   bool WaitForIOCompletion(DWORD timeout, IOHandler* filter);
+#elif defined(MINI_CHROMIUM_OS_POSIX)
+  // Please see MessagePumpEpoll for definition.
+  bool WatchFileDescriptor(int fd,
+                           bool persistent,
+                           Mode mode,
+                           FileDescriptorWatcher* controller,
+                           Watcher* delegate,
+                           Trigger trigger = TRIGGER_LEVEL);
+#endif
 };
 
 // Do not add any member variables to MessageLoopForIO!  This is important b/c
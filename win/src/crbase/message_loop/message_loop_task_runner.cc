@@ -28,7 +28,7 @@ bool MessageLoopTaskRunner::PostDelayedTask(
     cr::TimeDelta delay) {
   CR_DCHECK(!task.is_null()) << from_here.ToString();
   return incoming_queue_->AddToIncomingQueue(
-      from_here, std::move(task), delay, true);
+      from_here, std::move(task), delay, true, TaskPriority::NORMAL);
 }
 
 bool MessageLoopTaskRunner::PostNonNestableDelayedTask(
@@ -37,7 +37,16 @@ bool MessageLoopTaskRunner::PostNonNestableDelayedTask(
     cr::TimeDelta delay) {
   CR_DCHECK(!task.is_null()) << from_here.ToString();
   return incoming_queue_->AddToIncomingQueue(
-      from_here, std::move(task), delay, false);
+      from_here, std::move(task), delay, false, TaskPriority::NORMAL);
+}
+
+bool MessageLoopTaskRunner::PostTasks(
+    const tracked_objects::Location& from_here,
+    std::vector<OnceClosure> tasks) {
+  for (size_t i = 0; i < tasks.size(); ++i)
+    CR_DCHECK(!tasks[i].is_null()) << from_here.ToString();
+  return incoming_queue_->AddTasksToIncomingQueue(
+      from_here, std::move(tasks), true, TaskPriority::NORMAL);
 }
 
 bool MessageLoopTaskRunner::RunsTasksOnCurrentThread() const {
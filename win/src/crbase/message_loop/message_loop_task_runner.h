@@ -39,6 +39,8 @@ class CRBASE_EXPORT MessageLoopTaskRunner : public SingleThreadTaskRunner {
   bool PostNonNestableDelayedTask(const tracked_objects::Location& from_here,
                                   OnceClosure task,
                                   cr::TimeDelta delay) override;
+  bool PostTasks(const tracked_objects::Location& from_here,
+                 std::vector<OnceClosure> tasks) override;
   bool RunsTasksOnCurrentThread() const override;
 
  private:
@@ -0,0 +1,396 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/message_loop/message_pump_epoll.h"
+
+#include <errno.h>
+#include <math.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include "crbase/auto_reset.h"
+#include "crbase/logging.h"
+#include "crbase/posix/eintr_wrapper.h"
+
+namespace cr {
+
+namespace {
+
+// Upper bound on the number of events reaped by a single epoll_wait() call.
+// Events beyond this stay queued in the kernel for the next call.
+const int kMaxEventsPerWait = 64;
+
+// Readiness that should wake up a reader.  Errors and hang-ups are reported
+// to both readers and writers so that the next read()/write() surfaces them.
+const uint32_t kReadableEvents = EPOLLIN | EPOLLPRI | EPOLLRDHUP |
+                                 EPOLLERR | EPOLLHUP;
+const uint32_t kWritableEvents = EPOLLOUT | EPOLLERR | EPOLLHUP;
+
+bool ContainsController(
+    const std::vector<MessagePumpEpoll::FileDescriptorWatcher*>& controllers,
+    MessagePumpEpoll::FileDescriptorWatcher* controller) {
+  return std::find(controllers.begin(), controllers.end(), controller) !=
+         controllers.end();
+}
+
+}  // namespace
+
+MessagePumpEpoll::FileDescriptorWatcher::FileDescriptorWatcher()
+    : fd_(-1),
+      events_(0),
+      persistent_(false),
+      edge_triggered_(false),
+      pump_(NULL),
+      watcher_(NULL),
+      was_destroyed_(NULL) {
+}
+
+MessagePumpEpoll::FileDescriptorWatcher::~FileDescriptorWatcher() {
+  if (pump_)
+    StopWatchingFileDescriptor();
+  if (was_destroyed_) {
+    CR_DCHECK(!*was_destroyed_);
+    *was_destroyed_ = true;
+  }
+}
+
+bool MessagePumpEpoll::FileDescriptorWatcher::StopWatchingFileDescriptor() {
+  if (!pump_)
+    return true;
+
+  bool rv = pump_->StopWatching(this);
+
+  fd_ = -1;
+  events_ = 0;
+  pump_ = NULL;
+  watcher_ = NULL;
+  return rv;
+}
+
+void MessagePumpEpoll::FileDescriptorWatcher::OnFileCanReadWithoutBlocking(
+    int fd, MessagePumpEpoll* pump) {
+  // Since OnFileCanWriteWithoutBlocking() gets called first, it can stop
+  // watching the file descriptor.
+  if (!watcher_)
+    return;
+  pump->WillProcessIOEvent();
+  watcher_->OnFileCanReadWithoutBlocking(fd);
+  pump->DidProcessIOEvent();
+}
+
+void MessagePumpEpoll::FileDescriptorWatcher::OnFileCanWriteWithoutBlocking(
+    int fd, MessagePumpEpoll* pump) {
+  CR_DCHECK(watcher_);
+  pump->WillProcessIOEvent();
+  watcher_->OnFileCanWriteWithoutBlocking(fd);
+  pump->DidProcessIOEvent();
+}
+
+MessagePumpEpoll::EpollEntry::EpollEntry() : registered_events(0) {
+}
+
+MessagePumpEpoll::EpollEntry::~EpollEntry() {
+}
+
+MessagePumpEpoll::MessagePumpEpoll()
+    : keep_running_(true),
+      have_work_(0) {
+  epoll_fd_.reset(epoll_create1(EPOLL_CLOEXEC));
+  CR_PCHECK(epoll_fd_.is_valid());
+
+  wakeup_fd_.reset(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+  CR_PCHECK(wakeup_fd_.is_valid());
+
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = wakeup_fd_.get();
+  int rv = epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, wakeup_fd_.get(), &event);
+  CR_PCHECK(rv == 0);
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() {
+  // Any controller still attached would otherwise dangle on |this|.
+  while (!entries_.empty()) {
+    EpollEntry& entry = entries_.begin()->second;
+    CR_DCHECK(!entry.controllers.empty());
+    entry.controllers.front()->StopWatchingFileDescriptor();
+  }
+}
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           int mode,
+                                           FileDescriptorWatcher* controller,
+                                           Watcher* delegate,
+                                           Trigger trigger) {
+  CR_DCHECK_GE(fd, 0);
+  CR_DCHECK(controller);
+  CR_DCHECK(delegate);
+  CR_DCHECK(mode == WATCH_READ || mode == WATCH_WRITE ||
+            mode == WATCH_READ_WRITE);
+  // WatchFileDescriptor should be called on the pump thread. It is not
+  // threadsafe, and your watcher may never be registered.
+  CR_DCHECK(watch_file_descriptor_caller_checker_.CalledOnValidThread());
+
+  uint32_t events = 0;
+  if (mode & WATCH_READ)
+    events |= EPOLLIN;
+  if (mode & WATCH_WRITE)
+    events |= EPOLLOUT;
+
+  if (controller->pump_) {
+    // Make this watch cumulative with the one already attached.
+    if (controller->pump_ != this || controller->fd_ != fd) {
+      CR_NOTREACHED() << "FDs don't match: " << controller->fd_
+                      << " != " << fd;
+      return false;
+    }
+    events |= controller->events_;
+  }
+
+  controller->fd_ = fd;
+  controller->events_ = events;
+  controller->persistent_ = persistent;
+  controller->edge_triggered_ = trigger == TRIGGER_EDGE;
+  controller->pump_ = this;
+  controller->watcher_ = delegate;
+
+  EpollEntry& entry = entries_[fd];
+  if (!ContainsController(entry.controllers, controller))
+    entry.controllers.push_back(controller);
+
+  if (!UpdateEpollRegistration(fd, &entry)) {
+    controller->StopWatchingFileDescriptor();
+    return false;
+  }
+  return true;
+}
+
+void MessagePumpEpoll::AddIOObserver(IOObserver *obs) {
+  io_observers_.AddObserver(obs);
+}
+
+void MessagePumpEpoll::RemoveIOObserver(IOObserver *obs) {
+  io_observers_.RemoveObserver(obs);
+}
+
+void MessagePumpEpoll::Run(Delegate* delegate) {
+  AutoReset<bool> auto_reset_keep_running(&keep_running_, true);
+
+  for (;;) {
+    bool did_work = delegate->DoWork();
+    if (!keep_running_)
+      break;
+
+    did_work |= WaitForEpollEvents(0);
+    if (!keep_running_)
+      break;
+
+    did_work |= delegate->DoDelayedWork(&delayed_work_time_);
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    did_work = delegate->DoIdleWork();
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    WaitForEpollEvents(GetCurrentDelay());
+  }
+}
+
+void MessagePumpEpoll::Quit() {
+  CR_DCHECK(keep_running_) << "Quit was called outside of Run!";
+  keep_running_ = false;
+}
+
+void MessagePumpEpoll::ScheduleWork() {
+  if (subtle::NoBarrier_AtomicExchange(&have_work_, 1))
+    return;  // Someone else continued the pumping.
+
+  // Tell epoll that we have work to do.
+  const uint64_t one = 1;
+  ssize_t nwrite = HANDLE_EINTR(write(wakeup_fd_.get(), &one, sizeof(one)));
+  CR_DPCHECK(nwrite == static_cast<ssize_t>(sizeof(one)) || errno == EAGAIN)
+      << "[nwrite:" << nwrite << "] [errno:" << errno << "]";
+}
+
+void MessagePumpEpoll::ScheduleDelayedWork(
+    const TimeTicks& delayed_work_time) {
+  // We know that we can't be blocked on Wait right now since this method can
+  // only be called on the same thread as Run, so we only need to update our
+  // record of how long to sleep when we do sleep.
+  delayed_work_time_ = delayed_work_time;
+}
+
+bool MessagePumpEpoll::StopWatching(FileDescriptorWatcher* controller) {
+  auto it = entries_.find(controller->fd_);
+  if (it == entries_.end())
+    return false;
+
+  std::vector<FileDescriptorWatcher*>& controllers = it->second.controllers;
+  auto pos = std::find(controllers.begin(), controllers.end(), controller);
+  if (pos == controllers.end())
+    return false;
+  controllers.erase(pos);
+
+  return UpdateEpollRegistration(controller->fd_, &it->second);
+}
+
+bool MessagePumpEpoll::UpdateEpollRegistration(int fd, EpollEntry* entry) {
+  if (entry->controllers.empty()) {
+    bool rv = true;
+    if (entry->registered_events) {
+      epoll_event event = {};
+      // The descriptor may already have been closed by its owner, in which
+      // case the kernel has dropped it from the interest list by itself.
+      if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, fd, &event) != 0 &&
+          errno != EBADF && errno != ENOENT) {
+        CR_DPLOG(ERROR) << "epoll_ctl(EPOLL_CTL_DEL)";
+        rv = false;
+      }
+    }
+    entries_.erase(fd);
+    return rv;
+  }
+
+  uint32_t events = 0;
+  bool edge_triggered = true;
+  for (FileDescriptorWatcher* controller : entry->controllers) {
+    events |= controller->events_;
+    edge_triggered &= controller->edge_triggered_;
+  }
+  // Edge triggering is only used when every watcher of the FD asked for it;
+  // a level-triggered watcher would otherwise miss readiness it has not
+  // consumed yet.
+  if (edge_triggered)
+    events |= EPOLLET;
+
+  if (events == entry->registered_events)
+    return true;
+
+  epoll_event event;
+  event.events = events;
+  event.data.fd = fd;
+  int op = entry->registered_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (epoll_ctl(epoll_fd_.get(), op, fd, &event) != 0) {
+    CR_DPLOG(ERROR) << "epoll_ctl(" << op << ")";
+    return false;
+  }
+  entry->registered_events = events;
+  return true;
+}
+
+bool MessagePumpEpoll::WaitForEpollEvents(int timeout_ms) {
+  epoll_event events[kMaxEventsPerWait];
+  int count =
+      epoll_wait(epoll_fd_.get(), events, kMaxEventsPerWait, timeout_ms);
+  if (count < 0) {
+    CR_DPCHECK(errno == EINTR) << "epoll_wait";
+    return false;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == wakeup_fd_.get())
+      OnWakeup();
+    else
+      OnEpollEvent(events[i].data.fd, events[i].events);
+  }
+  return count > 0;
+}
+
+void MessagePumpEpoll::OnEpollEvent(int fd, uint32_t events) {
+  auto it = entries_.find(fd);
+  if (it == entries_.end())
+    return;  // Stopped by an earlier callback of the same batch.
+
+  // Callbacks may add, stop or destroy any controller of |fd|, so work on a
+  // copy and check that each controller is still attached before using it.
+  std::vector<FileDescriptorWatcher*> controllers(it->second.controllers);
+  for (FileDescriptorWatcher* controller : controllers) {
+    it = entries_.find(fd);
+    if (it == entries_.end())
+      return;
+    if (!ContainsController(it->second.controllers, controller))
+      continue;
+
+    bool can_write = (controller->events_ & EPOLLOUT) &&
+                     (events & kWritableEvents);
+    bool can_read = (controller->events_ & EPOLLIN) &&
+                    (events & kReadableEvents);
+    if (!can_write && !can_read)
+      continue;
+
+    Watcher* watcher = controller->watcher_;
+    if (!controller->persistent_) {
+      // One-shot watches are disarmed before the callback so that the
+      // callback is free to watch the descriptor again.
+      controller->StopWatchingFileDescriptor();
+      controller->watcher_ = watcher;
+    }
+
+    bool controller_was_destroyed = false;
+    controller->was_destroyed_ = &controller_was_destroyed;
+    if (can_write)
+      controller->OnFileCanWriteWithoutBlocking(fd, this);
+    if (!controller_was_destroyed && can_read)
+      controller->OnFileCanReadWithoutBlocking(fd, this);
+    if (!controller_was_destroyed) {
+      controller->was_destroyed_ = NULL;
+      if (!controller->pump_)
+        controller->watcher_ = NULL;
+    }
+  }
+}
+
+void MessagePumpEpoll::OnWakeup() {
+  uint64_t value;
+  ssize_t nread = HANDLE_EINTR(read(wakeup_fd_.get(), &value, sizeof(value)));
+  CR_DPCHECK(nread == static_cast<ssize_t>(sizeof(value)) || errno == EAGAIN);
+
+  // Allow new wakeups once the pending one has been consumed.  The fence
+  // orders the clear before the DoWork() that follows reads the queue: a
+  // poster either sees |have_work_| cleared and writes the eventfd, or has
+  // its task picked up by that DoWork().
+  subtle::NoBarrier_AtomicExchange(&have_work_, 0);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+int MessagePumpEpoll::GetCurrentDelay() const {
+  if (delayed_work_time_.is_null())
+    return -1;
+
+  // Be careful here.  TimeDelta has a precision of microseconds, but we want a
+  // value in milliseconds.  If there are 5.5ms left, should the delay be 5 or
+  // 6?  It should be 6 to avoid executing delayed work too early.
+  double timeout =
+      ceil((delayed_work_time_ - TimeTicks::Now()).InMillisecondsF());
+
+  // Range check the |timeout| while converting to an integer.  If the
+  // |timeout| is negative, then we need to run delayed work soon.  If the
+  // |timeout| is "overflowingly" large, that means a delayed task was posted
+  // with a super-long delay.
+  return timeout < 0 ? 0 :
+      (timeout > std::numeric_limits<int>::max() ?
+       std::numeric_limits<int>::max() : static_cast<int>(timeout));
+}
+
+void MessagePumpEpoll::WillProcessIOEvent() {
+  CR_FOR_EACH_OBSERVER(IOObserver, io_observers_, WillProcessIOEvent());
+}
+
+void MessagePumpEpoll::DidProcessIOEvent() {
+  CR_FOR_EACH_OBSERVER(IOObserver, io_observers_, DidProcessIOEvent());
+}
+
+}  // namespace cr
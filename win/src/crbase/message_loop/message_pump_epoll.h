@@ -0,0 +1,211 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "crbase/atomic/atomicops.h"
+#include "crbase/base_export.h"
+#include "crbase/files/scoped_file.h"
+#include "crbase/message_loop/message_pump.h"
+#include "crbase/observer_list.h"
+#include "crbase/threading/thread_checker.h"
+#include "crbase/time/time.h"
+
+namespace cr {
+
+// Class to monitor sockets and issue callbacks when sockets are ready for I/O.
+// This is the Linux counterpart of MessagePumpForIO: instead of completion
+// ports it waits on an epoll instance, wakes up through an eventfd when work
+// is posted from another thread and uses the epoll_wait() timeout to run
+// delayed work.
+class CRBASE_EXPORT MessagePumpEpoll : public MessagePump {
+ public:
+  class IOObserver {
+   public:
+    IOObserver() {}
+
+    // An IOObserver is an object that receives IO notifications from the
+    // MessagePump.
+    //
+    // NOTE: An IOObserver implementation should be extremely fast!
+    virtual void WillProcessIOEvent() = 0;
+    virtual void DidProcessIOEvent() = 0;
+
+   protected:
+    virtual ~IOObserver() {}
+  };
+
+  // Used with WatchFileDescriptor to asynchronously monitor the I/O readiness
+  // of a file descriptor.
+  class Watcher {
+   public:
+    // Called from MessageLoop::Run when an FD can be read from/written to
+    // without blocking
+    virtual void OnFileCanReadWithoutBlocking(int fd) = 0;
+    virtual void OnFileCanWriteWithoutBlocking(int fd) = 0;
+
+   protected:
+    virtual ~Watcher() {}
+  };
+
+  // Object returned by WatchFileDescriptor to manage further watching.
+  class CRBASE_EXPORT FileDescriptorWatcher {
+   public:
+    FileDescriptorWatcher(const FileDescriptorWatcher&) = delete;
+    FileDescriptorWatcher& operator=(const FileDescriptorWatcher&) = delete;
+
+    FileDescriptorWatcher();
+    ~FileDescriptorWatcher();  // Implicitly calls StopWatchingFileDescriptor.
+
+    // NOTE: These methods aren't called StartWatching()/StopWatching() to
+    // avoid confusion with the win32 ObjectWatcher class.
+
+    // Stop watching the FD, always safe to call.  No-op if there's nothing
+    // to do.
+    bool StopWatchingFileDescriptor();
+
+   private:
+    friend class MessagePumpEpoll;
+
+    // Called by MessagePumpEpoll.
+    void OnFileCanReadWithoutBlocking(int fd, MessagePumpEpoll* pump);
+    void OnFileCanWriteWithoutBlocking(int fd, MessagePumpEpoll* pump);
+
+    // The watched descriptor, or -1 when not watching.
+    int fd_;
+
+    // EPOLLIN and/or EPOLLOUT requested by this watcher.
+    uint32_t events_;
+
+    // True if the watcher stays registered after the first notification.
+    bool persistent_;
+
+    // True if the watcher asked for edge-triggered notifications.
+    bool edge_triggered_;
+
+    MessagePumpEpoll* pump_;
+    Watcher* watcher_;
+
+    // If this pointer is non-NULL, the pointee is set to true in the
+    // destructor.
+    bool* was_destroyed_;
+  };
+
+  enum Mode {
+    WATCH_READ = 1 << 0,
+    WATCH_WRITE = 1 << 1,
+    WATCH_READ_WRITE = WATCH_READ | WATCH_WRITE
+  };
+
+  // TRIGGER_LEVEL keeps notifying the watcher for as long as the descriptor
+  // stays readable/writable.  TRIGGER_EDGE only notifies when the readiness
+  // changes, so the watcher must drain the descriptor until EAGAIN before it
+  // can expect another notification.
+  enum Trigger {
+    TRIGGER_LEVEL,
+    TRIGGER_EDGE
+  };
+
+  MessagePumpEpoll(const MessagePumpEpoll&) = delete;
+  MessagePumpEpoll& operator=(const MessagePumpEpoll&) = delete;
+
+  MessagePumpEpoll();
+  ~MessagePumpEpoll() override;
+
+  // Have the current thread's message loop watch for a a situation in which
+  // reading/writing to the FD can be performed without blocking.
+  // Callers must provide a preallocated FileDescriptorWatcher object which
+  // can later be used to manage the lifetime of this event.
+  // If a FileDescriptorWatcher is passed in which is already attached to
+  // an event, then the effect is cumulative i.e. after the call |controller|
+  // will watch both the previous event and the new one.
+  // If an error occurs while calling this method in a cumulative fashion, the
+  // event previously attached to |controller| is aborted.
+  // Returns true on success.
+  // Must be called on the same thread the message_pump is running on.
+  // Several controllers may watch the same FD at once, for instance one for
+  // reading and one for writing.
+  bool WatchFileDescriptor(int fd,
+                           bool persistent,
+                           int mode,
+                           FileDescriptorWatcher* controller,
+                           Watcher* delegate,
+                           Trigger trigger = TRIGGER_LEVEL);
+
+  void AddIOObserver(IOObserver* obs);
+  void RemoveIOObserver(IOObserver* obs);
+
+  // MessagePump methods:
+  void Run(Delegate* delegate) override;
+  void Quit() override;
+  void ScheduleWork() override;
+  void ScheduleDelayedWork(const TimeTicks& delayed_work_time) override;
+
+ private:
+  // All the controllers currently watching one file descriptor.  The events
+  // registered with epoll are the union of what each controller asked for.
+  struct EpollEntry {
+    EpollEntry();
+    ~EpollEntry();
+
+    uint32_t registered_events;
+    std::vector<FileDescriptorWatcher*> controllers;
+  };
+
+  // Removes |controller| from the entry of its FD and updates the epoll
+  // registration accordingly.
+  bool StopWatching(FileDescriptorWatcher* controller);
+
+  // Recomputes the epoll interest set for |fd| after its controller list
+  // changed.  Removes the FD from epoll once no controller is left.
+  bool UpdateEpollRegistration(int fd, EpollEntry* entry);
+
+  // Waits up to |timeout_ms| (-1 for forever) for file descriptor events or a
+  // wakeup and dispatches them.  Returns true if any event was processed.
+  bool WaitForEpollEvents(int timeout_ms);
+
+  // Dispatches one epoll event to the controllers watching its FD.
+  void OnEpollEvent(int fd, uint32_t events);
+
+  // Drains the wakeup eventfd.
+  void OnWakeup();
+
+  // Returns the epoll_wait() timeout matching |delayed_work_time_|.
+  int GetCurrentDelay() const;
+
+  void WillProcessIOEvent();
+  void DidProcessIOEvent();
+
+  // This flag is set to false when Run should return.
+  bool keep_running_;
+
+  // The time at which we should call DoDelayedWork.
+  TimeTicks delayed_work_time_;
+
+  // The epoll instance all file descriptors are registered with.
+  ScopedFD epoll_fd_;
+
+  // eventfd used to wake up epoll_wait() from ScheduleWork().
+  ScopedFD wakeup_fd_;
+
+  // Set to 1 while a wakeup is pending in |wakeup_fd_| so that concurrent
+  // ScheduleWork() calls don't write the eventfd more than once.
+  subtle::Atomic32 have_work_;
+
+  std::unordered_map<int, EpollEntry> entries_;
+
+  ObserverList<IOObserver> io_observers_;
+  ThreadChecker watch_file_descriptor_caller_checker_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
@@ -0,0 +1,515 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/message_loop/message_pump_io_uring.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <math.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include "crbase/auto_reset.h"
+#include "crbase/logging.h"
+#include "crbase/posix/eintr_wrapper.h"
+
+namespace cr {
+
+namespace {
+
+// Number of submission entries.  The kernel sizes the completion ring at
+// twice this value.
+const unsigned kRingEntries = 256;
+
+// user_data values of the pump's own entries.  IOContext pointers are at least
+// 8-byte aligned, so their low three bits are always clear and can be used to
+// tell them apart.
+const uint64_t kUserDataTagMask = 7;
+const uint64_t kWakeupTag = 1;
+const uint64_t kTimeoutTag = 2;
+const uint64_t kTimeoutRemoveTag = 3;
+const uint64_t kCancelTag = 4;
+
+int IOUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IOUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, NULL, 0));
+}
+
+// The ring indices are shared with the kernel and must be accessed with
+// acquire/release semantics.
+unsigned LoadAcquire(const unsigned* index) {
+  return static_cast<unsigned>(subtle::Acquire_Load(
+      reinterpret_cast<volatile const subtle::Atomic32*>(index)));
+}
+
+void StoreRelease(unsigned* index, unsigned value) {
+  subtle::Release_Store(reinterpret_cast<volatile subtle::Atomic32*>(index),
+                        static_cast<subtle::Atomic32>(value));
+}
+
+template <typename T>
+T* RingPointer(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+static_assert(sizeof(unsigned) == sizeof(subtle::Atomic32),
+              "ring indices must be 32-bit");
+
+MessagePumpIOUring::MessagePumpIOUring()
+    : keep_running_(true),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_array_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      sqes_(NULL),
+      sqes_size_(0),
+      sqe_tail_(0),
+      submit_limit_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cqes_(NULL),
+      wakeup_value_(0),
+      have_work_(0),
+      timeout_armed_(false),
+      timeout_sequence_(0) {
+  static_assert(sizeof(timeout_spec_) == sizeof(__kernel_timespec),
+                "TimeoutSpec must match __kernel_timespec");
+  MapRings();
+
+  // The eventfd is left blocking: the kernel parks the read until
+  // ScheduleWork() writes it instead of failing it with EAGAIN.
+  wakeup_fd_.reset(eventfd(0, EFD_CLOEXEC));
+  CR_PCHECK(wakeup_fd_.is_valid());
+  ArmWakeup();
+}
+
+MessagePumpIOUring::~MessagePumpIOUring() {
+  // Closing the ring cancels whatever is still in flight.
+  if (sqes_)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != MAP_FAILED)
+    munmap(sq_ring_, sq_ring_size_);
+}
+
+void MessagePumpIOUring::MapRings() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_.reset(IOUringSetup(kRingEntries, &params));
+  CR_PCHECK(ring_fd_.is_valid()) << "io_uring_setup";
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+  sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_.get(),
+                  IORING_OFF_SQ_RING);
+  CR_PCHECK(sq_ring_ != MAP_FAILED);
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_.get(),
+                    IORING_OFF_CQ_RING);
+    CR_PCHECK(cq_ring_ != MAP_FAILED);
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_.get(),
+                    IORING_OFF_SQES);
+  CR_PCHECK(sqes != MAP_FAILED);
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sq_head_ = RingPointer<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingPointer<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_array_ = RingPointer<unsigned>(sq_ring_, params.sq_off.array);
+  sq_mask_ = *RingPointer<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_entries_ = *RingPointer<unsigned>(sq_ring_, params.sq_off.ring_entries);
+  sqe_tail_ = *sq_tail_;
+
+  cq_head_ = RingPointer<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingPointer<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *RingPointer<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingPointer<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+bool MessagePumpIOUring::Read(int fd, void* buffer, size_t length,
+                              IOContext* context) {
+  CR_DCHECK(context && context->handler);
+  io_uring_sqe* sqe = GetSubmissionEntry();
+  if (!sqe)
+    return false;
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer);
+  sqe->len = static_cast<uint32_t>(length);
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->user_data = reinterpret_cast<uint64_t>(context);
+  return true;
+}
+
+bool MessagePumpIOUring::Write(int fd, const void* buffer, size_t length,
+                               IOContext* context) {
+  CR_DCHECK(context && context->handler);
+  io_uring_sqe* sqe = GetSubmissionEntry();
+  if (!sqe)
+    return false;
+  sqe->opcode = IORING_OP_WRITE;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buffer);
+  sqe->len = static_cast<uint32_t>(length);
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->user_data = reinterpret_cast<uint64_t>(context);
+  return true;
+}
+
+bool MessagePumpIOUring::Accept(int fd, sockaddr* address,
+                                socklen_t* address_length,
+                                IOContext* context) {
+  CR_DCHECK(context && context->handler);
+  io_uring_sqe* sqe = GetSubmissionEntry();
+  if (!sqe)
+    return false;
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(address);
+  sqe->addr2 = reinterpret_cast<uint64_t>(address_length);
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = reinterpret_cast<uint64_t>(context);
+  return true;
+}
+
+bool MessagePumpIOUring::Cancel(IOContext* context) {
+  io_uring_sqe* sqe = GetSubmissionEntry();
+  if (!sqe)
+    return false;
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = reinterpret_cast<uint64_t>(context);
+  sqe->user_data = kCancelTag;
+  return true;
+}
+
+bool MessagePumpIOUring::WaitForIOCompletion(int timeout_ms,
+                                             IOHandler* filter) {
+  IOItem item;
+  if (completed_io_.empty() || !MatchCompletedIOItem(filter, &item)) {
+    // We have to ask the system for another IO completion.
+    if (!GetIOItem(timeout_ms, &item))
+      return false;
+
+    if (!item.context)
+      return true;  // One of our internal completions.
+  }
+
+  if (item.context->handler) {
+    if (filter && item.handler != filter) {
+      // Save this item for later
+      completed_io_.push_back(item);
+    } else {
+      CR_DCHECK_EQ(item.context->handler, item.handler);
+      WillProcessIOEvent();
+      item.handler->OnIOCompleted(item.context, item.bytes_transfered,
+                                  item.error);
+      DidProcessIOEvent();
+    }
+  } else {
+    // The handler must be gone by now, just cleanup the mess.
+    delete item.context;
+  }
+  return true;
+}
+
+void MessagePumpIOUring::AddIOObserver(IOObserver *obs) {
+  io_observers_.AddObserver(obs);
+}
+
+void MessagePumpIOUring::RemoveIOObserver(IOObserver *obs) {
+  io_observers_.RemoveObserver(obs);
+}
+
+void MessagePumpIOUring::Run(Delegate* delegate) {
+  AutoReset<bool> auto_reset_keep_running(&keep_running_, true);
+
+  for (;;) {
+    bool more_work_is_plausible = delegate->DoWork();
+    if (!keep_running_)
+      break;
+
+    // Submits whatever the tasks above queued and reaps the completions that
+    // are ready, without blocking.
+    SubmitAndWait(0);
+    more_work_is_plausible |= ProcessCompletions();
+    if (!keep_running_)
+      break;
+
+    more_work_is_plausible |= delegate->DoDelayedWork(&delayed_work_time_);
+    if (!keep_running_)
+      break;
+
+    if (more_work_is_plausible)
+      continue;
+
+    more_work_is_plausible = delegate->DoIdleWork();
+    if (!keep_running_)
+      break;
+
+    if (more_work_is_plausible)
+      continue;
+
+    // Wait (sleep) until we have work to do again.
+    SubmitAndWait(GetCurrentDelay());
+  }
+}
+
+void MessagePumpIOUring::Quit() {
+  CR_DCHECK(keep_running_) << "Quit was called outside of Run!";
+  keep_running_ = false;
+}
+
+void MessagePumpIOUring::ScheduleWork() {
+  if (subtle::NoBarrier_AtomicExchange(&have_work_, 1))
+    return;  // Someone else continued the pumping.
+
+  const uint64_t one = 1;
+  ssize_t nwrite = HANDLE_EINTR(write(wakeup_fd_.get(), &one, sizeof(one)));
+  CR_DPCHECK(nwrite == static_cast<ssize_t>(sizeof(one)));
+}
+
+void MessagePumpIOUring::ScheduleDelayedWork(
+    const TimeTicks& delayed_work_time) {
+  // We know that we can't be blocked right now since this method can only be
+  // called on the same thread as Run, so we only need to update our record of
+  // how long to sleep when we do sleep.
+  delayed_work_time_ = delayed_work_time;
+}
+
+io_uring_sqe* MessagePumpIOUring::GetSubmissionEntry() {
+  if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+    // The queue is full: hand it to the kernel now rather than failing.
+    SubmitAndWait(0);
+    if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_)
+      return NULL;
+  }
+
+  unsigned index = sqe_tail_ & sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  ++sqe_tail_;
+  return sqe;
+}
+
+void MessagePumpIOUring::SubmitAndWait(int timeout_ms) {
+  unsigned min_complete = 0;
+  unsigned flags = 0;
+  if (timeout_ms != 0 && LoadAcquire(cq_tail_) == *cq_head_) {
+    if (timeout_ms > 0)
+      ArmTimeout(TimeTicks::Now() + TimeDelta::FromMilliseconds(timeout_ms));
+    min_complete = 1;
+    flags |= IORING_ENTER_GETEVENTS;
+  }
+
+  // Count from the kernel's head rather than from the last published tail:
+  // entries left over by a short or failed submit, possibly the wakeup read,
+  // must be submitted again.
+  StoreRelease(sq_tail_, sqe_tail_);
+  unsigned to_submit = sqe_tail_ - LoadAcquire(sq_head_);
+  if (submit_limit_)
+    to_submit = std::min(to_submit, submit_limit_);
+  if (!to_submit && !min_complete)
+    return;
+
+  int rv = IOUringEnter(ring_fd_.get(), to_submit, min_complete, flags);
+  // EINTR and EBUSY (completion ring overflowing) are resolved by reaping
+  // completions, which the caller does next.
+  CR_DPCHECK(rv >= 0 || errno == EINTR || errno == EBUSY || errno == EAGAIN)
+      << "io_uring_enter";
+}
+
+bool MessagePumpIOUring::PopCompletion(uint64_t* user_data, int32_t* result) {
+  unsigned head = *cq_head_;
+  if (head == LoadAcquire(cq_tail_))
+    return false;
+
+  const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+  *user_data = cqe.user_data;
+  *result = cqe.res;
+  StoreRelease(cq_head_, head + 1);
+  return true;
+}
+
+bool MessagePumpIOUring::GetIOItem(int timeout_ms, IOItem* item) {
+  uint64_t user_data;
+  int32_t result;
+  if (!PopCompletion(&user_data, &result)) {
+    SubmitAndWait(timeout_ms);
+    if (!PopCompletion(&user_data, &result))
+      return false;
+  }
+
+  memset(item, 0, sizeof(*item));
+  if (ProcessInternalIOItem(user_data, result))
+    return true;
+
+  item->context = reinterpret_cast<IOContext*>(user_data);
+  item->handler = item->context->handler;
+  if (result < 0) {
+    item->error = -result;
+    item->bytes_transfered = 0;
+  } else {
+    item->bytes_transfered = result;
+  }
+  return true;
+}
+
+bool MessagePumpIOUring::ProcessInternalIOItem(uint64_t user_data,
+                                               int32_t result) {
+  switch (user_data & kUserDataTagMask) {
+    case 0:
+      return false;
+    case kWakeupTag:
+      // Allow new wakeups once the pending one has been consumed.  Work
+      // posted before this point is picked up by the DoWork() that follows.
+      CR_DCHECK_EQ(result, static_cast<int32_t>(sizeof(wakeup_value_)));
+      // See MessagePumpEpoll::OnWakeup() for the fence.
+      subtle::NoBarrier_AtomicExchange(&have_work_, 0);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      ArmWakeup();
+      return true;
+    case kTimeoutTag:
+      if ((user_data >> 3) == timeout_sequence_)
+        timeout_armed_ = false;
+      return true;
+    default:
+      // Results of timeout removals and cancellations need no handling.
+      return true;
+  }
+}
+
+bool MessagePumpIOUring::MatchCompletedIOItem(IOHandler* filter,
+                                              IOItem* item) {
+  CR_DCHECK(!completed_io_.empty());
+  for (std::list<IOItem>::iterator it = completed_io_.begin();
+       it != completed_io_.end(); ++it) {
+    if (!filter || it->handler == filter) {
+      *item = *it;
+      completed_io_.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MessagePumpIOUring::ProcessCompletions() {
+  // Completions arriving while the handlers run are left for the next pass so
+  // that tasks are not starved by a busy ring.
+  size_t available = LoadAcquire(cq_tail_) - *cq_head_ + completed_io_.size();
+  bool did_work = false;
+  for (; available > 0 && keep_running_; --available)
+    did_work |= WaitForIOCompletion(0, NULL);
+  return did_work;
+}
+
+void MessagePumpIOUring::ArmWakeup() {
+  io_uring_sqe* sqe = GetSubmissionEntry();
+  CR_CHECK(sqe);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = wakeup_fd_.get();
+  sqe->addr = reinterpret_cast<uint64_t>(&wakeup_value_);
+  sqe->len = sizeof(wakeup_value_);
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->user_data = kWakeupTag;
+}
+
+void MessagePumpIOUring::ArmTimeout(TimeTicks deadline) {
+  // A pending timeout that fires no later than |deadline| already bounds the
+  // wait; an earlier wakeup simply lets the loop recompute the delay.
+  if (timeout_armed_ && timeout_deadline_ <= deadline)
+    return;
+
+  if (timeout_armed_) {
+    io_uring_sqe* sqe = GetSubmissionEntry();
+    if (sqe) {
+      sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+      sqe->fd = -1;
+      sqe->addr = (timeout_sequence_ << 3) | kTimeoutTag;
+      sqe->user_data = kTimeoutRemoveTag;
+    }
+  }
+
+  io_uring_sqe* sqe = GetSubmissionEntry();
+  if (!sqe)
+    return;
+
+  // The kernel copies |timeout_spec_| when the entry is submitted, which
+  // happens in the io_uring_enter() call that follows.
+  TimeDelta delay = std::max(deadline - TimeTicks::Now(), TimeDelta());
+  timeout_spec_.tv_sec = delay.InSeconds();
+  timeout_spec_.tv_nsec =
+      (delay - TimeDelta::FromSeconds(timeout_spec_.tv_sec)).InMicroseconds() *
+      Time::kNanosecondsPerMicrosecond;
+
+  ++timeout_sequence_;
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->fd = -1;
+  sqe->addr = reinterpret_cast<uint64_t>(&timeout_spec_);
+  sqe->len = 1;
+  sqe->user_data = (timeout_sequence_ << 3) | kTimeoutTag;
+  timeout_armed_ = true;
+  timeout_deadline_ = deadline;
+}
+
+int MessagePumpIOUring::GetCurrentDelay() const {
+  if (delayed_work_time_.is_null())
+    return -1;
+
+  // Be careful here.  TimeDelta has a precision of microseconds, but we want a
+  // value in milliseconds.  If there are 5.5ms left, should the delay be 5 or
+  // 6?  It should be 6 to avoid executing delayed work too early.
+  double timeout =
+      ceil((delayed_work_time_ - TimeTicks::Now()).InMillisecondsF());
+
+  // A zero timeout would not block, so a due timer simply lets the loop
+  // come back to DoDelayedWork.
+  return timeout < 0 ? 0 :
+      (timeout > std::numeric_limits<int>::max() ?
+       std::numeric_limits<int>::max() : static_cast<int>(timeout));
+}
+
+void MessagePumpIOUring::WillProcessIOEvent() {
+  CR_FOR_EACH_OBSERVER(IOObserver, io_observers_, WillProcessIOEvent());
+}
+
+void MessagePumpIOUring::DidProcessIOEvent() {
+  CR_FOR_EACH_OBSERVER(IOObserver, io_observers_, DidProcessIOEvent());
+}
+
+}  // namespace cr
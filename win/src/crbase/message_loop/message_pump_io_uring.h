@@ -0,0 +1,232 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_MESSAGE_PUMP_IO_URING_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_MESSAGE_PUMP_IO_URING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <list>
+
+#include "crbase/atomic/atomicops.h"
+#include "crbase/base_export.h"
+#include "crbase/files/scoped_file.h"
+#include "crbase/message_loop/message_pump.h"
+#include "crbase/observer_list.h"
+#include "crbase/time/time.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace cr {
+
+//-----------------------------------------------------------------------------
+// MessagePumpIOUring is a Linux MessagePump built on io_uring.  It keeps the
+// completion model of MessagePumpForIO (see message_pump_win.h): an operation
+// is started with an IOContext whose |handler| is called back through
+// IOHandler::OnIOCompleted once the kernel has finished it, so code written
+// for overlapped I/O can be ported without a readiness-to-completion layer.
+//
+// Read, Write and Accept only queue a submission entry.  Everything queued
+// while tasks and completions run is handed to the kernel by the single
+// io_uring_enter() call the pump makes before it goes back to sleep, and all
+// the completions available at that point are reaped from the shared ring
+// without further system calls.
+//
+// Unlike epoll, io_uring waits by itself for descriptors that are not ready,
+// so sockets and pipes should be left in blocking mode; a descriptor with
+// O_NONBLOCK set may complete with EAGAIN instead.
+//
+// The pump is used through MessageLoop's TYPE_CUSTOM constructor, e.g.
+//   MessagePumpIOUring* pump = new MessagePumpIOUring();
+//   MessageLoop loop(std::unique_ptr<MessagePump>(pump));
+//
+class CRBASE_EXPORT MessagePumpIOUring : public MessagePump {
+ public:
+  struct IOContext;
+
+  // Same contract as MessagePumpForIO::IOHandler.  |error| is the errno value
+  // of the operation (0 if there was no error).  |bytes_transfered| is zero on
+  // error; for Accept it holds the accepted descriptor instead.
+  class IOHandler {
+   public:
+    virtual ~IOHandler() {}
+    virtual void OnIOCompleted(IOContext* context, int bytes_transfered,
+                               int error) = 0;
+  };
+
+  // An IOObserver is an object that receives IO notifications from the
+  // MessagePump.
+  //
+  // NOTE: An IOObserver implementation should be extremely fast!
+  class IOObserver {
+   public:
+    IOObserver() {}
+
+    virtual void WillProcessIOEvent() = 0;
+    virtual void DidProcessIOEvent() = 0;
+
+   protected:
+    virtual ~IOObserver() {}
+  };
+
+  // The context that identifies an operation, the equivalent of the OVERLAPPED
+  // based IOContext on Windows.  It and every buffer handed to the operation
+  // must stay alive until the completion is delivered.  |handler| can be set
+  // to NULL before the operation completes to indicate that the handler
+  // should not be called anymore, and instead, the IOContext should be
+  // deleted when the kernel reports the completion.
+  struct IOContext {
+    IOHandler* handler;
+  };
+
+  MessagePumpIOUring(const MessagePumpIOUring&) = delete;
+  MessagePumpIOUring& operator=(const MessagePumpIOUring&) = delete;
+
+  MessagePumpIOUring();
+  ~MessagePumpIOUring() override;
+
+  // Queue an operation on |fd|.  The operation is submitted to the kernel
+  // together with every other queued operation the next time the pump polls
+  // for completions.  Return false if the submission queue cannot take more
+  // entries, in which case |context| will not be called back.
+  // Read and Write use the current file position, which is what sockets and
+  // pipes expect.
+  bool Read(int fd, void* buffer, size_t length, IOContext* context);
+  bool Write(int fd, const void* buffer, size_t length, IOContext* context);
+  bool Accept(int fd, sockaddr* address, socklen_t* address_length,
+              IOContext* context);
+
+  // Ask the kernel to cancel the operation started with |context|.  The
+  // operation still completes (usually with ECANCELED) through the handler.
+  bool Cancel(IOContext* context);
+
+  // Waits for the next IO completion that should be processed by |filter|, for
+  // up to |timeout_ms| milliseconds (-1 waits forever).  See
+  // MessagePumpForIO::WaitForIOCompletion for the semantics.
+  bool WaitForIOCompletion(int timeout_ms, IOHandler* filter);
+
+  void AddIOObserver(IOObserver* obs);
+  void RemoveIOObserver(IOObserver* obs);
+
+  // Caps the number of entries handed to each io_uring_enter() call, to
+  // exercise the kernel consuming only part of the queue.  0 means no cap.
+  void SetSubmitLimitForTesting(unsigned limit) { submit_limit_ = limit; }
+
+  // MessagePump methods:
+  void Run(Delegate* delegate) override;
+  void Quit() override;
+  void ScheduleWork() override;
+  void ScheduleDelayedWork(const TimeTicks& delayed_work_time) override;
+
+ private:
+  struct IOItem {
+    IOHandler* handler;
+    IOContext* context;
+    int bytes_transfered;
+    int error;
+  };
+
+  // Maps the rings shared with the kernel.
+  void MapRings();
+
+  // Returns the next free submission entry, flushing the queue to the kernel
+  // if it is full.  Returns NULL if no entry can be obtained.
+  io_uring_sqe* GetSubmissionEntry();
+
+  // Hands every queued entry to the kernel.  If |timeout_ms| is not zero and
+  // no completion is available yet, also waits for at least one completion
+  // (-1 waits forever).  This is the only place that enters the kernel.
+  void SubmitAndWait(int timeout_ms);
+
+  // Pops the next completion from the ring.  Returns false if it is empty.
+  bool PopCompletion(uint64_t* user_data, int32_t* result);
+
+  // Pops the next completion, waiting up to |timeout_ms| for one.
+  bool GetIOItem(int timeout_ms, IOItem* item);
+
+  // Handles completions of the pump's own wakeup and timeout entries.
+  bool ProcessInternalIOItem(uint64_t user_data, int32_t result);
+
+  bool MatchCompletedIOItem(IOHandler* filter, IOItem* item);
+
+  // Delivers all the completions currently in the ring.  Returns true if any
+  // was processed.
+  bool ProcessCompletions();
+
+  // Queues the read on the wakeup eventfd that ScheduleWork() completes.
+  void ArmWakeup();
+
+  // Queues a timeout entry so that a blocking wait returns by |deadline|.
+  void ArmTimeout(TimeTicks deadline);
+
+  // Returns the wait timeout matching |delayed_work_time_|.
+  int GetCurrentDelay() const;
+
+  void WillProcessIOEvent();
+  void DidProcessIOEvent();
+
+  // This flag is set to false when Run should return.
+  bool keep_running_;
+
+  // The time at which we should call DoDelayedWork.
+  TimeTicks delayed_work_time_;
+
+  ScopedFD ring_fd_;
+
+  // Submission queue ring.
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  // Entries prepared by the pump but not yet published to |sq_tail_|.
+  unsigned sqe_tail_;
+
+  // See SetSubmitLimitForTesting().
+  unsigned submit_limit_;
+
+  // Completion queue ring.  May alias |sq_ring_|.
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe* cqes_;
+
+  // eventfd read by a pending entry; ScheduleWork() writes it.
+  ScopedFD wakeup_fd_;
+  uint64_t wakeup_value_;
+
+  // Set to 1 while a wakeup is pending so that concurrent ScheduleWork()
+  // calls don't write the eventfd more than once.
+  subtle::Atomic32 have_work_;
+
+  // State of the timeout entry used for delayed work.  Only the most recent
+  // one, identified by |timeout_sequence_|, clears |timeout_armed_|.
+  bool timeout_armed_;
+  TimeTicks timeout_deadline_;
+  uint64_t timeout_sequence_;
+  struct TimeoutSpec {
+    int64_t tv_sec;
+    long long tv_nsec;
+  } timeout_spec_;
+
+  // This list will be empty almost always. It stores IO completions that have
+  // not been delivered yet because somebody was doing cleanup.
+  std::list<IOItem> completed_io_;
+
+  ObserverList<IOObserver> io_observers_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_MESSAGE_PUMP_IO_URING_H_
@@ -0,0 +1,128 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/message_loop/message_pump_io_uring.h"
+
+#include <unistd.h>
+
+#include "crbase/files/scoped_file.h"
+#include "crbase/logging.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace cr {
+
+namespace {
+
+class RecordingIOHandler : public MessagePumpIOUring::IOHandler {
+ public:
+  RecordingIOHandler() : completions_(0), bytes_(0), error_(0) {}
+
+  void OnIOCompleted(MessagePumpIOUring::IOContext* context,
+                     int bytes_transfered,
+                     int error) override {
+    ++completions_;
+    bytes_ = bytes_transfered;
+    error_ = error;
+  }
+
+  int completions() const { return completions_; }
+  int bytes() const { return bytes_; }
+  int error() const { return error_; }
+
+ private:
+  int completions_;
+  int bytes_;
+  int error_;
+};
+
+class MessagePumpIOUringTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    read_fd_.reset(fds[0]);
+    write_fd_.reset(fds[1]);
+  }
+
+  // Polls the pump without blocking until |handler| has been called or
+  // |attempts| polls went by.
+  void PollUntilCompleted(MessagePumpIOUring* pump,
+                          RecordingIOHandler* handler,
+                          int attempts) {
+    for (int i = 0; i < attempts && !handler->completions(); ++i)
+      pump->WaitForIOCompletion(0, handler);
+  }
+
+  ScopedFD read_fd_;
+  ScopedFD write_fd_;
+};
+
+}  // namespace
+
+TEST_F(MessagePumpIOUringTest, ReadCompletes) {
+  MessagePumpIOUring pump;
+  RecordingIOHandler handler;
+  MessagePumpIOUring::IOContext context = {&handler};
+  char buffer[4];
+  ASSERT_EQ(4, write(write_fd_.get(), "ping", 4));
+  ASSERT_TRUE(pump.Read(read_fd_.get(), buffer, sizeof(buffer), &context));
+
+  PollUntilCompleted(&pump, &handler, 4);
+  EXPECT_EQ(1, handler.completions());
+  EXPECT_EQ(4, handler.bytes());
+  EXPECT_EQ(0, handler.error());
+}
+
+// The kernel consumes a single entry per io_uring_enter() call, so the read
+// below stays queued behind the wakeup read after the first poll.  Later
+// polls must submit it although nothing new was queued since.
+TEST_F(MessagePumpIOUringTest, ShortSubmitIsResubmitted) {
+  MessagePumpIOUring pump;
+  pump.SetSubmitLimitForTesting(1);
+  RecordingIOHandler handler;
+  MessagePumpIOUring::IOContext context = {&handler};
+  char buffer[4];
+  ASSERT_EQ(4, write(write_fd_.get(), "ping", 4));
+  ASSERT_TRUE(pump.Read(read_fd_.get(), buffer, sizeof(buffer), &context));
+
+  PollUntilCompleted(&pump, &handler, 4);
+  EXPECT_EQ(1, handler.completions());
+  EXPECT_EQ(4, handler.bytes());
+}
+
+// The wakeup read is re-armed behind an entry that a short submit left
+// queued.  Polls that queue nothing new must still submit it, or the loop
+// would sleep through ScheduleWork().
+TEST_F(MessagePumpIOUringTest, WakeupSurvivesShortSubmit) {
+  MessagePumpIOUring pump;
+  pump.SetSubmitLimitForTesting(1);
+  RecordingIOHandler handler;
+  MessagePumpIOUring::IOContext context = {&handler};
+  char buffer[4];
+  // Queued behind the initial wakeup read, and never completed until the
+  // end of the test since the pipe stays empty.
+  ASSERT_TRUE(pump.Read(read_fd_.get(), buffer, sizeof(buffer), &context));
+
+  // Submits and reaps the initial wakeup read, which re-arms it behind the
+  // pipe read.
+  pump.ScheduleWork();
+  EXPECT_TRUE(pump.WaitForIOCompletion(0, nullptr));
+
+  pump.ScheduleWork();
+  bool woken_up = false;
+  for (int i = 0; i < 100 && !woken_up; ++i) {
+    woken_up = pump.WaitForIOCompletion(0, nullptr);
+    if (!woken_up)
+      usleep(1000);
+  }
+  EXPECT_TRUE(woken_up);
+  EXPECT_EQ(0, handler.completions());
+
+  // Completes the pipe read so that |context| outlives the operation.
+  ASSERT_EQ(4, write(write_fd_.get(), "ping", 4));
+  PollUntilCompleted(&pump, &handler, 4);
+  EXPECT_EQ(1, handler.completions());
+}
+
+}  // namespace cr
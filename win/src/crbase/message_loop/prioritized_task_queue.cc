@@ -0,0 +1,63 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/message_loop/prioritized_task_queue.h"
+
+#include <string.h>
+
+#include <utility>
+
+#include "crbase/logging.h"
+
+namespace cr {
+
+PrioritizedTaskQueue::PrioritizedTaskQueue() : size_(0) {
+  memset(starved_counts_, 0, sizeof(starved_counts_));
+}
+
+PrioritizedTaskQueue::~PrioritizedTaskQueue() {
+}
+
+void PrioritizedTaskQueue::Push(PendingTask pending_task) {
+  int index = static_cast<int>(pending_task.priority);
+  CR_DCHECK(index >= 0 && index < kTaskPriorityCount);
+  queues_[index].push(std::move(pending_task));
+  ++size_;
+}
+
+PendingTask PrioritizedTaskQueue::Pop() {
+  CR_DCHECK(!empty());
+
+  // The highest priority queue with tasks, unless a lower one waited long
+  // enough.  The lowest starved queue goes first since it waited the longest.
+  int selected = -1;
+  for (int i = kTaskPriorityCount - 1; i >= 0; --i) {
+    if (queues_[i].empty())
+      continue;
+    if (selected == -1 && starved_counts_[i] >= kMaxStarvedTasks)
+      selected = i;
+  }
+  if (selected == -1) {
+    for (int i = 0; i < kTaskPriorityCount; ++i) {
+      if (!queues_[i].empty()) {
+        selected = i;
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < kTaskPriorityCount; ++i) {
+    if (i == selected || queues_[i].empty())
+      starved_counts_[i] = 0;
+    else if (i > selected)
+      ++starved_counts_[i];
+  }
+
+  PendingTask pending_task = std::move(queues_[selected].front());
+  queues_[selected].pop();
+  --size_;
+  return pending_task;
+}
+
+}  // namespace cr
@@ -0,0 +1,54 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_PRIORITIZED_TASK_QUEUE_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_PRIORITIZED_TASK_QUEUE_H_
+
+#include <stddef.h>
+
+#include "crbase/base_export.h"
+#include "crbase/threading/pending_task.h"
+
+namespace cr {
+
+// The work queue of a MessageLoop: one FIFO queue per TaskPriority.  Pop()
+// returns the oldest task of the highest priority queue that has one, except
+// that a queue passed over kMaxStarvedTasks times in a row is served next, so
+// a steady stream of high priority tasks can delay lower priority ones but
+// never block them.
+//
+// This class is not thread-safe; it is only used on the MessageLoop thread.
+class CRBASE_EXPORT PrioritizedTaskQueue {
+ public:
+  // Number of times a non-empty queue may be passed over before it is served.
+  static const int kMaxStarvedTasks = 16;
+
+  PrioritizedTaskQueue(const PrioritizedTaskQueue&) = delete;
+  PrioritizedTaskQueue& operator=(const PrioritizedTaskQueue&) = delete;
+
+  PrioritizedTaskQueue();
+  ~PrioritizedTaskQueue();
+
+  // Appends |pending_task| to the queue of its |priority|.
+  void Push(PendingTask pending_task);
+
+  // Removes and returns the next task to run.  Must not be called when
+  // empty().
+  PendingTask Pop();
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+ private:
+  TaskQueue queues_[kTaskPriorityCount];
+
+  // Number of times in a row each queue was passed over while it had tasks.
+  int starved_counts_[kTaskPriorityCount];
+
+  size_t size_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_PRIORITIZED_TASK_QUEUE_H_
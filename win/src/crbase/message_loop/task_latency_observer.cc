@@ -0,0 +1,103 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/message_loop/task_latency_observer.h"
+
+#include <utility>
+
+#include "crbase/json/json_writer.h"
+#include "crbase/logging.h"
+#include "crbase/values.h"
+
+namespace cr {
+
+TaskLatencyObserver::Histograms::Histograms(
+    const tracked_objects::Location& location)
+    : location(location) {
+}
+
+TaskLatencyObserver::Histograms::~Histograms() {
+}
+
+TaskLatencyObserver::TaskLatencyObserver(const std::string& name)
+    : name_(name) {
+}
+
+TaskLatencyObserver::~TaskLatencyObserver() {
+  CR_DCHECK(start_times_.empty());
+}
+
+void TaskLatencyObserver::WillProcessTask(const PendingTask& pending_task) {
+  TimeTicks now = TimeTicks::Now();
+  start_times_.push_back(now);
+
+  // A delayed task is ready from its run time on.
+  TimeTicks ready_time = pending_task.delayed_run_time.is_null() ?
+      pending_task.queue_time : pending_task.delayed_run_time;
+  if (ready_time.is_null())
+    return;
+
+  TimeDelta queue_delay = now - ready_time;
+  queue_delay_.Record(queue_delay);
+  GetHistogramsForLocation(pending_task.posted_from)->queue_delay.Record(
+      queue_delay);
+}
+
+void TaskLatencyObserver::DidProcessTask(const PendingTask& pending_task) {
+  CR_DCHECK(!start_times_.empty());
+  TimeDelta run_time = TimeTicks::Now() - start_times_.back();
+  start_times_.pop_back();
+
+  run_time_.Record(run_time);
+  GetHistogramsForLocation(pending_task.posted_from)->run_time.Record(
+      run_time);
+}
+
+std::unique_ptr<DictionaryValue> TaskLatencyObserver::SnapshotAsValue() const {
+  std::unique_ptr<DictionaryValue> dictionary(new DictionaryValue);
+  dictionary->SetString("name", name_);
+  dictionary->Set("queue_delay", queue_delay_.GetSnapshot().ToValue());
+  dictionary->Set("run_time", run_time_.GetSnapshot().ToValue());
+
+  std::unique_ptr<ListValue> locations(new ListValue);
+  {
+    AutoLock lock(lock_);
+    for (size_t i = 0; i < location_histograms_.size(); ++i) {
+      const Histograms* histograms = location_histograms_[i].get();
+      std::unique_ptr<DictionaryValue> location(new DictionaryValue);
+      location->SetString("file", histograms->location.file_name());
+      location->SetString("function", histograms->location.function_name());
+      location->SetInteger("line", histograms->location.line_number());
+      location->Set("queue_delay",
+                    histograms->queue_delay.GetSnapshot().ToValue());
+      location->Set("run_time", histograms->run_time.GetSnapshot().ToValue());
+      locations->Append(std::move(location));
+    }
+  }
+  dictionary->Set("locations", std::move(locations));
+  return dictionary;
+}
+
+std::string TaskLatencyObserver::SnapshotAsJSON() const {
+  std::string json;
+  JSONWriter::Write(*SnapshotAsValue(), &json);
+  return json;
+}
+
+TaskLatencyObserver::Histograms* TaskLatencyObserver::GetHistogramsForLocation(
+    const tracked_objects::Location& location) {
+  auto found = locations_.find(location);
+  if (found != locations_.end())
+    return found->second;
+
+  Histograms* histograms = new Histograms(location);
+  {
+    AutoLock lock(lock_);
+    location_histograms_.push_back(std::unique_ptr<Histograms>(histograms));
+  }
+  locations_[location] = histograms;
+  return histograms;
+}
+
+}  // namespace cr
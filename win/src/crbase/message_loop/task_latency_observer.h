@@ -0,0 +1,102 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_TASK_LATENCY_OBSERVER_H_
+#define MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_TASK_LATENCY_OBSERVER_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crbase/base_export.h"
+#include "crbase/message_loop/message_loop.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/time/time.h"
+#include "crbase/tracing/latency_histogram.h"
+#include "crbase/tracing/location.h"
+
+namespace cr {
+
+class DictionaryValue;
+
+// A TaskObserver that keeps latency histograms of the tasks run by a
+// MessageLoop: how long each task waited between becoming ready (posted, or
+// due for a delayed task) and starting to run, and how long it ran.  Both are
+// kept for the whole loop and for each posting Location, which shows the
+// distributions behind the sums and maxes of tracked_objects::DeathData.
+//
+// Recording happens on the thread of the loop without taking any lock, except
+// the first time a task from a new Location runs.  Snapshots may be taken on
+// any thread, e.g. to export them as JSON:
+//
+//   TaskLatencyObserver observer("io");
+//   MessageLoop::current()->AddTaskObserver(&observer);
+//   ...
+//   std::string json = observer.SnapshotAsJSON();  // Any thread.
+//
+// The observer must be removed from the loop before it is destroyed.
+class CRBASE_EXPORT TaskLatencyObserver : public MessageLoop::TaskObserver {
+ public:
+  TaskLatencyObserver(const TaskLatencyObserver&) = delete;
+  TaskLatencyObserver& operator=(const TaskLatencyObserver&) = delete;
+
+  // |name| identifies the loop in snapshots.
+  explicit TaskLatencyObserver(const std::string& name);
+  ~TaskLatencyObserver() override;
+
+  // MessageLoop::TaskObserver:
+  void WillProcessTask(const PendingTask& pending_task) override;
+  void DidProcessTask(const PendingTask& pending_task) override;
+
+  // Returns the histograms of the loop and of every Location as
+  //   {"name": ..., "queue_delay": {...}, "run_time": {...},
+  //    "locations": [{"file": ..., "function": ..., "line": ...,
+  //                   "queue_delay": {...}, "run_time": {...}}, ...]}
+  // where each histogram is a LatencyHistogramSnapshot::ToValue().
+  std::unique_ptr<DictionaryValue> SnapshotAsValue() const;
+
+  // Same as SnapshotAsValue(), serialized with JSONWriter.
+  std::string SnapshotAsJSON() const;
+
+ private:
+  struct Histograms {
+    explicit Histograms(const tracked_objects::Location& location);
+    ~Histograms();
+
+    const tracked_objects::Location location;
+    tracked_objects::LatencyHistogram queue_delay;
+    tracked_objects::LatencyHistogram run_time;
+  };
+
+  // Returns the histograms of |location|, creating them if needed.  Only
+  // called on the thread of the loop.
+  Histograms* GetHistogramsForLocation(
+      const tracked_objects::Location& location);
+
+  const std::string name_;
+
+  // Histograms of every task of the loop.
+  tracked_objects::LatencyHistogram queue_delay_;
+  tracked_objects::LatencyHistogram run_time_;
+
+  // Start times of the tasks being run; nested loops run tasks within tasks.
+  // Only accessed on the thread of the loop.
+  std::vector<TimeTicks> start_times_;
+
+  // Index of |location_histograms_| used on the thread of the loop, so that
+  // finding the histograms of a known Location takes no lock.
+  std::unordered_map<tracked_objects::Location,
+                     Histograms*,
+                     tracked_objects::Location::Hash> locations_;
+
+  // Protects |location_histograms_|, which is appended to on the thread of
+  // the loop and read by snapshots.
+  mutable Lock lock_;
+  std::vector<std::unique_ptr<Histograms>> location_histograms_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_MESSAGE_LOOP_TASK_LATENCY_OBSERVER_H_
@@ -6,7 +6,11 @@
 #define MINI_CHROMIUM_SRC_CRBASE_OBSERVER_LIST_THREADSAFE_H_
 
 #include <algorithm>
+#include <atomic>
 #include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 #include "crbase/functional/bind.h"
 #include "crbase/tracing/location.h"
@@ -19,6 +23,8 @@
 #include "crbase/stl_util.h"
 #include "crbase/threading/thread_task_runner_handle.h"
 #include "crbase/threading/platform_thread.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/time/time.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -51,6 +57,13 @@
 //   we simply call PostTask to each registered thread, and then each thread
 //   will notify its regular ObserverList.
 //
+//   The set of registered threads is published as an immutable snapshot,
+//   which is replaced whenever a thread adds its first observer or removes
+//   its last one.  Notify() reads the current snapshot without taking any
+//   lock; a replaced snapshot is deleted once no Notify() can still be
+//   reading it.  Adding and removing observers therefore costs more than
+//   notifying them, which suits lists whose observers rarely change.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace cr {
@@ -63,19 +76,109 @@ namespace internal {
 
 // An UnboundMethod is a wrapper for a method where the actual object is
 // provided at Run dispatch time.
-template <class T, class Method, class Params>
+template <class T, class Method, class... Params>
 class UnboundMethod {
  public:
-  UnboundMethod(Method m, const Params& p) : m_(m), p_(p) {
-    static_assert((internal::ParamsUseScopedRefptrCorrectly<Params>::value),
+  UnboundMethod(Method m, const Params&... p) : m_(m), p_(p...) {
+    static_assert((internal::ParamsUseScopedRefptrCorrectly<
+                      std::tuple<Params...>>::value),
                   "bad unbound method params");
   }
   void Run(T* obj) const {
-    DispatchToMethod(obj, m_, p_);
+    RunImpl(obj, MakeIndexSequence<sizeof...(Params)>());
   }
  private:
+  template <size_t... Ns>
+  void RunImpl(T* obj, IndexSequence<Ns...>) const {
+    (obj->*m_)(std::get<Ns>(p_)...);
+  }
+
   Method m_;
-  Params p_;
+  std::tuple<Params...> p_;
+};
+
+// Holds a pointer to an immutable T that one writer replaces while any number
+// of readers use it.  Readers never block: a ReadScope counts itself in one
+// of two reader counts, selected by the current epoch.  Publish() flips the
+// epoch after swapping the pointer and waits for the readers counted under
+// the previous epoch, the only ones that may still see the previous T,
+// before deleting it.
+template <class T>
+class PublishedSnapshot {
+ public:
+  PublishedSnapshot(const PublishedSnapshot&) = delete;
+  PublishedSnapshot& operator=(const PublishedSnapshot&) = delete;
+
+  explicit PublishedSnapshot(std::unique_ptr<const T> snapshot)
+      : snapshot_(snapshot.release()), epoch_(0) {
+    readers_[0].store(0, std::memory_order_relaxed);
+    readers_[1].store(0, std::memory_order_relaxed);
+  }
+
+  // There must be no ReadScope left.
+  ~PublishedSnapshot() {
+    delete snapshot_.load(std::memory_order_relaxed);
+  }
+
+  // Keeps the snapshot current at construction alive until destruction.
+  // ReadScopes must be short; Publish() waits for them.
+  class ReadScope {
+   public:
+    ReadScope(const ReadScope&) = delete;
+    ReadScope& operator=(const ReadScope&) = delete;
+
+    explicit ReadScope(const PublishedSnapshot* published)
+        : published_(published) {
+      // Retry if the epoch flipped before this reader was counted, since the
+      // writer may not be waiting for that epoch's count anymore.
+      for (;;) {
+        epoch_ = published_->epoch_.load(std::memory_order_seq_cst);
+        published_->readers_[epoch_].fetch_add(1, std::memory_order_seq_cst);
+        if (published_->epoch_.load(std::memory_order_seq_cst) == epoch_)
+          break;
+        published_->readers_[epoch_].fetch_sub(1, std::memory_order_release);
+      }
+      snapshot_ = published_->snapshot_.load(std::memory_order_seq_cst);
+    }
+
+    ~ReadScope() {
+      published_->readers_[epoch_].fetch_sub(1, std::memory_order_release);
+    }
+
+    const T& operator*() const { return *snapshot_; }
+    const T* operator->() const { return snapshot_; }
+
+   private:
+    const PublishedSnapshot* published_;
+    int epoch_;
+    const T* snapshot_;
+  };
+
+  // Replaces the snapshot and deletes the previous one once no ReadScope can
+  // use it.  Calls must be serialized, and must not be made from within a
+  // ReadScope.
+  void Publish(std::unique_ptr<const T> snapshot) {
+    const T* previous =
+        snapshot_.exchange(snapshot.release(), std::memory_order_seq_cst);
+    int epoch = epoch_.load(std::memory_order_relaxed);
+    epoch_.store(epoch ^ 1, std::memory_order_seq_cst);
+
+    // Yielding may not let a preempted reader of lower priority run, so fall
+    // back to sleeping.
+    const int kMaxYields = 64;
+    for (int i = 0; readers_[epoch].load(std::memory_order_acquire); ++i) {
+      if (i < kMaxYields)
+        PlatformThread::YieldCurrentThread();
+      else
+        PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+    }
+    delete previous;
+  }
+
+ private:
+  std::atomic<const T*> snapshot_;
+  std::atomic<int> epoch_;
+  mutable std::atomic<int> readers_[2];
 };
 
 }  // namespace internal
@@ -109,8 +212,11 @@ class ObserverListThreadSafe
   ObserverListThreadSafe& operator=(const ObserverListThreadSafe&) = delete;
 
   ObserverListThreadSafe()
-      : type_(ObserverListBase<ObserverType>::NOTIFY_ALL) {}
-  explicit ObserverListThreadSafe(NotificationType type) : type_(type) {}
+      : snapshot_(std::unique_ptr<const Snapshot>(new Snapshot)),
+        type_(ObserverListBase<ObserverType>::NOTIFY_ALL) {}
+  explicit ObserverListThreadSafe(NotificationType type)
+      : snapshot_(std::unique_ptr<const Snapshot>(new Snapshot)),
+        type_(type) {}
 
   // Add an observer to the list.  An observer should not be added to
   // the same list more than once.
@@ -124,8 +230,10 @@ class ObserverListThreadSafe
     PlatformThreadId thread_id = PlatformThread::CurrentId();
     {
       AutoLock lock(list_lock_);
-      if (observer_lists_.find(thread_id) == observer_lists_.end())
+      if (observer_lists_.find(thread_id) == observer_lists_.end()) {
         observer_lists_[thread_id] = new ObserverListContext(type_);
+        PublishSnapshotLocked();
+      }
       list = &(observer_lists_[thread_id]->list);
     }
     list->AddObserver(obs);
@@ -153,8 +261,10 @@ class ObserverListThreadSafe
 
       // If we're about to remove the last observer from the list,
       // then we can remove this observer_list entirely.
-      if (list->HasObserver(obs) && list->size() == 1)
+      if (list->HasObserver(obs) && list->size() == 1) {
         observer_lists_.erase(it);
+        PublishSnapshotLocked();
+      }
     }
     list->RemoveObserver(obs);
 
@@ -168,7 +278,7 @@ class ObserverListThreadSafe
   // Verifies that the list is currently empty (i.e. there are no observers).
   void AssertEmpty() const {
     AutoLock lock(list_lock_);
-    CRBASE_DCHECK(observer_lists_.empty());
+    CR_DCHECK(observer_lists_.empty());
   }
 
   // Notify methods.
@@ -176,21 +286,22 @@ class ObserverListThreadSafe
   // Note, these calls are effectively asynchronous.  You cannot assume
   // that at the completion of the Notify call that all Observers have
   // been Notified.  The notification may still be pending delivery.
+  // Does not take any lock.
   template <class Method, class... Params>
   void Notify(const tracked_objects::Location& from_here,
               Method m,
               const Params&... params) {
-    internal::UnboundMethod<ObserverType, Method, Tuple<Params...>> method(
-        m, MakeTuple(params...));
+    internal::UnboundMethod<ObserverType, Method, Params...> method(
+        m, params...);
 
-    AutoLock lock(list_lock_);
-    for (const auto& entry : observer_lists_) {
-      ObserverListContext* context = entry.second;
-      context->task_runner->PostTask(
+    typename internal::PublishedSnapshot<Snapshot>::ReadScope snapshot(
+        &snapshot_);
+    for (const auto& entry : *snapshot) {
+      entry.task_runner->PostTask(
           from_here,
-          Bind(&ObserverListThreadSafe<ObserverType>::template NotifyWrapper<
-                  Method, Tuple<Params...>>,
-              this, context, method));
+          BindOnce(&ObserverListThreadSafe<ObserverType>::template
+                       NotifyWrapper<Method, Params...>,
+                   this, entry.context, method));
     }
   }
 
@@ -211,30 +322,61 @@ class ObserverListThreadSafe
    private:
   };
 
+  // A registered thread, as seen by Notify().  |context| is only dereferenced
+  // on |thread_id|, which owns it, so the entry holds its own reference to
+  // the task runner.
+  struct SnapshotEntry {
+    PlatformThreadId thread_id;
+    ObserverListContext* context;
+    scoped_refptr<SingleThreadTaskRunner> task_runner;
+  };
+  typedef std::vector<SnapshotEntry> Snapshot;
+
   ~ObserverListThreadSafe() {
     STLDeleteValues(&observer_lists_);
   }
 
+  // Publishes the current |observer_lists_| for Notify().
+  void PublishSnapshotLocked() {
+    list_lock_.AssertAcquired();
+    std::unique_ptr<Snapshot> snapshot(new Snapshot);
+    snapshot->reserve(observer_lists_.size());
+    for (const auto& entry : observer_lists_) {
+      SnapshotEntry snapshot_entry;
+      snapshot_entry.thread_id = entry.first;
+      snapshot_entry.context = entry.second;
+      snapshot_entry.task_runner = entry.second->task_runner;
+      snapshot->push_back(snapshot_entry);
+    }
+    snapshot_.Publish(std::move(snapshot));
+  }
+
+  // Returns true if |context| is registered for the current thread.
+  bool IsRegisteredOnCurrentThread(ObserverListContext* context) const {
+    PlatformThreadId thread_id = PlatformThread::CurrentId();
+    typename internal::PublishedSnapshot<Snapshot>::ReadScope snapshot(
+        &snapshot_);
+    for (const auto& entry : *snapshot) {
+      if (entry.thread_id == thread_id)
+        return entry.context == context;
+    }
+    return false;
+  }
+
   // Wrapper which is called to fire the notifications for each thread's
   // ObserverList.  This function MUST be called on the thread which owns
   // the unsafe ObserverList.
-  template <class Method, class Params>
+  template <class Method, class... Params>
   void NotifyWrapper(
       ObserverListContext* context,
-      const internal::UnboundMethod<ObserverType, Method, Params>& method) {
-    // Check that this list still needs notifications.
-    {
-      AutoLock lock(list_lock_);
-      typename ObserversListMap::iterator it =
-          observer_lists_.find(PlatformThread::CurrentId());
-
-      // The ObserverList could have been removed already.  In fact, it could
-      // have been removed and then re-added!  If the master list's loop
-      // does not match this one, then we do not need to finish this
-      // notification.
-      if (it == observer_lists_.end() || it->second != context)
-        return;
-    }
+      const internal::UnboundMethod<ObserverType, Method, Params...>& method) {
+    // Check that this list still needs notifications.  The ObserverList could
+    // have been removed already.  In fact, it could have been removed and
+    // then re-added!  If the master list's loop does not match this one,
+    // then we do not need to finish this notification.  The snapshot must
+    // not be held while notifying, since observers may remove themselves.
+    if (!IsRegisteredOnCurrentThread(context))
+      return;
 
     {
       typename ObserverList<ObserverType>::Iterator it(&context->list);
@@ -252,8 +394,10 @@ class ObserverListThreadSafe
         // See http://crbug.com/55725.
         typename ObserversListMap::iterator it =
             observer_lists_.find(PlatformThread::CurrentId());
-        if (it != observer_lists_.end() && it->second == context)
+        if (it != observer_lists_.end() && it->second == context) {
           observer_lists_.erase(it);
+          PublishSnapshotLocked();
+        }
       }
       delete context;
     }
@@ -265,8 +409,13 @@ class ObserverListThreadSafe
   typedef std::map<PlatformThreadId, ObserverListContext*>
       ObserversListMap;
 
-  mutable Lock list_lock_;  // Protects the observer_lists_.
+  // Protects |observer_lists_| and serializes the snapshot updates.
+  mutable Lock list_lock_;
   ObserversListMap observer_lists_;
+
+  // Copy of |observer_lists_| read by Notify() without |list_lock_|.
+  internal::PublishedSnapshot<Snapshot> snapshot_;
+
   const NotificationType type_;
 };
 
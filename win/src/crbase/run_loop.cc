@@ -6,7 +6,11 @@
 
 #include "crbase/functional/bind.h"
 #include "crbase/tracing/tracked_objects.h"
+#include "crbase/build_config.h"
+
+#if defined(MINI_CHROMIUM_OS_WIN)
 #include "crbase/message_loop/message_pump_dispatcher.h"
+#endif
 
 namespace cr {
 
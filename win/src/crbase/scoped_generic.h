@@ -55,7 +55,7 @@ template<typename T, typename Traits>
 class ScopedGeneric {
  private:
   ScopedGeneric(const ScopedGeneric&) = delete;
-  ScopedGeneric& operatror=(const ScopedGeneric&) = delete;
+  ScopedGeneric& operator=(const ScopedGeneric&) = delete;
 
   // This must be first since it's used inline below.
   //
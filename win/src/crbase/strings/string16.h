@@ -130,7 +130,7 @@ struct string16_char_traits {
   }
 };
 
-typedef std::basic_string<char16, base::string16_char_traits> string16;
+typedef std::basic_string<char16, string16_char_traits> string16;
 
 CRBASE_EXPORT extern std::ostream& operator<<(std::ostream& out,
                                               const string16& str);
@@ -11,16 +11,24 @@
 #include <stdarg.h>   // va_list
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
-#include <sal.h>
+#include <wchar.h>
 
 #include <string>
 #include <vector>
 
 #include "crbase/base_export.h"
+#include "crbase/build_config.h"
 #include "crbase/strings/string16.h"
 #include "crbase/strings/string_piece.h"  // For implicit conversions.
 
+#if defined(MINI_CHROMIUM_OS_WIN)
+#include <sal.h>  // _Printf_format_string_
+#elif !defined(_Printf_format_string_)
+#define _Printf_format_string_
+#endif
+
 namespace cr {
 
 // C standard-library functions that aren't cross-platform are provided as
@@ -427,6 +435,7 @@ CRBASE_EXPORT string16 ReplaceStringPlaceholders(const string16& format_string,
 
 // Chromium code style is to not use malloc'd strings; this is only for use
 // for interaction with APIs that require it.
+#if defined(MINI_CHROMIUM_OS_WIN)
 inline char* strdup(const char* str) {
   return ::_strdup(str);
 }
@@ -446,6 +455,21 @@ inline int vswprintf(wchar_t* buffer, size_t size,
     return ::_vscwprintf(format, arguments);
   return length;
 }
+#elif defined(MINI_CHROMIUM_OS_POSIX)
+inline char* strdup(const char* str) {
+  return ::strdup(str);
+}
+
+inline int vsnprintf(char* buffer, size_t size,
+                     const char* format, va_list arguments) {
+  return ::vsnprintf(buffer, size, format, arguments);
+}
+
+inline int vswprintf(wchar_t* buffer, size_t size,
+                     const wchar_t* format, va_list arguments) {
+  return ::vswprintf(buffer, size, format, arguments);
+}
+#endif
 
 }  // namespace cr
 
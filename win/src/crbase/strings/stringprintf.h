@@ -6,11 +6,17 @@
 #define MINI_CHROMIUM_SRC_CRBASE_STRINGS_STRINGPRINTF_H_
 
 #include <stdarg.h>   // va_list
-#include <sal.h>  // _Printf_format_string_
 
 #include <string>
 
 #include "crbase/base_export.h"
+#include "crbase/build_config.h"
+
+#if defined(MINI_CHROMIUM_OS_WIN)
+#include <sal.h>  // _Printf_format_string_
+#elif !defined(_Printf_format_string_)
+#define _Printf_format_string_
+#endif
 
 namespace cr {
 
@@ -72,7 +72,9 @@
 #include "crbase/build_config.h"
 
 #if defined(MINI_CHROMIUM_OS_POSIX)
-#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
 #endif
 
 namespace cr {
@@ -104,8 +106,14 @@ class CRBASE_EXPORT ConditionVariable {
 #if defined(MINI_CHROMIUM_OS_WIN)
   ConditionVarImpl* impl_;
 #elif defined(MINI_CHROMIUM_OS_POSIX)
-  pthread_cond_t condition_;
-  pthread_mutex_t* user_mutex_;
+  // Futex word, bumped by every Signal() and Broadcast().
+  std::atomic<int32_t> sequence_;
+
+  // Number of threads in Wait() or TimedWait(), so that signaling without
+  // waiters skips the system call.
+  std::atomic<int32_t> waiters_;
+
+  Lock* const user_lock_;
 #endif
 };
 
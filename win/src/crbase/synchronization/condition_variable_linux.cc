@@ -0,0 +1,85 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/synchronization/condition_variable.h"
+
+#include "crbase/synchronization/futex_linux.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/time/time.h"
+
+namespace cr {
+
+ConditionVariable::ConditionVariable(Lock* user_lock)
+    : sequence_(0), waiters_(0), user_lock_(user_lock) {
+  CR_DCHECK(user_lock);
+}
+
+ConditionVariable::~ConditionVariable() {
+}
+
+void ConditionVariable::Wait() {
+  TimedWait(TimeDelta::Max());
+}
+
+void ConditionVariable::TimedWait(const TimeDelta& max_time) {
+  // Signals sent after this point, while the user lock is still held, change
+  // |sequence_| and so can't be missed by FutexWait().
+  const int32_t sequence = sequence_.load(std::memory_order_relaxed);
+  waiters_.fetch_add(1, std::memory_order_seq_cst);
+
+  Lock::ProfiledAcquisition profiled_acquisition;
+  user_lock_->SuspendProfiledAcquisition(&profiled_acquisition);
+#if CR_DCHECK_IS_ON()
+  user_lock_->CheckHeldAndUnmark();
+#endif
+  user_lock_->lock_.Unlock();
+
+  internal::FutexWait(&sequence_, sequence, &max_time);
+  waiters_.fetch_sub(1, std::memory_order_relaxed);
+
+  // Broadcast() may have moved this thread to the lock's futex, along with
+  // other waiters which then need the lock marked as contended to be woken.
+  user_lock_->lock_.LockContended();
+#if CR_DCHECK_IS_ON()
+  user_lock_->CheckUnheldAndMark();
+#endif
+  user_lock_->ResumeProfiledAcquisition(profiled_acquisition);
+}
+
+void ConditionVariable::Broadcast() {
+  const int32_t sequence =
+      sequence_.fetch_add(1, std::memory_order_seq_cst) + 1;
+  if (!waiters_.load(std::memory_order_seq_cst))
+    return;
+
+  // Wake a single waiter and move the others to the lock's futex: they would
+  // only contend for the lock, and are instead woken one by one as it is
+  // released.
+  internal::LockImpl::NativeHandle* lock_word =
+      user_lock_->lock_.native_handle();
+  int moved = internal::FutexCmpRequeue(&sequence_, 1, lock_word, sequence);
+  if (moved < 0) {
+    // Signaled concurrently.  Fall back to waking everyone.
+    internal::FutexWake(&sequence_, INT_MAX);
+    return;
+  }
+
+  // Threads moved to the lock must be woken when it is released, so mark it
+  // contended.  If it is free, nobody will release it: take and release it to
+  // wake one of them.
+  if (moved > 1 &&
+      lock_word->exchange(internal::LockImpl::kLockedContended,
+                          std::memory_order_acquire) ==
+          internal::LockImpl::kUnlocked) {
+    user_lock_->lock_.Unlock();
+  }
+}
+
+void ConditionVariable::Signal() {
+  sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_seq_cst))
+    internal::FutexWake(&sequence_, 1);
+}
+
+}  // namespace cr
@@ -98,6 +98,8 @@ void WinVistaCondVar::TimedWait(const TimeDelta& max_time) {
   DWORD timeout = static_cast<DWORD>(max_time.InMilliseconds());
   CRITICAL_SECTION* cs = user_lock_.lock_.native_handle();
 
+  Lock::ProfiledAcquisition profiled_acquisition;
+  user_lock_.SuspendProfiledAcquisition(&profiled_acquisition);
 #if CR_DCHECK_IS_ON()
   user_lock_.CheckHeldAndUnmark();
 #endif
@@ -109,6 +111,7 @@ void WinVistaCondVar::TimedWait(const TimeDelta& max_time) {
 #if !defined(NDEBUG) || defined(CR_DCHECK_ALWAYS_ON)
   user_lock_.CheckUnheldAndMark();
 #endif
+  user_lock_.ResumeProfiledAcquisition(profiled_acquisition);
 }
 
 void WinVistaCondVar::Broadcast() {
@@ -254,6 +257,8 @@ void WinXPCondVar::TimedWait(const TimeDelta& max_time) {
     CR_DCHECK(handle);
   }  // Release internal_lock.
 
+  Lock::ProfiledAcquisition profiled_acquisition;
+  user_lock_.SuspendProfiledAcquisition(&profiled_acquisition);
   {
     AutoUnlock unlock(user_lock_);  // Release caller's lock
     WaitForSingleObject(handle, static_cast<DWORD>(max_time.InMilliseconds()));
@@ -262,6 +267,7 @@ void WinXPCondVar::TimedWait(const TimeDelta& max_time) {
     RecycleEvent(waiting_event);
     // Release internal_lock_
   }  // Reacquire callers lock to depth at entry.
+  user_lock_.ResumeProfiledAcquisition(profiled_acquisition);
 }
 
 // Broadcast() is guaranteed to signal all threads that were waiting (i.e., had
@@ -0,0 +1,82 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Thin wrappers around the futex(2) operations used by the Linux Lock,
+// ConditionVariable and WaitableEvent.  All futexes are process-private.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_SYNCHRONIZATION_FUTEX_LINUX_H_
+#define MINI_CHROMIUM_SRC_CRBASE_SYNCHRONIZATION_FUTEX_LINUX_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "crbase/time/time.h"
+
+namespace cr {
+namespace internal {
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex words must be plain 32-bit integers");
+
+inline int32_t* FutexAddress(std::atomic<int32_t>* word) {
+  return reinterpret_cast<int32_t*>(word);
+}
+
+// Sleeps while |*word| == |expected|, until woken or |timeout| elapses.  A
+// null or maximum |timeout| waits forever.  Returns false on timeout.
+// Spurious wake-ups are possible.
+inline bool FutexWait(std::atomic<int32_t>* word,
+                      int32_t expected,
+                      const TimeDelta* timeout = nullptr) {
+  struct timespec ts;
+  struct timespec* relative_timeout = nullptr;
+  if (timeout && !timeout->is_max()) {
+    if (*timeout <= TimeDelta())
+      return false;
+    int64_t microseconds = timeout->InMicroseconds();
+    ts.tv_sec =
+        static_cast<time_t>(microseconds / Time::kMicrosecondsPerSecond);
+    ts.tv_nsec = static_cast<long>(
+        (microseconds % Time::kMicrosecondsPerSecond) *
+        Time::kNanosecondsPerMicrosecond);
+    relative_timeout = &ts;
+  }
+  if (syscall(SYS_futex, FutexAddress(word), FUTEX_WAIT_PRIVATE, expected,
+              relative_timeout, nullptr, 0) == 0) {
+    return true;
+  }
+  return errno != ETIMEDOUT;
+}
+
+// Wakes up to |count| threads sleeping on |word|.
+inline int FutexWake(std::atomic<int32_t>* word, int count) {
+  return static_cast<int>(syscall(SYS_futex, FutexAddress(word),
+                                  FUTEX_WAKE_PRIVATE, count, nullptr,
+                                  nullptr, 0));
+}
+
+// If |*word| == |expected|, wakes up to |wake_count| threads sleeping on
+// |word| and moves the others to |target|.  Returns the number of threads
+// woken or moved, or -1 if |*word| changed.
+inline int FutexCmpRequeue(std::atomic<int32_t>* word,
+                           int wake_count,
+                           std::atomic<int32_t>* target,
+                           int32_t expected) {
+  return static_cast<int>(syscall(
+      SYS_futex, FutexAddress(word), FUTEX_CMP_REQUEUE_PRIVATE, wake_count,
+      reinterpret_cast<void*>(static_cast<uintptr_t>(INT_MAX)),
+      FutexAddress(target), expected));
+}
+
+}  // namespace internal
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_SYNCHRONIZATION_FUTEX_LINUX_H_
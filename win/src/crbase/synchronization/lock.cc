@@ -2,16 +2,20 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
-// This file is used for debugging assertion support.  The Lock class
-// is functionally a wrapper around the LockImpl class, so the only
-// real intelligence in the class is in the debugging logic.
+// This file is used for debugging assertion support and lock profiling.  The
+// Lock class is functionally a wrapper around the LockImpl class, so the only
+// real intelligence in the class is in the debugging and profiling logic.
 
 #include "crbase/synchronization/lock.h"
 
-#if CR_DCHECK_IS_ON()
+#if CR_LOCK_PROFILING_IS_ON()
+#include "crbase/tracing/tracked_objects.h"
+#endif
 
 namespace cr {
 
+#if CR_DCHECK_IS_ON()
+
 Lock::Lock() : lock_() {
 }
 
@@ -33,6 +37,63 @@ void Lock::CheckUnheldAndMark() {
   owning_thread_ref_ = PlatformThread::CurrentRef();
 }
 
-}  // namespace cr
+#endif  // CR_DCHECK_IS_ON()
+
+#if CR_LOCK_PROFILING_IS_ON()
+
+void Lock::AcquireProfiled(const LockSite& site) {
+  if (!tracked_objects::ThreadData::TrackingStatus()) {
+    Acquire();
+    return;
+  }
+
+  const TimeTicks start_time = TimeTicks::Now();
+  const bool contended = !lock_.Try();
+  if (contended)
+    lock_.Lock();
+#if CR_DCHECK_IS_ON()
+  CheckUnheldAndMark();
+#endif
+
+  profiled_.is_profiled = true;
+  profiled_.contended = contended;
+  profiled_.site = site;
+  profiled_.acquire_time = contended ? TimeTicks::Now() : start_time;
+  profiled_.wait_time = profiled_.acquire_time - start_time;
+  profiled_.hold_time = TimeDelta();
+}
+
+void Lock::ReleaseProfiled() {
+  const LockSite site = profiled_.site;
+  const bool contended = profiled_.contended;
+  const TimeDelta wait_time = profiled_.wait_time;
+  const TimeDelta hold_time =
+      profiled_.hold_time + (TimeTicks::Now() - profiled_.acquire_time);
+  profiled_ = ProfiledAcquisition();
+
+#if CR_DCHECK_IS_ON()
+  CheckHeldAndUnmark();
+#endif
+  lock_.Unlock();
+
+  // Outside of the lock, which the tally must not lengthen.
+  tracked_objects::ThreadData::TallyLockAcquisitionIfActive(
+      site, wait_time, hold_time, contended);
+}
+
+void Lock::SuspendProfiledAcquisition(ProfiledAcquisition* saved) {
+  *saved = profiled_;
+  if (saved->is_profiled)
+    saved->hold_time += TimeTicks::Now() - saved->acquire_time;
+  profiled_ = ProfiledAcquisition();
+}
+
+void Lock::ResumeProfiledAcquisition(const ProfiledAcquisition& saved) {
+  profiled_ = saved;
+  if (profiled_.is_profiled)
+    profiled_.acquire_time = TimeTicks::Now();
+}
+
+#endif  // CR_LOCK_PROFILING_IS_ON()
 
-#endif  // CR_DCHECK_IS_ON()
\ No newline at end of file
+}  // namespace cr
\ No newline at end of file
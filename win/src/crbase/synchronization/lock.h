@@ -12,8 +12,35 @@
 #include "crbase/threading/platform_thread.h"
 #include "crbase/build_config.h"
 
+// Lock profiling records, for each call site passing CR_LOCK_FROM_HERE to
+// Lock::Acquire() or AutoLock, how many acquisitions were contended, how long
+// they waited and how long the lock was then held.  The data is kept in the
+// tracked_objects tables of the acquiring thread while tracking is active,
+// and exported by tracked_objects::ThreadData::Snapshot().
+//
+// It is compiled in by defining CR_ENABLE_LOCK_PROFILING.  Otherwise
+// CR_LOCK_FROM_HERE is an empty LockSite and Lock is unchanged.
+#if defined(CR_ENABLE_LOCK_PROFILING)
+#define CR_LOCK_PROFILING_IS_ON() 1
+#else
+#define CR_LOCK_PROFILING_IS_ON() 0
+#endif
+
+#if CR_LOCK_PROFILING_IS_ON()
+#include "crbase/time/time.h"
+#include "crbase/tracing/location.h"
+#endif
+
 namespace cr {
 
+#if CR_LOCK_PROFILING_IS_ON()
+typedef tracked_objects::Location LockSite;
+#define CR_LOCK_FROM_HERE CR_FROM_HERE
+#else
+struct LockSite {};
+#define CR_LOCK_FROM_HERE ::cr::LockSite()
+#endif
+
 // A convenient wrapper for an OS specific critical section.  The only real
 // intelligence in this class is in debug mode for the support for the
 // AssertAcquired() method.
@@ -27,7 +54,15 @@ class CRBASE_EXPORT Lock {
   Lock() : lock_() {}
   ~Lock() {}
   void Acquire() { lock_.Lock(); }
-  void Release() { lock_.Unlock(); }
+  void Release() {
+#if CR_LOCK_PROFILING_IS_ON()
+    if (profiled_.is_profiled) {
+      ReleaseProfiled();
+      return;
+    }
+#endif
+    lock_.Unlock();
+  }
 
   // If the lock is not held, take it and return true. If the lock is already
   // held by another thread, immediately return false. This must not be called
@@ -49,6 +84,12 @@ class CRBASE_EXPORT Lock {
     CheckUnheldAndMark();
   }
   void Release() {
+#if CR_LOCK_PROFILING_IS_ON()
+    if (profiled_.is_profiled) {
+      ReleaseProfiled();
+      return;
+    }
+#endif
     CheckHeldAndUnmark();
     lock_.Unlock();
   }
@@ -64,6 +105,17 @@ class CRBASE_EXPORT Lock {
   void AssertAcquired() const;
 #endif  // CR_DCHECK_IS_ON()
 
+  // Like Acquire(), attributing the acquisition to |site| when lock profiling
+  // is on.  The hold time ends with the matching Release(), and excludes the
+  // time spent in ConditionVariable waits in between.
+  void Acquire(const LockSite& site) {
+#if CR_LOCK_PROFILING_IS_ON()
+    AcquireProfiled(site);
+#else
+    Acquire();
+#endif
+  }
+
 #if defined(MINI_CHROMIUM_OS_POSIX)
   // The posix implementation of ConditionVariable needs to be able
   // to see our lock and tweak our debugging counters, as it releases
@@ -73,6 +125,9 @@ class CRBASE_EXPORT Lock {
   // The Windows Vista implementation of ConditionVariable needs the
   // native handle of the critical section.
   friend class WinVistaCondVar;
+  // Both Windows implementations set the profiled acquisition aside while
+  // they wait.
+  friend class WinXPCondVar;
 #endif
 
  private:
@@ -90,6 +145,44 @@ class CRBASE_EXPORT Lock {
   PlatformThreadRef owning_thread_ref_;
 #endif  // CR_DCHECK_IS_ON()
 
+  // A profiled acquisition of the lock, from Acquire(const LockSite&) to the
+  // matching Release().
+#if CR_LOCK_PROFILING_IS_ON()
+  struct ProfiledAcquisition {
+    bool is_profiled = false;
+    bool contended = false;
+    LockSite site;
+    TimeTicks acquire_time;
+    TimeDelta wait_time;
+
+    // Time held before the ConditionVariable waits so far.
+    TimeDelta hold_time;
+  };
+#else
+  struct ProfiledAcquisition {};
+#endif
+
+  // Called by ConditionVariable, with the lock held, right before releasing
+  // it for a wait and right after taking it again.  The acquisition of the
+  // waiting thread is kept in |*saved| meanwhile, so that a thread taking the
+  // lock during the wait doesn't release it as its own.
+#if CR_LOCK_PROFILING_IS_ON()
+  void SuspendProfiledAcquisition(ProfiledAcquisition* saved);
+  void ResumeProfiledAcquisition(const ProfiledAcquisition& saved);
+#else
+  void SuspendProfiledAcquisition(ProfiledAcquisition* saved) {}
+  void ResumeProfiledAcquisition(const ProfiledAcquisition& saved) {}
+#endif
+
+#if CR_LOCK_PROFILING_IS_ON()
+  void AcquireProfiled(const LockSite& site);
+  void ReleaseProfiled();
+
+  // The profiled acquisition of the thread holding the lock, if any.
+  // Protected by lock_.
+  ProfiledAcquisition profiled_;
+#endif
+
   // Platform specific underlying lock implementation.
   internal::LockImpl lock_;
 };
@@ -106,6 +199,13 @@ class AutoLock {
     lock_.Acquire();
   }
 
+  // Attributes the acquisition to |site| when lock profiling is on:
+  //
+  //   AutoLock lock(lock_, CR_LOCK_FROM_HERE);
+  AutoLock(Lock& lock, const LockSite& site) : lock_(lock) {
+    lock_.Acquire(site);
+  }
+
   AutoLock(Lock& lock, const AlreadyAcquired&) : lock_(lock) {
     lock_.AssertAcquired();
   }
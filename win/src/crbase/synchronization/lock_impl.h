@@ -12,7 +12,9 @@
 #if defined(MINI_CHROMIUM_OS_WIN)
 #include <windows.h>
 #elif defined(MINI_CHROMIUM_OS_POSIX)
-#include <pthread.h>
+#include <stdint.h>
+
+#include <atomic>
 #endif
 
 namespace cr {
@@ -23,7 +25,19 @@ namespace internal {
 // should instead use Lock.
 class CRBASE_EXPORT LockImpl {
  public:
+#if defined(MINI_CHROMIUM_OS_WIN)
   typedef CRITICAL_SECTION NativeHandle;
+#elif defined(MINI_CHROMIUM_OS_POSIX)
+  // A futex word holding one of the states below.
+  typedef std::atomic<int32_t> NativeHandle;
+
+  enum : int32_t {
+    kUnlocked = 0,
+    kLocked = 1,
+    // Locked, and threads may be sleeping on the futex.
+    kLockedContended = 2,
+  };
+#endif
 
   LockImpl(const LockImpl&) = delete;
   LockImpl& operator=(const LockImpl&) = delete;
@@ -47,10 +61,45 @@ class CRBASE_EXPORT LockImpl {
   // unnecessary.
   NativeHandle* native_handle() { return &native_handle_; }
 
+#if defined(MINI_CHROMIUM_OS_POSIX)
+  // Takes the lock, leaving it marked as contended.  Used by threads woken
+  // from the futex, which can't know whether others are still sleeping on it.
+  void LockContended();
+#endif
+
  private:
+#if defined(MINI_CHROMIUM_OS_POSIX)
+  void LockSlow();
+  void WakeOne();
+
+  // Moving average of the spins it took to get the lock in LockSlow().
+  std::atomic<int32_t> spin_estimate_;
+#endif
+
   NativeHandle native_handle_;
 };
 
+#if defined(MINI_CHROMIUM_OS_POSIX)
+// The uncontended paths take a single atomic operation, without a system call.
+inline bool LockImpl::Try() {
+  int32_t state = kUnlocked;
+  return native_handle_.compare_exchange_strong(
+      state, kLocked, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+inline void LockImpl::Lock() {
+  if (!Try())
+    LockSlow();
+}
+
+inline void LockImpl::Unlock() {
+  if (native_handle_.exchange(kUnlocked, std::memory_order_release) ==
+      kLockedContended) {
+    WakeOne();
+  }
+}
+#endif
+
 }  // namespace internal
 }  // namespace cr
 
@@ -0,0 +1,78 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/synchronization/lock_impl.h"
+
+#include <algorithm>
+
+#include "crbase/synchronization/futex_linux.h"
+
+namespace cr {
+namespace internal {
+
+namespace {
+
+// Bounds on the spinning before sleeping on the futex.  Like glibc's adaptive
+// mutexes, each lock spins up to twice its recent average, so that locks
+// which are held briefly are taken without sleeping, and the others soon
+// stop burning CPU.
+const int32_t kMinSpinCount = 10;
+const int32_t kMaxSpinCount = 100;
+
+inline void SpinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+// Moves |estimate| an eighth of the way towards |spins|, and at least one
+// step, so that it converges rather than stalling within 8 of it.
+inline int32_t UpdateSpinEstimate(int32_t estimate, int32_t spins) {
+  int32_t step = (spins - estimate) / 8;
+  if (!step && spins != estimate)
+    step = spins > estimate ? 1 : -1;
+  return estimate + step;
+}
+
+}  // namespace
+
+LockImpl::LockImpl() : spin_estimate_(0), native_handle_(kUnlocked) {
+}
+
+LockImpl::~LockImpl() {
+}
+
+void LockImpl::LockSlow() {
+  const int32_t estimate = spin_estimate_.load(std::memory_order_relaxed);
+  const int32_t max_spins =
+      std::min(kMaxSpinCount, estimate * 2 + kMinSpinCount);
+  for (int32_t spins = 0; spins < max_spins; ++spins) {
+    SpinPause();
+    if (native_handle_.load(std::memory_order_relaxed) == kUnlocked &&
+        Try()) {
+      spin_estimate_.store(UpdateSpinEstimate(estimate, spins),
+                           std::memory_order_relaxed);
+      return;
+    }
+  }
+  spin_estimate_.store(UpdateSpinEstimate(estimate, max_spins),
+                       std::memory_order_relaxed);
+  LockContended();
+}
+
+void LockImpl::LockContended() {
+  while (native_handle_.exchange(kLockedContended,
+                                 std::memory_order_acquire) != kUnlocked) {
+    FutexWait(&native_handle_, kLockedContended);
+  }
+}
+
+void LockImpl::WakeOne() {
+  FutexWake(&native_handle_, 1);
+}
+
+}  // namespace internal
+}  // namespace cr
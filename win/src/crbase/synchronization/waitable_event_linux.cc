@@ -0,0 +1,368 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/synchronization/waitable_event.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "crbase/logging.h"
+#include "crbase/synchronization/futex_linux.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/time/time.h"
+
+// -----------------------------------------------------------------------------
+// A WaitableEvent on Linux is implemented as a wait-list. Currently we don't
+// support cross-process events (where one process can signal an event which
+// others are waiting on). Because of this, we can avoid having one thread per
+// listener in several cases.
+//
+// The WaitableEvent maintains a list of waiters, protected by a lock. Each
+// waiter is either an async wait, in which case we have a Task and the
+// MessageLoop to run it on, or a blocking wait, in which case the waiting
+// thread sleeps on a futex word of its own until fired.
+//
+// Waiting on multiple events is handled by adding a single, synchronous wait to
+// the wait-list of many events. An event passes a pointer to itself when
+// firing a waiter and so we can store that pointer to find out which event
+// triggered.
+// -----------------------------------------------------------------------------
+
+namespace cr {
+
+WaitableEvent::WaitableEvent(bool manual_reset, bool initially_signaled)
+    : kernel_(new WaitableEventKernel(manual_reset, initially_signaled)) {
+}
+
+WaitableEvent::~WaitableEvent() {
+}
+
+void WaitableEvent::Reset() {
+  AutoLock locked(kernel_->lock_);
+  kernel_->signaled_ = false;
+}
+
+void WaitableEvent::Signal() {
+  AutoLock locked(kernel_->lock_);
+
+  if (kernel_->signaled_)
+    return;
+
+  if (kernel_->manual_reset_) {
+    SignalAll();
+    kernel_->signaled_ = true;
+  } else {
+    // In the case of auto reset, if no waiters were woken, we remain
+    // signaled.
+    if (!SignalOne())
+      kernel_->signaled_ = true;
+  }
+}
+
+bool WaitableEvent::IsSignaled() {
+  AutoLock locked(kernel_->lock_);
+
+  const bool result = kernel_->signaled_;
+  if (result && !kernel_->manual_reset_)
+    kernel_->signaled_ = false;
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+// Synchronous waits
+
+// -----------------------------------------------------------------------------
+// This is a synchronous waiter. The thread is waiting on a futex word which
+// Fire() sets.  Once fired, or disabled after a timeout, the waiter can't be
+// fired again.
+// -----------------------------------------------------------------------------
+namespace {
+
+class SyncWaiter : public WaitableEvent::Waiter {
+ public:
+  SyncWaiter() : state_(kWaiting), signaling_event_(nullptr) {}
+
+  // Called with the lock of |signaling_event|'s kernel held.
+  bool Fire(WaitableEvent* signaling_event) override {
+    int32_t state = kWaiting;
+    if (!state_.compare_exchange_strong(state, kFired,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+      return false;
+    }
+
+    signaling_event_ = signaling_event;
+    internal::FutexWake(&state_, 1);
+    return true;
+  }
+
+  // Sleeps until fired or |max_time| passes, then disables the waiter.
+  // Returns true if it was fired.
+  bool Wait(const TimeDelta& max_time) {
+    const bool forever = max_time.is_max();
+    const TimeTicks end_time = forever ? TimeTicks() : TimeTicks::Now() +
+                                                       max_time;
+    while (state_.load(std::memory_order_acquire) == kWaiting) {
+      if (forever) {
+        internal::FutexWait(&state_, kWaiting);
+        continue;
+      }
+      const TimeDelta remaining = end_time - TimeTicks::Now();
+      if (!internal::FutexWait(&state_, kWaiting, &remaining))
+        break;
+    }
+
+    int32_t state = kWaiting;
+    return !state_.compare_exchange_strong(state, kDisabled,
+                                           std::memory_order_acquire);
+  }
+
+  // Only valid once fired, with the lock of the signaling event's kernel
+  // acquired after Wait() returned.
+  WaitableEvent* signaling_event() const { return signaling_event_; }
+
+  // -------------------------------------------------------------------------
+  // These waiters are always stack allocated and don't delete themselves. Thus
+  // there's no problem and the ABA tag is the same as the object pointer.
+  // -------------------------------------------------------------------------
+  bool Compare(void* tag) override { return this == tag; }
+
+ private:
+  enum : int32_t {
+    kWaiting,
+    kFired,
+    kDisabled,
+  };
+
+  std::atomic<int32_t> state_;
+  WaitableEvent* signaling_event_;  // The WaitableEvent which woke us.
+};
+
+}  // namespace
+
+void WaitableEvent::Wait() {
+  bool result = TimedWait(TimeDelta::Max());
+  CR_DCHECK(result) << "TimedWait() should never fail with infinite timeout";
+}
+
+bool WaitableEvent::TimedWait(const TimeDelta& max_time) {
+  CR_DCHECK_GE(max_time, TimeDelta());
+
+  kernel_->lock_.Acquire();
+  if (kernel_->signaled_) {
+    if (!kernel_->manual_reset_) {
+      // In this case we were signaled when we had no waiters. Now that
+      // someone has waited upon us, we can automatically reset.
+      kernel_->signaled_ = false;
+    }
+
+    kernel_->lock_.Release();
+    return true;
+  }
+
+  SyncWaiter sw;
+  Enqueue(&sw);
+  kernel_->lock_.Release();
+
+  const bool fired = sw.Wait(max_time);
+
+  // Once fired or disabled, the waiter is only referenced from the wait-list
+  // if it timed out.  Taking the kernel lock also waits for Fire() to return
+  // before |sw| goes out of scope.
+  kernel_->lock_.Acquire();
+  kernel_->Dequeue(&sw, &sw);
+  kernel_->lock_.Release();
+
+  return fired;
+}
+
+// -----------------------------------------------------------------------------
+// Synchronous waiting on multiple objects.
+
+static bool  // StrictWeakOrdering
+cmp_fst_addr(const std::pair<WaitableEvent*, size_t> &a,
+             const std::pair<WaitableEvent*, size_t> &b) {
+  return a.first < b.first;
+}
+
+// static
+size_t WaitableEvent::WaitMany(WaitableEvent** raw_waitables,
+                               size_t count) {
+  CR_DCHECK(count) << "Cannot wait on no events";
+
+  // We need to acquire the locks in a globally consistent order. Thus we sort
+  // the array of waitables by address. We actually sort a pairs so that we can
+  // map back to the original index values later.
+  std::vector<std::pair<WaitableEvent*, size_t> > waitables;
+  waitables.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    waitables.push_back(std::make_pair(raw_waitables[i], i));
+
+  CR_DCHECK_EQ(count, waitables.size());
+
+  std::sort(waitables.begin(), waitables.end(), cmp_fst_addr);
+
+  // The set of waitables must be distinct. Since we have just sorted by
+  // address, we can check this cheaply by comparing pairs of consecutive
+  // elements.
+  for (size_t i = 0; i < waitables.size() - 1; ++i) {
+    CR_DCHECK(waitables[i].first != waitables[i+1].first);
+  }
+
+  SyncWaiter sw;
+
+  const size_t r = EnqueueMany(&waitables[0], count, &sw);
+  if (r < count) {
+    // One of the events is already signaled. The SyncWaiter has not been
+    // enqueued anywhere.
+    return waitables[r].second;
+  }
+
+  // At this point, we hold the locks on all the WaitableEvents and we have
+  // enqueued our waiter in them all.
+  for (size_t i = 0; i < count; ++i)
+    waitables[count - (1 + i)].first->kernel_->lock_.Release();
+
+  sw.Wait(TimeDelta::Max());
+
+  // The waiter is fired and disabled, so it won't be fired again.  Take all
+  // the locks again so that we can dequeue it from the others.
+  for (size_t i = 0; i < count; ++i)
+    waitables[i].first->kernel_->lock_.Acquire();
+
+  WaitableEvent* const signaled_event = sw.signaling_event();
+  // We depend on the SyncWaiter being disabled to avoid it being fired again
+  // and overwriting |signaling_event_|.
+  size_t signaled_index = 0;
+
+  // Dequeue on all the other waitables.
+  for (size_t i = 0; i < count; ++i) {
+    if (raw_waitables[i] != signaled_event) {
+      raw_waitables[i]->kernel_->Dequeue(&sw, &sw);
+    } else {
+      signaled_index = i;
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i)
+    waitables[count - (1 + i)].first->kernel_->lock_.Release();
+
+  return signaled_index;
+}
+
+// -----------------------------------------------------------------------------
+// If return value == count:
+//   The locks of the WaitableEvents have been taken in order and the Waiter has
+//   been enqueued in the wait-list of each. None of the WaitableEvents are
+//   currently signaled
+// else:
+//   None of the WaitableEvent locks are held. The Waiter has not been enqueued
+//   in any of them and the return value is the index of the WaitableEvent
+//   which was signaled with the lowest input index from the original WaitMany
+//   call.
+// -----------------------------------------------------------------------------
+// static
+size_t WaitableEvent::EnqueueMany(WaiterAndIndex* waitables,
+                                  size_t count, Waiter* waiter) {
+  size_t winner = count;
+  size_t winner_index = count;
+  for (size_t i = 0; i < count; ++i) {
+    auto& kernel = waitables[i].first->kernel_;
+    kernel->lock_.Acquire();
+    if (kernel->signaled_ && waitables[i].second < winner) {
+      winner = waitables[i].second;
+      winner_index = i;
+    }
+  }
+
+  // No events signaled. All locks acquired. Enqueue the Waiter on all of them
+  // and return.
+  if (winner == count) {
+    for (size_t i = 0; i < count; ++i)
+      waitables[i].first->Enqueue(waiter);
+    return count;
+  }
+
+  // Unlock in reverse order and possibly clear the chosen winner's signal
+  // before returning its index.
+  for (size_t i = count; i > 0; --i) {
+    auto& kernel = waitables[i - 1].first->kernel_;
+    if (waitables[i - 1].second == winner && !kernel->manual_reset_)
+      kernel->signaled_ = false;
+    kernel->lock_.Release();
+  }
+
+  return winner_index;
+}
+
+// -----------------------------------------------------------------------------
+// Private functions...
+
+WaitableEvent::WaitableEventKernel::WaitableEventKernel(bool manual_reset,
+                                                        bool initially_signaled)
+    : manual_reset_(manual_reset),
+      signaled_(initially_signaled) {
+}
+
+WaitableEvent::WaitableEventKernel::~WaitableEventKernel() {
+}
+
+// -----------------------------------------------------------------------------
+// Wake all waiting waiters. Called with lock held.
+// -----------------------------------------------------------------------------
+bool WaitableEvent::SignalAll() {
+  bool signaled_at_least_one = false;
+
+  for (std::list<Waiter*>::iterator
+       i = kernel_->waiters_.begin(); i != kernel_->waiters_.end(); ++i) {
+    if ((*i)->Fire(this))
+      signaled_at_least_one = true;
+  }
+
+  kernel_->waiters_.clear();
+  return signaled_at_least_one;
+}
+
+// ---------------------------------------------------------------------------
+// Try to wake a single waiter. Return true if one was woken. Called with lock
+// held.
+// ---------------------------------------------------------------------------
+bool WaitableEvent::SignalOne() {
+  for (;;) {
+    if (kernel_->waiters_.empty())
+      return false;
+
+    const bool r = (*kernel_->waiters_.begin())->Fire(this);
+    kernel_->waiters_.pop_front();
+    if (r)
+      return true;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Add a waiter to the list of those waiting. Called with lock held.
+// -----------------------------------------------------------------------------
+void WaitableEvent::Enqueue(Waiter* waiter) {
+  kernel_->waiters_.push_back(waiter);
+}
+
+// -----------------------------------------------------------------------------
+// Remove a waiter from the list of those waiting. Return true if the waiter was
+// actually removed. Called with lock held.
+// -----------------------------------------------------------------------------
+bool WaitableEvent::WaitableEventKernel::Dequeue(Waiter* waiter, void* tag) {
+  for (std::list<Waiter*>::iterator
+       i = waiters_.begin(); i != waiters_.end(); ++i) {
+    if (*i == waiter && (*i)->Compare(tag)) {
+      waiters_.erase(i);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace cr
@@ -4,6 +4,8 @@
 
 #include "crbase/threading/pending_task.h"
 
+#include <utility>
+
 #include "crbase/tracing/tracked_objects.h"
 
 namespace cr {
@@ -15,7 +17,8 @@ PendingTask::PendingTask(const tracked_objects::Location& posted_from,
       posted_from(posted_from),
       sequence_num(0),
       nestable(true),
-      is_high_res(false) {
+      is_high_res(false),
+      priority(TaskPriority::NORMAL) {
 }
 
 PendingTask::PendingTask(const tracked_objects::Location& posted_from,
@@ -27,7 +30,8 @@ PendingTask::PendingTask(const tracked_objects::Location& posted_from,
       posted_from(posted_from),
       sequence_num(0),
       nestable(nestable),
-      is_high_res(false) {
+      is_high_res(false),
+      priority(TaskPriority::NORMAL) {
 }
 
 PendingTask::PendingTask(PendingTask&& other) = default;
@@ -53,4 +57,60 @@ bool PendingTask::operator<(const PendingTask& other) const {
   return (sequence_num - other.sequence_num) > 0;
 }
 
+DelayedTaskQueue::DelayedTaskQueue() : sweep_index_(0) {
+}
+
+DelayedTaskQueue::~DelayedTaskQueue() {
+}
+
+size_t DelayedTaskQueue::SweepCancelledTasks(size_t max_tasks) {
+  size_t removed = 0;
+  for (size_t visited = 0; visited < max_tasks && !c.empty(); ++visited) {
+    if (sweep_index_ >= c.size())
+      sweep_index_ = 0;
+    if (c[sweep_index_].task.IsCancelled()) {
+      // Another task takes the freed position, so look at it again.
+      RemoveAt(sweep_index_);
+      ++removed;
+    } else {
+      ++sweep_index_;
+    }
+  }
+  return removed;
+}
+
+void DelayedTaskQueue::RemoveAt(size_t index) {
+  size_t last = c.size() - 1;
+  if (index != last)
+    c[index] = std::move(c[last]);
+  c.pop_back();
+  if (index >= c.size())
+    return;
+
+  // The moved task may belong above or below |index|.  The heap keeps the
+  // "greatest" task at the root, as defined by |comp|.
+  size_t current = index;
+  while (current > 0) {
+    size_t parent = (current - 1) / 2;
+    if (!comp(c[parent], c[current]))
+      break;
+    std::swap(c[parent], c[current]);
+    current = parent;
+  }
+  if (current != index)
+    return;
+
+  for (;;) {
+    size_t child = 2 * current + 1;
+    if (child >= c.size())
+      break;
+    if (child + 1 < c.size() && comp(c[child], c[child + 1]))
+      ++child;
+    if (!comp(c[current], c[child]))
+      break;
+    std::swap(c[current], c[child]);
+    current = child;
+  }
+}
+
 }  // namespace cr
@@ -15,6 +15,21 @@
 
 namespace cr {
 
+// Priority of a task posted to a MessageLoop.  Among the tasks that are ready
+// to run, those of a higher priority run first; see
+// MessageLoop::PostTaskWithPriority().
+enum class TaskPriority {
+  // Latency-critical work, e.g. socket completions or IPC replies.
+  HIGH,
+  // The priority of the tasks posted through the usual PostTask() calls.
+  NORMAL,
+  // Background work that can wait for everything else.
+  BEST_EFFORT,
+};
+
+// Number of TaskPriority values.
+const int kTaskPriorityCount = 3;
+
 // Contains data about a pending task. Stored in TaskQueue and DelayedTaskQueue
 // for use by classes that queue and execute tasks.
 struct CRBASE_EXPORT PendingTask : public TrackingInfo {
@@ -46,12 +61,36 @@ struct CRBASE_EXPORT PendingTask : public TrackingInfo {
 
   // Needs high resolution timers.
   bool is_high_res;
+
+  // Selects the queue of the MessageLoop the task waits in once it is ready.
+  TaskPriority priority;
+
+  // When the task was posted, if it was posted without a delay.  Used for the
+  // queueing delay statistics of the MessageLoop.
+  TimeTicks queue_time;
 };
 
 using TaskQueue = std::queue<PendingTask>;
 
 // PendingTasks are sorted by their |delayed_run_time| property.
-using DelayedTaskQueue = std::priority_queue<cr::PendingTask>;
+class CRBASE_EXPORT DelayedTaskQueue
+    : public std::priority_queue<cr::PendingTask> {
+ public:
+  DelayedTaskQueue();
+  ~DelayedTaskQueue();
+
+  // Looks at up to |max_tasks| queued tasks, resuming where the previous call
+  // stopped, and deletes those whose callback reports IsCancelled().  Returns
+  // the number of deleted tasks.
+  size_t SweepCancelledTasks(size_t max_tasks);
+
+ private:
+  // Removes the task at |index| of the heap and restores the heap order.
+  void RemoveAt(size_t index);
+
+  // Position in the heap at which the next sweep starts.
+  size_t sweep_index_;
+};
 
 }  // namespace cr
 
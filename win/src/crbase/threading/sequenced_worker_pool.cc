@@ -6,9 +6,13 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <list>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -86,6 +90,56 @@ struct SequencedTaskLessThan {
   }
 };
 
+// Runnable work queued on a worker deque in SCHEDULING_WORK_STEALING mode.
+// Either an unsequenced task, or a sequence whose next task should be run.
+struct WorkItem {
+  WorkItem() : sequence_token_id(0) {}
+  explicit WorkItem(int sequence_token_id)
+      : sequence_token_id(sequence_token_id) {}
+  explicit WorkItem(SequencedTask task)
+      : sequence_token_id(0), task(std::move(task)) {}
+
+  WorkItem(WorkItem&&) = default;
+  WorkItem& operator=(WorkItem&&) = default;
+
+  // Nonzero if the item stands for the sequence with this token.
+  int sequence_token_id;
+
+  // The task of an unsequenced item.
+  SequencedTask task;
+};
+
+// The deque of a worker.  The owner takes work from the front, thieves from
+// the back.
+struct WorkerDeque {
+  Lock lock;
+  std::deque<WorkItem> items;
+};
+
+// The pending tasks of a sequence in SCHEDULING_WORK_STEALING mode.  A
+// sequence exists while it has tasks or one of its tasks is running, and
+// during that time it is owned by exactly one worker or queued exactly once
+// on a deque, which keeps its tasks in posting order.
+struct SequenceQueue {
+  SequenceQueue() : running(false) {}
+
+  std::deque<SequencedTask> tasks;
+
+  // True while a worker runs a task of the sequence.
+  bool running;
+};
+
+// The sequences whose token id falls in one stripe of |sequence_shards_|.
+// Striping keeps sequenced tasks on different tokens from contending on one
+// pool-wide lock.
+struct SequenceShard {
+  Lock lock;
+  std::unordered_map<int, std::unique_ptr<SequenceQueue>> sequences;
+};
+
+// Number of stripes of |sequence_shards_|.
+const size_t kSequenceShardCount = 64;
+
 // SequencedWorkerPoolTaskRunner ---------------------------------------------
 // A TaskRunner which posts tasks to a SequencedWorkerPool with a
 // fixed ShutdownBehavior.
@@ -260,6 +314,14 @@ class SequencedWorkerPool::Worker : public SimpleThread {
   // Whether the worker is processing a task.
   bool is_processing_task() { return is_processing_task_; }
 
+  // The 1-based number the worker was created with.
+  int thread_number() const { return thread_number_; }
+
+  // Whether the worker runs the tasks of |worker_pool|.
+  bool IsWorkerOf(const SequencedWorkerPool* worker_pool) const {
+    return worker_pool_.get() == worker_pool;
+  }
+
   SequenceToken task_sequence_token() const {
     CR_DCHECK(is_processing_task_);
     return task_sequence_token_;
@@ -279,6 +341,7 @@ class SequencedWorkerPool::Worker : public SimpleThread {
       lazy_tls_ptr_;
 
   scoped_refptr<SequencedWorkerPool> worker_pool_;
+  const int thread_number_;
   // The sequence token of the task being processed. Only valid when
   // is_processing_task_ is true.
   SequenceToken task_sequence_token_;
@@ -300,6 +363,7 @@ class SequencedWorkerPool::Inner {
   // by it).
   Inner(SequencedWorkerPool* worker_pool, size_t max_threads,
         const std::string& thread_name_prefix,
+        SchedulingMode scheduling_mode,
         TestingObserver* observer);
 
   ~Inner();
@@ -365,6 +429,11 @@ class SequencedWorkerPool::Inner {
   // token ID, creating a new one if necessary.
   int LockedGetNamedTokenID(const std::string& name);
 
+  // Called from within the lock once Shutdown() has been called. Returns true
+  // if a task with |shutdown_behavior| may still be posted from the current
+  // thread, and takes it from the allowance of new BLOCK_SHUTDOWN tasks.
+  bool LockedCanPostTaskAfterShutdown(WorkerShutdown shutdown_behavior);
+
   // Called from within the lock, this returns the next sequence task number.
   int64_t LockedGetNextSequenceTaskNumber();
 
@@ -427,6 +496,65 @@ class SequencedWorkerPool::Inner {
   // called inside the lock.
   bool CanShutdown() const;
 
+  // SCHEDULING_WORK_STEALING mode ---------------------------------------------
+  // Immediate tasks bypass |lock_| and |pending_tasks_| in this mode; delayed
+  // tasks wait in |pending_tasks_| until an idle worker finds them due.
+
+  // Posts a task whose delay is zero. Called outside the lock.
+  bool PostTaskWorkStealing(const std::string* optional_token_name,
+                            SequencedTask sequenced);
+
+  // Queues |task| on its sequence, or on a deque if it is unsequenced.
+  void QueueWorkStealingTask(SequencedTask task);
+
+  // Pushes |item| on the deque of the current worker, or of some worker if
+  // the current thread isn't one, and wakes up or starts a worker for it.
+  void PushWorkItem(WorkItem item);
+
+  // Takes work from the deque at |index|, or else steals it from another one.
+  bool GetWorkItem(size_t index, WorkItem* item);
+
+  // Returns true if any deque has work.
+  bool HasQueuedWork();
+
+  // Runs (or deletes, during shutdown) the next task of |item|.
+  void RunWorkItem(Worker* this_worker, WorkItem item);
+
+  // Returns the stripe that holds the sequence |sequence_token_id|.
+  SequenceShard* GetSequenceShard(int sequence_token_id) const;
+
+  // Called once a task of the sequence |sequence_token_id| has finished.
+  // Queues the sequence again if it has more tasks.
+  void DidRunSequenceTask(int sequence_token_id);
+
+  // Moves the delayed tasks that are due to the deques. Returns true if it
+  // queued or deleted any. Otherwise sets |wait_time| to the time until the
+  // next one is due, or to zero if there is none.
+  bool ScheduleDueDelayedTasks(Worker* this_worker, TimeDelta* wait_time);
+
+  // Waits until a worker is needed or for |wait_time| if not zero.
+  void WaitForWork(TimeDelta wait_time);
+
+  // Wakes up to |count| idle workers.
+  void WakeUpIdleWorkers(size_t count);
+
+  // Starts another worker if all of them are busy and there is work queued.
+  void StartAdditionalThreadIfHelpful();
+
+  // Decrements one of the atomic counters that block shutdown and wakes up
+  // Shutdown() and the idle workers when it drops to zero during shutdown.
+  void DecrementShutdownBlocker(std::atomic<size_t>* counter);
+
+  // Decrements |outstanding_task_count_| and wakes up CleanupForTesting() when
+  // the pool drained.
+  void DecrementOutstandingTaskCount();
+
+  // True once a worker should exit in SCHEDULING_WORK_STEALING mode.
+  bool ShouldWorkerExit() const;
+
+  // Runs the worker loop for SCHEDULING_WORK_STEALING mode.
+  void ThreadLoopWorkStealing(Worker* this_worker);
+
   SequencedWorkerPool* const worker_pool_;
 
   // The last sequence number used. Managed by GetSequenceToken, since this
@@ -495,8 +623,9 @@ class SequencedWorkerPool::Inner {
   int trace_id_;
 
   // Set when Shutdown is called and no further tasks should be
-  // allowed, though we may still be running existing tasks.
-  bool shutdown_called_;
+  // allowed, though we may still be running existing tasks. Written inside
+  // the lock, but also read outside of it in SCHEDULING_WORK_STEALING mode.
+  std::atomic<bool> shutdown_called_;
 
   // The number of new BLOCK_SHUTDOWN tasks that may be posted after Shudown()
   // has been called.
@@ -508,6 +637,42 @@ class SequencedWorkerPool::Inner {
   ConditionVariable cleanup_cv_;
 
   TestingObserver* const testing_observer_;
+
+  // SCHEDULING_WORK_STEALING mode state. None of it is guarded by |lock_|.
+  const bool work_stealing_;
+
+  // One deque per possible worker, indexed by thread number - 1.
+  std::vector<std::unique_ptr<WorkerDeque>> worker_deques_;
+
+  // Sequences that have pending or running tasks, striped by token id.
+  mutable SequenceShard sequence_shards_[kSequenceShardCount];
+
+  // Idle workers wait on |idle_cv_| until |pending_wakeups_| is nonzero.
+  Lock idle_lock_;
+  ConditionVariable idle_cv_;
+  size_t pending_wakeups_;
+
+  // Number of workers that are about to wait or waiting for work.
+  std::atomic<size_t> idle_worker_count_;
+
+  // Number of workers that have started their loop.
+  std::atomic<size_t> started_worker_count_;
+
+  // Used to spread the tasks posted from other threads across the deques.
+  std::atomic<size_t> next_deque_index_;
+
+  // BLOCK_SHUTDOWN tasks queued or running, and SKIP_ON_SHUTDOWN tasks
+  // running. Both are counted before |shutdown_called_| is read, and
+  // Shutdown() sets it before reading them, so either side sees the other.
+  std::atomic<size_t> blocking_task_count_;
+  std::atomic<size_t> blocking_skip_task_count_;
+
+  // Immediate tasks queued or running, used by CleanupForTesting().
+  std::atomic<size_t> outstanding_task_count_;
+
+  // Number of tasks in |pending_tasks_|, so that workers only take |lock_| to
+  // look for due delayed tasks if there are some.
+  std::atomic<size_t> delayed_task_count_;
 };
 
 // Worker definitions ---------------------------------------------------------
@@ -518,6 +683,7 @@ SequencedWorkerPool::Worker::Worker(
     const std::string& prefix)
     : SimpleThread(prefix + StringPrintf("Worker%d", thread_number)),
       worker_pool_(worker_pool),
+      thread_number_(thread_number),
       task_shutdown_behavior_(BLOCK_SHUTDOWN),
       is_processing_task_(false) {
   Start();
@@ -565,6 +731,7 @@ SequencedWorkerPool::Inner::Inner(
     SequencedWorkerPool* worker_pool,
     size_t max_threads,
     const std::string& thread_name_prefix,
+    SchedulingMode scheduling_mode,
     TestingObserver* observer)
     : worker_pool_(worker_pool),
       lock_(),
@@ -583,7 +750,22 @@ SequencedWorkerPool::Inner::Inner(
       cleanup_state_(CLEANUP_DONE),
       cleanup_idlers_(0),
       cleanup_cv_(&lock_),
-      testing_observer_(observer) {}
+      testing_observer_(observer),
+      work_stealing_(scheduling_mode == SCHEDULING_WORK_STEALING),
+      idle_cv_(&idle_lock_),
+      pending_wakeups_(0),
+      idle_worker_count_(0),
+      started_worker_count_(0),
+      next_deque_index_(0),
+      blocking_task_count_(0),
+      blocking_skip_task_count_(0),
+      outstanding_task_count_(0),
+      delayed_task_count_(0) {
+  if (work_stealing_) {
+    for (size_t i = 0; i < max_threads_; ++i)
+      worker_deques_.push_back(WrapUnique(new WorkerDeque));
+  }
+}
 
 SequencedWorkerPool::Inner::~Inner() {
   // You must call Shutdown() before destroying the pool.
@@ -630,29 +812,14 @@ bool SequencedWorkerPool::Inner::PostTask(
       cr::MakeCriticalClosure(std::move(task)) : std::move(task);
   sequenced.time_to_run = TimeTicks::Now() + delay;
 
+  if (work_stealing_ && delay == TimeDelta())
+    return PostTaskWorkStealing(optional_token_name, std::move(sequenced));
+
   int create_thread_id = 0;
   {
-    AutoLock lock(lock_);
-    if (shutdown_called_) {
-      // Don't allow a new task to be posted if it doesn't block shutdown.
-      if (shutdown_behavior != BLOCK_SHUTDOWN)
-        return false;
-
-      // If the current thread is running a task, and that task doesn't block
-      // shutdown, then it shouldn't be allowed to post any more tasks.
-      ThreadMap::const_iterator found =
-          threads_.find(PlatformThread::CurrentId());
-      if (found != threads_.end() && found->second->is_processing_task() &&
-          found->second->task_shutdown_behavior() != BLOCK_SHUTDOWN) {
-        return false;
-      }
-
-      if (max_blocking_tasks_after_shutdown_ <= 0) {
-        CR_DLOG(WARNING) << "BLOCK_SHUTDOWN task disallowed";
-        return false;
-      }
-      max_blocking_tasks_after_shutdown_ -= 1;
-    }
+    AutoLock lock(lock_, CR_LOCK_FROM_HERE);
+    if (shutdown_called_ && !LockedCanPostTaskAfterShutdown(shutdown_behavior))
+      return false;
 
     // The trace_id is used for identifying the task in about:tracing.
     sequenced.trace_id = trace_id_++;
@@ -672,7 +839,21 @@ bool SequencedWorkerPool::Inner::PostTask(
     if (shutdown_behavior == BLOCK_SHUTDOWN)
       blocking_shutdown_pending_task_count_++;
 
-    create_thread_id = PrepareToStartAdditionalThreadIfHelpful();
+    if (work_stealing_) {
+      // An idle worker picks the delayed task up once it is due. Wake one up
+      // so that it can shorten its wait if needed.
+      delayed_task_count_++;
+    } else {
+      create_thread_id = PrepareToStartAdditionalThreadIfHelpful();
+    }
+  }
+
+  if (work_stealing_) {
+    if (idle_worker_count_ > 0)
+      WakeUpIdleWorkers(1);
+    else
+      StartAdditionalThreadIfHelpful();
+    return true;
   }
 
   // Actually start the additional thread or signal an existing one now that
@@ -703,6 +884,12 @@ bool SequencedWorkerPool::Inner::IsRunningSequenceOnCurrentThread(
 bool SequencedWorkerPool::Inner::IsRunningSequence(
     SequenceToken sequence_token) const {
   CR_DCHECK(sequence_token.IsValid());
+  if (work_stealing_) {
+    SequenceShard* shard = GetSequenceShard(sequence_token.id_);
+    AutoLock lock(shard->lock);
+    auto found = shard->sequences.find(sequence_token.id_);
+    return found != shard->sequences.end() && found->second->running;
+  }
   AutoLock lock(lock_);
   return !IsSequenceTokenRunnable(sequence_token.id_);
 }
@@ -717,6 +904,19 @@ void SequencedWorkerPool::Inner::SetRunningTaskInfoForCurrentThread(
   CR_DCHECK(!found->second->task_sequence_token().IsValid());
   found->second->set_running_task_info(sequence_token, shutdown_behavior);
 
+  if (work_stealing_) {
+    // Own the new sequence until the running task completes, so that the
+    // tasks posted to it wait for that.
+    SequenceShard* shard = GetSequenceShard(sequence_token.id_);
+    AutoLock sequences_lock(shard->lock);
+    std::unique_ptr<SequenceQueue>& sequence =
+        shard->sequences[sequence_token.id_];
+    CR_DCHECK(!sequence);
+    sequence.reset(new SequenceQueue);
+    sequence->running = true;
+    return;
+  }
+
   // Mark the sequence token as in use.
   bool success = current_sequences_.insert(sequence_token.id_).second;
   CR_DCHECK(success);
@@ -726,6 +926,24 @@ void SequencedWorkerPool::Inner::SetRunningTaskInfoForCurrentThread(
 void SequencedWorkerPool::Inner::CleanupForTesting() {
   CR_DCHECK(!RunsTasksOnCurrentThread());
   cr::ThreadRestrictions::ScopedAllowWait allow_wait;
+  if (work_stealing_) {
+    // Delayed tasks are deleted, outside the lock, and immediate ones are
+    // waited for.
+    std::vector<SequencedTask> delayed_tasks;
+    AutoLock lock(lock_);
+    CR_CHECK_EQ(CLEANUP_DONE, cleanup_state_);
+    if (shutdown_called_)
+      return;
+    for (PendingTaskSet::iterator i = pending_tasks_.begin();
+         i != pending_tasks_.end(); ++i) {
+      delayed_tasks.push_back(std::move(const_cast<SequencedTask&>(*i)));
+    }
+    pending_tasks_.clear();
+    delayed_task_count_ = 0;
+    while (outstanding_task_count_ != 0)
+      cleanup_cv_.Wait();
+    return;
+  }
   AutoLock lock(lock_);
   CR_CHECK_EQ(CLEANUP_DONE, cleanup_state_);
   if (shutdown_called_)
@@ -740,6 +958,8 @@ void SequencedWorkerPool::Inner::CleanupForTesting() {
 }
 
 void SequencedWorkerPool::Inner::SignalHasWorkForTesting() {
+  if (work_stealing_)
+    WakeUpIdleWorkers(1);
   SignalHasWork();
 }
 
@@ -758,6 +978,8 @@ void SequencedWorkerPool::Inner::Shutdown(
     // Tickle the threads. This will wake up a waiting one so it will know that
     // it can exit, which in turn will wake up any other waiting ones.
     SignalHasWork();
+    if (work_stealing_)
+      WakeUpIdleWorkers(max_threads_);
 
     // There are no pending or running tasks blocking shutdown, we're done.
     if (CanShutdown())
@@ -788,8 +1010,13 @@ bool SequencedWorkerPool::Inner::IsShutdownInProgress() {
 }
 
 void SequencedWorkerPool::Inner::ThreadLoop(Worker* this_worker) {
+  if (work_stealing_) {
+    ThreadLoopWorkStealing(this_worker);
+    return;
+  }
+
   {
-    AutoLock lock(lock_);
+    AutoLock lock(lock_, CR_LOCK_FROM_HERE);
     CR_DCHECK(thread_being_created_);
     thread_being_created_ = false;
     std::pair<ThreadMap::iterator, bool> result =
@@ -994,6 +1221,32 @@ int SequencedWorkerPool::Inner::LockedGetNamedTokenID(
   return result.id_;
 }
 
+bool SequencedWorkerPool::Inner::LockedCanPostTaskAfterShutdown(
+    WorkerShutdown shutdown_behavior) {
+  lock_.AssertAcquired();
+  CR_DCHECK(shutdown_called_);
+
+  // Don't allow a new task to be posted if it doesn't block shutdown.
+  if (shutdown_behavior != BLOCK_SHUTDOWN)
+    return false;
+
+  // If the current thread is running a task, and that task doesn't block
+  // shutdown, then it shouldn't be allowed to post any more tasks.
+  ThreadMap::const_iterator found =
+      threads_.find(PlatformThread::CurrentId());
+  if (found != threads_.end() && found->second->is_processing_task() &&
+      found->second->task_shutdown_behavior() != BLOCK_SHUTDOWN) {
+    return false;
+  }
+
+  if (max_blocking_tasks_after_shutdown_ <= 0) {
+    CR_DLOG(WARNING) << "BLOCK_SHUTDOWN task disallowed";
+    return false;
+  }
+  max_blocking_tasks_after_shutdown_ -= 1;
+  return true;
+}
+
 int64_t SequencedWorkerPool::Inner::LockedGetNextSequenceTaskNumber() {
   lock_.AssertAcquired();
   // We assume that we never create enough tasks to wrap around.
@@ -1184,6 +1437,14 @@ int SequencedWorkerPool::Inner::PrepareToStartAdditionalThreadIfHelpful() {
       cleanup_state_ == CLEANUP_DONE &&
       threads_.size() < max_threads_ &&
       waiting_thread_count_ == 0) {
+    if (work_stealing_) {
+      // The caller has queued work and found no idle worker to take it.
+      if (idle_worker_count_ != 0)
+        return 0;
+      thread_being_created_ = true;
+      return static_cast<int>(threads_.size() + 1);
+    }
+
     // We could use an additional thread if there's work to be done.
     for (PendingTaskSet::const_iterator i = pending_tasks_.begin();
          i != pending_tasks_.end(); ++i) {
@@ -1219,7 +1480,354 @@ bool SequencedWorkerPool::Inner::CanShutdown() const {
   // See PrepareToStartAdditionalThreadIfHelpful for how thread creation works.
   return !thread_being_created_ &&
          blocking_shutdown_thread_count_ == 0 &&
-         blocking_shutdown_pending_task_count_ == 0;
+         blocking_shutdown_pending_task_count_ == 0 &&
+         blocking_task_count_ == 0 &&
+         blocking_skip_task_count_ == 0;
+}
+
+bool SequencedWorkerPool::Inner::PostTaskWorkStealing(
+    const std::string* optional_token_name,
+    SequencedTask sequenced) {
+  if (optional_token_name) {
+    AutoLock lock(lock_);
+    sequenced.sequence_token_id = LockedGetNamedTokenID(*optional_token_name);
+  }
+
+  // The task is counted before |shutdown_called_| is read; see
+  // |blocking_task_count_|.
+  const bool blocks_shutdown = sequenced.shutdown_behavior == BLOCK_SHUTDOWN;
+  if (blocks_shutdown)
+    blocking_task_count_++;
+  if (shutdown_called_) {
+    bool allowed;
+    {
+      AutoLock lock(lock_);
+      allowed = LockedCanPostTaskAfterShutdown(sequenced.shutdown_behavior);
+    }
+    if (!allowed) {
+      if (blocks_shutdown)
+        DecrementShutdownBlocker(&blocking_task_count_);
+      return false;
+    }
+  }
+
+  QueueWorkStealingTask(std::move(sequenced));
+  return true;
+}
+
+void SequencedWorkerPool::Inner::QueueWorkStealingTask(SequencedTask task) {
+  outstanding_task_count_++;
+
+  int sequence_token_id = task.sequence_token_id;
+  if (!sequence_token_id) {
+    PushWorkItem(WorkItem(std::move(task)));
+    return;
+  }
+
+  {
+    SequenceShard* shard = GetSequenceShard(sequence_token_id);
+    AutoLock lock(shard->lock, CR_LOCK_FROM_HERE);
+    std::unique_ptr<SequenceQueue>& sequence =
+        shard->sequences[sequence_token_id];
+    if (sequence) {
+      // The sequence is already queued or running somewhere; whoever owns it
+      // will get to the task.
+      sequence->tasks.push_back(std::move(task));
+      return;
+    }
+    sequence.reset(new SequenceQueue);
+    sequence->tasks.push_back(std::move(task));
+  }
+  PushWorkItem(WorkItem(sequence_token_id));
+}
+
+void SequencedWorkerPool::Inner::PushWorkItem(WorkItem item) {
+  size_t index;
+  Worker* worker = Worker::GetForCurrentThread();
+  if (worker && worker->IsWorkerOf(worker_pool_)) {
+    // Keep the work local; idle workers will steal it if this one is busy.
+    index = static_cast<size_t>(worker->thread_number() - 1);
+  } else {
+    size_t started = started_worker_count_;
+    index = started ? next_deque_index_++ % started : 0;
+  }
+
+  WorkerDeque* deque = worker_deques_[index].get();
+  {
+    AutoLock lock(deque->lock, CR_LOCK_FROM_HERE);
+    deque->items.push_back(std::move(item));
+  }
+
+  // Pairs with the increment of |idle_worker_count_| in WaitForWork(): either
+  // an idle worker is seen here, or the worker sees the item.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (idle_worker_count_ > 0)
+    WakeUpIdleWorkers(1);
+  else
+    StartAdditionalThreadIfHelpful();
+}
+
+bool SequencedWorkerPool::Inner::GetWorkItem(size_t index, WorkItem* item) {
+  {
+    WorkerDeque* deque = worker_deques_[index].get();
+    AutoLock lock(deque->lock, CR_LOCK_FROM_HERE);
+    if (!deque->items.empty()) {
+      *item = std::move(deque->items.front());
+      deque->items.pop_front();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < worker_deques_.size(); ++i) {
+    WorkerDeque* victim =
+        worker_deques_[(index + i) % worker_deques_.size()].get();
+    AutoLock lock(victim->lock, CR_LOCK_FROM_HERE);
+    if (!victim->items.empty()) {
+      *item = std::move(victim->items.back());
+      victim->items.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SequencedWorkerPool::Inner::HasQueuedWork() {
+  for (size_t i = 0; i < worker_deques_.size(); ++i) {
+    WorkerDeque* deque = worker_deques_[i].get();
+    AutoLock lock(deque->lock);
+    if (!deque->items.empty())
+      return true;
+  }
+  return false;
+}
+
+void SequencedWorkerPool::Inner::RunWorkItem(Worker* this_worker,
+                                             WorkItem item) {
+  SequencedTask task;
+  if (item.sequence_token_id) {
+    SequenceShard* shard = GetSequenceShard(item.sequence_token_id);
+    AutoLock lock(shard->lock, CR_LOCK_FROM_HERE);
+    SequenceQueue* sequence = shard->sequences[item.sequence_token_id].get();
+    CR_DCHECK(sequence && !sequence->tasks.empty() && !sequence->running);
+    task = std::move(sequence->tasks.front());
+    sequence->tasks.pop_front();
+    sequence->running = true;
+  } else {
+    task = std::move(item.task);
+  }
+
+  // Tasks that don't block shutdown are deleted instead of run once shutdown
+  // started. A SKIP_ON_SHUTDOWN task that starts before blocks it until it
+  // completes; it is counted before |shutdown_called_| is read again.
+  bool run_task = !shutdown_called_ || task.shutdown_behavior == BLOCK_SHUTDOWN;
+  if (run_task && task.shutdown_behavior == SKIP_ON_SHUTDOWN) {
+    blocking_skip_task_count_++;
+    if (shutdown_called_) {
+      DecrementShutdownBlocker(&blocking_skip_task_count_);
+      run_task = false;
+    }
+  }
+
+  this_worker->set_running_task_info(
+      SequenceToken(task.sequence_token_id), task.shutdown_behavior);
+  if (run_task) {
+    tracked_objects::TaskStopwatch stopwatch;
+    stopwatch.Start();
+    std::move(task.task).Run();
+    stopwatch.Stop();
+
+    tracked_objects::ThreadData::TallyRunOnNamedThreadIfTracking(
+        task, stopwatch);
+  }
+
+  // The task may have bound a new sequence token to this thread, see
+  // SetRunningTaskInfoForCurrentThread().
+  int sequence_token_id = this_worker->task_sequence_token().id_;
+
+  // Destroy the task while the running task info is still set so that
+  // sequence-checking from within its destructor works.
+  task.task.Reset();
+  this_worker->reset_running_task_info();
+
+  if (task.shutdown_behavior == BLOCK_SHUTDOWN)
+    DecrementShutdownBlocker(&blocking_task_count_);
+  else if (run_task && task.shutdown_behavior == SKIP_ON_SHUTDOWN)
+    DecrementShutdownBlocker(&blocking_skip_task_count_);
+
+  if (sequence_token_id)
+    DidRunSequenceTask(sequence_token_id);
+
+  DecrementOutstandingTaskCount();
+}
+
+SequenceShard* SequencedWorkerPool::Inner::GetSequenceShard(
+    int sequence_token_id) const {
+  return &sequence_shards_[static_cast<unsigned int>(sequence_token_id) %
+                           kSequenceShardCount];
+}
+
+void SequencedWorkerPool::Inner::DidRunSequenceTask(int sequence_token_id) {
+  {
+    SequenceShard* shard = GetSequenceShard(sequence_token_id);
+    AutoLock lock(shard->lock, CR_LOCK_FROM_HERE);
+    auto found = shard->sequences.find(sequence_token_id);
+    CR_DCHECK(found != shard->sequences.end());
+    SequenceQueue* sequence = found->second.get();
+    sequence->running = false;
+    if (sequence->tasks.empty()) {
+      shard->sequences.erase(found);
+      return;
+    }
+  }
+  // Queue the sequence behind the work that is already waiting, so that a
+  // long sequence doesn't starve the rest.
+  PushWorkItem(WorkItem(sequence_token_id));
+}
+
+bool SequencedWorkerPool::Inner::ScheduleDueDelayedTasks(Worker* this_worker,
+                                                         TimeDelta* wait_time) {
+  *wait_time = TimeDelta();
+  if (delayed_task_count_ == 0)
+    return false;
+
+  std::vector<SequencedTask> due_tasks;
+  std::vector<SequencedTask> delete_these_outside_lock;
+  {
+    AutoLock lock(lock_);
+    const TimeTicks current_time = TimeTicks::Now();
+    while (!pending_tasks_.empty()) {
+      PendingTaskSet::iterator i = pending_tasks_.begin();
+      // Delayed tasks don't block shutdown and are deleted once it started.
+      // The const_casts are safe since the objects are erased right after.
+      if (shutdown_called_) {
+        CR_DCHECK_NE(BLOCK_SHUTDOWN, i->shutdown_behavior);
+        delete_these_outside_lock.push_back(
+            std::move(const_cast<SequencedTask&>(*i)));
+      } else if (i->time_to_run <= current_time) {
+        due_tasks.push_back(std::move(const_cast<SequencedTask&>(*i)));
+      } else {
+        *wait_time = i->time_to_run - current_time;
+        break;
+      }
+      pending_tasks_.erase(i);
+    }
+    delayed_task_count_ -= due_tasks.size() + delete_these_outside_lock.size();
+  }
+
+  DeleteWithoutLock(&delete_these_outside_lock, this_worker);
+  for (size_t i = 0; i < due_tasks.size(); ++i)
+    QueueWorkStealingTask(std::move(due_tasks[i]));
+  return !due_tasks.empty() || !delete_these_outside_lock.empty();
+}
+
+void SequencedWorkerPool::Inner::WaitForWork(TimeDelta wait_time) {
+  // Pairs with the fence in PushWorkItem().
+  idle_worker_count_++;
+  if (!HasQueuedWork() && !ShouldWorkerExit()) {
+    cr::ThreadRestrictions::ScopedAllowWait allow_wait;
+    AutoLock lock(idle_lock_);
+    if (pending_wakeups_ == 0) {
+      if (wait_time == TimeDelta())
+        idle_cv_.Wait();
+      else
+        idle_cv_.TimedWait(wait_time);
+    }
+    if (pending_wakeups_ > 0)
+      pending_wakeups_--;
+  }
+  idle_worker_count_--;
+}
+
+void SequencedWorkerPool::Inner::WakeUpIdleWorkers(size_t count) {
+  AutoLock lock(idle_lock_);
+  // Wakeups nobody waits for are kept for the next idle workers, up to one
+  // per worker.
+  pending_wakeups_ = std::min(pending_wakeups_ + count, max_threads_);
+  if (count == 1)
+    idle_cv_.Signal();
+  else
+    idle_cv_.Broadcast();
+}
+
+void SequencedWorkerPool::Inner::StartAdditionalThreadIfHelpful() {
+  if (started_worker_count_ >= max_threads_ || shutdown_called_)
+    return;
+
+  int create_thread_id;
+  {
+    AutoLock lock(lock_);
+    create_thread_id = PrepareToStartAdditionalThreadIfHelpful();
+  }
+  if (create_thread_id)
+    FinishStartingAdditionalThread(create_thread_id);
+}
+
+void SequencedWorkerPool::Inner::DecrementShutdownBlocker(
+    std::atomic<size_t>* counter) {
+  if (--(*counter) != 0 || !shutdown_called_)
+    return;
+
+  // Idle workers may now be able to exit.
+  WakeUpIdleWorkers(max_threads_);
+  AutoLock lock(lock_);
+  can_shutdown_cv_.Signal();
+}
+
+void SequencedWorkerPool::Inner::DecrementOutstandingTaskCount() {
+  if (--outstanding_task_count_ != 0)
+    return;
+
+  AutoLock lock(lock_);
+  cleanup_cv_.Broadcast();
+}
+
+bool SequencedWorkerPool::Inner::ShouldWorkerExit() const {
+  // Same rule as in ThreadLoop(): the workers stay until no task that blocks
+  // shutdown is left.
+  return shutdown_called_ && blocking_task_count_ == 0;
+}
+
+void SequencedWorkerPool::Inner::ThreadLoopWorkStealing(Worker* this_worker) {
+  {
+    AutoLock lock(lock_);
+    CR_DCHECK(thread_being_created_);
+    thread_being_created_ = false;
+    std::pair<ThreadMap::iterator, bool> result =
+        threads_.insert(
+            std::make_pair(this_worker->tid(), WrapUnique(this_worker)));
+    CR_DCHECK(result.second);
+    started_worker_count_++;
+  }
+
+  const size_t index = static_cast<size_t>(this_worker->thread_number() - 1);
+  CR_DCHECK_LT(index, worker_deques_.size());
+
+  while (true) {
+    WorkItem item;
+    if (GetWorkItem(index, &item)) {
+      // Work is piling up if more is queued after this item and nobody is
+      // idle; see WillRunWorkerTask().
+      if (idle_worker_count_ == 0 && HasQueuedWork())
+        StartAdditionalThreadIfHelpful();
+      RunWorkItem(this_worker, std::move(item));
+      continue;
+    }
+
+    TimeDelta wait_time;
+    if (ScheduleDueDelayedTasks(this_worker, &wait_time))
+      continue;
+
+    if (ShouldWorkerExit())
+      break;
+
+    WaitForWork(wait_time);
+  }
+
+  // Wake up the other workers so they know they should exit as well.
+  WakeUpIdleWorkers(max_threads_);
+
+  // Possibly unblock shutdown.
+  can_shutdown_cv_.Signal();
 }
 
 cr::StaticAtomicSequenceNumber
@@ -1281,14 +1889,24 @@ SequencedWorkerPool::GetSequencedTaskRunnerForCurrentThread() {
 SequencedWorkerPool::SequencedWorkerPool(size_t max_threads,
                                          const std::string& thread_name_prefix)
     : constructor_task_runner_(ThreadTaskRunnerHandle::Get()),
-      inner_(new Inner(this, max_threads, thread_name_prefix, NULL)) {
+      inner_(new Inner(this, max_threads, thread_name_prefix,
+                       SCHEDULING_SHARED_QUEUE, NULL)) {
 }
 
 SequencedWorkerPool::SequencedWorkerPool(size_t max_threads,
                                          const std::string& thread_name_prefix,
                                          TestingObserver* observer)
     : constructor_task_runner_(ThreadTaskRunnerHandle::Get()),
-      inner_(new Inner(this, max_threads, thread_name_prefix, observer)) {
+      inner_(new Inner(this, max_threads, thread_name_prefix,
+                       SCHEDULING_SHARED_QUEUE, observer)) {
+}
+
+SequencedWorkerPool::SequencedWorkerPool(size_t max_threads,
+                                         const std::string& thread_name_prefix,
+                                         SchedulingMode scheduling_mode)
+    : constructor_task_runner_(ThreadTaskRunnerHandle::Get()),
+      inner_(new Inner(this, max_threads, thread_name_prefix,
+                       scheduling_mode, NULL)) {
 }
 
 SequencedWorkerPool::~SequencedWorkerPool() {}
@@ -123,6 +123,21 @@ class CRBASE_EXPORT SequencedWorkerPool : public TaskRunner {
     BLOCK_SHUTDOWN,
   };
 
+  // Defines how pending tasks are handed to the worker threads.
+  enum SchedulingMode {
+    // Every pending task is kept in one set guarded by the pool lock, which
+    // each worker takes to look for the next task to run.
+    SCHEDULING_SHARED_QUEUE,
+
+    // Each worker owns a deque of runnable work and idle workers steal from
+    // the deques of the others.  Tasks of one sequence are queued on their
+    // sequence, which is handed to one worker at a time.  Posting and running
+    // tasks do not take the pool lock, which lets throughput scale with the
+    // number of cores.  Delayed tasks still go through the pool lock until
+    // they are due.
+    SCHEDULING_WORK_STEALING,
+  };
+
   // Opaque identifier that defines sequencing of tasks posted to the worker
   // pool.
   class CRBASE_EXPORT SequenceToken {
@@ -200,6 +215,12 @@ class CRBASE_EXPORT SequencedWorkerPool : public TaskRunner {
                       const std::string& thread_name_prefix,
                       TestingObserver* observer);
 
+  // Like the first constructor, but with the given |scheduling_mode|.  The
+  // other constructors use SCHEDULING_SHARED_QUEUE.
+  SequencedWorkerPool(size_t max_threads,
+                      const std::string& thread_name_prefix,
+                      SchedulingMode scheduling_mode);
+
   // Returns the sequence token associated with the given name. Calling this
   // function multiple times with the same string will always produce the
   // same sequence token. If the name has not been used before, a new token
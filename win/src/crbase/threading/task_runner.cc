@@ -44,6 +44,15 @@ bool TaskRunner::PostTask(const tracked_objects::Location& from_here,
   return PostDelayedTask(from_here, std::move(task), TimeDelta());
 }
 
+bool TaskRunner::PostTasks(const tracked_objects::Location& from_here,
+                           std::vector<OnceClosure> tasks) {
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    if (!PostTask(from_here, std::move(tasks[i])))
+      return false;
+  }
+  return true;
+}
+
 bool TaskRunner::PostTaskAndReply(
     const tracked_objects::Location& from_here,
     OnceClosure task,
@@ -7,6 +7,8 @@
 
 #include <stddef.h>
 
+#include <vector>
+
 #include "crbase/base_export.h"
 #include "crbase/memory/ref_counted.h"
 #include "crbase/time/time.h"
@@ -76,6 +78,17 @@ class CRBASE_EXPORT TaskRunner
                                OnceClosure task,
                                TimeDelta delay) = 0;
 
+  // Posts every task of |tasks|, in order, as if PostTask() was called for
+  // each of them.  Returns true if all of them may be run, and false if some
+  // definitely will not be run.
+  //
+  // Implementations can override this to queue the whole batch at once, e.g.
+  // with a single lock acquisition and a single wakeup of the thread that runs
+  // the tasks.  The default implementation calls PostTask() for each task and
+  // stops at the first one that fails.
+  virtual bool PostTasks(const tracked_objects::Location& from_here,
+                         std::vector<OnceClosure> tasks);
+
   // Returns true if the current thread is a thread on which a task
   // may be run, and false if no task will be run on the current
   // thread.
@@ -35,6 +35,7 @@ void ThreadQuitHelper() {
 Thread::Options::Options()
     : message_loop_type(MessageLoop::TYPE_DEFAULT),
       timer_slack(TIMER_SLACK_NONE),
+      use_delayed_task_wheel(false),
       stack_size(0),
       priority(ThreadPriority::NORMAL) {
 }
@@ -43,6 +44,7 @@ Thread::Options::Options(MessageLoop::Type type,
                          size_t size)
     : message_loop_type(type),
       timer_slack(TIMER_SLACK_NONE),
+      use_delayed_task_wheel(false),
       stack_size(size),
       priority(ThreadPriority::NORMAL) {
 }
@@ -60,6 +62,7 @@ Thread::Thread(const std::string& name)
       id_event_(true, false),
       message_loop_(nullptr),
       message_loop_timer_slack_(TIMER_SLACK_NONE),
+      message_loop_use_delayed_task_wheel_(false),
       name_(name),
       start_event_(false, false) {
 }
@@ -91,6 +94,7 @@ bool Thread::StartWithOptions(const Options& options) {
     type = MessageLoop::TYPE_CUSTOM;
 
   message_loop_timer_slack_ = options.timer_slack;
+  message_loop_use_delayed_task_wheel_ = options.use_delayed_task_wheel;
   std::unique_ptr<MessageLoop> message_loop = MessageLoop::CreateUnbound(
       type, options.message_pump_factory);
   message_loop_ = message_loop.get();
@@ -218,6 +222,8 @@ void Thread::ThreadMain() {
   message_loop_->BindToCurrentThread();
   message_loop_->set_thread_name(name_);
   message_loop_->SetTimerSlack(message_loop_timer_slack_);
+  if (message_loop_use_delayed_task_wheel_)
+    message_loop_->EnableDelayedTaskWheel();
 
   std::unique_ptr<win::ScopedCOMInitializer> com_initializer;
   if (com_status_ != NONE) {
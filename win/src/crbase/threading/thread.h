@@ -57,6 +57,10 @@ class CRBASE_EXPORT Thread : PlatformThread::Delegate {
     // Specifies timer slack for thread message loop.
     TimerSlack timer_slack;
 
+    // If true, the thread message loop keeps its delayed tasks in a timing
+    // wheel.  See MessageLoop::EnableDelayedTaskWheel().
+    bool use_delayed_task_wheel;
+
     // Used to create the MessagePump for the MessageLoop. The callback is Run()
     // on the thread. If message_pump_factory.is_null(), then a MessagePump
     // appropriate for |message_loop_type| is created. Setting this forces the
@@ -248,6 +252,10 @@ class CRBASE_EXPORT Thread : PlatformThread::Delegate {
   // a thread.
   TimerSlack message_loop_timer_slack_;
 
+  // Stores Options::use_delayed_task_wheel until the message loop has been
+  // bound to a thread.
+  bool message_loop_use_delayed_task_wheel_;
+
   // The name of the thread.  Used for debugging purposes.
   std::string name_;
 
@@ -0,0 +1,55 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ThreadCacheSlot<Type> holds one Type per thread, created on first use by
+// GetOrCreate() and deleted when the thread exits.  It is meant for the
+// per-thread free lists of allocators: ~Type() runs on the exiting thread
+// and can hand the cached memory back.
+//
+// Get() keeps returning null on a thread whose Type was deleted, so frees
+// that happen later in thread teardown can tell the cache is gone.
+//
+// Declare it leaky so that the slot outlives every thread using it:
+//
+//   LazyInstance<ThreadCacheSlot<MyCache>>::Leaky g_cache_slot =
+//       CR_LAZY_INSTANCE_INITIALIZER;
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_THREADING_THREAD_CACHE_SLOT_H_
+#define MINI_CHROMIUM_SRC_CRBASE_THREADING_THREAD_CACHE_SLOT_H_
+
+#include "crbase/threading/thread_local_storage.h"
+
+namespace cr {
+
+template <typename Type>
+class ThreadCacheSlot {
+ public:
+  ThreadCacheSlot(const ThreadCacheSlot&) = delete;
+  ThreadCacheSlot& operator=(const ThreadCacheSlot&) = delete;
+
+  ThreadCacheSlot() : slot_(&OnThreadExit) {}
+
+  // Returns the cache of the current thread, or null if it has none.
+  Type* Get() const { return static_cast<Type*>(slot_.Get()); }
+
+  Type* GetOrCreate() {
+    Type* cache = Get();
+    if (!cache) {
+      cache = new Type;
+      slot_.Set(cache);
+    }
+    return cache;
+  }
+
+ private:
+  static void OnThreadExit(void* value) {
+    delete static_cast<Type*>(value);
+  }
+
+  ThreadLocalStorage::Slot slot_;
+};
+
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_THREADING_THREAD_CACHE_SLOT_H_
@@ -58,6 +58,7 @@
 
 #if defined(MINI_CHROMIUM_OS_POSIX)
 #include <pthread.h>
+#include <stddef.h>
 #endif
 
 namespace cr {
@@ -68,15 +69,63 @@ struct CRBASE_EXPORT ThreadLocalPlatform {
 #if defined(MINI_CHROMIUM_OS_WIN)
   typedef unsigned long SlotType;
 #elif defined(MINI_CHROMIUM_OS_POSIX)
-  typedef pthread_key_t SlotType;
+  // A fast slot is the index of its entry in |fast_slots_| plus
+  // kFastSlotCount times the generation of that index, which goes up each
+  // time the index is handed out again.  Other slots are pthread keys with
+  // kKeySlotFlag set.
+  typedef size_t SlotType;
+
+  static const size_t kFastSlotCount = 64;
+  static const SlotType kKeySlotFlag = ~(~SlotType(0) >> 1);
 #endif
 
   static void AllocateSlot(SlotType* slot);
   static void FreeSlot(SlotType slot);
   static void* GetValueFromSlot(SlotType slot);
   static void SetValueInSlot(SlotType slot, void* value);
+
+#if defined(MINI_CHROMIUM_OS_POSIX)
+ private:
+  static void* GetValueFromKey(SlotType slot);
+  static void SetValueInKey(SlotType slot, void* value);
+
+  // A value and the slot that set it.  A freed index may still hold a value
+  // on other threads; it reads as null for the next slot given that index,
+  // whose generation differs.
+  struct FastSlot {
+    void* value;
+    SlotType slot;
+  };
+
+  // Values of the fast slots, read and written without calling into
+  // libpthread.  Thread-local pointers have no destructor, so nothing needs
+  // to run at thread exit.
+  static __thread FastSlot fast_slots_[kFastSlotCount]
+      __attribute__((tls_model("initial-exec")));
+#endif
 };
 
+#if defined(MINI_CHROMIUM_OS_POSIX)
+// static
+inline void* ThreadLocalPlatform::GetValueFromSlot(SlotType slot) {
+  if (slot & kKeySlotFlag)
+    return GetValueFromKey(slot);
+  const FastSlot& fast_slot = fast_slots_[slot % kFastSlotCount];
+  return fast_slot.slot == slot ? fast_slot.value : NULL;
+}
+
+// static
+inline void ThreadLocalPlatform::SetValueInSlot(SlotType slot, void* value) {
+  if (slot & kKeySlotFlag) {
+    SetValueInKey(slot, value);
+    return;
+  }
+  FastSlot& fast_slot = fast_slots_[slot % kFastSlotCount];
+  fast_slot.value = value;
+  fast_slot.slot = slot;
+}
+#endif
+
 }  // namespace internal
 
 template <typename Type>
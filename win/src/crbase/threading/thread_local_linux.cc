@@ -0,0 +1,90 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/threading/thread_local.h"
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "crbase/logging.h"
+
+namespace cr {
+namespace internal {
+
+namespace {
+
+static_assert(ThreadLocalPlatform::kFastSlotCount == 64,
+              "g_free_fast_slots has one bit per fast slot");
+
+// Bit i is set while fast slot index i is free.
+std::atomic<uint64_t> g_free_fast_slots(~uint64_t(0));
+
+// How many times each index was handed out.  A slot is never 0, which is
+// what the unused entries of |fast_slots_| hold.
+std::atomic<size_t> g_fast_slot_generations[
+    ThreadLocalPlatform::kFastSlotCount];
+
+}  // namespace
+
+const size_t ThreadLocalPlatform::kFastSlotCount;
+const ThreadLocalPlatform::SlotType ThreadLocalPlatform::kKeySlotFlag;
+
+__thread ThreadLocalPlatform::FastSlot
+    ThreadLocalPlatform::fast_slots_[kFastSlotCount]
+    __attribute__((tls_model("initial-exec")));
+
+// static
+void ThreadLocalPlatform::AllocateSlot(SlotType* slot) {
+  uint64_t free_slots = g_free_fast_slots.load(std::memory_order_relaxed);
+  while (free_slots) {
+    const uint64_t lowest = free_slots & (~free_slots + 1);
+    if (g_free_fast_slots.compare_exchange_weak(free_slots,
+                                                free_slots & ~lowest,
+                                                std::memory_order_relaxed)) {
+      const size_t index = __builtin_ctzll(lowest);
+      const size_t generation = g_fast_slot_generations[index].fetch_add(
+          1, std::memory_order_relaxed) + 1;
+      *slot = generation * kFastSlotCount + index;
+      CR_DCHECK(!(*slot & kKeySlotFlag));
+      return;
+    }
+  }
+
+  pthread_key_t key;
+  int error = pthread_key_create(&key, NULL);
+  CR_CHECK_EQ(error, 0);
+  *slot = kKeySlotFlag | key;
+}
+
+// static
+void ThreadLocalPlatform::FreeSlot(SlotType slot) {
+  if (!(slot & kKeySlotFlag)) {
+    // Values other threads left in the index are told apart by the slot.
+    const size_t index = slot % kFastSlotCount;
+    fast_slots_[index].value = NULL;
+    g_free_fast_slots.fetch_or(uint64_t(1) << index,
+                               std::memory_order_relaxed);
+    return;
+  }
+  int error = pthread_key_delete(static_cast<pthread_key_t>(
+      slot & ~kKeySlotFlag));
+  CR_DCHECK_EQ(0, error);
+}
+
+// static
+void* ThreadLocalPlatform::GetValueFromKey(SlotType slot) {
+  return pthread_getspecific(static_cast<pthread_key_t>(
+      slot & ~kKeySlotFlag));
+}
+
+// static
+void ThreadLocalPlatform::SetValueInKey(SlotType slot, void* value) {
+  int error = pthread_setspecific(static_cast<pthread_key_t>(
+      slot & ~kKeySlotFlag), value);
+  CR_DCHECK_EQ(error, 0);
+}
+
+}  // namespace internal
+}  // namespace cr
@@ -173,6 +173,7 @@ namespace cr {
 
 namespace internal {
 
+#if defined(MINI_CHROMIUM_OS_WIN)
 void PlatformThreadLocalStorage::OnThreadExit() {
   PlatformThreadLocalStorage::TLSKey key =
       cr::subtle::NoBarrier_Load(&g_native_tls_key);
@@ -184,6 +185,11 @@ void PlatformThreadLocalStorage::OnThreadExit() {
     return;
   OnThreadExitInternal(tls_data);
 }
+#elif defined(MINI_CHROMIUM_OS_POSIX)
+void PlatformThreadLocalStorage::OnThreadExit(void* value) {
+  OnThreadExitInternal(value);
+}
+#endif
 
 }  // namespace internal
 
@@ -5,8 +5,6 @@
 #ifndef MINI_CHROMIUM_SRC_CRBASE_THREADING_THREAD_LOCAL_STORAGE_H_
 #define MINI_CHROMIUM_SRC_CRBASE_THREADING_THREAD_LOCAL_STORAGE_H_
 
-#include <windows.h>
-
 #include "crbase/base_export.h"
 #include "crbase/macros.h"
 #include "crbase/atomic/atomicops.h"
@@ -74,9 +72,22 @@ class CRBASE_EXPORT PlatformThreadLocalStorage {
   // GetTLSValue() to retrieve the value of slot as it has already been reset
   // in Posix.
   static void OnThreadExit(void* value);
+
+ private:
+  // ThreadLocalStorage only ever sets the value of the one key it uses, so
+  // that value is mirrored in a native thread-local variable, which reads
+  // without calling into libpthread.  The pthread key is kept for its
+  // destructor, which runs OnThreadExit().
+  static __thread void* tls_value_ __attribute__((tls_model("initial-exec")));
 #endif
 };
 
+#if defined(MINI_CHROMIUM_OS_POSIX)
+inline void* PlatformThreadLocalStorage::GetTLSValue(TLSKey key) {
+  return tls_value_;
+}
+#endif
+
 }  // namespace internal
 
 // Wrapper for thread local storage.  This class doesn't do much except provide
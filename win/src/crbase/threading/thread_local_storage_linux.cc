@@ -0,0 +1,37 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/threading/thread_local_storage.h"
+
+#include <pthread.h>
+
+#include "crbase/logging.h"
+
+namespace cr {
+
+namespace internal {
+
+__thread void* PlatformThreadLocalStorage::tls_value_
+    __attribute__((tls_model("initial-exec"))) = nullptr;
+
+bool PlatformThreadLocalStorage::AllocTLS(TLSKey* key) {
+  // The key's destructor runs the slot destructors when a thread exits.
+  return !pthread_key_create(key, &PlatformThreadLocalStorage::OnThreadExit);
+}
+
+void PlatformThreadLocalStorage::FreeTLS(TLSKey key) {
+  int ret = pthread_key_delete(key);
+  CR_DCHECK_EQ(ret, 0);
+}
+
+void PlatformThreadLocalStorage::SetTLSValue(TLSKey key, void* value) {
+  tls_value_ = value;
+  // Still set the key, whose destructor is only called for non-null values.
+  int ret = pthread_setspecific(key, value);
+  CR_DCHECK_EQ(ret, 0);
+}
+
+}  // namespace internal
+
+}  // namespace cr
@@ -55,12 +55,35 @@ class BaseTimerTaskInternal {
   // The task remains in the queue, but nothing will happen when it runs.
   void Abandon() { timer_ = nullptr; }
 
+  // True once the task has been abandoned; the message loop may then delete
+  // it before its run time.
+  bool is_abandoned() const { return !timer_; }
+
  private:
   TimerBase* timer_;
 
   ///DISALLOW_COPY_AND_ASSIGN(BaseTimerTaskInternal);
 };
 
+}  // namespace internal
+
+// Lets the callback posted by TimerBase report IsCancelled() once the timer
+// was stopped, so that it doesn't linger in the delayed queue until it fires.
+template <>
+struct CallbackCancellationTraits<
+    void (internal::BaseTimerTaskInternal::*)(),
+    std::tuple<internal::OwnedWrapper<internal::BaseTimerTaskInternal>>> {
+  static constexpr bool is_cancellable = true;
+
+  static bool IsCancelled(
+      void (internal::BaseTimerTaskInternal::*)(),
+      const internal::OwnedWrapper<internal::BaseTimerTaskInternal>& task) {
+    return task.get()->is_abandoned();
+  }
+};
+
+namespace internal {
+
 TimerBase::TimerBase() : TimerBase(nullptr) {}
 
 TimerBase::TimerBase(const TickClock* tick_clock)
@@ -0,0 +1,165 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crbase/tracing/latency_histogram.h"
+
+#include <algorithm>
+
+#include "crbase/bits.h"
+#include "crbase/logging.h"
+#include "crbase/values.h"
+
+namespace cr {
+namespace tracked_objects {
+
+//------------------------------------------------------------------------------
+// LatencyHistogramSnapshot
+
+LatencyHistogramSnapshot::LatencyHistogramSnapshot()
+    : counts(LatencyHistogram::kBucketCount),
+      count(0),
+      sum_us(0),
+      max_us(0) {
+}
+
+LatencyHistogramSnapshot::LatencyHistogramSnapshot(
+    const LatencyHistogramSnapshot& other) = default;
+
+LatencyHistogramSnapshot::~LatencyHistogramSnapshot() {
+}
+
+void LatencyHistogramSnapshot::Add(const LatencyHistogramSnapshot& other) {
+  for (size_t i = 0; i < counts.size(); ++i)
+    counts[i] += other.counts[i];
+  count += other.count;
+  sum_us += other.sum_us;
+  max_us = std::max(max_us, other.max_us);
+}
+
+int64_t LatencyHistogramSnapshot::Percentile(double fraction) const {
+  // The bucket counts and |count| are read separately from a live histogram,
+  // so rely on the counts only.
+  uint64_t total = 0;
+  for (size_t i = 0; i < counts.size(); ++i)
+    total += counts[i];
+  if (!total)
+    return 0;
+
+  // 1-based rank of the sample we are looking for.
+  uint64_t rank = static_cast<uint64_t>(fraction * total + 0.5);
+  rank = std::max<uint64_t>(1, std::min(rank, total));
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    seen += counts[i];
+    if (seen < rank)
+      continue;
+    int index = static_cast<int>(i);
+    int64_t upper = index + 1 < LatencyHistogram::kBucketCount ?
+        LatencyHistogram::BucketLowerBound(index + 1) - 1 : max_us;
+    return std::min(upper, max_us);
+  }
+  return max_us;
+}
+
+std::unique_ptr<DictionaryValue> LatencyHistogramSnapshot::ToValue() const {
+  // Values may not fit an int, so numbers are written as doubles.
+  std::unique_ptr<DictionaryValue> dictionary(new DictionaryValue);
+  dictionary->SetDouble("count", static_cast<double>(count));
+  dictionary->SetDouble("mean_us",
+                        count ? static_cast<double>(sum_us) / count : 0.0);
+  dictionary->SetDouble("max_us", static_cast<double>(max_us));
+  dictionary->SetDouble("p50_us", static_cast<double>(Percentile(0.5)));
+  dictionary->SetDouble("p99_us", static_cast<double>(Percentile(0.99)));
+  dictionary->SetDouble("p999_us", static_cast<double>(Percentile(0.999)));
+
+  // Only the non-empty buckets, as [lower bound in us, count] pairs.
+  std::unique_ptr<ListValue> buckets(new ListValue);
+  for (size_t i = 0; i < counts.size(); ++i) {
+    if (!counts[i])
+      continue;
+    std::unique_ptr<ListValue> bucket(new ListValue);
+    bucket->AppendDouble(static_cast<double>(
+        LatencyHistogram::BucketLowerBound(static_cast<int>(i))));
+    bucket->AppendDouble(static_cast<double>(counts[i]));
+    buckets->Append(std::move(bucket));
+  }
+  dictionary->Set("buckets", std::move(buckets));
+  return dictionary;
+}
+
+//------------------------------------------------------------------------------
+// LatencyHistogram
+
+LatencyHistogram::LatencyHistogram() {
+  Reset();
+}
+
+LatencyHistogram::~LatencyHistogram() {
+}
+
+void LatencyHistogram::Record(TimeDelta duration) {
+  int64_t value_us = std::max<int64_t>(0, duration.InMicroseconds());
+
+  // There is a single writer, so a load and a store are enough; no
+  // read-modify-write instruction or lock is needed.
+  std::atomic<uint32_t>& bucket = counts_[BucketIndex(value_us)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+               std::memory_order_relaxed);
+  sum_us_.store(sum_us_.load(std::memory_order_relaxed) + value_us,
+                std::memory_order_relaxed);
+  if (value_us > max_us_.load(std::memory_order_relaxed))
+    max_us_.store(value_us, std::memory_order_relaxed);
+  count_.store(count_.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+}
+
+void LatencyHistogram::Reset() {
+  for (int i = 0; i < kBucketCount; ++i)
+    counts_[i].store(0, std::memory_order_relaxed);
+  sum_us_.store(0, std::memory_order_relaxed);
+  max_us_.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_release);
+}
+
+LatencyHistogramSnapshot LatencyHistogram::GetSnapshot() const {
+  LatencyHistogramSnapshot snapshot;
+  snapshot.count = count_.load(std::memory_order_acquire);
+  for (int i = 0; i < kBucketCount; ++i)
+    snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+  snapshot.sum_us = sum_us_.load(std::memory_order_relaxed);
+  snapshot.max_us = max_us_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+// static
+int LatencyHistogram::BucketIndex(int64_t value_us) {
+  CR_DCHECK_GE(value_us, 0);
+  if (value_us < kSubBucketCount)
+    return static_cast<int>(value_us);
+
+  int exponent = bits::Log2Floor64(static_cast<uint64_t>(value_us));
+  if (exponent > kMaxExponent)
+    return kBucketCount - 1;
+
+  // The kSubBucketBits bits below the leading one select the sub-bucket.
+  int shift = exponent - kSubBucketBits;
+  int sub_bucket =
+      static_cast<int>((value_us >> shift) & (kSubBucketCount - 1));
+  return (shift + 1) * kSubBucketCount + sub_bucket;
+}
+
+// static
+int64_t LatencyHistogram::BucketLowerBound(int index) {
+  CR_DCHECK(index >= 0 && index < kBucketCount);
+  if (index < kSubBucketCount)
+    return index;
+
+  int shift = index / kSubBucketCount - 1;
+  int64_t sub_bucket = index % kSubBucketCount;
+  return (kSubBucketCount + sub_bucket) << shift;
+}
+
+}  // namespace tracked_objects
+}  // namespace cr
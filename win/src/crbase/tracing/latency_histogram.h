@@ -0,0 +1,101 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRBASE_TRACING_LATENCY_HISTOGRAM_H_
+#define MINI_CHROMIUM_SRC_CRBASE_TRACING_LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "crbase/base_export.h"
+#include "crbase/time/time.h"
+
+namespace cr {
+
+class DictionaryValue;
+
+namespace tracked_objects {
+
+// A "snapshotted" representation of a LatencyHistogram.  Snapshots of several
+// histograms, e.g. of different threads, can be merged with Add().
+struct CRBASE_EXPORT LatencyHistogramSnapshot {
+  LatencyHistogramSnapshot();
+  LatencyHistogramSnapshot(const LatencyHistogramSnapshot& other);
+  ~LatencyHistogramSnapshot();
+
+  // Adds the samples of |other| to this snapshot.
+  void Add(const LatencyHistogramSnapshot& other);
+
+  // Returns the value, in microseconds, under which |fraction| of the samples
+  // fall, e.g. 0.999 for the 99.9th percentile.  The result is the upper bound
+  // of the bucket holding that sample, so it is at most 1/16 too high, and it
+  // never exceeds |max_us|.  Returns 0 without samples.
+  int64_t Percentile(double fraction) const;
+
+  // Returns the count, mean, max, p50, p99 and p999 (all in microseconds)
+  // and the non-empty buckets as a dictionary, e.g. for JSONWriter.
+  std::unique_ptr<DictionaryValue> ToValue() const;
+
+  // Number of samples in each bucket of LatencyHistogram.
+  std::vector<uint64_t> counts;
+
+  int64_t count;
+  int64_t sum_us;
+  int64_t max_us;
+};
+
+// A log-linear histogram of durations, in microseconds.  Every power of two
+// range is cut into 16 buckets of equal width, so values are kept with a
+// relative error under 6.25% from 1us to hours, in a fixed set of buckets.
+//
+// Record() must only be called on one thread at a time, usually the thread
+// owning the histogram, and takes no lock: each counter is updated with a
+// plain atomic load and store.  GetSnapshot() may be called on any thread; it
+// sees every sample recorded before, but a snapshot taken during a Record()
+// may be inconsistent by that one sample.
+class CRBASE_EXPORT LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 4;
+  static const int kSubBucketCount = 1 << kSubBucketBits;
+  // Values at or above 2^(kMaxExponent + 1) microseconds, about 38 hours, go
+  // to the last bucket.
+  static const int kMaxExponent = 36;
+  static const int kBucketCount =
+      (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  LatencyHistogram();
+  ~LatencyHistogram();
+
+  // Adds a sample.  Negative durations are counted as 0.
+  void Record(TimeDelta duration);
+
+  // Drops every sample.  Same thread as Record(); a snapshot taken meanwhile
+  // may mix samples from before and after.
+  void Reset();
+
+  LatencyHistogramSnapshot GetSnapshot() const;
+
+  // Returns the index of the bucket holding |value_us|.
+  static int BucketIndex(int64_t value_us);
+
+  // Returns the smallest value of the bucket at |index|, in microseconds.
+  static int64_t BucketLowerBound(int index);
+
+ private:
+  std::atomic<uint32_t> counts_[kBucketCount];
+  std::atomic<int64_t> count_;
+  std::atomic<int64_t> sum_us_;
+  std::atomic<int64_t> max_us_;
+};
+
+}  // namespace tracked_objects
+}  // namespace cr
+
+#endif  // MINI_CHROMIUM_SRC_CRBASE_TRACING_LATENCY_HISTOGRAM_H_
@@ -435,6 +435,7 @@ void ThreadData::Snapshot(int current_profiling_phase,
     thread_data->SnapshotExecutedTasks(current_profiling_phase,
                                        &process_data_snapshot->phased_snapshots,
                                        &birth_counts);
+    thread_data->SnapshotLockContention(&process_data_snapshot->locks);
   }
 
   // Add births that are still active -- i.e. objects that have tallied a birth,
@@ -606,6 +607,22 @@ void ThreadData::TallyRunInAScopedRegionIfTracking(
   current_thread_data->TallyADeath(*births, queue_duration, stopwatch);
 }
 
+// static
+void ThreadData::TallyLockAcquisitionIfActive(const Location& location,
+                                              cr::TimeDelta wait_time,
+                                              cr::TimeDelta hold_time,
+                                              bool contended) {
+  if (!TrackingStatus())
+    return;
+  ThreadData* current_thread_data = Get();
+  if (!current_thread_data)
+    return;
+
+  cr::AutoLock lock(current_thread_data->map_lock_);
+  current_thread_data->lock_contention_map_[location].RecordAcquisition(
+      wait_time, hold_time, contended);
+}
+
 void ThreadData::SnapshotExecutedTasks(
     int current_profiling_phase,
     PhasedProcessDataSnapshotMap* phased_snapshots,
@@ -665,6 +682,16 @@ void ThreadData::SnapshotMaps(int profiling_phase,
   }
 }
 
+// This may be called from another thread.
+void ThreadData::SnapshotLockContention(
+    std::vector<LockContentionSnapshot>* locks) {
+  cr::AutoLock lock(map_lock_);
+
+  for (const auto& entry : lock_contention_map_)
+    locks->push_back(
+        LockContentionSnapshot(entry.first, entry.second, thread_name()));
+}
+
 void ThreadData::OnProfilingPhaseCompletedOnThread(int profiling_phase) {
   cr::AutoLock lock(map_lock_);
 
@@ -953,6 +980,52 @@ DeathDataPhaseSnapshot::DeathDataPhaseSnapshot(
                  queue_duration_sample),
       prev(prev) {}
 
+//------------------------------------------------------------------------------
+// LockContentionData
+
+LockContentionData::LockContentionData()
+    : acquisitions(0),
+      contentions(0),
+      wait_us_sum(0),
+      wait_us_max(0),
+      hold_us_sum(0),
+      hold_us_max(0) {
+}
+
+void LockContentionData::RecordAcquisition(cr::TimeDelta wait_time,
+                                           cr::TimeDelta hold_time,
+                                           bool contended) {
+  const int64_t wait_us = wait_time.InMicroseconds();
+  const int64_t hold_us = hold_time.InMicroseconds();
+  ++acquisitions;
+  if (contended)
+    ++contentions;
+  wait_us_sum += wait_us;
+  if (wait_us > wait_us_max)
+    wait_us_max = wait_us;
+  hold_us_sum += hold_us;
+  if (hold_us > hold_us_max)
+    hold_us_max = hold_us;
+}
+
+//------------------------------------------------------------------------------
+// LockContentionSnapshot
+
+LockContentionSnapshot::LockContentionSnapshot() {
+}
+
+LockContentionSnapshot::LockContentionSnapshot(
+    const Location& location,
+    const LockContentionData& data,
+    const std::string& thread_name)
+    : location(location),
+      data(data),
+      thread_name(thread_name) {
+}
+
+LockContentionSnapshot::~LockContentionSnapshot() {
+}
+
 //------------------------------------------------------------------------------
 // TaskSnapshot
 
@@ -418,6 +418,41 @@ struct CRBASE_EXPORT TaskSnapshot {
   std::string death_thread_name;
 };
 
+//------------------------------------------------------------------------------
+// Tallies of the acquisitions of Locks at one Location on one thread, made
+// when lock profiling is compiled in (see lock.h).  Only updated on that
+// thread, under the lock of its ThreadData maps.
+
+struct CRBASE_EXPORT LockContentionData {
+  LockContentionData();
+
+  void RecordAcquisition(cr::TimeDelta wait_time,
+                         cr::TimeDelta hold_time,
+                         bool contended);
+
+  // Number of acquisitions, and of those which found the lock held.
+  int64_t acquisitions;
+  int64_t contentions;
+
+  // Time spent waiting for the lock, and holding it, in microseconds.
+  int64_t wait_us_sum;
+  int64_t wait_us_max;
+  int64_t hold_us_sum;
+  int64_t hold_us_max;
+};
+
+struct CRBASE_EXPORT LockContentionSnapshot {
+  LockContentionSnapshot();
+  LockContentionSnapshot(const Location& location,
+                         const LockContentionData& data,
+                         const std::string& thread_name);
+  ~LockContentionSnapshot();
+
+  LocationSnapshot location;
+  LockContentionData data;
+  std::string thread_name;
+};
+
 //------------------------------------------------------------------------------
 // For each thread, we have a ThreadData that stores all tracking info generated
 // on this thread.  This prevents the need for locking as data accumulates.
@@ -514,6 +549,14 @@ class CRBASE_EXPORT ThreadData {
   static void TallyRunInAScopedRegionIfTracking(const Births* births,
                                                 const TaskStopwatch& stopwatch);
 
+  // Records an acquisition of a Lock at |location| on the current thread,
+  // which waited |wait_time| for the lock and then held it for |hold_time|.
+  // Called by Locks when lock profiling is compiled in.
+  static void TallyLockAcquisitionIfActive(const Location& location,
+                                           cr::TimeDelta wait_time,
+                                           cr::TimeDelta hold_time,
+                                           bool contended);
+
   const std::string& thread_name() const { return thread_name_; }
 
   // Initializes all statics if needed (this initialization call should be made
@@ -556,6 +599,9 @@ class CRBASE_EXPORT ThreadData {
 
   typedef std::map<const BirthOnThread*, int> BirthCountMap;
 
+  typedef std::unordered_map<Location, LockContentionData, Location::Hash>
+      LockContentionMap;
+
   typedef std::vector<std::pair<const Births*, DeathDataPhaseSnapshot>>
       DeathsSnapshot;
 
@@ -605,6 +651,10 @@ class CRBASE_EXPORT ThreadData {
                     BirthMap* birth_map,
                     DeathsSnapshot* deaths);
 
+  // Using our lock, appends the lock contention tallies of this thread to
+  // |locks|.  This call may be made on non-local threads.
+  void SnapshotLockContention(std::vector<LockContentionSnapshot>* locks);
+
   // Called for this thread when the current profiling phase, identified by
   // |profiling_phase|, ends.
   void OnProfilingPhaseCompletedOnThread(int profiling_phase);
@@ -705,6 +755,10 @@ class CRBASE_EXPORT ThreadData {
   // locking before reading it.
   DeathMap death_map_;
 
+  // Tallies of the Lock acquisitions profiled on this thread.  Only written on
+  // this thread, and always accessed under map_lock_.
+  LockContentionMap lock_contention_map_;
+
   // Lock to protect *some* access to BirthMap and DeathMap.  The maps are
   // regularly read and written on this thread, but may only be read from other
   // threads.  To support this, we acquire this lock if we are writing from this
@@ -812,6 +866,11 @@ struct CRBASE_EXPORT ProcessDataSnapshot {
   ~ProcessDataSnapshot();
 
   PhasedProcessDataSnapshotMap phased_snapshots;
+
+  // Profiled Lock acquisitions, per thread and Location.  Empty unless lock
+  // profiling is compiled in.
+  std::vector<LockContentionSnapshot> locks;
+
   cr::ProcessId process_id;
 };
 
@@ -4,11 +4,172 @@
 
 #include "crnet/base/io_buffer.h"
 
+#include <atomic>
+
+#include "crbase/lazy_instance.h"
 #include "crbase/logging.h"
 #include "crbase/numerics/safe_math.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/threading/thread_cache_slot.h"
 
 namespace crnet {
 
+namespace {
+
+// PooledIOBuffer size classes: kMinPooledSize << index.
+const size_t kPoolSizeClassCount = 9;
+static_assert((PooledIOBuffer::kMinPooledSize << (kPoolSizeClassCount - 1)) ==
+                  PooledIOBuffer::kMaxPooledSize,
+              "size classes must end at kMaxPooledSize");
+
+// Number of blocks moved at once between a thread's free list and the
+// shared one.  A thread gives blocks back to the shared list above
+// kPoolMaxCachedBlocks per size class.
+const size_t kPoolTransferCount = 8;
+const size_t kPoolMaxCachedBlocks = 2 * kPoolTransferCount;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  FreeBlock* head;
+  size_t count;
+};
+
+std::atomic<size_t> g_pool_memory_limit(
+    PooledIOBuffer::kDefaultPoolMemoryLimit);
+std::atomic<size_t> g_pool_cached_bytes(0);
+std::atomic<uint64_t> g_pool_hits(0);
+std::atomic<uint64_t> g_pool_misses(0);
+
+size_t PoolSizeClassIndex(size_t size) {
+  size_t index = 0;
+  while ((PooledIOBuffer::kMinPooledSize << index) < size)
+    ++index;
+  return index;
+}
+
+// Moves up to |count| blocks from the front of |from| to the front of |to|.
+void TransferBlocks(FreeList* from, FreeList* to, size_t count) {
+  while (count-- && from->head) {
+    FreeBlock* block = from->head;
+    from->head = block->next;
+    --from->count;
+    block->next = to->head;
+    to->head = block;
+    ++to->count;
+  }
+}
+
+// The free lists shared by all threads, one per size class.  Storage freed on
+// a thread that does not allocate, e.g. the consumer of buffers read on
+// another thread, goes back through them to the threads that do.
+class PoolSharedCache {
+ public:
+  PoolSharedCache() {
+    for (size_t i = 0; i < kPoolSizeClassCount; ++i) {
+      lists_[i].head = nullptr;
+      lists_[i].count = 0;
+    }
+  }
+
+  // Moves up to kPoolTransferCount blocks of size class |index| to |list|.
+  void Refill(size_t index, FreeList* list) {
+    cr::AutoLock lock(locks_[index]);
+    TransferBlocks(&lists_[index], list, kPoolTransferCount);
+  }
+
+  // Takes back up to |count| blocks of size class |index| from |list|.
+  void Release(size_t index, FreeList* list, size_t count) {
+    cr::AutoLock lock(locks_[index]);
+    TransferBlocks(list, &lists_[index], count);
+  }
+
+ private:
+  cr::Lock locks_[kPoolSizeClassCount];
+  FreeList lists_[kPoolSizeClassCount];
+};
+
+cr::LazyInstance<PoolSharedCache>::Leaky g_pool_shared_cache =
+    CR_LAZY_INSTANCE_INITIALIZER;
+
+// The free blocks of one thread, one list per size class.  They go back to
+// the shared lists when the thread exits.
+struct PoolThreadCache {
+  PoolThreadCache() {
+    for (size_t i = 0; i < kPoolSizeClassCount; ++i) {
+      lists[i].head = nullptr;
+      lists[i].count = 0;
+    }
+  }
+
+  ~PoolThreadCache() {
+    for (size_t i = 0; i < kPoolSizeClassCount; ++i)
+      g_pool_shared_cache.Pointer()->Release(i, &lists[i], lists[i].count);
+  }
+
+  FreeList lists[kPoolSizeClassCount];
+};
+
+cr::LazyInstance<cr::ThreadCacheSlot<PoolThreadCache>>::Leaky
+    g_pool_thread_cache_slot = CR_LAZY_INSTANCE_INITIALIZER;
+
+uint8_t* PoolAllocBlock(size_t index) {
+  PoolThreadCache* cache = g_pool_thread_cache_slot.Pointer()->GetOrCreate();
+  FreeList* list = &cache->lists[index];
+  if (!list->head)
+    g_pool_shared_cache.Pointer()->Refill(index, list);
+
+  FreeBlock* block = list->head;
+  if (!block) {
+    g_pool_misses.fetch_add(1, std::memory_order_relaxed);
+    return new uint8_t[PooledIOBuffer::kMinPooledSize << index];
+  }
+
+  g_pool_hits.fetch_add(1, std::memory_order_relaxed);
+  list->head = block->next;
+  --list->count;
+  g_pool_cached_bytes.fetch_sub(PooledIOBuffer::kMinPooledSize << index,
+                                std::memory_order_relaxed);
+  return reinterpret_cast<uint8_t*>(block);
+}
+
+void PoolFreeBlock(uint8_t* data, size_t index) {
+  const size_t block_size = PooledIOBuffer::kMinPooledSize << index;
+
+  // Storage released over the limit is freed.
+  size_t cached_bytes =
+      g_pool_cached_bytes.fetch_add(block_size, std::memory_order_relaxed);
+  if (cached_bytes + block_size >
+      g_pool_memory_limit.load(std::memory_order_relaxed)) {
+    g_pool_cached_bytes.fetch_sub(block_size, std::memory_order_relaxed);
+    delete[] data;
+    return;
+  }
+
+  FreeBlock* block = reinterpret_cast<FreeBlock*>(data);
+
+  // Threads that are exiting give the block straight to the shared list.
+  PoolThreadCache* cache = g_pool_thread_cache_slot.Pointer()->Get();
+  if (!cache) {
+    FreeList list = { block, 1 };
+    block->next = nullptr;
+    g_pool_shared_cache.Pointer()->Release(index, &list, 1);
+    return;
+  }
+
+  FreeList* list = &cache->lists[index];
+  block->next = list->head;
+  list->head = block;
+  if (++list->count > kPoolMaxCachedBlocks) {
+    g_pool_shared_cache.Pointer()->Release(index, list,
+                                           kPoolTransferCount);
+  }
+}
+
+}  // namespace
+
 // TODO(eroman): IOBuffer is being converted to require buffer sizes and offsets
 // be specified as "size_t" rather than "int" (crbug.com/488553). To facilitate
 // this move (since LOTS of code needs to be updated), this function ensures
@@ -48,6 +209,50 @@ IOBufferWithSize::~IOBufferWithSize() {
   data_.reset();
 }
 
+// -- PooledIOBuffer
+const size_t PooledIOBuffer::kMinPooledSize;
+const size_t PooledIOBuffer::kMaxPooledSize;
+const size_t PooledIOBuffer::kDefaultPoolMemoryLimit;
+
+PooledIOBuffer::PooledIOBuffer(size_t size) : block_size_(size) {
+  AssertValidBufferSize(size);
+  if (size > kMaxPooledSize) {
+    g_pool_misses.fetch_add(1, std::memory_order_relaxed);
+    block_ = new uint8_t[size];
+  } else {
+    block_ = PoolAllocBlock(PoolSizeClassIndex(size));
+  }
+  SetBytesView(cr::MakeBytesView(block_, size));
+}
+
+PooledIOBuffer::~PooledIOBuffer() {
+  // Clear pointer before this destructor makes it dangle.
+  ClearBytesView();
+  if (block_size_ > kMaxPooledSize)
+    delete[] block_;
+  else
+    PoolFreeBlock(block_, PoolSizeClassIndex(block_size_));
+}
+
+// static
+void PooledIOBuffer::SetPoolMemoryLimit(size_t bytes) {
+  g_pool_memory_limit.store(bytes, std::memory_order_relaxed);
+}
+
+// static
+size_t PooledIOBuffer::GetPoolMemoryLimit() {
+  return g_pool_memory_limit.load(std::memory_order_relaxed);
+}
+
+// static
+PooledIOBuffer::PoolStats PooledIOBuffer::GetPoolStats() {
+  PoolStats stats;
+  stats.hits = g_pool_hits.load(std::memory_order_relaxed);
+  stats.misses = g_pool_misses.load(std::memory_order_relaxed);
+  stats.cached_bytes = g_pool_cached_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
 // -- VectorIOBuffer
 VectorIOBuffer::VectorIOBuffer(std::vector<uint8_t> vector) 
     : vector_(std::move(vector)) {
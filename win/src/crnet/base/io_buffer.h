@@ -6,6 +6,7 @@
 #define MINI_CHROMIUM_SRC_CRNET_BASE_IO_BUFFER_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <string>
 #include <memory>
@@ -13,6 +14,7 @@
 
 #include "crbase/containers/array_view.h"
 #include "crbase/memory/ref_counted.h"
+#include "crbase/memory/ref_counted_biased.h"
 #include "crbase/memory/free_deleter.h"
 #include "crnet/base/net_export.h"
 
@@ -74,9 +76,14 @@ namespace crnet {
 // and hence the buffer it was reading into must remain alive. Using
 // reference counting we can add a reference to the IOBuffer and make sure
 // it is not destroyed until after the synchronous operation has completed.
+//
+// IOBuffers are referenced mostly on the thread that creates them, so they
+// use RefCountedBiased: that thread adds and drops references without atomic
+// operations.  If another thread drops the last reference, the buffer is
+// deleted by a task posted to the creating thread.
 
 // Base class, never instantiated, does not own the buffer.
-class CRNET_EXPORT IOBuffer : public cr::RefCountedThreadSafe<IOBuffer> {
+class CRNET_EXPORT IOBuffer : public cr::RefCountedBiased<IOBuffer> {
  public:
   // Returns the length from bytes() to the end of the buffer. Many methods that
   // take an IOBuffer also take a size indicated the number of IOBuffer bytes to
@@ -101,7 +108,7 @@ class CRNET_EXPORT IOBuffer : public cr::RefCountedThreadSafe<IOBuffer> {
   cr::BytesView bytes_view() { return bytes_view_; }
 
  protected:
-  friend class cr::RefCountedThreadSafe<IOBuffer>;
+  friend class cr::RefCountedBiased<IOBuffer>;
 
   static void AssertValidBufferSize(size_t size);
 
@@ -123,6 +130,26 @@ class CRNET_EXPORT IOBuffer : public cr::RefCountedThreadSafe<IOBuffer> {
   cr::BytesView bytes_view_;
 };
 
+// The most IOBufferSlices that a gather write sends in one call.  Slices past
+// this are left for the next call, as for a partial write.
+const int kMaxIOBufferSlices = 64;
+
+// |length| bytes starting at |offset| in |buffer|.  Arrays of slices are the
+// arguments of gather writes such as StreamSocket::Writev().  A slice does not
+// hold a reference to |buffer|: like the IOBuffer passed to Write(), the
+// socket takes one while the write is pending.
+struct IOBufferSlice {
+  IOBufferSlice() : buffer(nullptr), offset(0), length(0) {}
+  IOBufferSlice(IOBuffer* buffer, size_t offset, int length)
+      : buffer(buffer), offset(offset), length(length) {}
+
+  char* data() const { return buffer->data() + offset; }
+
+  IOBuffer* buffer;
+  size_t offset;
+  int length;
+};
+
 
 // Class which owns its buffer and manages its destruction.
 class CRNET_EXPORT IOBufferWithSize : public IOBuffer {
@@ -137,6 +164,53 @@ class CRNET_EXPORT IOBufferWithSize : public IOBuffer {
   std::unique_ptr<uint8_t[]> data_;
 };
 
+// This is like IOBufferWithSize, except that its storage comes from per-thread
+// free lists of power-of-two size classes, and goes back to the free list of
+// the thread that releases the last reference.  Use it for the short-lived
+// read buffers allocated at a high rate:
+//
+//   auto buf = cr::MakeRefCounted<PooledIOBuffer>(kReadBufferSize);
+//
+// A thread keeps a few blocks per size class and moves the rest, in batches,
+// to free lists shared by all threads, which threads refill from when their
+// own list is empty.  Storage released on another thread than the one that
+// allocated it, as when buffers are read on one thread and consumed on
+// another, thus finds its way back to the allocating thread.
+//
+// Sizes above kMaxPooledSize are allocated and freed directly.  The memory
+// held by all the free lists is bounded by SetPoolMemoryLimit(); storage
+// released over the limit is freed.
+class CRNET_EXPORT PooledIOBuffer : public IOBuffer {
+ public:
+  static const size_t kMinPooledSize = 256;
+  static const size_t kMaxPooledSize = 64 * 1024;
+  static const size_t kDefaultPoolMemoryLimit = 4 * 1024 * 1024;
+
+  struct PoolStats {
+    // Buffers whose storage came from a free list, and buffers that had to
+    // allocate it.
+    uint64_t hits;
+    uint64_t misses;
+
+    // Bytes currently held by the free lists.
+    size_t cached_bytes;
+  };
+
+  explicit PooledIOBuffer(size_t size);
+
+  // Lowering the limit does not free storage already in the free lists.
+  static void SetPoolMemoryLimit(size_t bytes);
+  static size_t GetPoolMemoryLimit();
+
+  static PoolStats GetPoolStats();
+
+ private:
+  ~PooledIOBuffer() override;
+
+  uint8_t* block_;
+  size_t block_size_;
+};
+
 // This is like IOBufferWithSize, except its constructor takes a vector.
 // IOBufferWithSize uses a HeapArray instead of a vector so that it can avoid
 // initializing its data. VectorIOBuffer is primarily useful useful for writing
@@ -0,0 +1,538 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crnet/server/sharded_stream_server.h"
+
+#include <deque>
+#include <utility>
+
+#include "crbase/functional/bind.h"
+#include "crbase/logging.h"
+#include "crbase/strings/stringprintf.h"
+#include "crbase/synchronization/waitable_event.h"
+#include "crbase/threading/single_thread_task_runner.h"
+#include "crbase/threading/thread.h"
+#include "crbase/tracing/location.h"
+#include "crnet/base/io_buffer.h"
+#include "crnet/base/net_errors.h"
+#include "crnet/socket/tcp/server_socket.h"
+#include "crnet/socket/tcp/stream_socket.h"
+#include "crnet/socket/tcp/tcp_server_socket.h"
+
+namespace crnet {
+
+namespace {
+
+// The ServerSocket of a shard fed by the acceptor thread: Accept() completes
+// with the connections handed over by AddAcceptedSocket().
+class AcceptQueueServerSocket : public ServerSocket {
+ public:
+  AcceptQueueServerSocket(const AcceptQueueServerSocket&) = delete;
+  AcceptQueueServerSocket& operator=(const AcceptQueueServerSocket&) = delete;
+
+  explicit AcceptQueueServerSocket(const IPEndPoint& local_address)
+      : local_address_(local_address),
+        pending_socket_(nullptr) {
+  }
+
+  ~AcceptQueueServerSocket() override {}
+
+  // Takes a connection accepted on another thread, and detached from it.
+  void AddAcceptedSocket(std::unique_ptr<StreamSocket> socket) {
+    if (pending_callback_.is_null()) {
+      accepted_sockets_.push_back(std::move(socket));
+      return;
+    }
+    *pending_socket_ = std::move(socket);
+    pending_socket_ = nullptr;
+    std::move(pending_callback_).Run(OK);
+  }
+
+  // ServerSocket implementation.
+  int Listen(const IPEndPoint& address, int backlog) override {
+    // The acceptor thread listens for all the shards.
+    return ERR_NOT_IMPLEMENTED;
+  }
+
+  int GetLocalAddress(IPEndPoint* address) const override {
+    *address = local_address_;
+    return OK;
+  }
+
+  int Accept(std::unique_ptr<StreamSocket>* socket,
+             CompletionOnceCallback callback) override {
+    CR_DCHECK(socket);
+    CR_DCHECK(pending_callback_.is_null());
+    if (accepted_sockets_.empty()) {
+      pending_socket_ = socket;
+      pending_callback_ = std::move(callback);
+      return ERR_IO_PENDING;
+    }
+    *socket = std::move(accepted_sockets_.front());
+    accepted_sockets_.pop_front();
+    return OK;
+  }
+
+ private:
+  const IPEndPoint local_address_;
+
+  // Connections handed over while no Accept() was pending.
+  std::deque<std::unique_ptr<StreamSocket>> accepted_sockets_;
+
+  // The pending Accept(), if any.
+  std::unique_ptr<StreamSocket>* pending_socket_;
+  CompletionOnceCallback pending_callback_;
+};
+
+}  // namespace
+
+// The thread listening for all the shards where they cannot listen under
+// SO_REUSEPORT.  Everything but |thread| is used on that thread only.
+struct ShardedStreamServer::Acceptor {
+  Acceptor() : next_shard_index(0) {}
+
+  void ShutDown() {
+    accepted_socket.reset();
+    server_socket.reset();
+  }
+
+  std::unique_ptr<cr::Thread> thread;
+  cr::scoped_refptr<cr::SingleThreadTaskRunner> task_runner;
+
+  std::unique_ptr<TCPServerSocket> server_socket;
+
+  // Currently accepted socket from a client.
+  std::unique_ptr<StreamSocket> accepted_socket;
+
+  // The shard to hand the next connection to.
+  size_t next_shard_index;
+};
+
+// A StreamServer and its delegate, used on |thread| only.  The forwarding
+// methods are posted there by the ShardedStreamServer methods of the same
+// name.
+struct ShardedStreamServer::Shard {
+  explicit Shard(size_t index) : index(index) {}
+
+  void SendData(uint32_t connection_id, const std::string& data) {
+    if (server)
+      server->SendData(connection_id, data);
+  }
+
+  void SendBuffer(uint32_t connection_id,
+                  cr::scoped_refptr<IOBuffer> data,
+                  size_t data_len) {
+    if (server)
+      server->SendData(connection_id, std::move(data), data_len);
+  }
+
+  void SendFrame(uint32_t connection_id,
+                 cr::scoped_refptr<IOBuffer> header,
+                 size_t header_len,
+                 cr::scoped_refptr<IOBuffer> payload,
+                 size_t payload_len) {
+    if (server) {
+      server->SendData(connection_id, std::move(header), header_len,
+                       std::move(payload), payload_len);
+    }
+  }
+
+  void Close(uint32_t connection_id) {
+    if (server)
+      server->Close(connection_id);
+  }
+
+  void SetReceiveBufferSize(uint32_t connection_id, int32_t size) {
+    if (server)
+      server->SetReceiveBufferSize(connection_id, size);
+  }
+
+  void SetSendBufferSize(uint32_t connection_id, int32_t size) {
+    if (server)
+      server->SetSendBufferSize(connection_id, size);
+  }
+
+  void AddAcceptedSocket(std::unique_ptr<StreamSocket> socket) {
+    if (accept_queue)
+      accept_queue->AddAcceptedSocket(std::move(socket));
+  }
+
+  void ShutDown() {
+    // |server| owns |accept_queue| and calls |delegate|, so goes first.
+    accept_queue = nullptr;
+    server.reset();
+    delegate.reset();
+  }
+
+  const size_t index;
+  std::unique_ptr<cr::Thread> thread;
+
+  // The task runner of |thread|, kept so that other threads need not touch
+  // |thread| to post to it.
+  cr::scoped_refptr<cr::SingleThreadTaskRunner> task_runner;
+
+  std::unique_ptr<StreamServer::Delegate> delegate;
+  std::unique_ptr<StreamServer> server;
+
+  // The socket of |server| when it is fed by the acceptor, or null.
+  AcceptQueueServerSocket* accept_queue = nullptr;
+};
+
+ShardedStreamServer::ShardedStreamServer(size_t shard_count,
+                                         DelegateFactory* factory)
+    : factory_(factory),
+      id_step_(1) {
+  CR_DCHECK_GT(shard_count, 0U);
+  CR_DCHECK(factory);
+  CR_CHECK_LE(shard_count, 1U << 16);
+  while (id_step_ < shard_count)
+    id_step_ <<= 1;
+  for (size_t i = 0; i < shard_count; ++i)
+    shards_.push_back(std::unique_ptr<Shard>(new Shard(i)));
+}
+
+ShardedStreamServer::~ShardedStreamServer() {
+  Stop();
+}
+
+int ShardedStreamServer::Listen(const IPEndPoint& address, int backlog) {
+  CR_DCHECK(!shards_.front()->thread) << "Listen() called twice";
+
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    shard->thread.reset(new cr::Thread(
+        cr::StringPrintf("StreamServerShard%u",
+                         static_cast<unsigned>(shard->index))));
+    if (!shard->thread->StartWithOptions(
+            cr::Thread::Options(cr::MessageLoop::TYPE_IO, 0))) {
+      Stop();
+      return ERR_FAILED;
+    }
+    shard->task_runner = shard->thread->task_runner();
+  }
+
+  int result = ListenOnShards(address, backlog);
+  if (result == ERR_NOT_IMPLEMENTED)
+    result = ListenOnAcceptor(address, backlog);
+  if (result != OK)
+    Stop();
+  return result;
+}
+
+int ShardedStreamServer::ListenOnShards(const IPEndPoint& address,
+                                        int backlog) {
+  IPEndPoint shard_address = address;
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    int result = ERR_FAILED;
+    IPEndPoint local_address;
+    cr::WaitableEvent done(false, false);
+    shard->task_runner->PostTask(
+        CR_FROM_HERE,
+        cr::BindOnce(&ShardedStreamServer::ListenOnShard,
+                     cr::Unretained(this), cr::Unretained(shard.get()),
+                     shard_address, backlog, &result, &local_address,
+                     &done));
+    done.Wait();
+    if (result != OK)
+      return result;
+
+    // The other shards must share the port picked for the first one.
+    if (shard->index == 0) {
+      local_address_ = local_address;
+      shard_address = IPEndPoint(address.address(), local_address.port());
+    }
+  }
+  return OK;
+}
+
+int ShardedStreamServer::ListenOnAcceptor(const IPEndPoint& address,
+                                          int backlog) {
+  acceptor_.reset(new Acceptor);
+  acceptor_->thread.reset(new cr::Thread("StreamServerAcceptor"));
+  if (!acceptor_->thread->StartWithOptions(
+          cr::Thread::Options(cr::MessageLoop::TYPE_IO, 0))) {
+    return ERR_FAILED;
+  }
+  acceptor_->task_runner = acceptor_->thread->task_runner();
+
+  int result = ERR_FAILED;
+  cr::WaitableEvent done(false, false);
+  acceptor_->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&ShardedStreamServer::ListenOnAcceptorThread,
+                   cr::Unretained(this), address, backlog, &result,
+                   &local_address_, &done));
+  done.Wait();
+  if (result != OK)
+    return result;
+
+  // The shards must be ready for the connections before any is accepted.
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    shard->task_runner->PostTask(
+        CR_FROM_HERE,
+        cr::BindOnce(&ShardedStreamServer::StartShardWithAcceptQueue,
+                     cr::Unretained(this), cr::Unretained(shard.get()),
+                     &done));
+    done.Wait();
+  }
+
+  acceptor_->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&ShardedStreamServer::DoAcceptLoop, cr::Unretained(this)));
+  return OK;
+}
+
+int ShardedStreamServer::ListenWithAddressAndPort(
+    const std::string& address_string,
+    uint16_t port,
+    int backlog) {
+  IPAddress ip_address;
+  if (!ip_address.AssignFromIPLiteral(address_string))
+    return ERR_ADDRESS_INVALID;
+
+  return Listen(IPEndPoint(ip_address, port), backlog);
+}
+
+void ShardedStreamServer::SendData(uint32_t connection_id,
+                                   const std::string& data) {
+  SendData(connection_id, data.data(), data.size());
+}
+
+void ShardedStreamServer::SendData(uint32_t connection_id,
+                                   const char* data,
+                                   size_t data_len) {
+  Shard* shard = GetShard(connection_id);
+  if (!shard)
+    return;
+
+  // Delegates mostly answer on their own shard: skip the copy and the task.
+  if (shard->task_runner->BelongsToCurrentThread()) {
+    if (shard->server)
+      shard->server->SendData(connection_id, data, data_len);
+    return;
+  }
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::SendData, cr::Unretained(shard), connection_id,
+                   std::string(data, data_len)));
+}
+
+void ShardedStreamServer::SendData(uint32_t connection_id,
+                                   cr::scoped_refptr<IOBuffer> data,
+                                   size_t data_len) {
+  Shard* shard = GetShard(connection_id);
+  if (!shard)
+    return;
+
+  if (shard->task_runner->BelongsToCurrentThread()) {
+    shard->SendBuffer(connection_id, std::move(data), data_len);
+    return;
+  }
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::SendBuffer, cr::Unretained(shard), connection_id,
+                   std::move(data), data_len));
+}
+
+void ShardedStreamServer::SendData(uint32_t connection_id,
+                                   cr::scoped_refptr<IOBuffer> header,
+                                   size_t header_len,
+                                   cr::scoped_refptr<IOBuffer> payload,
+                                   size_t payload_len) {
+  Shard* shard = GetShard(connection_id);
+  if (!shard)
+    return;
+
+  if (shard->task_runner->BelongsToCurrentThread()) {
+    shard->SendFrame(connection_id, std::move(header), header_len,
+                     std::move(payload), payload_len);
+    return;
+  }
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::SendFrame, cr::Unretained(shard), connection_id,
+                   std::move(header), header_len, std::move(payload),
+                   payload_len));
+}
+
+void ShardedStreamServer::Close(uint32_t connection_id) {
+  Shard* shard = GetShard(connection_id);
+  if (!shard)
+    return;
+
+  if (shard->task_runner->BelongsToCurrentThread()) {
+    shard->Close(connection_id);
+    return;
+  }
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::Close, cr::Unretained(shard), connection_id));
+}
+
+void ShardedStreamServer::SetReceiveBufferSize(uint32_t connection_id,
+                                               int32_t size) {
+  Shard* shard = GetShard(connection_id);
+  if (!shard)
+    return;
+
+  if (shard->task_runner->BelongsToCurrentThread()) {
+    shard->SetReceiveBufferSize(connection_id, size);
+    return;
+  }
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::SetReceiveBufferSize, cr::Unretained(shard),
+                   connection_id, size));
+}
+
+void ShardedStreamServer::SetSendBufferSize(uint32_t connection_id,
+                                            int32_t size) {
+  Shard* shard = GetShard(connection_id);
+  if (!shard)
+    return;
+
+  if (shard->task_runner->BelongsToCurrentThread()) {
+    shard->SetSendBufferSize(connection_id, size);
+    return;
+  }
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::SetSendBufferSize, cr::Unretained(shard),
+                   connection_id, size));
+}
+
+int ShardedStreamServer::GetLocalAddress(IPEndPoint* address) {
+  if (!shards_.front()->server)
+    return ERR_SOCKET_NOT_CONNECTED;
+  *address = local_address_;
+  return OK;
+}
+
+size_t ShardedStreamServer::GetShardIndex(uint32_t connection_id) const {
+  return (connection_id - 1) & (id_step_ - 1);
+}
+
+void ShardedStreamServer::ListenOnShard(Shard* shard,
+                                        const IPEndPoint& address,
+                                        int backlog,
+                                        int* result,
+                                        IPEndPoint* local_address,
+                                        cr::WaitableEvent* done) {
+  std::unique_ptr<TCPServerSocket> server_socket(new TCPServerSocket());
+  server_socket->set_reuse_port(true);
+  *result = server_socket->Listen(address, backlog);
+  if (*result == OK)
+    *result = server_socket->GetLocalAddress(local_address);
+  if (*result == OK)
+    StartShard(shard, std::move(server_socket));
+  done->Signal();
+}
+
+void ShardedStreamServer::StartShardWithAcceptQueue(Shard* shard,
+                                                    cr::WaitableEvent* done) {
+  std::unique_ptr<AcceptQueueServerSocket> server_socket(
+      new AcceptQueueServerSocket(local_address_));
+  shard->accept_queue = server_socket.get();
+  StartShard(shard, std::move(server_socket));
+  done->Signal();
+}
+
+void ShardedStreamServer::StartShard(
+    Shard* shard,
+    std::unique_ptr<ServerSocket> server_socket) {
+  shard->delegate = factory_->CreateDelegate(shard->index);
+  shard->server.reset(new StreamServer(
+      std::move(server_socket), shard->delegate.get(),
+      static_cast<uint32_t>(shard->index) + 1, id_step_));
+}
+
+void ShardedStreamServer::ListenOnAcceptorThread(const IPEndPoint& address,
+                                                 int backlog,
+                                                 int* result,
+                                                 IPEndPoint* local_address,
+                                                 cr::WaitableEvent* done) {
+  std::unique_ptr<TCPServerSocket> server_socket(new TCPServerSocket());
+  *result = server_socket->Listen(address, backlog);
+  if (*result == OK)
+    *result = server_socket->GetLocalAddress(local_address);
+  if (*result == OK)
+    acceptor_->server_socket = std::move(server_socket);
+  done->Signal();
+}
+
+void ShardedStreamServer::DoAcceptLoop() {
+  int rv;
+  do {
+    // |acceptor_| destroys the socket on its thread before |this| goes away,
+    // and with it the pending callback.
+    rv = acceptor_->server_socket->Accept(
+        &acceptor_->accepted_socket,
+        cr::BindOnce(&ShardedStreamServer::OnAcceptCompleted,
+                     cr::Unretained(this)));
+    if (rv == ERR_IO_PENDING)
+      return;
+    rv = HandleAcceptResult(rv);
+  } while (rv == OK);
+}
+
+void ShardedStreamServer::OnAcceptCompleted(int rv) {
+  if (HandleAcceptResult(rv) == OK)
+    DoAcceptLoop();
+}
+
+int ShardedStreamServer::HandleAcceptResult(int rv) {
+  if (rv < 0) {
+    CR_LOG(ERROR) << "Accept error: rv=" << rv;
+    return rv;
+  }
+
+  // Round-robin: the shards have no way to tell how busy the others are.
+  Shard* shard = shards_[acceptor_->next_shard_index].get();
+  acceptor_->next_shard_index =
+      (acceptor_->next_shard_index + 1) % shards_.size();
+
+  std::unique_ptr<StreamSocket> socket = std::move(acceptor_->accepted_socket);
+  socket->DetachFromThread();
+  shard->task_runner->PostTask(
+      CR_FROM_HERE,
+      cr::BindOnce(&Shard::AddAcceptedSocket, cr::Unretained(shard),
+                   std::move(socket)));
+  return OK;
+}
+
+ShardedStreamServer::Shard* ShardedStreamServer::GetShard(
+    uint32_t connection_id) {
+  size_t index = GetShardIndex(connection_id);
+  if (index >= shards_.size() || !shards_[index]->task_runner)
+    return nullptr;
+  return shards_[index].get();
+}
+
+void ShardedStreamServer::Stop() {
+  // No more connections are handed to the shards once the acceptor stopped.
+  if (acceptor_ && acceptor_->thread) {
+    if (acceptor_->task_runner) {
+      acceptor_->task_runner->PostTask(
+          CR_FROM_HERE,
+          cr::BindOnce(&Acceptor::ShutDown,
+                       cr::Unretained(acceptor_.get())));
+    }
+    acceptor_->thread->Stop();
+  }
+  acceptor_.reset();
+
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    if (!shard->thread)
+      continue;
+    if (shard->task_runner) {
+      shard->task_runner->PostTask(
+          CR_FROM_HERE,
+          cr::BindOnce(&Shard::ShutDown, cr::Unretained(shard.get())));
+    }
+    shard->thread->Stop();
+    shard->thread.reset();
+    shard->task_runner = nullptr;
+  }
+}
+
+}  // namespace crnet
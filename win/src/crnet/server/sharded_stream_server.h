@@ -0,0 +1,148 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRNET_SERVER_SHARDED_STREAM_SERVER_H_
+#define MINI_CHROMIUM_SRC_CRNET_SERVER_SHARDED_STREAM_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crnet/base/ip_endpoint.h"
+#include "crnet/base/net_export.h"
+#include "crnet/server/stream_server.h"
+
+namespace cr {
+class Thread;
+class WaitableEvent;
+}  // namespace cr
+
+namespace crnet {
+
+// Runs one StreamServer per IO thread ("shard").  Where SO_REUSEPORT is
+// available, each shard has its own listening socket bound to the same
+// address, and the kernel spreads incoming connections across the shards.
+// Elsewhere, as on Windows, a single acceptor thread owns the listening
+// socket and hands the accepted connections to the shards in turn.  A
+// connection lives on the shard it was given to, and its delegate callbacks
+// run on that shard's thread.
+//
+// Connection ids are unique across shards: the id encodes the shard, and
+// SendData() or Close() may be called from any thread, they are forwarded to
+// the owning shard.
+class CRNET_EXPORT ShardedStreamServer {
+ public:
+  // Creates the StreamServer::Delegate of each shard.
+  class DelegateFactory {
+   public:
+    virtual ~DelegateFactory() {}
+
+    // Called on the thread of shard |shard_index| before it accepts any
+    // connection.  The delegate is only called on that thread, and destroyed
+    // there when the server stops.
+    virtual std::unique_ptr<StreamServer::Delegate> CreateDelegate(
+        size_t shard_index) = 0;
+  };
+
+  ShardedStreamServer(const ShardedStreamServer&) = delete;
+  ShardedStreamServer& operator=(const ShardedStreamServer&) = delete;
+
+  // |factory| must outlive Listen().
+  ShardedStreamServer(size_t shard_count, DelegateFactory* factory);
+
+  // Stops the shards, closing all their connections.
+  ~ShardedStreamServer();
+
+  // Starts the shard threads and has each listen on |address|, or has the
+  // acceptor thread listen for them.  Blocks until the server listens.  If
+  // the port of |address| is 0, the shards share the port picked for the
+  // first one.  Returns a net error code; on failure no shard is left running.
+  int Listen(const IPEndPoint& address, int backlog);
+  int ListenWithAddressAndPort(const std::string& address_string,
+                               uint16_t port,
+                               int backlog);
+
+  // Same as the StreamServer methods, callable from any thread between
+  // Listen() and the destruction of the server.
+  void SendData(uint32_t connection_id, const std::string& data);
+  void SendData(uint32_t connection_id, const char* data, size_t data_len);
+  void SendData(uint32_t connection_id,
+                cr::scoped_refptr<IOBuffer> data,
+                size_t data_len);
+  void SendData(uint32_t connection_id,
+                cr::scoped_refptr<IOBuffer> header,
+                size_t header_len,
+                cr::scoped_refptr<IOBuffer> payload,
+                size_t payload_len);
+  void Close(uint32_t connection_id);
+  void SetReceiveBufferSize(uint32_t connection_id, int32_t size);
+  void SetSendBufferSize(uint32_t connection_id, int32_t size);
+
+  // Copies the local address to |address|. Returns a network error code.
+  int GetLocalAddress(IPEndPoint* address);
+
+  size_t shard_count() const { return shards_.size(); }
+
+  // Returns the index of the shard owning |connection_id|.
+  size_t GetShardIndex(uint32_t connection_id) const;
+
+ private:
+  struct Acceptor;
+  struct Shard;
+
+  // Has each shard listen on |address| under SO_REUSEPORT.  Returns
+  // ERR_NOT_IMPLEMENTED, with no shard listening, if that is unavailable.
+  int ListenOnShards(const IPEndPoint& address, int backlog);
+
+  // Starts the acceptor thread listening on |address|, and has it hand the
+  // connections it accepts to the shards.
+  int ListenOnAcceptor(const IPEndPoint& address, int backlog);
+
+  // Run on the thread of |shard|.  ListenOnShard() listens on a socket of
+  // its own, StartShardWithAcceptQueue() serves the connections handed over
+  // by the acceptor.
+  void ListenOnShard(Shard* shard,
+                     const IPEndPoint& address,
+                     int backlog,
+                     int* result,
+                     IPEndPoint* local_address,
+                     cr::WaitableEvent* done);
+  void StartShardWithAcceptQueue(Shard* shard, cr::WaitableEvent* done);
+  void StartShard(Shard* shard, std::unique_ptr<ServerSocket> server_socket);
+
+  // Run on the acceptor thread.
+  void ListenOnAcceptorThread(const IPEndPoint& address,
+                              int backlog,
+                              int* result,
+                              IPEndPoint* local_address,
+                              cr::WaitableEvent* done);
+  void DoAcceptLoop();
+  void OnAcceptCompleted(int rv);
+  int HandleAcceptResult(int rv);
+
+  // Returns the shard owning |connection_id|, or null if there is none.
+  Shard* GetShard(uint32_t connection_id);
+
+  void Stop();
+
+  DelegateFactory* const factory_;
+
+  // Connection ids of shard i are i + 1 + n * |id_step_|.  A power of two no
+  // smaller than the shard count.
+  uint32_t id_step_;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  // Only used where the shards cannot listen under SO_REUSEPORT.
+  std::unique_ptr<Acceptor> acceptor_;
+
+  IPEndPoint local_address_;
+};
+
+}  // namespace crnet
+
+#endif  // MINI_CHROMIUM_SRC_CRNET_SERVER_SHARDED_STREAM_SERVER_H_
@@ -4,6 +4,9 @@
 
 #include "crnet/server/stream_connection.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <utility>
 
 #include "crbase/logging.h"
@@ -51,9 +54,43 @@ bool StreamConnection::ReadIOBuffer::IncreaseCapacity() {
   return true;
 }
 
+bool StreamConnection::ReadIOBuffer::MakeRoom() {
+  // The storage was released by ReleaseIfEmptyAndLarge().
+  if (GetCapacity() == 0) {
+    SetCapacity(kInitialBufSize);
+    return true;
+  }
+
+  // Reclaiming the space of consumed data moves the unconsumed data, so it is
+  // only done when it frees at least as much as it moves, and more than the
+  // room already left.  On average, a byte read is then moved at most once.
+  size_t unconsumed_size = base_->offset() - consumed_;
+  if (consumed_ > RemainingCapacity() && consumed_ >= unconsumed_size)
+    Compact();
+  if (RemainingCapacity() > 0)
+    return true;
+  if (IncreaseCapacity())
+    return true;
+
+  // At the limit, any room is better than none.
+  if (consumed_ == 0)
+    return false;
+  Compact();
+  return true;
+}
+
+void StreamConnection::ReadIOBuffer::ReleaseIfEmptyAndLarge() {
+  if (base_->offset() != consumed_ || GetCapacity() <= kMaxIdleBufSize)
+    return;
+
+  consumed_ = 0;
+  base_->set_offset(0);
+  SetCapacity(0);
+}
+
 cr::ArrayView<const uint8_t> 
 StreamConnection::ReadIOBuffer::readable_bytes() const {
-  return base_->bytes_view_before_offset();
+  return base_->bytes_view_before_offset().subview(consumed_);
 }
 
 void StreamConnection::ReadIOBuffer::DidRead(size_t bytes) {
@@ -68,16 +105,18 @@ size_t StreamConnection::ReadIOBuffer::RemainingCapacity() const {
 
 void StreamConnection::ReadIOBuffer::DidConsume(size_t bytes) {
   size_t previous_size = base_->offset();
-  CR_DCHECK_LE(bytes, previous_size);
+  size_t unconsumed_size = previous_size - consumed_;
+  CR_DCHECK_LE(bytes, unconsumed_size);
 
-  bytes = bytes > previous_size ? previous_size : bytes;
-  size_t unconsumed_size = previous_size - bytes;
-  if (unconsumed_size != 0) {
-    // Move unconsumed data to the start of buffer.
-    cr::BytesView buffer = base_->bytes_view_before_offset();
-    memmove(buffer.begin(), buffer.subview(bytes).data(), unconsumed_size);
-  }
-  base_->set_offset(unconsumed_size);
+  bytes = bytes > unconsumed_size ? unconsumed_size : bytes;
+  consumed_ += bytes;
+  if (consumed_ != previous_size)
+    return;
+
+  // No data is left, so the buffer can start over at its beginning without
+  // moving anything.
+  consumed_ = 0;
+  base_->set_offset(0);
   SetBytesView(base_->bytes_view());
 
   // If capacity is too big, reduce it.
@@ -91,86 +130,115 @@ void StreamConnection::ReadIOBuffer::DidConsume(size_t bytes) {
     ClearBytesView();
 
     // realloc() within GrowableIOBuffer::SetCapacity() could move data even
-    // when size is reduced. If unconsumed_size == 0, i.e. no data exists in
-    // the buffer, free internal buffer first to guarantee no data move.
-    if (unconsumed_size == 0)
-      base_->SetCapacity(0);
+    // when size is reduced.  Free internal buffer first to guarantee no data
+    // move.
+    base_->SetCapacity(0);
     SetCapacity(new_capacity);
   }
 }
 
+void StreamConnection::ReadIOBuffer::Compact() {
+  size_t unconsumed_size = base_->offset() - consumed_;
+  if (unconsumed_size != 0) {
+    // Move unconsumed data to the start of buffer.
+    cr::BytesView buffer = base_->bytes_view_before_offset();
+    memmove(buffer.begin(), buffer.subview(consumed_).data(), unconsumed_size);
+  }
+  consumed_ = 0;
+  base_->set_offset(unconsumed_size);
+  SetBytesView(base_->bytes_view());
+}
+
 StreamConnection::QueuedWriteIOBuffer::QueuedWriteIOBuffer() = default;
 
 StreamConnection::QueuedWriteIOBuffer::~QueuedWriteIOBuffer() {
-  // `pending_data_` owns the underlying data.
+  // `chunks_` owns the underlying data.
   ClearBytesView();
 }
 
 bool StreamConnection::QueuedWriteIOBuffer::IsEmpty() const {
-  return pending_data_.empty();
+  return chunks_.empty();
 }
 
 bool StreamConnection::QueuedWriteIOBuffer::Append(const std::string& data) {
-  if (data.empty())
+  return Append(data.data(), data.size());
+}
+
+bool StreamConnection::QueuedWriteIOBuffer::Append(const char* data, 
+                                                   size_t data_len) {
+  if (data == nullptr || !data_len)
     return true;
 
-  if (total_size_ + data.size() > max_buffer_size_) {
-    CR_LOG(ERROR) << "Too large write data is pending: size="
-                  << total_size_ + data.size()
-                  << ", max_buffer_size=" << max_buffer_size_;
+  if (!CanAppend(data_len))
     return false;
-  }
 
-  pending_data_.push(data);
-  total_size_ += data.size();
+  // Fill the room left in the last chunk first.
+  if (tail_room_ > 0) {
+    Chunk& tail = chunks_.back();
+    size_t copy_len = std::min(tail_room_, data_len);
+    memcpy(tail.buffer->data() + tail.offset + tail.size, data, copy_len);
+    tail.size += copy_len;
+    tail_room_ -= copy_len;
+    total_size_ += copy_len;
+    data += copy_len;
+    data_len -= copy_len;
+  }
 
-  // If new data is the first pending data, updates data_.
-  if (pending_data_.size() == 1) {
-    SetBytesView(cr::MakeBytesView(pending_data_.front()));
+  if (data_len > 0) {
+    size_t chunk_size = data_len > kCopyChunkSize ? data_len : kCopyChunkSize;
+    cr::scoped_refptr<IOBuffer> buffer =
+        cr::MakeRefCounted<PooledIOBuffer>(chunk_size);
+    memcpy(buffer->data(), data, data_len);
+    chunks_.emplace_back(std::move(buffer), 0, data_len);
+    tail_room_ = chunk_size - data_len;
+    total_size_ += data_len;
   }
+
+  UpdateBytesView();
   return true;
 }
 
-bool StreamConnection::QueuedWriteIOBuffer::Append(const char* data, 
-                                                   size_t data_len) {
-  if (data == nullptr || !data_len)
+bool StreamConnection::QueuedWriteIOBuffer::Append(
+    cr::scoped_refptr<IOBuffer> buffer,
+    size_t len) {
+  if (!buffer || !len)
     return true;
 
-  if (total_size_ + data_len > max_buffer_size_) {
-    CR_LOG(ERROR) << "Too large write data is pending: size="
-                  << total_size_ + data_len
-                  << ", max_buffer_size=" << max_buffer_size_;
+  CR_DCHECK_LE(len, buffer->size());
+  if (!CanAppend(len))
     return false;
-  }
 
-  pending_data_.push(std::string(data, data_len));
-  total_size_ += data_len;
+  chunks_.emplace_back(std::move(buffer), 0, len);
+  // |buffer| belongs to the caller: copied data must not go into it.
+  tail_room_ = 0;
+  total_size_ += len;
 
-  // If new data is the first pending data, updates data_.
-  if (pending_data_.size() == 1) {
-    SetBytesView(cr::MakeBytesView(pending_data_.front()));
-  }
+  UpdateBytesView();
   return true;
 }
 
 void StreamConnection::QueuedWriteIOBuffer::DidConsume(size_t size) {
   CR_DCHECK_GE(total_size_, size);
-  CR_DCHECK_GE(GetSizeToWrite(), size);
   if (size == 0)
     return;
 
-  if (size < GetSizeToWrite()) {
-    SetBytesView(bytes_view().subview(size));
-  }
-  else {
-    // size == GetSizeToWrite(). Updates data_ to next pending data.
-    ClearBytesView();
-    pending_data_.pop();
-    if (!IsEmpty()) {
-      SetBytesView(cr::MakeBytesView(pending_data_.front()));
+  // Do not leave data() pointing into a chunk about to be released.
+  ClearBytesView();
+  total_size_ -= size;
+  while (size > 0) {
+    Chunk& front = chunks_.front();
+    if (size < front.size) {
+      front.offset += size;
+      front.size -= size;
+      break;
     }
+    size -= front.size;
+    chunks_.pop_front();
   }
-  total_size_ -= size;
+  if (IsEmpty())
+    tail_room_ = 0;
+
+  UpdateBytesView();
 }
 
 size_t StreamConnection::QueuedWriteIOBuffer::GetSizeToWrite() const {
@@ -178,10 +246,43 @@ size_t StreamConnection::QueuedWriteIOBuffer::GetSizeToWrite() const {
     CR_DCHECK_EQ(0, total_size_);
     return 0;
   }
-  // Return the unconsumed size of the current pending write.
+  // Return the unconsumed size of the first chunk.
   return size();
 }
 
+int StreamConnection::QueuedWriteIOBuffer::GetSlicesToWrite(
+    IOBufferSlice* slices,
+    int max_slices) const {
+  int slice_count = 0;
+  for (const Chunk& chunk : chunks_) {
+    if (slice_count == max_slices)
+      break;
+    slices[slice_count++] = IOBufferSlice(chunk.buffer.get(), chunk.offset,
+                                          static_cast<int>(chunk.size));
+  }
+  return slice_count;
+}
+
+bool StreamConnection::QueuedWriteIOBuffer::CanAppend(size_t len) const {
+  if (total_size_ + len > max_buffer_size_) {
+    CR_LOG(ERROR) << "Too large write data is pending: size="
+                  << total_size_ + len
+                  << ", max_buffer_size=" << max_buffer_size_;
+    return false;
+  }
+  return true;
+}
+
+void StreamConnection::QueuedWriteIOBuffer::UpdateBytesView() {
+  if (IsEmpty()) {
+    ClearBytesView();
+    return;
+  }
+  const Chunk& front = chunks_.front();
+  SetBytesView(cr::MakeBytesView(front.buffer->bytes() + front.offset,
+                                 front.size));
+}
+
 StreamConnection::StreamConnection(int id, std::unique_ptr<StreamSocket> socket)
     : id_(id),
       socket_(std::move(socket)),
@@ -5,9 +5,10 @@
 #ifndef MINI_CHROMIUM_SRC_CRNET_SERVER_STREAM_CONNECTION_H_
 #define MINI_CHROMIUM_SRC_CRNET_SERVER_STREAM_CONNECTION_H_
 
-#include <queue>
+#include <deque>
 #include <string>
 #include <memory>
+#include <utility>
 
 #include "crbase/macros.h"
 #include "crbase/memory/ref_counted.h"
@@ -22,14 +23,17 @@ class StreamSocket;
 class StreamConnection {
  public:
   // IOBuffer for data read.  It's a wrapper around GrowableIOBuffer, with more
-  // functions for buffer management.  It moves unconsumed data to the start of
-  // buffer.
+  // functions for buffer management.  Consumed data is dropped by moving a
+  // start offset rather than the unconsumed data; the space it held is
+  // reclaimed by MakeRoom() when more data is to be read.
   class ReadIOBuffer : public IOBuffer {
    public:
     static const size_t kInitialBufSize = 1024;
     static const size_t kMinimumBufSize = 128;
     static const size_t kCapacityIncreaseFactor = 2;
     static const size_t kDefaultMaxBufferSize = 1 * 1024 * 1024;  // 1 Mbytes.
+    // Largest capacity kept while the connection waits for data.
+    static const size_t kMaxIdleBufSize = 4 * 1024;
     
     ReadIOBuffer(const ReadIOBuffer&) = delete;
     ReadIOBuffer& operator=(const ReadIOBuffer&) = delete;
@@ -42,6 +46,18 @@ class StreamConnection {
     // Increases capacity and returns true if capacity is not beyond the limit.
     bool IncreaseCapacity();
 
+    // Makes RemainingCapacity() non-zero before a read, by reclaiming the
+    // space of consumed data or by increasing capacity.  Returns false if
+    // neither is possible without going beyond the limit.
+    bool MakeRoom();
+
+    // Frees the storage if no unconsumed data is left and the capacity is
+    // above kMaxIdleBufSize, e.g. after a burst on a connection now idle.
+    // The next MakeRoom() allocates kInitialBufSize again.  A smaller buffer
+    // is kept, so that a connection reading in turns does not free and
+    // allocate it on every wait.
+    void ReleaseIfEmptyAndLarge();
+
     // Returns a span containing bytes that have been written to, and thus are
     // available to be read from.
     cr::ArrayView<const uint8_t> readable_bytes() const;
@@ -52,7 +68,8 @@ class StreamConnection {
     // span_before_offset().
     size_t RemainingCapacity() const;
 
-    // Removes consumed data and moves unconsumed data to the start of buffer.
+    // Removes consumed data from readable_bytes().  Does not move the
+    // unconsumed data.
     void DidConsume(size_t bytes);
 
     // Limit of how much internal capacity can increase.
@@ -64,16 +81,28 @@ class StreamConnection {
    private:
     ~ReadIOBuffer() override;
 
+    // Moves unconsumed data to the start of buffer.
+    void Compact();
+
     cr::scoped_refptr<GrowableIOBuffer> base_;
+
+    // Bytes at the start of |base_| which have been consumed.  The readable
+    // bytes are those from |consumed_| to the offset of |base_|.
+    size_t consumed_ = 0;
+
     size_t max_buffer_size_ = kDefaultMaxBufferSize;
   };
 
-  // IOBuffer of pending data to write which has a queue of pending data. Each
-  // pending data is stored in std::string.  data() is the data of first
-  // std::string stored.
+  // IOBuffer of pending data to write, kept as a chain of refcounted chunks.
+  // Buffers handed over with Append(IOBuffer) become chunks of their own
+  // without being copied; copied data is packed into chunks of at least
+  // kCopyChunkSize bytes, so that a run of small appends costs a few chunks.
+  // GetSlicesToWrite() lists the chunks for one gather write.  data() is the
+  // unconsumed data of the first chunk.
   class QueuedWriteIOBuffer : public IOBuffer {
    public:
     static const int kDefaultMaxBufferSize = 1 * 1024 * 1024;  // 1 Mbytes.
+    static const size_t kCopyChunkSize = 4 * 1024;
 
     QueuedWriteIOBuffer(const QueuedWriteIOBuffer&) = delete;
     QueuedWriteIOBuffer& operator=(const QueuedWriteIOBuffer&) = delete;
@@ -89,13 +118,27 @@ class StreamConnection {
     bool Append(const std::string& data);
     bool Append(const char* data, size_t len);
 
+    // Same as above, but appends the first |len| bytes of |buffer| without
+    // copying them.  Like a buffer passed to Write(), |buffer| must not be
+    // modified until it has been written.
+    bool Append(cr::scoped_refptr<IOBuffer> buffer, size_t len);
+
+    // Returns true if |len| more bytes of pending data don't exceed the limit,
+    // and logs otherwise.
+    bool CanAppend(size_t len) const;
+
     // Consumes data and changes data() accordingly.  It cannot be more than
-    // GetSizeToWrite().
+    // total_size(), and may span several chunks.
     void DidConsume(size_t size);
 
     // Gets size of data to write this time. It is NOT total data size.
     size_t GetSizeToWrite() const;
 
+    // Fills |slices| with the pending chunks, in order, up to |max_slices| of
+    // them, and returns the number of slices filled.  The slices stay valid
+    // until the next DidConsume().
+    int GetSlicesToWrite(IOBufferSlice* slices, int max_slices) const;
+
     // Total size of all pending data.
     size_t total_size() const { return total_size_; }
 
@@ -106,9 +149,28 @@ class StreamConnection {
     }
 
    private:
+    // |size| unconsumed bytes starting at |offset| in |buffer|.
+    struct Chunk {
+      Chunk(cr::scoped_refptr<IOBuffer> buffer, size_t offset, size_t size)
+          : buffer(std::move(buffer)), offset(offset), size(size) {}
+
+      cr::scoped_refptr<IOBuffer> buffer;
+      size_t offset;
+      size_t size;
+    };
+
     ~QueuedWriteIOBuffer() override;
 
-    std::queue<std::string> pending_data_;
+    // Points data() at the first chunk.
+    void UpdateBytesView();
+
+    std::deque<Chunk> chunks_;
+
+    // Free bytes at the end of the last chunk, if it is a chunk that copied
+    // data is packed into.  Bytes past the end of a chunk are not part of
+    // any pending write, so they can be filled while the chunk is written.
+    size_t tail_room_ = 0;
+
     size_t total_size_ = 0;
     size_t max_buffer_size_ = kDefaultMaxBufferSize;
   };
@@ -28,12 +28,22 @@ namespace crnet {
 
 StreamServer::StreamServer(std::unique_ptr<ServerSocket> server_socket,
                            StreamServer::Delegate* delegate)
+    : StreamServer(std::move(server_socket), delegate, 1, 1) {
+}
+
+StreamServer::StreamServer(std::unique_ptr<ServerSocket> server_socket,
+                           StreamServer::Delegate* delegate,
+                           uint32_t first_connection_id,
+                           uint32_t connection_id_step)
     : server_socket_(std::move(server_socket)),
       delegate_(delegate),
-      last_id_(0),
+      next_id_(first_connection_id),
+      id_step_(connection_id_step),
       weak_ptr_factory_(this) {
   CR_DCHECK(server_socket_);
   CR_DCHECK(delegate);
+  CR_DCHECK(connection_id_step &&
+            !(connection_id_step & (connection_id_step - 1)));
   // Start accepting connections in next run loop in case when delegate is not
   // ready to get callbacks.
   cr::ThreadTaskRunnerHandle::Get()->PostTask(
@@ -68,6 +78,40 @@ void StreamServer::SendData(uint32_t connection_id, const char* data,
     DoWriteLoop(connection);
 }
 
+void StreamServer::SendData(uint32_t connection_id,
+                            cr::scoped_refptr<IOBuffer> data,
+                            size_t data_len) {
+  StreamConnection* connection = FindConnection(connection_id);
+  if (connection == NULL)
+    return;
+
+  bool writing_in_progress = !connection->write_buf()->IsEmpty();
+  if (connection->write_buf()->Append(std::move(data), data_len) &&
+      !writing_in_progress)
+    DoWriteLoop(connection);
+}
+
+void StreamServer::SendData(uint32_t connection_id,
+                            cr::scoped_refptr<IOBuffer> header,
+                            size_t header_len,
+                            cr::scoped_refptr<IOBuffer> payload,
+                            size_t payload_len) {
+  StreamConnection* connection = FindConnection(connection_id);
+  if (connection == NULL)
+    return;
+
+  // A header queued without its payload would corrupt the stream.
+  StreamConnection::QueuedWriteIOBuffer* write_buf = connection->write_buf();
+  if (!write_buf->CanAppend(header_len + payload_len))
+    return;
+
+  bool writing_in_progress = !write_buf->IsEmpty();
+  write_buf->Append(std::move(header), header_len);
+  write_buf->Append(std::move(payload), payload_len);
+  if (!writing_in_progress && !write_buf->IsEmpty())
+    DoWriteLoop(connection);
+}
+
 void StreamServer::Close(uint32_t connection_id) {
   StreamConnection* connection = FindConnection(connection_id);
   if (connection == NULL)
@@ -124,7 +168,8 @@ int StreamServer::HandleAcceptResult(int rv) {
   }
 
   StreamConnection* connection =
-      new StreamConnection(++last_id_, std::move(accepted_socket_));
+      new StreamConnection(next_id_, std::move(accepted_socket_));
+  next_id_ += id_step_;
   id_to_connection_[connection->id()] = connection;
   delegate_->OnConnectionCreate(connection->id());
   if (!HasClosedConnection(connection))
@@ -136,30 +181,38 @@ void StreamServer::DoReadLoop(StreamConnection* connection) {
   int rv;
   do {
     StreamConnection::ReadIOBuffer* read_buf = connection->read_buf();
-    // Increases read buffer size if necessary.
-    if (read_buf->RemainingCapacity() == 0 && !read_buf->IncreaseCapacity()) {
+    // Makes room in read buffer if necessary.
+    if (!read_buf->MakeRoom()) {
       Close(connection->id());
       return;
     }
 
-    rv = connection->socket()->Read(
+    rv = connection->socket()->ReadIfReady(
         read_buf,
         static_cast<int>(read_buf->RemainingCapacity()),
-        cr::BindOnce(&StreamServer::OnReadCompleted,
+        cr::BindOnce(&StreamServer::OnReadReady,
                      weak_ptr_factory_.GetWeakPtr(), connection->id()));
-    if (rv == ERR_IO_PENDING)
+    if (rv == ERR_IO_PENDING) {
+      // The socket does not hold |read_buf| while it waits for data, so an
+      // idle connection keeps at most kMaxIdleBufSize of read storage.
+      read_buf->ReleaseIfEmptyAndLarge();
       return;
+    }
     rv = HandleReadResult(connection, rv);
   } while (rv == OK);
 }
 
-void StreamServer::OnReadCompleted(uint32_t connection_id, int rv) {
+void StreamServer::OnReadReady(uint32_t connection_id, int rv) {
   StreamConnection* connection = FindConnection(connection_id);
   if (!connection)  // It might be closed right before by write error.
     return;
 
-  if (HandleReadResult(connection, rv) == OK)
-    DoReadLoop(connection);
+  // |rv| is OK once data can be read, and only carries errors.
+  if (rv != OK) {
+    Close(connection_id);
+    return;
+  }
+  DoReadLoop(connection);
 }
 
 int StreamServer::HandleReadResult(StreamConnection* connection, int rv) {
@@ -197,10 +250,12 @@ int StreamServer::HandleReadResult(StreamConnection* connection, int rv) {
 void StreamServer::DoWriteLoop(StreamConnection* connection) {
   int rv = OK;
   StreamConnection::QueuedWriteIOBuffer* write_buf = connection->write_buf();
-  while (rv == OK && write_buf->GetSizeToWrite() > 0) {
-    rv = connection->socket()->Write(
-        write_buf,
-        static_cast<int>(write_buf->GetSizeToWrite()),
+  IOBufferSlice slices[kMaxIOBufferSlices];
+  while (rv == OK && !write_buf->IsEmpty()) {
+    // Flush as many pending chunks as a single gather write takes.
+    int slice_count = write_buf->GetSlicesToWrite(slices, kMaxIOBufferSlices);
+    rv = connection->socket()->Writev(
+        slices, slice_count,
         cr::BindOnce(&StreamServer::OnWriteCompleted,
                      weak_ptr_factory_.GetWeakPtr(), connection->id()));
     if (rv == ERR_IO_PENDING || rv == OK)
@@ -47,6 +47,15 @@ class StreamServer {
   // callbacks yet.
   StreamServer(std::unique_ptr<ServerSocket> server_socket,
                StreamServer::Delegate* delegate);
+
+  // Same as above, but connection ids are |first_connection_id| +
+  // n * |connection_id_step|, so that several servers can hand out ids which
+  // never collide.  |connection_id_step| must be a power of two, which keeps
+  // the ids of a server congruent modulo it when they wrap around.
+  StreamServer(std::unique_ptr<ServerSocket> server_socket,
+               StreamServer::Delegate* delegate,
+               uint32_t first_connection_id,
+               uint32_t connection_id_step);
   ~StreamServer();
 
   // Sends the provided data directly to the given connection. No validation is
@@ -54,6 +63,19 @@ class StreamServer {
   // response may be split across multiple calls to SendData.
   void SendData(uint32_t connection_id, const std::string& data);
   void SendData(uint32_t connection_id, const char* data, size_t data_len);
+  // Sends the first |data_len| bytes of |data| without copying them.  |data|
+  // must not be modified afterwards: it is released once written.
+  void SendData(uint32_t connection_id,
+                cr::scoped_refptr<IOBuffer> data,
+                size_t data_len);
+  // Sends a frame made of a header and a payload, without copying either.
+  // Both are queued, or neither if they don't fit, and they usually go out
+  // in one gather write.
+  void SendData(uint32_t connection_id,
+                cr::scoped_refptr<IOBuffer> header,
+                size_t header_len,
+                cr::scoped_refptr<IOBuffer> payload,
+                size_t payload_len);
 
   void Close(uint32_t connection_id);
 
@@ -72,7 +94,7 @@ class StreamServer {
   int HandleAcceptResult(int rv);
 
   void DoReadLoop(StreamConnection* connection);
-  void OnReadCompleted(uint32_t connection_id, int rv);
+  void OnReadReady(uint32_t connection_id, int rv);
   int HandleReadResult(StreamConnection* connection, int rv);
 
   void DoWriteLoop(StreamConnection* connection);
@@ -91,7 +113,8 @@ class StreamServer {
 
   StreamServer::Delegate* const delegate_;
 
-  uint32_t last_id_;
+  uint32_t next_id_;
+  const uint32_t id_step_;
   IdToConnectionMap id_to_connection_;
 
   cr::WeakPtrFactory<StreamServer> weak_ptr_factory_;
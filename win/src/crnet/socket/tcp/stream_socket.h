@@ -17,6 +17,7 @@ namespace crnet {
 
 class AddressList;
 class IPEndPoint;
+struct IOBufferSlice;
 ///class SSLInfo;
 
 class CRNET_EXPORT_PRIVATE StreamSocket : public Socket {
@@ -57,6 +58,36 @@ class CRNET_EXPORT_PRIVATE StreamSocket : public Socket {
   // have been received.
   virtual bool IsConnectedAndIdle() const = 0;
 
+  // Reads into the |slice_count| slices of |slices| in order, as if they were
+  // one buffer, with the semantics of Read(): the result is the number of
+  // bytes read, 0 on EOF, or a net error code.  Only the first
+  // kMaxIOBufferSlices slices are read into.  |slices| itself need not
+  // outlive the call, but the socket acquires a reference to each of their
+  // buffers while the read is pending.
+  virtual int Readv(const IOBufferSlice* slices,
+                    int slice_count,
+                    CompletionOnceCallback callback) = 0;
+
+  // Reads data, up to |buf_len| bytes, into |buf| without blocking.  Upon
+  // synchronous completion, returns the number of bytes read, 0 on EOF, or a
+  // net error code.  Otherwise returns ERR_IO_PENDING and, unlike Read(), does
+  // not hold on to |buf|: |callback| is run with OK once data can be read, and
+  // the caller then calls ReadIfReady() again, or with a net error code.
+  // This lets an idle connection wait for data without a read buffer.
+  virtual int ReadIfReady(IOBuffer* buf,
+                          int buf_len,
+                          CompletionOnceCallback callback) = 0;
+
+  // Writes the |slice_count| slices of |slices| in order, as if they were one
+  // buffer, with the semantics of Write(): the write may be partial, and the
+  // result is the number of bytes written or a net error code.  Only the first
+  // kMaxIOBufferSlices slices are written.  |slices| itself need not outlive
+  // the call, but the socket acquires a reference to each of their buffers
+  // while the write is pending.
+  virtual int Writev(const IOBufferSlice* slices,
+                     int slice_count,
+                     CompletionOnceCallback callback) = 0;
+
   // Copies the peer address to |address| and returns a network error code.
   // ERR_SOCKET_NOT_CONNECTED will be returned if the socket is not connected.
   virtual int GetPeerAddress(IPEndPoint* address) const = 0;
@@ -106,6 +137,11 @@ class CRNET_EXPORT_PRIVATE StreamSocket : public Socket {
   // Disconnect() is called.
   virtual int64_t GetTotalReceivedBytes() const = 0;
 
+  // Resets the thread to be used for thread-safety checks, so that the socket
+  // can be handed to another thread.  Must not be called while a read or a
+  // write is pending.
+  virtual void DetachFromThread() = 0;
+
  protected:
   // The following class is only used to gather statistics about the history of
   // a socket.  It is only instantiated and used in basic sockets, such as
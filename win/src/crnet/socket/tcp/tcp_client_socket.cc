@@ -277,6 +277,44 @@ int TCPClientSocket::Read(IOBuffer* buf,
   return result;
 }
 
+int TCPClientSocket::Readv(const IOBufferSlice* slices,
+                           int slice_count,
+                           CompletionOnceCallback callback) {
+  CR_DCHECK(!callback.is_null());
+
+  // |socket_| is owned by this class and the callback won't be run once
+  // |socket_| is gone. Therefore, it is safe to use base::Unretained() here.
+  CompletionOnceCallback read_callback = cr::BindOnce(
+      &TCPClientSocket::DidCompleteRead, cr::Unretained(this),
+      std::move(callback));
+  int result = socket_->Readv(slices, slice_count, std::move(read_callback));
+  if (result > 0) {
+    use_history_.set_was_used_to_convey_data();
+    total_received_bytes_ += result;
+  }
+
+  return result;
+}
+
+int TCPClientSocket::ReadIfReady(IOBuffer* buf,
+                                 int buf_len,
+                                 CompletionOnceCallback callback) {
+  CR_DCHECK(!callback.is_null());
+
+  // The callback only signals that data can be read, so it carries no byte
+  // count to add to |total_received_bytes_|.
+  CompletionOnceCallback read_callback = cr::BindOnce(
+      &TCPClientSocket::DidCompleteReadWrite, cr::Unretained(this),
+      std::move(callback));
+  int result = socket_->ReadIfReady(buf, buf_len, std::move(read_callback));
+  if (result > 0) {
+    use_history_.set_was_used_to_convey_data();
+    total_received_bytes_ += result;
+  }
+
+  return result;
+}
+
 int TCPClientSocket::Write(IOBuffer* buf,
                            int buf_len,
                            CompletionOnceCallback callback) {
@@ -294,6 +332,23 @@ int TCPClientSocket::Write(IOBuffer* buf,
   return result;
 }
 
+int TCPClientSocket::Writev(const IOBufferSlice* slices,
+                            int slice_count,
+                            CompletionOnceCallback callback) {
+  CR_DCHECK(!callback.is_null());
+
+  // |socket_| is owned by this class and the callback won't be run once
+  // |socket_| is gone. Therefore, it is safe to use base::Unretained() here.
+  CompletionOnceCallback write_callback = cr::BindOnce(
+      &TCPClientSocket::DidCompleteWrite, cr::Unretained(this),
+      std::move(callback));
+  int result = socket_->Writev(slices, slice_count, std::move(write_callback));
+  if (result > 0)
+    use_history_.set_was_used_to_convey_data();
+
+  return result;
+}
+
 int TCPClientSocket::SetReceiveBufferSize(int32_t size) {
   return socket_->SetReceiveBufferSize(size);
 }
@@ -328,6 +383,10 @@ int64_t TCPClientSocket::GetTotalReceivedBytes() const {
   return total_received_bytes_;
 }
 
+void TCPClientSocket::DetachFromThread() {
+  socket_->DetachFromThread();
+}
+
 void TCPClientSocket::DidCompleteConnect(int result) {
   CR_DCHECK_EQ(next_connect_state_, CONNECT_STATE_CONNECT_COMPLETE);
   CR_DCHECK_NE(result, ERR_IO_PENDING);
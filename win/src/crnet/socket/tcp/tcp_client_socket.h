@@ -65,9 +65,18 @@ class CRNET_EXPORT TCPClientSocket : public StreamSocket {
   int Read(IOBuffer* buf,
            int buf_len,
            CompletionOnceCallback callback) override;
+  int Readv(const IOBufferSlice* slices,
+            int slice_count,
+            CompletionOnceCallback callback) override;
+  int ReadIfReady(IOBuffer* buf,
+                  int buf_len,
+                  CompletionOnceCallback callback) override;
   int Write(IOBuffer* buf,
             int buf_len,
             CompletionOnceCallback callback) override;
+  int Writev(const IOBufferSlice* slices,
+             int slice_count,
+             CompletionOnceCallback callback) override;
   int SetReceiveBufferSize(int32_t size) override;
   int SetSendBufferSize(int32_t size) override;
 
@@ -78,6 +87,7 @@ class CRNET_EXPORT TCPClientSocket : public StreamSocket {
   void ClearConnectionAttempts() override;
   void AddConnectionAttempts(const ConnectionAttempts& attempts) override;
   int64_t GetTotalReceivedBytes() const override;
+  void DetachFromThread() override;
 
  private:
   // State machine for connecting the socket.
@@ -19,7 +19,9 @@ namespace crnet {
 ///      pending_accept_(false) {
 //}
 
-TCPServerSocket:: TCPServerSocket() : pending_accept_(false) {
+TCPServerSocket:: TCPServerSocket()
+    : pending_accept_(false),
+      reuse_port_(false) {
 }
 
 TCPServerSocket::~TCPServerSocket() {
@@ -36,6 +38,18 @@ int TCPServerSocket::Listen(const IPEndPoint& address, int backlog) {
     return result;
   }
 
+  if (reuse_port_) {
+#if defined(MINI_CHROMIUM_OS_POSIX)
+    result = socket_.AllowPortReuse();
+#else
+    result = ERR_NOT_IMPLEMENTED;
+#endif
+    if (result != OK) {
+      socket_.Close();
+      return result;
+    }
+  }
+
   result = socket_.Bind(address);
   if (result != OK) {
     socket_.Close();
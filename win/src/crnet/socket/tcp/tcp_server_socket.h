@@ -33,6 +33,12 @@ class CRNET_EXPORT_PRIVATE TCPServerSocket : public ServerSocket {
   int Accept(std::unique_ptr<StreamSocket>* socket,
              CompletionOnceCallback callback) override;
 
+  // Lets other sockets listen on the same address and port, the kernel
+  // spreading incoming connections between them.  Must be called before
+  // Listen(), which fails with ERR_NOT_IMPLEMENTED where the platform has no
+  // SO_REUSEPORT.
+  void set_reuse_port(bool reuse_port) { reuse_port_ = reuse_port; }
+
   // Detachs from the current thread, to allow the socket to be transferred to
   // a new thread. Should only be called when the object is no longer used by
   // the old thread.
@@ -56,6 +62,7 @@ class CRNET_EXPORT_PRIVATE TCPServerSocket : public ServerSocket {
   std::unique_ptr<TCPSocket> accepted_socket_;
   IPEndPoint accepted_address_;
   bool pending_accept_;
+  bool reuse_port_;
 };
 
 }  // namespace crnet
@@ -0,0 +1,781 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crnet/socket/tcp/tcp_socket.h"
+#include "crnet/socket/tcp/tcp_socket_posix.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "crbase/functional/bind.h"
+#include "crbase/logging.h"
+#include "crbase/posix/eintr_wrapper.h"
+#include "crnet/base/io_buffer.h"
+#include "crnet/base/ip_endpoint.h"
+#include "crnet/base/net_errors.h"
+#include "crnet/base/sockaddr_storage.h"
+
+namespace crnet {
+
+namespace {
+
+const int kTCPKeepAliveSeconds = 45;
+
+int SetSocketReceiveBufferSize(int fd, int32_t size) {
+  int rv = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  int net_error = (rv == 0) ? OK : MapSystemError(errno);
+  CR_DCHECK(!rv) << "Could not set socket receive buffer size: " << net_error;
+  return net_error;
+}
+
+int SetSocketSendBufferSize(int fd, int32_t size) {
+  int rv = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  int net_error = (rv == 0) ? OK : MapSystemError(errno);
+  CR_DCHECK(!rv) << "Could not set socket send buffer size: " << net_error;
+  return net_error;
+}
+
+// Disable Nagle.  See the comment on DisableNagle() in tcp_socket_win.cc.
+bool DisableNagle(int fd, bool disable) {
+  int on = disable ? 1 : 0;
+  int rv = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  CR_DCHECK(!rv) << "Could not disable nagle";
+  return rv == 0;
+}
+
+// Enable TCP Keep-Alive to prevent NAT routers from timing out TCP
+// connections. See http://crbug.com/27400 for details.
+bool SetTCPKeepAlive(int fd, bool enable, int delay) {
+  int on = enable ? 1 : 0;
+  if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on))) {
+    CR_PLOG(ERROR) << "Failed to set SO_KEEPALIVE on fd: " << fd;
+    return false;
+  }
+
+  // If we disabled TCP keep alive, our work is done here.
+  if (!enable)
+    return true;
+
+  // Seconds until first TCP keep alive.
+  if (setsockopt(fd, SOL_TCP, TCP_KEEPIDLE, &delay, sizeof(delay))) {
+    CR_PLOG(ERROR) << "Failed to set TCP_KEEPIDLE on fd: " << fd;
+    return false;
+  }
+  // Seconds between TCP keep alives.
+  if (setsockopt(fd, SOL_TCP, TCP_KEEPINTVL, &delay, sizeof(delay))) {
+    CR_PLOG(ERROR) << "Failed to set TCP_KEEPINTVL on fd: " << fd;
+    return false;
+  }
+  return true;
+}
+
+int MapAcceptError(int os_error) {
+  switch (os_error) {
+    // If the client aborts the connection before the server calls accept,
+    // POSIX specifies accept should fail with ECONNABORTED. The server can
+    // ignore the error and just call accept again, so we map the error to
+    // ERR_IO_PENDING. See UNIX Network Programming, Vol. 1, 3rd Ed., Sec.
+    // 5.11, "Connection Abort before accept Returns".
+    case ECONNABORTED:
+      return ERR_IO_PENDING;
+    default:
+      return MapSystemError(os_error);
+  }
+}
+
+int MapConnectError(int os_error) {
+  switch (os_error) {
+    case EINPROGRESS:
+      return ERR_IO_PENDING;
+    case EACCES:
+      return ERR_NETWORK_ACCESS_DENIED;
+    case ETIMEDOUT:
+      return ERR_CONNECTION_TIMED_OUT;
+    default: {
+      int net_error = MapSystemError(os_error);
+      if (net_error == ERR_FAILED)
+        return ERR_CONNECTION_FAILED;  // More specific than ERR_FAILED.
+
+      // Give a more specific error when the user is offline.
+      if (net_error == ERR_ADDRESS_UNREACHABLE /*&&
+          NetworkChangeNotifier::IsOffline() */) {
+        return ERR_INTERNET_DISCONNECTED;
+      }
+
+      return net_error;
+    }
+  }
+}
+
+bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1)
+    return false;
+  if (flags & O_NONBLOCK)
+    return true;
+  return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+}  // namespace
+
+//-----------------------------------------------------------------------------
+
+TCPSocketPosix::TCPSocketPosix()
+    : socket_(kInvalidSocket),
+      accept_socket_(NULL),
+      accept_address_(NULL),
+      waiting_connect_(false),
+      waiting_read_(false),
+      waiting_write_(false),
+      connect_os_error_(0) {
+}
+
+TCPSocketPosix::~TCPSocketPosix() {
+  Close();
+}
+
+int TCPSocketPosix::Open(AddressFamily family) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_EQ(socket_, kInvalidSocket);
+
+  socket_ = CreatePlatformSocket(ConvertAddressFamily(family), SOCK_STREAM,
+                                 IPPROTO_TCP);
+  if (socket_ == kInvalidSocket) {
+    CR_PLOG(ERROR) << "CreatePlatformSocket() returned an error";
+    return MapSystemError(errno);
+  }
+
+  if (!SetNonBlocking(socket_)) {
+    int result = MapSystemError(errno);
+    Close();
+    return result;
+  }
+
+  return OK;
+}
+
+int TCPSocketPosix::AdoptConnectedSocket(SocketDescriptor socket,
+                                         const IPEndPoint& peer_address) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_EQ(socket_, kInvalidSocket);
+
+  socket_ = socket;
+
+  if (!SetNonBlocking(socket_)) {
+    int result = MapSystemError(errno);
+    Close();
+    return result;
+  }
+
+  peer_address_.reset(new IPEndPoint(peer_address));
+
+  return OK;
+}
+
+int TCPSocketPosix::AdoptListenSocket(SocketDescriptor socket) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_EQ(socket_, kInvalidSocket);
+
+  socket_ = socket;
+
+  if (!SetNonBlocking(socket_)) {
+    int result = MapSystemError(errno);
+    Close();
+    return result;
+  }
+
+  return OK;
+}
+
+int TCPSocketPosix::Bind(const IPEndPoint& address) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+
+  SockaddrStorage storage;
+  if (!address.ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+
+  int result = bind(socket_, storage.addr, storage.addr_len);
+  if (result < 0) {
+    CR_PLOG(ERROR) << "bind() returned an error";
+    return MapSystemError(errno);
+  }
+
+  return OK;
+}
+
+int TCPSocketPosix::Listen(int backlog) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_GT(backlog, 0);
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+
+  int result = listen(socket_, backlog);
+  if (result < 0) {
+    CR_PLOG(ERROR) << "listen() returned an error";
+    return MapSystemError(errno);
+  }
+
+  return OK;
+}
+
+int TCPSocketPosix::Accept(std::unique_ptr<TCPSocketPosix>* socket,
+                           IPEndPoint* address,
+                           CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(socket);
+  CR_DCHECK(address);
+  CR_DCHECK(!callback.is_null());
+  CR_DCHECK(accept_callback_.is_null());
+
+  int result = AcceptInternal(socket, address);
+
+  if (result == ERR_IO_PENDING) {
+    if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+            socket_, true, cr::MessageLoopForIO::WATCH_READ,
+            &read_watcher_, this)) {
+      CR_PLOG(ERROR) << "WatchFileDescriptor failed on accept";
+      return MapSystemError(errno);
+    }
+
+    accept_socket_ = socket;
+    accept_address_ = address;
+    accept_callback_ = std::move(callback);
+  }
+
+  return result;
+}
+
+int TCPSocketPosix::Connect(const IPEndPoint& address,
+                            CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(!waiting_connect_);
+
+  // |peer_address_| will be non-NULL if Connect() has been called. Unless
+  // Close() is called to reset the internal state, a second call to Connect()
+  // is not allowed: connecting the same socket again after a failed attempt
+  // results in unspecified behavior according to POSIX.
+  CR_DCHECK(!peer_address_);
+
+  peer_address_.reset(new IPEndPoint(address));
+
+  int rv = DoConnect();
+  if (rv == ERR_IO_PENDING) {
+    // Synchronous operation not supported.
+    CR_DCHECK(!callback.is_null());
+    read_callback_ = std::move(callback);
+    waiting_connect_ = true;
+  } else {
+    connect_os_error_ = 0;
+  }
+
+  return rv;
+}
+
+bool TCPSocketPosix::IsConnected() const {
+  CR_DCHECK(CalledOnValidThread());
+
+  if (socket_ == kInvalidSocket || waiting_connect_)
+    return false;
+
+  if (waiting_read_)
+    return true;
+
+  // Check if connection is alive.
+  char c;
+  int rv = HANDLE_EINTR(recv(socket_, &c, 1, MSG_PEEK | MSG_DONTWAIT));
+  if (rv == 0)
+    return false;
+  if (rv == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    return false;
+
+  return true;
+}
+
+bool TCPSocketPosix::IsConnectedAndIdle() const {
+  CR_DCHECK(CalledOnValidThread());
+
+  if (socket_ == kInvalidSocket || waiting_connect_)
+    return false;
+
+  if (waiting_read_)
+    return true;
+
+  // Check if connection is alive and we haven't received any data
+  // unexpectedly.
+  char c;
+  int rv = HANDLE_EINTR(recv(socket_, &c, 1, MSG_PEEK | MSG_DONTWAIT));
+  if (rv >= 0)
+    return false;
+  if (errno != EAGAIN && errno != EWOULDBLOCK)
+    return false;
+
+  return true;
+}
+
+int TCPSocketPosix::Read(IOBuffer* buf,
+                         int buf_len,
+                         CompletionOnceCallback callback) {
+  CR_DCHECK_GT(buf_len, 0);
+  IOBufferSlice slice(buf, 0, buf_len);
+  return Readv(&slice, 1, std::move(callback));
+}
+
+int TCPSocketPosix::Readv(const IOBufferSlice* slices,
+                          int slice_count,
+                          CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(read_slices_.empty());
+  CR_DCHECK_GT(slice_count, 0);
+
+  if (slice_count > kMaxIOBufferSlices)
+    slice_count = kMaxIOBufferSlices;
+
+  // cr::Unretained() is safe because RetryRead() won't be called when |this|
+  // is gone.
+  int rv = ReadvIfReady(
+      slices, slice_count,
+      cr::BindOnce(&TCPSocketPosix::RetryRead, cr::Unretained(this)));
+  if (rv != ERR_IO_PENDING)
+    return rv;
+  read_callback_ = std::move(callback);
+  read_slices_.reserve(kMaxIOBufferSlices);
+  read_slices_.assign(slices, slices + slice_count);
+  read_bufs_.reserve(kMaxIOBufferSlices);
+  for (int i = 0; i < slice_count; ++i)
+    read_bufs_.push_back(slices[i].buffer);
+  return ERR_IO_PENDING;
+}
+
+int TCPSocketPosix::ReadIfReady(IOBuffer* buf,
+                                int buf_len,
+                                CompletionOnceCallback callback) {
+  CR_DCHECK_GT(buf_len, 0);
+  IOBufferSlice slice(buf, 0, buf_len);
+  return ReadvIfReady(&slice, 1, std::move(callback));
+}
+
+int TCPSocketPosix::ReadvIfReady(const IOBufferSlice* slices,
+                                 int slice_count,
+                                 CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(!waiting_read_);
+  CR_DCHECK(read_if_ready_callback_.is_null());
+  CR_DCHECK(!waiting_connect_);
+
+  int rv = DoRead(slices, slice_count);
+  if (rv != ERR_IO_PENDING)
+    return rv;
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_READ,
+          &read_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on read";
+    return MapSystemError(errno);
+  }
+
+  waiting_read_ = true;
+  read_if_ready_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int TCPSocketPosix::CancelReadIfReady() {
+  CR_DCHECK(read_callback_.is_null());
+  CR_DCHECK(!read_if_ready_callback_.is_null());
+  CR_DCHECK(waiting_read_);
+
+  bool ok = read_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  read_if_ready_callback_.Reset();
+  waiting_read_ = false;
+  return crnet::OK;
+}
+
+int TCPSocketPosix::Write(IOBuffer* buf,
+                          int buf_len,
+                          CompletionOnceCallback callback) {
+  CR_DCHECK_GT(buf_len, 0);
+  IOBufferSlice slice(buf, 0, buf_len);
+  return Writev(&slice, 1, std::move(callback));
+}
+
+int TCPSocketPosix::Writev(const IOBufferSlice* slices,
+                           int slice_count,
+                           CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(!waiting_write_);
+  CR_CHECK(write_callback_.is_null());
+  CR_DCHECK_GT(slice_count, 0);
+  CR_DCHECK(!waiting_connect_);
+
+  if (slice_count > kMaxIOBufferSlices)
+    slice_count = kMaxIOBufferSlices;
+
+  int rv = DoWrite(slices, slice_count);
+  if (rv != ERR_IO_PENDING)
+    return rv;
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_WRITE,
+          &write_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on write";
+    return MapSystemError(errno);
+  }
+
+  waiting_write_ = true;
+  write_slices_.reserve(kMaxIOBufferSlices);
+  write_slices_.assign(slices, slices + slice_count);
+  write_bufs_.reserve(kMaxIOBufferSlices);
+  for (int i = 0; i < slice_count; ++i)
+    write_bufs_.push_back(slices[i].buffer);
+  write_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int TCPSocketPosix::GetLocalAddress(IPEndPoint* address) const {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(address);
+
+  SockaddrStorage storage;
+  if (getsockname(socket_, storage.addr, &storage.addr_len) < 0)
+    return MapSystemError(errno);
+  if (!address->FromSockAddr(storage.addr, storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+
+  return OK;
+}
+
+int TCPSocketPosix::GetPeerAddress(IPEndPoint* address) const {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(address);
+  if (!IsConnected())
+    return ERR_SOCKET_NOT_CONNECTED;
+  *address = *peer_address_;
+  return OK;
+}
+
+int TCPSocketPosix::SetDefaultOptionsForServer() {
+  return AllowAddressReuse();
+}
+
+void TCPSocketPosix::SetDefaultOptionsForClient() {
+  DisableNagle(socket_, true);
+  SetTCPKeepAlive(socket_, true, kTCPKeepAliveSeconds);
+}
+
+int TCPSocketPosix::AllowAddressReuse() {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+
+  int true_value = 1;
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &true_value,
+                      sizeof(true_value));
+  return rv == -1 ? MapSystemError(errno) : OK;
+}
+
+int TCPSocketPosix::AllowPortReuse() {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+
+  int true_value = 1;
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &true_value,
+                      sizeof(true_value));
+  if (rv == -1) {
+    // Kernels predating SO_REUSEPORT don't know the option.
+    return errno == ENOPROTOOPT ? ERR_NOT_IMPLEMENTED : MapSystemError(errno);
+  }
+  return OK;
+}
+
+int TCPSocketPosix::SetReceiveBufferSize(int32_t size) {
+  CR_DCHECK(CalledOnValidThread());
+  return SetSocketReceiveBufferSize(socket_, size);
+}
+
+int TCPSocketPosix::SetSendBufferSize(int32_t size) {
+  CR_DCHECK(CalledOnValidThread());
+  return SetSocketSendBufferSize(socket_, size);
+}
+
+bool TCPSocketPosix::SetKeepAlive(bool enable, int delay) {
+  return SetTCPKeepAlive(socket_, enable, delay);
+}
+
+bool TCPSocketPosix::SetNoDelay(bool no_delay) {
+  return DisableNagle(socket_, no_delay);
+}
+
+void TCPSocketPosix::Close() {
+  CR_DCHECK(CalledOnValidThread());
+
+  StopWatchingAndCleanUp();
+
+  if (socket_ != kInvalidSocket) {
+    if (IGNORE_EINTR(close(socket_)) < 0)
+      CR_PLOG(ERROR) << "close() returned an error, errno=" << errno;
+    socket_ = kInvalidSocket;
+  }
+}
+
+void TCPSocketPosix::DetachFromThread() {
+  cr::NonThreadSafe::DetachFromThread();
+}
+
+bool TCPSocketPosix::GetEstimatedRoundTripTime(cr::TimeDelta* out_rtt) const {
+  CR_DCHECK(out_rtt);
+  if (socket_ == kInvalidSocket)
+    return false;
+
+  tcp_info info;
+  socklen_t info_len = sizeof(tcp_info);
+  if (getsockopt(socket_, IPPROTO_TCP, TCP_INFO, &info, &info_len) != 0 ||
+      info_len != sizeof(tcp_info)) {
+    return false;
+  }
+
+  // Reject the RTT if it is zero: the kernel has no estimate yet.
+  if (info.tcpi_rtt == 0)
+    return false;
+  *out_rtt = cr::TimeDelta::FromMicroseconds(info.tcpi_rtt);
+  return true;
+}
+
+void TCPSocketPosix::OnFileCanReadWithoutBlocking(int fd) {
+  if (!accept_callback_.is_null()) {
+    DidCompleteAccept();
+  } else {
+    CR_DCHECK(!read_if_ready_callback_.is_null());
+    DidCompleteRead();
+  }
+}
+
+void TCPSocketPosix::OnFileCanWriteWithoutBlocking(int fd) {
+  if (waiting_connect_) {
+    DidCompleteConnect();
+  } else {
+    CR_DCHECK(!write_callback_.is_null());
+    DidCompleteWrite();
+  }
+}
+
+int TCPSocketPosix::AcceptInternal(std::unique_ptr<TCPSocketPosix>* socket,
+                                   IPEndPoint* address) {
+  SockaddrStorage storage;
+  int new_socket = HANDLE_EINTR(accept4(socket_, storage.addr,
+                                        &storage.addr_len, SOCK_NONBLOCK));
+  if (new_socket < 0)
+    return MapAcceptError(errno);
+
+  IPEndPoint ip_end_point;
+  if (!ip_end_point.FromSockAddr(storage.addr, storage.addr_len)) {
+    CR_NOTREACHED();
+    if (IGNORE_EINTR(close(new_socket)) < 0)
+      CR_PLOG(ERROR) << "close";
+    return ERR_ADDRESS_INVALID;
+  }
+
+  std::unique_ptr<TCPSocketPosix> tcp_socket(new TCPSocketPosix());
+  int adopt_result = tcp_socket->AdoptConnectedSocket(new_socket,
+                                                      ip_end_point);
+  if (adopt_result != OK)
+    return adopt_result;
+  *socket = std::move(tcp_socket);
+  *address = ip_end_point;
+  return OK;
+}
+
+int TCPSocketPosix::DoConnect() {
+  CR_DCHECK_EQ(connect_os_error_, 0);
+
+  SockaddrStorage storage;
+  if (!peer_address_->ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+
+  // connect() is not retried on EINTR: the connection attempt goes on in the
+  // background and its result is reported like that of EINPROGRESS.
+  if (!connect(socket_, storage.addr, storage.addr_len))
+    return OK;  // Connected without waiting!
+
+  int os_error = errno;
+  if (os_error != EINPROGRESS && os_error != EINTR) {
+    connect_os_error_ = os_error;
+    int rv = MapConnectError(os_error);
+    CR_CHECK_NE(ERR_IO_PENDING, rv);
+    return rv;
+  }
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_WRITE,
+          &write_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on connect";
+    connect_os_error_ = errno;
+    return MapSystemError(errno);
+  }
+  return ERR_IO_PENDING;
+}
+
+int TCPSocketPosix::DoRead(const IOBufferSlice* slices, int slice_count) {
+  CR_DCHECK_LE(slice_count, kMaxIOBufferSlices);
+
+  struct iovec iov[kMaxIOBufferSlices];
+  for (int i = 0; i < slice_count; ++i) {
+    CR_DCHECK_GT(slices[i].length, 0);
+    iov[i].iov_base = slices[i].data();
+    iov[i].iov_len = slices[i].length;
+  }
+
+  struct msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = slice_count;
+
+  ssize_t rv = HANDLE_EINTR(recvmsg(socket_, &msg, 0));
+  if (rv >= 0)
+    return static_cast<int>(rv);
+  return MapSystemError(errno);
+}
+
+int TCPSocketPosix::DoWrite(const IOBufferSlice* slices, int slice_count) {
+  CR_DCHECK_LE(slice_count, kMaxIOBufferSlices);
+
+  struct iovec iov[kMaxIOBufferSlices];
+  size_t total_len = 0;
+  for (int i = 0; i < slice_count; ++i) {
+    CR_DCHECK_GT(slices[i].length, 0);
+    iov[i].iov_base = slices[i].data();
+    iov[i].iov_len = slices[i].length;
+    total_len += slices[i].length;
+  }
+
+  struct msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = slice_count;
+
+  // MSG_NOSIGNAL reports a write to a closed connection as EPIPE instead of
+  // raising SIGPIPE.
+  ssize_t rv = HANDLE_EINTR(sendmsg(socket_, &msg, MSG_NOSIGNAL));
+  if (rv >= 0) {
+    CR_CHECK_LE(static_cast<size_t>(rv), total_len);
+    // Linux never transfers more than INT_MAX bytes in one call.
+    return static_cast<int>(rv);
+  }
+  return MapSystemError(errno);
+}
+
+void TCPSocketPosix::RetryRead(int rv) {
+  CR_DCHECK(!read_slices_.empty());
+
+  if (rv == OK) {
+    // cr::Unretained() is safe because RetryRead() won't be called when
+    // |this| is gone.
+    rv = ReadvIfReady(
+        read_slices_.data(), static_cast<int>(read_slices_.size()),
+        cr::BindOnce(&TCPSocketPosix::RetryRead, cr::Unretained(this)));
+    if (rv == ERR_IO_PENDING)
+      return;
+  }
+  read_slices_.clear();
+  read_bufs_.clear();
+  std::move(read_callback_).Run(rv);
+}
+
+void TCPSocketPosix::DidCompleteAccept() {
+  CR_DCHECK(CalledOnValidThread());
+
+  int rv = AcceptInternal(accept_socket_, accept_address_);
+  if (rv == ERR_IO_PENDING)
+    return;
+
+  bool ok = read_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  accept_socket_ = NULL;
+  accept_address_ = NULL;
+  std::move(accept_callback_).Run(rv);
+}
+
+void TCPSocketPosix::DidCompleteConnect() {
+  CR_DCHECK(waiting_connect_);
+  CR_DCHECK(!read_callback_.is_null());
+
+  // Get the error that connect() completed with.
+  int os_error = 0;
+  socklen_t len = sizeof(os_error);
+  if (getsockopt(socket_, SOL_SOCKET, SO_ERROR, &os_error, &len) == 0) {
+    // TCPSocketPosix expects errno to be set.
+    errno = os_error;
+  }
+
+  int rv = MapConnectError(errno);
+  if (rv == ERR_IO_PENDING)
+    return;
+
+  bool ok = write_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  connect_os_error_ = 0;
+  waiting_connect_ = false;
+  std::move(read_callback_).Run(rv);
+}
+
+void TCPSocketPosix::DidCompleteRead() {
+  CR_DCHECK(waiting_read_);
+
+  bool ok = read_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  waiting_read_ = false;
+  std::move(read_if_ready_callback_).Run(OK);
+}
+
+void TCPSocketPosix::DidCompleteWrite() {
+  CR_DCHECK(waiting_write_);
+  CR_DCHECK(!write_callback_.is_null());
+
+  int rv = DoWrite(write_slices_.data(),
+                   static_cast<int>(write_slices_.size()));
+  if (rv == ERR_IO_PENDING)
+    return;
+
+  bool ok = write_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  waiting_write_ = false;
+  write_slices_.clear();
+  write_bufs_.clear();
+  std::move(write_callback_).Run(rv);
+}
+
+void TCPSocketPosix::StopWatchingAndCleanUp() {
+  bool ok = read_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  ok = write_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+
+  if (!accept_callback_.is_null()) {
+    accept_socket_ = NULL;
+    accept_address_ = NULL;
+    accept_callback_.Reset();
+  }
+
+  waiting_connect_ = false;
+  waiting_read_ = false;
+  waiting_write_ = false;
+
+  read_slices_.clear();
+  read_bufs_.clear();
+  read_callback_.Reset();
+  read_if_ready_callback_.Reset();
+
+  write_slices_.clear();
+  write_bufs_.clear();
+  write_callback_.Reset();
+
+  peer_address_.reset();
+  connect_os_error_ = 0;
+}
+
+}  // namespace crnet
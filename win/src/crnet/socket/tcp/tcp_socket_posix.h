@@ -0,0 +1,195 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRNET_SOCKET_TCP_TCP_SOCKET_POSIX_H_
+#define MINI_CHROMIUM_SRC_CRNET_SOCKET_TCP_TCP_SOCKET_POSIX_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "crbase/compiler_specific.h"
+#include "crbase/macros.h"
+#include "crbase/memory/ref_counted.h"
+#include "crbase/message_loop/message_loop.h"
+#include "crbase/threading/non_thread_safe.h"
+#include "crbase/time/time.h"
+#include "crnet/base/address_family.h"
+#include "crnet/base/completion_once_callback.h"
+#include "crnet/base/net_export.h"
+#include "crnet/socket/socket_descriptor.h"
+
+namespace crnet {
+
+class AddressList;
+class IOBuffer;
+class IPEndPoint;
+struct IOBufferSlice;
+
+// A non-blocking TCP socket driven by the epoll pump of the current
+// MessageLoopForIO.  It offers the same interface as TCPSocketWin: instead of
+// waiting for WSAEventSelect events, it watches its descriptor for
+// readability (accept and read) and writability (connect and write).
+//
+// The crnet socket and server code compiles for Linux, but no Linux binary
+// links yet: crbase still lacks POSIX versions of time, logging, Location and
+// the COM setup in Thread.
+class CRNET_EXPORT TCPSocketPosix
+    : public cr::NonThreadSafe,
+      public cr::MessageLoopForIO::Watcher {
+ public:
+  TCPSocketPosix(const TCPSocketPosix&) = delete;
+  TCPSocketPosix& operator=(const TCPSocketPosix&) = delete;
+  TCPSocketPosix();
+
+  ~TCPSocketPosix() override;
+
+  int Open(AddressFamily family);
+
+  // Both AdoptConnectedSocket and AdoptListenSocket take ownership of an
+  // existing socket. AdoptConnectedSocket takes an already connected
+  // socket. AdoptListenSocket takes a socket that is intended to accept
+  // connection. In some sense, AdoptListenSocket is more similar to Open.
+  int AdoptConnectedSocket(SocketDescriptor socket,
+                           const IPEndPoint& peer_address);
+  int AdoptListenSocket(SocketDescriptor socket);
+
+  int Bind(const IPEndPoint& address);
+
+  int Listen(int backlog);
+  int Accept(std::unique_ptr<TCPSocketPosix>* socket,
+             IPEndPoint* address,
+             CompletionOnceCallback callback);
+
+  int Connect(const IPEndPoint& address,
+              CompletionOnceCallback callback);
+  bool IsConnected() const;
+  bool IsConnectedAndIdle() const;
+
+  // Multiple outstanding requests are not supported.
+  // Full duplex mode (reading and writing at the same time) is supported.
+  int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  // Scatter read into up to kMaxIOBufferSlices slices in one recvmsg() call.
+  int Readv(const IOBufferSlice* slices,
+            int slice_count,
+            CompletionOnceCallback callback);
+  int ReadIfReady(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int CancelReadIfReady();
+  int Write(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  // Gather write of up to kMaxIOBufferSlices slices in one sendmsg() call.
+  int Writev(const IOBufferSlice* slices,
+             int slice_count,
+             CompletionOnceCallback callback);
+
+  int GetLocalAddress(IPEndPoint* address) const;
+  int GetPeerAddress(IPEndPoint* address) const;
+
+  // Sets various socket options.
+  // The commonly used options for server listening sockets:
+  // - AllowAddressReuse().
+  int SetDefaultOptionsForServer();
+  // The commonly used options for client sockets and accepted sockets:
+  // - SetNoDelay(true);
+  // - SetKeepAlive(true, 45).
+  void SetDefaultOptionsForClient();
+  // Sets SO_REUSEADDR, so that a listening socket can be bound to an address
+  // still held by connections in TIME_WAIT.
+  int AllowAddressReuse();
+  // Sets SO_REUSEPORT, so that several sockets can listen on the same address
+  // and port, the kernel spreading incoming connections between them.
+  int AllowPortReuse();
+  int SetReceiveBufferSize(int32_t size);
+  int SetSendBufferSize(int32_t size);
+  bool SetKeepAlive(bool enable, int delay);
+  bool SetNoDelay(bool no_delay);
+
+  // Gets the estimated RTT. Returns false if the RTT is
+  // unavailable. May also return false when estimated RTT is 0.
+  bool GetEstimatedRoundTripTime(cr::TimeDelta* out_rtt) const
+      CR_WARN_UNUSED_RESULT;
+
+  void Close();
+
+  bool IsValid() const { return socket_ != kInvalidSocket; }
+
+  // Detachs from the current thread, to allow the socket to be transferred to
+  // a new thread. Should only be called when the object is no longer used by
+  // the old thread.
+  void DetachFromThread();
+
+ private:
+  // cr::MessageLoopForIO::Watcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+  int AcceptInternal(std::unique_ptr<TCPSocketPosix>* socket,
+                     IPEndPoint* address);
+
+  int DoConnect();
+  int DoRead(const IOBufferSlice* slices, int slice_count);
+  int DoWrite(const IOBufferSlice* slices, int slice_count);
+
+  // ReadIfReady() into slices.
+  int ReadvIfReady(const IOBufferSlice* slices,
+                   int slice_count,
+                   CompletionOnceCallback callback);
+
+  void RetryRead(int rv);
+  void DidCompleteAccept();
+  void DidCompleteConnect();
+  void DidCompleteRead();
+  void DidCompleteWrite();
+
+  void StopWatchingAndCleanUp();
+
+  SocketDescriptor socket_;
+
+  // Watches |socket_| for readability, on behalf of Accept() or
+  // ReadIfReady().
+  cr::MessageLoopForIO::FileDescriptorWatcher read_watcher_;
+
+  // Watches |socket_| for writability, on behalf of Connect() or Write().
+  cr::MessageLoopForIO::FileDescriptorWatcher write_watcher_;
+
+  std::unique_ptr<TCPSocketPosix>* accept_socket_;
+  IPEndPoint* accept_address_;
+  CompletionOnceCallback accept_callback_;
+
+  // The various states that the socket could be in.
+  bool waiting_connect_;
+  bool waiting_read_;
+  bool waiting_write_;
+
+  // The slices of a Read() or Readv() waiting for RetryRead(), and
+  // references to their buffers.  Like the write vectors below, they get
+  // room for kMaxIOBufferSlices entries on first use and keep it when
+  // cleared, so later pending operations do not allocate.
+  std::vector<IOBufferSlice> read_slices_;
+  std::vector<cr::scoped_refptr<IOBuffer>> read_bufs_;
+
+  // External callback; called when connect or read is complete.
+  CompletionOnceCallback read_callback_;
+
+  // Non-null if a ReadIfReady() is to be completed asynchronously. This is an
+  // external callback if user used ReadIfReady() instead of Read(), but a
+  // wrapped callback on top of RetryRead() if Read() is used.
+  CompletionOnceCallback read_if_ready_callback_;
+
+  // The slices of a pending Write() or Writev(), and references to their
+  // buffers.
+  std::vector<IOBufferSlice> write_slices_;
+  std::vector<cr::scoped_refptr<IOBuffer>> write_bufs_;
+
+  // External callback; called when write is complete.
+  CompletionOnceCallback write_callback_;
+
+  std::unique_ptr<IPEndPoint> peer_address_;
+  // The OS error that a connect attempt last completed with.
+  int connect_os_error_;
+};
+
+}  // namespace crnet
+
+#endif  // MINI_CHROMIUM_SRC_CRNET_SOCKET_TCP_TCP_SOCKET_POSIX_H_
@@ -6,8 +6,11 @@
 #include "crnet/socket/tcp/tcp_socket_win.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <mstcpip.h>
 
+#include <vector>
+
 #include "crbase/functional/callback_helpers.h"
 #include "crbase/files/file_util.h"
 #include "crbase/logging.h"
@@ -165,10 +168,14 @@ class TCPSocketWin::Core : public cr::RefCounted<Core> {
   // |write_overlapped_| is only used for Write();
   OVERLAPPED write_overlapped_;
 
-  // The buffers used in Read() and Write().
-  cr::scoped_refptr<IOBuffer> read_iobuffer_;
-  cr::scoped_refptr<IOBuffer> write_iobuffer_;
-  int read_buffer_length_;
+  // The buffers used in Read() and Write().  A Readv() reads into several
+  // slices, and a Writev() writes several buffers, |write_buffer_length_| is
+  // then their total length.  The vectors get room for kMaxIOBufferSlices
+  // entries on first use and are cleared, not shrunk, when the operation
+  // completes, so later pending operations do not allocate.
+  std::vector<IOBufferSlice> read_slices_;
+  std::vector<cr::scoped_refptr<IOBuffer>> read_iobuffers_;
+  std::vector<cr::scoped_refptr<IOBuffer>> write_iobuffers_;
   int write_buffer_length_;
 
   bool non_blocking_reads_initialized_;
@@ -220,7 +227,6 @@ class TCPSocketWin::Core : public cr::RefCounted<Core> {
 
 TCPSocketWin::Core::Core(TCPSocketWin* socket)
     : read_event_(WSACreateEvent()),
-      read_buffer_length_(0),
       write_buffer_length_(0),
       non_blocking_reads_initialized_(false),
       socket_(socket),
@@ -529,34 +535,72 @@ bool TCPSocketWin::IsConnectedAndIdle() const {
 int TCPSocketWin::Read(IOBuffer* buf,
                        int buf_len,
                        CompletionOnceCallback callback) {
+  CR_DCHECK_GT(buf_len, 0);
+  IOBufferSlice slice(buf, 0, buf_len);
+  return Readv(&slice, 1, std::move(callback));
+}
+
+int TCPSocketWin::Readv(const IOBufferSlice* slices,
+                        int slice_count,
+                        CompletionOnceCallback callback) {
   CR_DCHECK(CalledOnValidThread());
-  CR_DCHECK(!core_->read_iobuffer_.get());
+  CR_DCHECK(core_->read_slices_.empty());
+  CR_DCHECK_GT(slice_count, 0);
+
+  if (slice_count > kMaxIOBufferSlices)
+    slice_count = kMaxIOBufferSlices;
+
   // cr::Unretained() is safe because RetryRead() won't be called when |this|
   // is gone.
-  int rv = ReadIfReady(
-      buf, buf_len,
+  int rv = ReadvIfReady(
+      slices, slice_count,
       cr::BindOnce(&TCPSocketWin::RetryRead, cr::Unretained(this)));
   if (rv != ERR_IO_PENDING)
     return rv;
   read_callback_ = std::move(callback);
-  core_->read_iobuffer_ = buf;
-  core_->read_buffer_length_ = buf_len;
+  core_->read_slices_.reserve(kMaxIOBufferSlices);
+  core_->read_slices_.assign(slices, slices + slice_count);
+  core_->read_iobuffers_.reserve(kMaxIOBufferSlices);
+  for (int i = 0; i < slice_count; ++i)
+    core_->read_iobuffers_.push_back(slices[i].buffer);
   return ERR_IO_PENDING;
 }
 
 int TCPSocketWin::ReadIfReady(IOBuffer* buf,
                               int buf_len,
                               CompletionOnceCallback callback) {
+  CR_DCHECK_GT(buf_len, 0);
+  IOBufferSlice slice(buf, 0, buf_len);
+  return ReadvIfReady(&slice, 1, std::move(callback));
+}
+
+int TCPSocketWin::ReadvIfReady(const IOBufferSlice* slices,
+                               int slice_count,
+                               CompletionOnceCallback callback) {
   CR_DCHECK(CalledOnValidThread());
   CR_DCHECK_NE(socket_, INVALID_SOCKET);
   CR_DCHECK(!waiting_read_);
   CR_DCHECK(read_if_ready_callback_.is_null());
+  CR_DCHECK_LE(slice_count, kMaxIOBufferSlices);
 
   if (!core_->non_blocking_reads_initialized_) {
     WSAEventSelect(socket_, core_->read_event_, FD_READ | FD_CLOSE);
     core_->non_blocking_reads_initialized_ = true;
   }
-  int rv = recv(socket_, buf->data(), buf_len, 0);
+
+  WSABUF read_buffers[kMaxIOBufferSlices];
+  for (int i = 0; i < slice_count; ++i) {
+    CR_DCHECK_GT(slices[i].length, 0);
+    read_buffers[i].len = slices[i].length;
+    read_buffers[i].buf = slices[i].data();
+  }
+
+  // WSAEventSelect() made the socket non-blocking, so this WSARecv() is a
+  // non-blocking recv() into several buffers.
+  DWORD num;
+  DWORD flags = 0;
+  int rv = WSARecv(socket_, read_buffers, slice_count, &num, &flags, NULL,
+                   NULL);
   int os_error = WSAGetLastError();
   if (rv == SOCKET_ERROR) {
     if (os_error != WSAEWOULDBLOCK) {
@@ -567,9 +611,9 @@ int TCPSocketWin::ReadIfReady(IOBuffer* buf,
     }
   } else {
     ///net_log_.AddByteTransferEvent(NetLogEventType::SOCKET_BYTES_RECEIVED, rv,
-    ///                              buf->data());
+    ///                              slices[0].data());
     ///activity_monitor::IncrementBytesReceived(rv);
-    return rv;
+    return static_cast<int>(num);
   }
 
   waiting_read_ = true;
@@ -592,21 +636,40 @@ int TCPSocketWin::CancelReadIfReady() {
 int TCPSocketWin::Write(IOBuffer* buf,
                         int buf_len,
                         CompletionOnceCallback callback) {
+  CR_DCHECK_GT(buf_len, 0);
+  IOBufferSlice slice(buf, 0, buf_len);
+  return Writev(&slice, 1, std::move(callback));
+}
+
+int TCPSocketWin::Writev(const IOBufferSlice* slices,
+                         int slice_count,
+                         CompletionOnceCallback callback) {
   CR_DCHECK(CalledOnValidThread());
   CR_DCHECK_NE(socket_, INVALID_SOCKET);
   CR_DCHECK(!waiting_write_);
   CR_CHECK(write_callback_.is_null());
-  CR_DCHECK_GT(buf_len, 0);
-  CR_DCHECK(!core_->write_iobuffer_.get());
-
-  WSABUF write_buffer;
-  write_buffer.len = buf_len;
-  write_buffer.buf = buf->data();
+  CR_DCHECK_GT(slice_count, 0);
+  CR_DCHECK(core_->write_iobuffers_.empty());
+
+  if (slice_count > kMaxIOBufferSlices)
+    slice_count = kMaxIOBufferSlices;
+
+  // WSASend() captures the WSABUF array before returning, even when the send
+  // is overlapped, so it can live on the stack.
+  WSABUF write_buffers[kMaxIOBufferSlices];
+  int buf_len = 0;
+  for (int i = 0; i < slice_count; ++i) {
+    CR_DCHECK_GT(slices[i].length, 0);
+    CR_DCHECK_LE(slices[i].length, INT_MAX - buf_len);
+    write_buffers[i].len = slices[i].length;
+    write_buffers[i].buf = slices[i].data();
+    buf_len += slices[i].length;
+  }
 
   // TODO(wtc): Remove the assertion after enough testing.
   AssertEventNotSignaled(core_->write_overlapped_.hEvent);
   DWORD num;
-  int rv = WSASend(socket_, &write_buffer, 1, &num, 0,
+  int rv = WSASend(socket_, write_buffers, slice_count, &num, 0,
                    &core_->write_overlapped_, NULL);
   if (rv == 0) {
     if (ResetEventIfSignaled(core_->write_overlapped_.hEvent)) {
@@ -634,7 +697,9 @@ int TCPSocketWin::Write(IOBuffer* buf,
   }
   waiting_write_ = true;
   write_callback_ = std::move(callback);
-  core_->write_iobuffer_ = buf;
+  core_->write_iobuffers_.reserve(kMaxIOBufferSlices);
+  for (int i = 0; i < slice_count; ++i)
+    core_->write_iobuffers_.push_back(slices[i].buffer);
   core_->write_buffer_length_ = buf_len;
   core_->WatchForWrite();
   return ERR_IO_PENDING;
@@ -783,6 +848,7 @@ void TCPSocketWin::Close() {
   waiting_write_ = false;
 
   read_callback_.Reset();
+  read_if_ready_callback_.Reset();
   write_callback_.Reset();
   peer_address_.reset();
   connect_os_error_ = 0;
@@ -975,19 +1041,20 @@ void TCPSocketWin::DoConnectComplete(int result) {
 ///}
 
 void TCPSocketWin::RetryRead(int rv) {
-  CR_DCHECK(core_->read_iobuffer_);
+  CR_DCHECK(!core_->read_slices_.empty());
 
   if (rv == OK) {
     // base::Unretained() is safe because RetryRead() won't be called when
     // |this| is gone.
-    rv = ReadIfReady(
-        core_->read_iobuffer_.get(), core_->read_buffer_length_,
+    rv = ReadvIfReady(
+        core_->read_slices_.data(),
+        static_cast<int>(core_->read_slices_.size()),
         cr::BindOnce(&TCPSocketWin::RetryRead, cr::Unretained(this)));
     if (rv == ERR_IO_PENDING)
       return;
   }
-  core_->read_iobuffer_ = nullptr;
-  core_->read_buffer_length_ = 0;
+  core_->read_slices_.clear();
+  core_->read_iobuffers_.clear();
   std::move(read_callback_).Run(rv);
 }
 
@@ -1051,7 +1118,7 @@ void TCPSocketWin::DidCompleteWrite() {
     }
   }
 
-  core_->write_iobuffer_ = NULL;
+  core_->write_iobuffers_.clear();
 
   CR_DCHECK_NE(rv, ERR_IO_PENDING);
   std::move(write_callback_).Run(rv);
@@ -1059,7 +1126,7 @@ void TCPSocketWin::DidCompleteWrite() {
 
 void TCPSocketWin::DidSignalRead() {
   CR_DCHECK(waiting_read_);
-  CR_DCHECK(!read_callback_.is_null());
+  CR_DCHECK(!read_if_ready_callback_.is_null());
 
   int os_error = 0;
   WSANETWORKEVENTS network_events;
@@ -25,6 +25,7 @@ namespace crnet {
 class AddressList;
 class IOBuffer;
 class IPEndPoint;
+struct IOBufferSlice;
 
 class CRNET_EXPORT TCPSocketWin 
     : MSVC_NON_EXPORTED_BASE(public cr::NonThreadSafe),
@@ -62,9 +63,17 @@ class CRNET_EXPORT TCPSocketWin
   // Multiple outstanding requests are not supported.
   // Full duplex mode (reading and writing at the same time) is supported.
   int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  // Scatter read into up to kMaxIOBufferSlices slices in one WSARecv() call.
+  int Readv(const IOBufferSlice* slices,
+            int slice_count,
+            CompletionOnceCallback callback);
   int ReadIfReady(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
   int CancelReadIfReady();
   int Write(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  // Gather write of up to kMaxIOBufferSlices slices in one WSASend() call.
+  int Writev(const IOBufferSlice* slices,
+             int slice_count,
+             CompletionOnceCallback callback);
 
   int GetLocalAddress(IPEndPoint* address) const;
   int GetPeerAddress(IPEndPoint* address) const;
@@ -125,6 +134,11 @@ class CRNET_EXPORT TCPSocketWin
   int DoConnect();
   void DoConnectComplete(int result);
 
+  // ReadIfReady() into slices.
+  int ReadvIfReady(const IOBufferSlice* slices,
+                   int slice_count,
+                   CompletionOnceCallback callback);
+
   ///void LogConnectBegin(const AddressList& addresses);
   ///void LogConnectEnd(int net_error);
   
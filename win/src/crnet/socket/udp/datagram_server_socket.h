@@ -66,6 +66,27 @@ class CRNET_EXPORT DatagramServerSocket : public DatagramSocket {
                      const IPEndPoint& address,
                      CompletionOnceCallback callback) = 0;
 
+  // Receives up to |count| datagrams, one into each element of |datagrams|,
+  // setting its |address| and |result|.  Returns the number of datagrams
+  // received, or a net error code, or ERR_IO_PENDING if none is ready yet, in
+  // which case the caller must keep |datagrams| alive until |callback| is
+  // called with the number of datagrams received or a net error code.  At
+  // most kMaxDatagramBatchSize datagrams are received per call.
+  virtual int RecvFromBatch(DatagramBuffer* datagrams,
+                            int count,
+                            CompletionOnceCallback callback) = 0;
+
+  // Sends the |count| datagrams of |datagrams| in order, each to its
+  // |address|.  Returns the number of datagrams sent, which is less than
+  // |count| when the send buffer filled up, or a net error code if the first
+  // one could not be sent, or ERR_IO_PENDING if it would block, in which case
+  // |callback| is called with the number of datagrams sent or a net error
+  // code.  |datagrams| itself need not outlive the call.  At most
+  // kMaxDatagramBatchSize datagrams are sent per call.
+  virtual int SendToBatch(const DatagramBuffer* datagrams,
+                          int count,
+                          CompletionOnceCallback callback) = 0;
+
   // Set the receive buffer size (in bytes) for the socket.
   // Returns a net error code.
   virtual int SetReceiveBufferSize(int32_t size) = 0;
@@ -74,6 +95,24 @@ class CRNET_EXPORT DatagramServerSocket : public DatagramSocket {
   // Returns a net error code.
   virtual int SetSendBufferSize(int32_t size) = 0;
 
+  // Turns on generic segmentation offload: a buffer passed to SendTo() or
+  // SendToBatch() is sent as datagrams of |segment_size| bytes, the last one
+  // possibly shorter, with one pass down the stack.  The buffer can hold up
+  // to 64 segments and 64 KB.  0 turns it off.  Returns ERR_NOT_IMPLEMENTED
+  // if the platform lacks it.
+  virtual int SetSendSegmentSize(int segment_size) = 0;
+
+  // Turns on generic receive offload: datagrams of the same size from the
+  // same peer may be received coalesced in one buffer, which then needs room
+  // for up to 64 KB.  RecvFromBatch() reports the segment size of each
+  // buffer in DatagramBuffer::segment_size.  Returns ERR_NOT_IMPLEMENTED if
+  // the platform lacks it.
+  //
+  // While it is on, the socket must be read with RecvFromBatch() only:
+  // RecvFrom() cannot report segment boundaries, and fails with
+  // ERR_NOT_IMPLEMENTED.
+  virtual int SetReceiveCoalescing(bool enable) = 0;
+
   // Allow the socket to share the local address to which the socket will
   // be bound with other processes. Should be called before Listen().
   virtual void AllowAddressReuse() = 0;
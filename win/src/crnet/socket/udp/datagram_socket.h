@@ -5,12 +5,53 @@
 #ifndef MINI_CHROMIUM_SRC_CRNET_SOCKET_UDP_DATAGRAM_SOCKET_H_
 #define MINI_CHROMIUM_SRC_CRNET_SOCKET_UDP_DATAGRAM_SOCKET_H_
 
+#include "crnet/base/ip_endpoint.h"
 #include "crnet/base/net_export.h"
 
 namespace crnet {
 
 ///class BoundNetLog;
-class IPEndPoint;
+class IOBuffer;
+
+// The most datagrams that a RecvFromBatch() or SendToBatch() call moves.
+// Datagrams past this are left for the next call.
+const int kMaxDatagramBatchSize = 64;
+
+// One datagram of a RecvFromBatch() or SendToBatch() call.  Like an
+// IOBufferSlice, it does not hold a reference to |buffer|: the socket takes
+// one while the call is pending.
+struct DatagramBuffer {
+  DatagramBuffer() : buffer(nullptr), buf_len(0), result(0), segment_size(0) {}
+  DatagramBuffer(IOBuffer* buffer, int buf_len)
+      : buffer(buffer), buf_len(buf_len), result(0), segment_size(0) {}
+  DatagramBuffer(IOBuffer* buffer, int buf_len, const IPEndPoint& address)
+      : buffer(buffer),
+        buf_len(buf_len),
+        address(address),
+        result(0),
+        segment_size(0) {}
+
+  // The buffer to receive into and the most bytes to receive, or the
+  // datagram to send and its size.
+  IOBuffer* buffer;
+  int buf_len;
+
+  // The peer the datagram was received from, or is sent to.
+  IPEndPoint address;
+
+  // Set by RecvFromBatch(): the size of the datagram received, or the net
+  // error code of this datagram alone, such as ERR_MSG_TOO_BIG when it did
+  // not fit in |buf_len| bytes.
+  int result;
+
+  // Segmentation offload.  For SendToBatch(), if not 0, |buffer| is sent as
+  // datagrams of |segment_size| bytes, the last one possibly shorter, in the
+  // manner of SetSendSegmentSize().  For RecvFromBatch() with receive
+  // coalescing on, set to the size of the datagrams coalesced into |buffer|,
+  // all but the last of which have this size, or to 0 if |buffer| holds a
+  // single datagram.
+  int segment_size;
+};
 
 // A datagram socket is an interface to a protocol which exchanges
 // datagrams, like UDP.
@@ -66,6 +66,18 @@ int UDPServerSocket::SendTo(IOBuffer* buf,
   return socket_.SendTo(buf, buf_len, address, std::move(callback));
 }
 
+int UDPServerSocket::RecvFromBatch(DatagramBuffer* datagrams,
+                                   int count,
+                                   CompletionOnceCallback callback) {
+  return socket_.RecvFromBatch(datagrams, count, std::move(callback));
+}
+
+int UDPServerSocket::SendToBatch(const DatagramBuffer* datagrams,
+                                 int count,
+                                 CompletionOnceCallback callback) {
+  return socket_.SendToBatch(datagrams, count, std::move(callback));
+}
+
 int UDPServerSocket::SetReceiveBufferSize(int32_t size) {
   return socket_.SetReceiveBufferSize(size);
 }
@@ -74,6 +86,14 @@ int UDPServerSocket::SetSendBufferSize(int32_t size) {
   return socket_.SetSendBufferSize(size);
 }
 
+int UDPServerSocket::SetSendSegmentSize(int segment_size) {
+  return socket_.SetSendSegmentSize(segment_size);
+}
+
+int UDPServerSocket::SetReceiveCoalescing(bool enable) {
+  return socket_.SetReceiveCoalescing(enable);
+}
+
 int UDPServerSocket::SetDoNotFragment() {
   return socket_.SetDoNotFragment();
 }
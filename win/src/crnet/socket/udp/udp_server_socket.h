@@ -38,8 +38,16 @@ class CRNET_EXPORT UDPServerSocket : public DatagramServerSocket {
              int buf_len,
              const IPEndPoint& address,
              CompletionOnceCallback callback) override;
+  int RecvFromBatch(DatagramBuffer* datagrams,
+                    int count,
+                    CompletionOnceCallback callback) override;
+  int SendToBatch(const DatagramBuffer* datagrams,
+                  int count,
+                  CompletionOnceCallback callback) override;
   int SetReceiveBufferSize(int32_t size) override;
   int SetSendBufferSize(int32_t size) override;
+  int SetSendSegmentSize(int segment_size) override;
+  int SetReceiveCoalescing(bool enable) override;
   int SetDoNotFragment() override;
   void SetMsgConfirm(bool confirm) override;
   void Close() override;
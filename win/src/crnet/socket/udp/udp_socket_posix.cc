@@ -0,0 +1,879 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crnet/socket/udp/udp_socket_posix.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "crbase/logging.h"
+#include "crbase/posix/eintr_wrapper.h"
+#include "crbase/rand_util.h"
+#include "crnet/base/net_errors.h"
+#include "crnet/base/sockaddr_storage.h"
+
+// Older C libraries lack the segmentation offload options.
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace crnet {
+
+namespace {
+
+const int kBindRetries = 10;
+const int kPortStart = 1024;
+const int kPortEnd = 65535;
+
+// Maps the error of setting a segmentation offload option: kernels older than
+// 4.18 (UDP_SEGMENT) or 5.0 (UDP_GRO) do not know them.
+int MapOffloadOptionError(int os_error) {
+  if (os_error == ENOPROTOOPT)
+    return ERR_NOT_IMPLEMENTED;
+  return MapSystemError(os_error);
+}
+
+bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1)
+    return false;
+  if (flags & O_NONBLOCK)
+    return true;
+  return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+}  // namespace
+
+UDPSocketPosix::UDPSocketPosix(DatagramSocket::BindType bind_type)
+    : socket_(kInvalidSocket),
+      addr_family_(0),
+      is_connected_(false),
+      socket_options_(SOCKET_OPTION_MULTICAST_LOOP),
+      sendto_flags_(0),
+      receive_coalescing_(false),
+      multicast_interface_(0),
+      multicast_time_to_live_(1),
+      bind_type_(bind_type),
+      read_buf_len_(0),
+      recv_from_address_(NULL),
+      recv_batch_(NULL),
+      recv_batch_count_(0),
+      write_buf_len_(0) {
+}
+
+UDPSocketPosix::~UDPSocketPosix() {
+  CR_DCHECK(CalledOnValidThread());
+  Close();
+}
+
+int UDPSocketPosix::Open(AddressFamily address_family) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_EQ(socket_, kInvalidSocket);
+
+  addr_family_ = ConvertAddressFamily(address_family);
+  socket_ = CreatePlatformSocket(addr_family_, SOCK_DGRAM, IPPROTO_UDP);
+  if (socket_ == kInvalidSocket)
+    return MapSystemError(errno);
+  if (!SetNonBlocking(socket_)) {
+    int result = MapSystemError(errno);
+    Close();
+    return result;
+  }
+  return OK;
+}
+
+void UDPSocketPosix::Close() {
+  CR_DCHECK(CalledOnValidThread());
+
+  if (socket_ == kInvalidSocket)
+    return;
+
+  // Zero out any pending read/write callback state.
+  read_buf_ = nullptr;
+  read_buf_len_ = 0;
+  recv_from_address_ = nullptr;
+  recv_batch_ = nullptr;
+  recv_batch_count_ = 0;
+  recv_batch_bufs_.clear();
+  read_callback_.Reset();
+
+  write_buf_ = nullptr;
+  write_buf_len_ = 0;
+  send_to_address_.reset();
+  send_batch_.clear();
+  send_batch_bufs_.clear();
+  write_callback_.Reset();
+
+  bool ok = read_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  ok = write_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+
+  if (IGNORE_EINTR(close(socket_)) < 0)
+    CR_PLOG(ERROR) << "close() returned an error, errno=" << errno;
+
+  socket_ = kInvalidSocket;
+  addr_family_ = 0;
+  is_connected_ = false;
+  receive_coalescing_ = false;
+  local_address_.reset();
+  remote_address_.reset();
+}
+
+int UDPSocketPosix::GetPeerAddress(IPEndPoint* address) const {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(address);
+  if (!is_connected())
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  if (!remote_address_.get()) {
+    SockaddrStorage storage;
+    if (getpeername(socket_, storage.addr, &storage.addr_len))
+      return MapSystemError(errno);
+    std::unique_ptr<IPEndPoint> remote_address(new IPEndPoint());
+    if (!remote_address->FromSockAddr(storage.addr, storage.addr_len))
+      return ERR_ADDRESS_INVALID;
+    remote_address_.reset(remote_address.release());
+  }
+
+  *address = *remote_address_;
+  return OK;
+}
+
+int UDPSocketPosix::GetLocalAddress(IPEndPoint* address) const {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(address);
+  if (!is_connected())
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  if (!local_address_.get()) {
+    SockaddrStorage storage;
+    if (getsockname(socket_, storage.addr, &storage.addr_len))
+      return MapSystemError(errno);
+    std::unique_ptr<IPEndPoint> local_address(new IPEndPoint());
+    if (!local_address->FromSockAddr(storage.addr, storage.addr_len))
+      return ERR_ADDRESS_INVALID;
+    local_address_.reset(local_address.release());
+  }
+
+  *address = *local_address_;
+  return OK;
+}
+
+int UDPSocketPosix::Read(IOBuffer* buf,
+                         int buf_len,
+                         CompletionOnceCallback callback) {
+  return RecvFrom(buf, buf_len, NULL, std::move(callback));
+}
+
+int UDPSocketPosix::RecvFrom(IOBuffer* buf,
+                             int buf_len,
+                             IPEndPoint* address,
+                             CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(kInvalidSocket, socket_);
+  CR_CHECK(read_callback_.is_null());
+  CR_DCHECK(!callback.is_null());  // Synchronous operation not supported.
+  CR_DCHECK_GT(buf_len, 0);
+
+  // UDP_GRO applies to every read of the socket, and only RecvFromBatch()
+  // reports the segment boundaries of a coalesced buffer.
+  if (receive_coalescing_) {
+    CR_NOTREACHED() << "RecvFrom() while receive coalescing is on";
+    return ERR_NOT_IMPLEMENTED;
+  }
+
+  int nread = InternalRecvFrom(buf, buf_len, address);
+  if (nread != ERR_IO_PENDING)
+    return nread;
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_READ,
+          &read_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on read";
+    return MapSystemError(errno);
+  }
+
+  read_buf_ = buf;
+  read_buf_len_ = buf_len;
+  recv_from_address_ = address;
+  read_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int UDPSocketPosix::RecvFromBatch(DatagramBuffer* datagrams,
+                                  int count,
+                                  CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(kInvalidSocket, socket_);
+  CR_CHECK(read_callback_.is_null());
+  CR_DCHECK(!callback.is_null());  // Synchronous operation not supported.
+  CR_DCHECK_GT(count, 0);
+
+  if (count > kMaxDatagramBatchSize)
+    count = kMaxDatagramBatchSize;
+
+  int nread = InternalRecvFromBatch(datagrams, count);
+  if (nread != ERR_IO_PENDING)
+    return nread;
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_READ,
+          &read_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on read";
+    return MapSystemError(errno);
+  }
+
+  recv_batch_ = datagrams;
+  recv_batch_count_ = count;
+  for (int i = 0; i < count; ++i)
+    recv_batch_bufs_.push_back(datagrams[i].buffer);
+  read_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int UDPSocketPosix::Write(IOBuffer* buf,
+                          int buf_len,
+                          CompletionOnceCallback callback) {
+  return SendToOrWrite(buf, buf_len, NULL, std::move(callback));
+}
+
+int UDPSocketPosix::SendTo(IOBuffer* buf,
+                           int buf_len,
+                           const IPEndPoint& address,
+                           CompletionOnceCallback callback) {
+  return SendToOrWrite(buf, buf_len, &address, std::move(callback));
+}
+
+int UDPSocketPosix::SendToOrWrite(IOBuffer* buf,
+                                  int buf_len,
+                                  const IPEndPoint* address,
+                                  CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(kInvalidSocket, socket_);
+  CR_CHECK(write_callback_.is_null());
+  CR_DCHECK(!callback.is_null());  // Synchronous operation not supported.
+  CR_DCHECK_GT(buf_len, 0);
+
+  int nwrite = InternalSendTo(buf, buf_len, address);
+  if (nwrite != ERR_IO_PENDING)
+    return nwrite;
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_WRITE,
+          &write_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on write";
+    return MapSystemError(errno);
+  }
+
+  write_buf_ = buf;
+  write_buf_len_ = buf_len;
+  if (address)
+    send_to_address_.reset(new IPEndPoint(*address));
+  write_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int UDPSocketPosix::SendToBatch(const DatagramBuffer* datagrams,
+                                int count,
+                                CompletionOnceCallback callback) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_NE(kInvalidSocket, socket_);
+  CR_CHECK(write_callback_.is_null());
+  CR_DCHECK(!callback.is_null());  // Synchronous operation not supported.
+  CR_DCHECK_GT(count, 0);
+
+  if (count > kMaxDatagramBatchSize)
+    count = kMaxDatagramBatchSize;
+
+  int nwrite = InternalSendToBatch(datagrams, count);
+  if (nwrite != ERR_IO_PENDING)
+    return nwrite;
+
+  if (!cr::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, cr::MessageLoopForIO::WATCH_WRITE,
+          &write_watcher_, this)) {
+    CR_PLOG(ERROR) << "WatchFileDescriptor failed on write";
+    return MapSystemError(errno);
+  }
+
+  send_batch_.assign(datagrams, datagrams + count);
+  for (int i = 0; i < count; ++i)
+    send_batch_bufs_.push_back(datagrams[i].buffer);
+  write_callback_ = std::move(callback);
+  return ERR_IO_PENDING;
+}
+
+int UDPSocketPosix::Connect(const IPEndPoint& address) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  int rv = SetMulticastOptions();
+  if (rv != OK)
+    return rv;
+
+  rv = InternalConnect(address);
+  is_connected_ = (rv == OK);
+  return rv;
+}
+
+int UDPSocketPosix::InternalConnect(const IPEndPoint& address) {
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(!is_connected());
+  CR_DCHECK(!remote_address_.get());
+
+  int rv = 0;
+  if (bind_type_ == DatagramSocket::RANDOM_BIND) {
+    // Construct IPAddress of appropriate size (IPv4 or IPv6) of 0s,
+    // representing INADDR_ANY or in6addr_any.
+    size_t addr_size = (address.GetSockAddrFamily() == AF_INET)
+      ? IPAddress::kIPv4AddressSize
+      : IPAddress::kIPv6AddressSize;
+    rv = RandomBind(IPAddress::AllZeros(addr_size));
+  }
+  // else connect() does the DatagramSocket::DEFAULT_BIND
+
+  if (rv < 0)
+    return rv;
+
+  SockaddrStorage storage;
+  if (!address.ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+
+  rv = HANDLE_EINTR(connect(socket_, storage.addr, storage.addr_len));
+  if (rv < 0)
+    return MapSystemError(errno);
+
+  remote_address_.reset(new IPEndPoint(address));
+  return rv;
+}
+
+int UDPSocketPosix::Bind(const IPEndPoint& address) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(!is_connected());
+
+  int rv = SetMulticastOptions();
+  if (rv < 0)
+    return rv;
+
+  rv = DoBind(address);
+  if (rv < 0)
+    return rv;
+
+  local_address_.reset();
+  is_connected_ = true;
+  return rv;
+}
+
+int UDPSocketPosix::SetReceiveBufferSize(int32_t size) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  return rv == 0 ? OK : MapSystemError(errno);
+}
+
+int UDPSocketPosix::SetSendBufferSize(int32_t size) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  return rv == 0 ? OK : MapSystemError(errno);
+}
+
+int UDPSocketPosix::SetSendSegmentSize(int segment_size) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_GE(segment_size, 0);
+  int rv = setsockopt(socket_, SOL_UDP, UDP_SEGMENT, &segment_size,
+                      sizeof(segment_size));
+  return rv == 0 ? OK : MapOffloadOptionError(errno);
+}
+
+int UDPSocketPosix::SetReceiveCoalescing(bool enable) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+  // A pending RecvFrom() would get coalesced buffers.
+  CR_DCHECK(!enable || read_callback_.is_null() || recv_batch_);
+  int value = enable ? 1 : 0;
+  int rv = setsockopt(socket_, SOL_UDP, UDP_GRO, &value, sizeof(value));
+  if (rv != 0)
+    return MapOffloadOptionError(errno);
+  receive_coalescing_ = enable;
+  return OK;
+}
+
+int UDPSocketPosix::SetDoNotFragment() {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+
+  if (addr_family_ == AF_INET6) {
+    int val = IPV6_PMTUDISC_DO;
+    int rv = setsockopt(socket_, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &val,
+                        sizeof(val));
+    return rv == 0 ? OK : MapSystemError(errno);
+  }
+
+  int val = IP_PMTUDISC_DO;
+  int rv = setsockopt(socket_, IPPROTO_IP, IP_MTU_DISCOVER, &val,
+                      sizeof(val));
+  return rv == 0 ? OK : MapSystemError(errno);
+}
+
+void UDPSocketPosix::SetMsgConfirm(bool confirm) {
+  if (confirm)
+    sendto_flags_ |= MSG_CONFIRM;
+  else
+    sendto_flags_ &= ~MSG_CONFIRM;
+}
+
+int UDPSocketPosix::AllowAddressReuse() {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK(!is_connected());
+
+  int true_value = 1;
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &true_value,
+                      sizeof(true_value));
+  return rv == 0 ? OK : MapSystemError(errno);
+}
+
+int UDPSocketPosix::SetBroadcast(bool broadcast) {
+  CR_DCHECK_NE(socket_, kInvalidSocket);
+  CR_DCHECK(CalledOnValidThread());
+
+  int value = broadcast ? 1 : 0;
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_BROADCAST, &value,
+                      sizeof(value));
+  return rv == 0 ? OK : MapSystemError(errno);
+}
+
+void UDPSocketPosix::OnFileCanReadWithoutBlocking(int fd) {
+  if (!read_callback_.is_null())
+    DidCompleteRead();
+}
+
+void UDPSocketPosix::OnFileCanWriteWithoutBlocking(int fd) {
+  if (!write_callback_.is_null())
+    DidCompleteWrite();
+}
+
+void UDPSocketPosix::DoReadCallback(int rv) {
+  CR_DCHECK_NE(rv, ERR_IO_PENDING);
+  CR_DCHECK(!read_callback_.is_null());
+
+  // Since Run() may result in Read() being called, clear |read_callback_| up
+  // front.
+  std::move(read_callback_).Run(rv);
+}
+
+void UDPSocketPosix::DoWriteCallback(int rv) {
+  CR_DCHECK_NE(rv, ERR_IO_PENDING);
+  CR_DCHECK(!write_callback_.is_null());
+
+  // Since Run() may result in Write() being called, clear |write_callback_|
+  // up front.
+  std::move(write_callback_).Run(rv);
+}
+
+void UDPSocketPosix::DidCompleteRead() {
+  int result = recv_batch_
+      ? InternalRecvFromBatch(recv_batch_, recv_batch_count_)
+      : InternalRecvFrom(read_buf_.get(), read_buf_len_, recv_from_address_);
+  if (result == ERR_IO_PENDING)
+    return;
+
+  read_buf_ = nullptr;
+  read_buf_len_ = 0;
+  recv_from_address_ = nullptr;
+  recv_batch_ = nullptr;
+  recv_batch_count_ = 0;
+  recv_batch_bufs_.clear();
+  bool ok = read_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  DoReadCallback(result);
+}
+
+void UDPSocketPosix::DidCompleteWrite() {
+  int result = !send_batch_.empty()
+      ? InternalSendToBatch(send_batch_.data(),
+                            static_cast<int>(send_batch_.size()))
+      : InternalSendTo(write_buf_.get(), write_buf_len_,
+                       send_to_address_.get());
+  if (result == ERR_IO_PENDING)
+    return;
+
+  write_buf_ = nullptr;
+  write_buf_len_ = 0;
+  send_to_address_.reset();
+  send_batch_.clear();
+  send_batch_bufs_.clear();
+  bool ok = write_watcher_.StopWatchingFileDescriptor();
+  CR_DCHECK(ok);
+  DoWriteCallback(result);
+}
+
+int UDPSocketPosix::InternalRecvFrom(IOBuffer* buf,
+                                     int buf_len,
+                                     IPEndPoint* address) {
+  SockaddrStorage storage;
+  struct iovec iov;
+  iov.iov_base = buf->data();
+  iov.iov_len = buf_len;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = storage.addr;
+  msg.msg_namelen = storage.addr_len;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  int rv = HANDLE_EINTR(recvmsg(socket_, &msg, 0));
+  if (rv < 0)
+    return MapSystemError(errno);
+  if (msg.msg_flags & MSG_TRUNC)
+    return ERR_MSG_TOO_BIG;
+  if (address && !address->FromSockAddr(storage.addr, msg.msg_namelen))
+    return ERR_ADDRESS_INVALID;
+  return rv;
+}
+
+int UDPSocketPosix::InternalSendTo(IOBuffer* buf,
+                                   int buf_len,
+                                   const IPEndPoint* address) {
+  SockaddrStorage storage;
+  struct sockaddr* addr = storage.addr;
+  if (!address) {
+    addr = NULL;
+    storage.addr_len = 0;
+  } else if (!address->ToSockAddr(storage.addr, &storage.addr_len)) {
+    return ERR_ADDRESS_INVALID;
+  }
+
+  int rv = HANDLE_EINTR(sendto(socket_, buf->data(), buf_len, sendto_flags_,
+                               addr, storage.addr_len));
+  if (rv < 0)
+    return MapSystemError(errno);
+  return rv;
+}
+
+int UDPSocketPosix::InternalRecvFromBatch(DatagramBuffer* datagrams,
+                                          int count) {
+  CR_DCHECK_LE(count, kMaxDatagramBatchSize);
+  struct mmsghdr msgs[kMaxDatagramBatchSize];
+  struct iovec iovs[kMaxDatagramBatchSize];
+  struct sockaddr_storage addrs[kMaxDatagramBatchSize];
+  // Room for the UDP_GRO control message of each coalesced buffer.
+  char controls[kMaxDatagramBatchSize][CMSG_SPACE(sizeof(int))];
+  memset(msgs, 0, sizeof(msgs[0]) * count);
+  for (int i = 0; i < count; ++i) {
+    iovs[i].iov_base = datagrams[i].buffer->data();
+    iovs[i].iov_len = datagrams[i].buf_len;
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (receive_coalescing_) {
+      msgs[i].msg_hdr.msg_control = controls[i];
+      msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+    }
+  }
+
+  int rv = HANDLE_EINTR(recvmmsg(socket_, msgs, count, 0, NULL));
+  if (rv < 0)
+    return MapSystemError(errno);
+
+  for (int i = 0; i < rv; ++i) {
+    struct msghdr* hdr = &msgs[i].msg_hdr;
+    DatagramBuffer* datagram = &datagrams[i];
+    datagram->segment_size = 0;
+    if (!datagram->address.FromSockAddr(
+            reinterpret_cast<const struct sockaddr*>(&addrs[i]),
+            hdr->msg_namelen)) {
+      datagram->result = ERR_ADDRESS_INVALID;
+      continue;
+    }
+    if (hdr->msg_flags & MSG_TRUNC) {
+      datagram->result = ERR_MSG_TOO_BIG;
+      continue;
+    }
+    datagram->result = static_cast<int>(msgs[i].msg_len);
+    if (!receive_coalescing_)
+      continue;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg;
+         cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+      if (cmsg->cmsg_level != SOL_UDP || cmsg->cmsg_type != UDP_GRO)
+        continue;
+      int segment_size;
+      memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+      // The kernel also reports a buffer that holds a single datagram.
+      if (segment_size < datagram->result)
+        datagram->segment_size = segment_size;
+    }
+  }
+  return rv;
+}
+
+int UDPSocketPosix::InternalSendToBatch(const DatagramBuffer* datagrams,
+                                        int count) {
+  CR_DCHECK_LE(count, kMaxDatagramBatchSize);
+  struct mmsghdr msgs[kMaxDatagramBatchSize];
+  struct iovec iovs[kMaxDatagramBatchSize];
+  struct sockaddr_storage addrs[kMaxDatagramBatchSize];
+  // Room for the UDP_SEGMENT control message of each segmented datagram.
+  char controls[kMaxDatagramBatchSize][CMSG_SPACE(sizeof(uint16_t))];
+  memset(msgs, 0, sizeof(msgs[0]) * count);
+  for (int i = 0; i < count; ++i) {
+    socklen_t addr_len = sizeof(addrs[i]);
+    if (!datagrams[i].address.ToSockAddr(
+            reinterpret_cast<struct sockaddr*>(&addrs[i]), &addr_len)) {
+      // Send the datagrams before this one, the next call fails on it.
+      if (i == 0)
+        return ERR_ADDRESS_INVALID;
+      count = i;
+      break;
+    }
+    iovs[i].iov_base = datagrams[i].buffer->data();
+    iovs[i].iov_len = datagrams[i].buf_len;
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = addr_len;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+
+    if (datagrams[i].segment_size > 0) {
+      CR_DCHECK_LE(datagrams[i].segment_size, 0xffff);
+      uint16_t segment_size =
+          static_cast<uint16_t>(datagrams[i].segment_size);
+      msgs[i].msg_hdr.msg_control = controls[i];
+      msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(segment_size));
+      memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    }
+  }
+
+  int rv = HANDLE_EINTR(sendmmsg(socket_, msgs, count, sendto_flags_));
+  if (rv < 0)
+    return MapSystemError(errno);
+  return rv;
+}
+
+int UDPSocketPosix::SetMulticastOptions() {
+  if (!(socket_options_ & SOCKET_OPTION_MULTICAST_LOOP)) {
+    int loop = 0;
+    int protocol_level =
+        addr_family_ == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+    int option =
+        addr_family_ == AF_INET ? IP_MULTICAST_LOOP : IPV6_MULTICAST_LOOP;
+    int rv = setsockopt(socket_, protocol_level, option, &loop, sizeof(loop));
+    if (rv < 0)
+      return MapSystemError(errno);
+  }
+  if (multicast_time_to_live_ != 1) {
+    int hops = multicast_time_to_live_;
+    int protocol_level =
+        addr_family_ == AF_INET ? IPPROTO_IP : IPPROTO_IPV6;
+    int option =
+        addr_family_ == AF_INET ? IP_MULTICAST_TTL : IPV6_MULTICAST_HOPS;
+    int rv = setsockopt(socket_, protocol_level, option, &hops, sizeof(hops));
+    if (rv < 0)
+      return MapSystemError(errno);
+  }
+  if (multicast_interface_ != 0) {
+    switch (addr_family_) {
+      case AF_INET: {
+        ip_mreqn mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_ifindex = multicast_interface_;
+        mreq.imr_address.s_addr = htonl(INADDR_ANY);
+        int rv = setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &mreq,
+                            sizeof(mreq));
+        if (rv)
+          return MapSystemError(errno);
+        break;
+      }
+      case AF_INET6: {
+        uint32_t interface_index = multicast_interface_;
+        int rv = setsockopt(socket_, IPPROTO_IPV6, IPV6_MULTICAST_IF,
+                            &interface_index, sizeof(interface_index));
+        if (rv)
+          return MapSystemError(errno);
+        break;
+      }
+      default:
+        CR_NOTREACHED() << "Invalid address family";
+        return ERR_ADDRESS_INVALID;
+    }
+  }
+  return OK;
+}
+
+int UDPSocketPosix::DoBind(const IPEndPoint& address) {
+  SockaddrStorage storage;
+  if (!address.ToSockAddr(storage.addr, &storage.addr_len))
+    return ERR_ADDRESS_INVALID;
+  int rv = bind(socket_, storage.addr, storage.addr_len);
+  if (rv == 0)
+    return OK;
+  int last_error = errno;
+  // EADDRNOTAVAIL is what a bind to a port that is not free may fail with
+  // when SO_REUSEADDR is set; retrying on another port may succeed.
+  if (last_error == EADDRNOTAVAIL)
+    return ERR_ADDRESS_IN_USE;
+  return MapSystemError(last_error);
+}
+
+int UDPSocketPosix::RandomBind(const IPAddress& address) {
+  CR_DCHECK_EQ(bind_type_, DatagramSocket::RANDOM_BIND);
+
+  for (int i = 0; i < kBindRetries; ++i) {
+    int rv = DoBind(IPEndPoint(address, static_cast<uint16_t>(
+        cr::RandInt(kPortStart, kPortEnd))));
+    if (rv == OK || rv != ERR_ADDRESS_IN_USE)
+      return rv;
+  }
+  return DoBind(IPEndPoint(address, 0));
+}
+
+int UDPSocketPosix::JoinGroup(const IPAddress& group_address) const {
+  CR_DCHECK(CalledOnValidThread());
+  if (!is_connected())
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  switch (group_address.size()) {
+    case IPAddress::kIPv4AddressSize: {
+      if (addr_family_ != AF_INET)
+        return ERR_ADDRESS_INVALID;
+      ip_mreqn mreq;
+      memset(&mreq, 0, sizeof(mreq));
+      mreq.imr_ifindex = multicast_interface_;
+      mreq.imr_address.s_addr = htonl(INADDR_ANY);
+      memcpy(&mreq.imr_multiaddr, group_address.bytes().data(),
+             IPAddress::kIPv4AddressSize);
+      int rv = setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq,
+                          sizeof(mreq));
+      if (rv < 0)
+        return MapSystemError(errno);
+      return OK;
+    }
+    case IPAddress::kIPv6AddressSize: {
+      if (addr_family_ != AF_INET6)
+        return ERR_ADDRESS_INVALID;
+      ipv6_mreq mreq;
+      mreq.ipv6mr_interface = multicast_interface_;
+      memcpy(&mreq.ipv6mr_multiaddr, group_address.bytes().data(),
+             IPAddress::kIPv6AddressSize);
+      int rv = setsockopt(socket_, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq,
+                          sizeof(mreq));
+      if (rv < 0)
+        return MapSystemError(errno);
+      return OK;
+    }
+    default:
+      CR_NOTREACHED() << "Invalid address family";
+      return ERR_ADDRESS_INVALID;
+  }
+}
+
+int UDPSocketPosix::LeaveGroup(const IPAddress& group_address) const {
+  CR_DCHECK(CalledOnValidThread());
+  if (!is_connected())
+    return ERR_SOCKET_NOT_CONNECTED;
+
+  switch (group_address.size()) {
+    case IPAddress::kIPv4AddressSize: {
+      if (addr_family_ != AF_INET)
+        return ERR_ADDRESS_INVALID;
+      ip_mreqn mreq;
+      memset(&mreq, 0, sizeof(mreq));
+      mreq.imr_ifindex = multicast_interface_;
+      mreq.imr_address.s_addr = htonl(INADDR_ANY);
+      memcpy(&mreq.imr_multiaddr, group_address.bytes().data(),
+             IPAddress::kIPv4AddressSize);
+      int rv = setsockopt(socket_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq,
+                          sizeof(mreq));
+      if (rv < 0)
+        return MapSystemError(errno);
+      return OK;
+    }
+    case IPAddress::kIPv6AddressSize: {
+      if (addr_family_ != AF_INET6)
+        return ERR_ADDRESS_INVALID;
+      ipv6_mreq mreq;
+      mreq.ipv6mr_interface = multicast_interface_;
+      memcpy(&mreq.ipv6mr_multiaddr, group_address.bytes().data(),
+             IPAddress::kIPv6AddressSize);
+      int rv = setsockopt(socket_, IPPROTO_IPV6, IPV6_LEAVE_GROUP, &mreq,
+                          sizeof(mreq));
+      if (rv < 0)
+        return MapSystemError(errno);
+      return OK;
+    }
+    default:
+      CR_NOTREACHED() << "Invalid address family";
+      return ERR_ADDRESS_INVALID;
+  }
+}
+
+int UDPSocketPosix::SetMulticastInterface(uint32_t interface_index) {
+  CR_DCHECK(CalledOnValidThread());
+  if (is_connected())
+    return ERR_SOCKET_IS_CONNECTED;
+  multicast_interface_ = interface_index;
+  return OK;
+}
+
+int UDPSocketPosix::SetMulticastTimeToLive(int time_to_live) {
+  CR_DCHECK(CalledOnValidThread());
+  if (is_connected())
+    return ERR_SOCKET_IS_CONNECTED;
+
+  if (time_to_live < 0 || time_to_live > 255)
+    return ERR_INVALID_ARGUMENT;
+  multicast_time_to_live_ = time_to_live;
+  return OK;
+}
+
+int UDPSocketPosix::SetMulticastLoopbackMode(bool loopback) {
+  CR_DCHECK(CalledOnValidThread());
+  if (is_connected())
+    return ERR_SOCKET_IS_CONNECTED;
+
+  if (loopback)
+    socket_options_ |= SOCKET_OPTION_MULTICAST_LOOP;
+  else
+    socket_options_ &= ~SOCKET_OPTION_MULTICAST_LOOP;
+  return OK;
+}
+
+int UDPSocketPosix::SetDiffServCodePoint(DiffServCodePoint dscp) {
+  if (dscp == DSCP_NO_CHANGE)
+    return OK;
+
+  // The DSCP is the upper six bits of the traffic class byte.
+  int traffic_class = dscp << 2;
+  int rv = addr_family_ == AF_INET
+      ? setsockopt(socket_, IPPROTO_IP, IP_TOS, &traffic_class,
+                   sizeof(traffic_class))
+      : setsockopt(socket_, IPPROTO_IPV6, IPV6_TCLASS, &traffic_class,
+                   sizeof(traffic_class));
+  return rv == 0 ? OK : MapSystemError(errno);
+}
+
+void UDPSocketPosix::DetachFromThread() {
+  cr::NonThreadSafe::DetachFromThread();
+}
+
+}  // namespace crnet
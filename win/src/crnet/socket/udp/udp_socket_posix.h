@@ -0,0 +1,210 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_CRNET_SOCKET_UDP_UDP_SOCKET_POSIX_H_
+#define MINI_CHROMIUM_SRC_CRNET_SOCKET_UDP_UDP_SOCKET_POSIX_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "crbase/macros.h"
+#include "crbase/memory/ref_counted.h"
+#include "crbase/message_loop/message_loop.h"
+#include "crbase/threading/non_thread_safe.h"
+#include "crnet/base/address_family.h"
+#include "crnet/base/completion_once_callback.h"
+#include "crnet/base/io_buffer.h"
+#include "crnet/base/ip_endpoint.h"
+#include "crnet/base/net_export.h"
+#include "crnet/socket/socket_descriptor.h"
+#include "crnet/socket/udp/datagram_socket.h"
+#include "crnet/socket/udp/diff_serv_code_point.h"
+
+namespace crnet {
+
+class IPAddress;
+
+// A non-blocking UDP socket driven by the epoll pump of the current
+// MessageLoopForIO.  It offers the same interface as UDPSocketWin, see there
+// for the documentation of the methods; the batch methods use recvmmsg() and
+// sendmmsg() to move several datagrams per system call, and segmentation
+// offload uses UDP_SEGMENT and UDP_GRO.
+class CRNET_EXPORT UDPSocketPosix
+    : public cr::NonThreadSafe,
+      public cr::MessageLoopForIO::Watcher {
+ public:
+  UDPSocketPosix(const UDPSocketPosix&) = delete;
+  UDPSocketPosix& operator=(const UDPSocketPosix&) = delete;
+
+  explicit UDPSocketPosix(DatagramSocket::BindType bind_type);
+  ~UDPSocketPosix() override;
+
+  int Open(AddressFamily address_family);
+  int Connect(const IPEndPoint& address);
+  int Bind(const IPEndPoint& address);
+  void Close();
+
+  int GetPeerAddress(IPEndPoint* address) const;
+  int GetLocalAddress(IPEndPoint* address) const;
+
+  // Multiple outstanding read requests are not supported.
+  // Full duplex mode (reading and writing at the same time) is supported.
+  int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int Write(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
+  int RecvFrom(IOBuffer* buf,
+               int buf_len,
+               IPEndPoint* address,
+               CompletionOnceCallback callback);
+  int SendTo(IOBuffer* buf,
+             int buf_len,
+             const IPEndPoint& address,
+             CompletionOnceCallback callback);
+
+  // Receives or sends up to kMaxDatagramBatchSize datagrams with one
+  // recvmmsg() or sendmmsg() call.  See DatagramServerSocket::RecvFromBatch()
+  // and SendToBatch().
+  int RecvFromBatch(DatagramBuffer* datagrams,
+                    int count,
+                    CompletionOnceCallback callback);
+  int SendToBatch(const DatagramBuffer* datagrams,
+                  int count,
+                  CompletionOnceCallback callback);
+
+  int SetReceiveBufferSize(int32_t size);
+  int SetSendBufferSize(int32_t size);
+
+  // Sets UDP_SEGMENT and UDP_GRO.  See
+  // DatagramServerSocket::SetSendSegmentSize() and SetReceiveCoalescing().
+  int SetSendSegmentSize(int segment_size);
+  int SetReceiveCoalescing(bool enable);
+
+  int SetDoNotFragment();
+
+  // Passes MSG_CONFIRM to the sends that follow if |confirm| is true.
+  void SetMsgConfirm(bool confirm);
+
+  bool is_connected() const { return is_connected_; }
+
+  int AllowAddressReuse();
+  int SetBroadcast(bool broadcast);
+
+  int JoinGroup(const IPAddress& group_address) const;
+  int LeaveGroup(const IPAddress& group_address) const;
+  int SetMulticastInterface(uint32_t interface_index);
+  int SetMulticastTimeToLive(int time_to_live);
+  int SetMulticastLoopbackMode(bool loopback);
+
+  // Sets IP_TOS or IPV6_TCLASS.
+  int SetDiffServCodePoint(DiffServCodePoint dscp);
+
+  void DetachFromThread();
+
+ private:
+  enum SocketOptions {
+    SOCKET_OPTION_MULTICAST_LOOP = 1 << 0
+  };
+
+  // cr::MessageLoopForIO::Watcher implementation.
+  void OnFileCanReadWithoutBlocking(int fd) override;
+  void OnFileCanWriteWithoutBlocking(int fd) override;
+
+  void DoReadCallback(int rv);
+  void DoWriteCallback(int rv);
+
+  void DidCompleteRead();
+  void DidCompleteWrite();
+
+  // Same as SendTo(), except that address is passed by pointer
+  // instead of by reference. It is called from Write() with |address|
+  // set to NULL.
+  int SendToOrWrite(IOBuffer* buf,
+                    int buf_len,
+                    const IPEndPoint* address,
+                    CompletionOnceCallback callback);
+
+  int InternalConnect(const IPEndPoint& address);
+
+  // The system calls of the IO methods.  Return ERR_IO_PENDING when the call
+  // would block.
+  int InternalRecvFrom(IOBuffer* buf, int buf_len, IPEndPoint* address);
+  int InternalSendTo(IOBuffer* buf, int buf_len, const IPEndPoint* address);
+  int InternalRecvFromBatch(DatagramBuffer* datagrams, int count);
+  int InternalSendToBatch(const DatagramBuffer* datagrams, int count);
+
+  // Applies |socket_options_| to |socket_|. Should be called before
+  // Bind().
+  int SetMulticastOptions();
+  int DoBind(const IPEndPoint& address);
+  // Binds to a random port on |address|.
+  int RandomBind(const IPAddress& address);
+
+  SocketDescriptor socket_;
+  int addr_family_;
+  bool is_connected_;
+
+  // Bitwise-or'd combination of SocketOptions. Specifies the set of
+  // options that should be applied to |socket_| before Bind().
+  int socket_options_;
+
+  // Flags passed to the send calls.
+  int sendto_flags_;
+
+  // Whether UDP_GRO is set, so that received datagrams may carry the segment
+  // size of a coalesced buffer.
+  bool receive_coalescing_;
+
+  // Multicast interface.
+  uint32_t multicast_interface_;
+
+  // Multicast socket options cached for SetMulticastOption.
+  // Cannot be used after Bind().
+  int multicast_time_to_live_;
+
+  // How to do source port binding, used only when UDPSocket is part of
+  // UDPClientSocket, since UDPServerSocket provides Bind.
+  DatagramSocket::BindType bind_type_;
+
+  // These are mutable since they're just cached copies to make
+  // GetPeerAddress/GetLocalAddress smarter.
+  mutable std::unique_ptr<IPEndPoint> local_address_;
+  mutable std::unique_ptr<IPEndPoint> remote_address_;
+
+  // Watches |socket_| for readability on behalf of a pending read, and for
+  // writability on behalf of a pending write.
+  cr::MessageLoopForIO::FileDescriptorWatcher read_watcher_;
+  cr::MessageLoopForIO::FileDescriptorWatcher write_watcher_;
+
+  // The buffer of a pending Read() or RecvFrom().
+  cr::scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_;
+  IPEndPoint* recv_from_address_;
+
+  // The datagrams of a pending RecvFromBatch(), and references to their
+  // buffers.
+  DatagramBuffer* recv_batch_;
+  int recv_batch_count_;
+  std::vector<cr::scoped_refptr<IOBuffer>> recv_batch_bufs_;
+
+  // The buffer of a pending Write() or SendTo().
+  cr::scoped_refptr<IOBuffer> write_buf_;
+  int write_buf_len_;
+  std::unique_ptr<IPEndPoint> send_to_address_;
+
+  // The datagrams of a pending SendToBatch(), and references to their
+  // buffers.
+  std::vector<DatagramBuffer> send_batch_;
+  std::vector<cr::scoped_refptr<IOBuffer>> send_batch_bufs_;
+
+  // External callback; called when read is complete.
+  CompletionOnceCallback read_callback_;
+
+  // External callback; called when write is complete.
+  CompletionOnceCallback write_callback_;
+};
+
+}  // namespace crnet
+
+#endif  // MINI_CHROMIUM_SRC_CRNET_SOCKET_UDP_UDP_SOCKET_POSIX_H_
@@ -6,6 +6,7 @@
 
 #include <mstcpip.h>
 
+#include "crbase/functional/bind.h"
 #include "crbase/functional/callback.h"
 #include "crbase/lazy_instance.h"
 #include "crbase/logging.h"
@@ -32,6 +33,21 @@ const int kBindRetries = 10;
 const int kPortStart = 1024;
 const int kPortEnd = 65535;
 
+// Completes a RecvFromBatch() or SendToBatch() whose first datagram moved
+// asynchronously.  |rv| is the result of that datagram, which is stored to
+// |result| unless null.
+void DidCompleteFirstOfBatch(int* result,
+                             crnet::CompletionOnceCallback callback,
+                             int rv) {
+  if (rv < 0 && !(result && rv == crnet::ERR_MSG_TOO_BIG)) {
+    std::move(callback).Run(rv);
+    return;
+  }
+  if (result)
+    *result = rv;
+  std::move(callback).Run(1);
+}
+
 }  // namespace
 
 namespace crnet {
@@ -433,6 +449,73 @@ int UDPSocketWin::SendToOrWrite(IOBuffer* buf,
   return ERR_IO_PENDING;
 }
 
+int UDPSocketWin::RecvFromBatch(DatagramBuffer* datagrams,
+                                int count,
+                                CompletionOnceCallback callback) {
+  CR_DCHECK_GT(count, 0);
+  if (count > kMaxDatagramBatchSize)
+    count = kMaxDatagramBatchSize;
+
+  DatagramBuffer* first = &datagrams[0];
+  int rv = RecvFrom(
+      first->buffer, first->buf_len, &first->address,
+      cr::BindOnce(&DidCompleteFirstOfBatch, &first->result,
+                   std::move(callback)));
+  // A truncated datagram is still received, and only fails itself.
+  if (rv < 0 && rv != ERR_MSG_TOO_BIG)
+    return rv;
+  first->result = rv;
+  first->segment_size = 0;
+
+  int received = 1;
+  if (core_)
+    return received;
+  for (; received < count; ++received) {
+    DatagramBuffer* datagram = &datagrams[received];
+    rv = DoRecvFromNonBlocking(datagram->buffer, datagram->buf_len,
+                               &datagram->address);
+    // Another error is left for the next call to return.
+    if (rv < 0 && rv != ERR_MSG_TOO_BIG)
+      break;
+    datagram->result = rv;
+    datagram->segment_size = 0;
+  }
+  return received;
+}
+
+int UDPSocketWin::SendToBatch(const DatagramBuffer* datagrams,
+                              int count,
+                              CompletionOnceCallback callback) {
+  CR_DCHECK_GT(count, 0);
+  if (count > kMaxDatagramBatchSize)
+    count = kMaxDatagramBatchSize;
+  if (datagrams[0].segment_size > 0)
+    return ERR_NOT_IMPLEMENTED;
+
+  int rv = SendTo(datagrams[0].buffer, datagrams[0].buf_len,
+                  datagrams[0].address,
+                  cr::BindOnce(&DidCompleteFirstOfBatch, nullptr,
+                               std::move(callback)));
+  if (rv < 0)
+    return rv;
+
+  int sent = 1;
+  if (core_)
+    return sent;
+  for (; sent < count; ++sent) {
+    const DatagramBuffer& datagram = datagrams[sent];
+    if (datagram.segment_size > 0)
+      break;
+    if (dscp_manager_)
+      dscp_manager_->PrepareForSend(datagram.address);
+    rv = DoSendToNonBlocking(datagram.buffer, datagram.buf_len,
+                             &datagram.address);
+    if (rv < 0)
+      break;
+  }
+  return sent;
+}
+
 int UDPSocketWin::Connect(const IPEndPoint& address) {
   CR_DCHECK_NE(socket_, INVALID_SOCKET);
   int rv = SetMulticastOptions();
@@ -543,6 +626,31 @@ int UDPSocketWin::SetSendBufferSize(int32_t size) {
   return ERR_SOCKET_SEND_BUFFER_SIZE_UNCHANGEABLE;
 }
 
+int UDPSocketWin::SetSendSegmentSize(int segment_size) {
+  CR_DCHECK_NE(socket_, INVALID_SOCKET);
+  CR_DCHECK(CalledOnValidThread());
+  CR_DCHECK_GE(segment_size, 0);
+#if defined(UDP_SEND_MSG_SIZE)
+  DWORD value = static_cast<DWORD>(segment_size);
+  int rv = setsockopt(socket_, IPPROTO_UDP, UDP_SEND_MSG_SIZE,
+                      reinterpret_cast<const char*>(&value), sizeof(value));
+  if (rv == 0)
+    return OK;
+  int os_error = WSAGetLastError();
+  if (os_error == WSAEINVAL || os_error == WSAENOPROTOOPT)
+    return ERR_NOT_IMPLEMENTED;
+  return MapSystemError(os_error);
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+int UDPSocketWin::SetReceiveCoalescing(bool enable) {
+  CR_DCHECK_NE(socket_, INVALID_SOCKET);
+  CR_DCHECK(CalledOnValidThread());
+  return enable ? ERR_NOT_IMPLEMENTED : OK;
+}
+
 int UDPSocketWin::SetDoNotFragment() {
   CR_DCHECK_NE(socket_, INVALID_SOCKET);
   CR_DCHECK(CalledOnValidThread());
@@ -830,6 +938,31 @@ int UDPSocketWin::InternalRecvFromNonBlocking(IOBuffer* buf,
                                               int buf_len,
                                               IPEndPoint* address) {
   CR_DCHECK(!read_iobuffer_ || read_iobuffer_.get() == buf);
+  int rv = DoRecvFromNonBlocking(buf, buf_len, address);
+  if (rv == ERR_IO_PENDING) {
+    read_iobuffer_ = buf;
+    read_iobuffer_len_ = buf_len;
+    WatchForReadWrite();
+  }
+  return rv;
+}
+
+int UDPSocketWin::InternalSendToNonBlocking(IOBuffer* buf,
+                                            int buf_len,
+                                            const IPEndPoint* address) {
+  CR_DCHECK(!write_iobuffer_ || write_iobuffer_.get() == buf);
+  int rv = DoSendToNonBlocking(buf, buf_len, address);
+  if (rv == ERR_IO_PENDING) {
+    write_iobuffer_ = buf;
+    write_iobuffer_len_ = buf_len;
+    WatchForReadWrite();
+  }
+  return rv;
+}
+
+int UDPSocketWin::DoRecvFromNonBlocking(IOBuffer* buf,
+                                        int buf_len,
+                                        IPEndPoint* address) {
   SockaddrStorage storage;
   storage.addr_len = sizeof(storage.addr_storage);
 
@@ -838,12 +971,8 @@ int UDPSocketWin::InternalRecvFromNonBlocking(IOBuffer* buf,
                     &storage.addr_len);
   if (rv == SOCKET_ERROR) {
     int os_error = WSAGetLastError();
-    if (os_error == WSAEWOULDBLOCK) {
-      read_iobuffer_ = buf;
-      read_iobuffer_len_ = buf_len;
-      WatchForReadWrite();
+    if (os_error == WSAEWOULDBLOCK)
       return ERR_IO_PENDING;
-    }
     rv = MapSystemError(os_error);
     LogRead(rv, NULL, NULL);
     return rv;
@@ -863,10 +992,9 @@ int UDPSocketWin::InternalRecvFromNonBlocking(IOBuffer* buf,
   return rv;
 }
 
-int UDPSocketWin::InternalSendToNonBlocking(IOBuffer* buf,
-                                            int buf_len,
-                                            const IPEndPoint* address) {
-  CR_DCHECK(!write_iobuffer_ || write_iobuffer_.get() == buf);
+int UDPSocketWin::DoSendToNonBlocking(IOBuffer* buf,
+                                      int buf_len,
+                                      const IPEndPoint* address) {
   SockaddrStorage storage;
   struct sockaddr* addr = storage.addr;
   // Convert address.
@@ -884,12 +1012,8 @@ int UDPSocketWin::InternalSendToNonBlocking(IOBuffer* buf,
   int rv = sendto(socket_, buf->data(), buf_len, 0, addr, storage.addr_len);
   if (rv == SOCKET_ERROR) {
     int os_error = WSAGetLastError();
-    if (os_error == WSAEWOULDBLOCK) {
-      write_iobuffer_ = buf;
-      write_iobuffer_len_ = buf_len;
-      WatchForReadWrite();
+    if (os_error == WSAEWOULDBLOCK)
       return ERR_IO_PENDING;
-    }
     rv = MapSystemError(os_error);
     LogWrite(rv, NULL, NULL);
     return rv;
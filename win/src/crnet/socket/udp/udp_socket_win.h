@@ -240,6 +240,22 @@ class CRNET_EXPORT UDPSocketWin
              const IPEndPoint& address,
              CompletionOnceCallback callback);
 
+  // Batch versions of RecvFrom() and SendTo(), see
+  // DatagramServerSocket::RecvFromBatch() and SendToBatch().  Windows has no
+  // recvmmsg() or sendmmsg(): the first datagram moves as by RecvFrom() or
+  // SendTo(), and if that completes synchronously and UseNonBlockingIO() was
+  // called, so do the datagrams after it, for as long as they do not block,
+  // with one system call each but no callback.  With overlapped IO these
+  // move one datagram per call.  A datagram to send with a |segment_size|
+  // is not supported: SendToBatch() stops before it, or returns
+  // ERR_NOT_IMPLEMENTED if it is the first.
+  int RecvFromBatch(DatagramBuffer* datagrams,
+                    int count,
+                    CompletionOnceCallback callback);
+  int SendToBatch(const DatagramBuffer* datagrams,
+                  int count,
+                  CompletionOnceCallback callback);
+
   // Sets the receive buffer size (in bytes) for the socket.
   // Returns a net error code.
   int SetReceiveBufferSize(int32_t size);
@@ -247,7 +263,15 @@ class CRNET_EXPORT UDPSocketWin
   // Sets the send buffer size (in bytes) for the socket.
   // Returns a net error code.
   int SetSendBufferSize(int32_t size);
-  
+
+  // Sets UDP_SEND_MSG_SIZE, where the SDK has it, for UDP segmentation
+  // offload on send.  Returns ERR_NOT_IMPLEMENTED before Windows 10 1703.
+  int SetSendSegmentSize(int segment_size);
+
+  // Returns ERR_NOT_IMPLEMENTED: UDP_RECV_MAX_COALESCED_SIZE reports the
+  // segment size only through WSARecvMsg(), which this socket does not use.
+  int SetReceiveCoalescing(bool enable);
+
   // Requests that packets sent by this socket not be fragment, either locally
   // by the host, or by routers (via the DF bit in the IPv4 packet header).
   // May not be supported by all platforms. Returns a return a network error
@@ -377,6 +401,13 @@ class CRNET_EXPORT UDPSocketWin
                                 int buf_len,
                                 const IPEndPoint* address);
 
+  // The recvfrom() and sendto() calls of the above.  Return ERR_IO_PENDING
+  // when the call would block, without waiting for the socket.
+  int DoRecvFromNonBlocking(IOBuffer* buf, int buf_len, IPEndPoint* address);
+  int DoSendToNonBlocking(IOBuffer* buf,
+                          int buf_len,
+                          const IPEndPoint* address);
+
   // Applies |socket_options_| to |socket_|. Should be called before
   // Bind().
   int SetMulticastOptions();
@@ -0,0 +1,88 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "examples/benchmarks/benchmark.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "crbase/threading/platform_thread.h"
+#include "crbase/threading/simple_thread.h"
+
+namespace benchmarks {
+
+namespace {
+
+class StartingGateDelegate : public cr::DelegateSimpleThread::Delegate {
+ public:
+  StartingGateDelegate(int index,
+                       const cr::RepeatingCallback<void(int)>& body,
+                       std::atomic<int>* ready,
+                       std::atomic<bool>* go)
+      : index_(index), body_(body), ready_(ready), go_(go) {}
+
+  void Run() override {
+    ready_->fetch_add(1);
+    while (!go_->load(std::memory_order_acquire))
+      cr::PlatformThread::YieldCurrentThread();
+    body_.Run(index_);
+  }
+
+ private:
+  const int index_;
+  const cr::RepeatingCallback<void(int)>& body_;
+  std::atomic<int>* ready_;
+  std::atomic<bool>* go_;
+};
+
+}  // namespace
+
+void PrintResult(const std::string& name,
+                 int64_t operations,
+                 cr::TimeDelta elapsed) {
+  double ns_per_op = operations ?
+      elapsed.InMicroseconds() * 1000.0 / operations : 0;
+  std::cout << std::left << std::setw(48) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1)
+            << ns_per_op << " ns/op  (" << operations << " ops in "
+            << elapsed.InMilliseconds() << " ms)" << std::endl;
+}
+
+void PrintCount(const std::string& name,
+                const std::string& unit,
+                int64_t operations,
+                int64_t count) {
+  double per_op = operations ? static_cast<double>(count) / operations : 0;
+  std::cout << std::left << std::setw(48) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(2)
+            << per_op << " " << unit << "/op  (" << count << " in "
+            << operations << " ops)" << std::endl;
+}
+
+cr::TimeDelta RunOnThreads(int thread_count,
+                           const cr::RepeatingCallback<void(int)>& body) {
+  std::atomic<int> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::unique_ptr<StartingGateDelegate>> delegates;
+  std::vector<std::unique_ptr<cr::DelegateSimpleThread>> threads;
+  for (int i = 0; i < thread_count; ++i) {
+    delegates.emplace_back(new StartingGateDelegate(i, body, &ready, &go));
+    threads.emplace_back(
+        new cr::DelegateSimpleThread(delegates.back().get(), "benchmark"));
+    threads.back()->Start();
+  }
+
+  while (ready.load() < thread_count)
+    cr::PlatformThread::YieldCurrentThread();
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  go.store(true, std::memory_order_release);
+  for (auto& thread : threads)
+    thread->Join();
+  return cr::TimeTicks::Now() - start;
+}
+
+}  // namespace benchmarks
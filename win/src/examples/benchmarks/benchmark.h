@@ -0,0 +1,48 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MINI_CHROMIUM_SRC_EXAMPLES_BENCHMARKS_BENCHMARK_H_
+#define MINI_CHROMIUM_SRC_EXAMPLES_BENCHMARKS_BENCHMARK_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "crbase/functional/callback.h"
+#include "crbase/time/time.h"
+
+namespace benchmarks {
+
+// Prints one result line: the time per operation and the totals it was
+// computed from.
+void PrintResult(const std::string& name,
+                 int64_t operations,
+                 cr::TimeDelta elapsed);
+
+// Prints one result line with a count per operation, e.g. heap allocations.
+void PrintCount(const std::string& name,
+                const std::string& unit,
+                int64_t operations,
+                int64_t count);
+
+// Runs |body| on |thread_count| threads, passing each its index.  The threads
+// are released together once all of them have started; the returned time
+// goes from that release to the last thread finishing.
+cr::TimeDelta RunOnThreads(int thread_count,
+                           const cr::RepeatingCallback<void(int)>& body);
+
+// Benchmark suites, one per file.  Each prints its own results.
+void RunArenaBenchmarks();
+void RunCallbackBenchmarks();
+void RunMessageLoopCurrentBenchmarks();
+void RunMpscQueueBenchmarks();
+void RunPoolAllocatorBenchmarks();
+void RunPostTasksBenchmarks();
+void RunRefCountedBiasedBenchmarks();
+void RunStreamConnectionBenchmarks();
+void RunWorkStealingBenchmarks();
+
+}  // namespace benchmarks
+
+#endif  // MINI_CHROMIUM_SRC_EXAMPLES_BENCHMARKS_BENCHMARK_H_
@@ -0,0 +1,24 @@
+#include <iostream>
+
+#include "crbase/at_exit.h"
+#include "crbase/import_libs.cc"
+#include "examples/benchmarks/benchmark.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  cr::AtExitManager at_exit;
+
+  benchmarks::RunArenaBenchmarks();
+  benchmarks::RunCallbackBenchmarks();
+  benchmarks::RunMessageLoopCurrentBenchmarks();
+  benchmarks::RunMpscQueueBenchmarks();
+  benchmarks::RunPoolAllocatorBenchmarks();
+  benchmarks::RunPostTasksBenchmarks();
+  benchmarks::RunRefCountedBiasedBenchmarks();
+  benchmarks::RunStreamConnectionBenchmarks();
+  benchmarks::RunWorkStealingBenchmarks();
+
+  std::system("pause");
+  return 0;
+}
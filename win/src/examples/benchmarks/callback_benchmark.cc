@@ -0,0 +1,94 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Cost of binding a callback and running it once, and of moving a bound
+// OnceCallback, for the receivers tasks are usually bound to.  The BindState
+// of a OnceCallback is stored inline for Unretained() and scoped_refptr
+// receivers, and on the heap for a WeakPtr receiver and for every
+// RepeatingCallback.
+
+#include <utility>
+
+#include "crbase/functional/bind.h"
+#include "crbase/functional/callback.h"
+#include "crbase/memory/ref_counted.h"
+#include "crbase/memory/weak_ptr.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kIterations = 1 << 22;
+
+class Receiver : public cr::RefCountedThreadSafe<Receiver> {
+ public:
+  Receiver() : count_(0), weak_factory_(this) {}
+
+  void Increment() { ++count_; }
+  void Add(int value) { count_ += value; }
+
+  cr::WeakPtr<Receiver> GetWeakPtr() { return weak_factory_.GetWeakPtr(); }
+
+ private:
+  friend class cr::RefCountedThreadSafe<Receiver>;
+  ~Receiver() {}
+
+  int count_;
+  cr::WeakPtrFactory<Receiver> weak_factory_;
+};
+
+template <typename MakeCallback>
+cr::TimeDelta BindAndRun(MakeCallback make_callback) {
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i)
+    std::move(make_callback()).Run();
+  return cr::TimeTicks::Now() - start;
+}
+
+// Moves one callback back and forth between two.
+cr::TimeDelta MoveOnce(cr::OnceClosure callback) {
+  cr::OnceClosure other;
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kIterations / 2; ++i) {
+    other = std::move(callback);
+    callback = std::move(other);
+  }
+  return cr::TimeTicks::Now() - start;
+}
+
+}  // namespace
+
+void RunCallbackBenchmarks() {
+  cr::scoped_refptr<Receiver> receiver = cr::MakeRefCounted<Receiver>();
+  Receiver* raw = receiver.get();
+
+  PrintResult("BindOnce+Run/Unretained", kIterations, BindAndRun([raw] {
+    return cr::BindOnce(&Receiver::Increment, cr::Unretained(raw));
+  }));
+  PrintResult("BindOnce+Run/Unretained+int", kIterations, BindAndRun([raw] {
+    return cr::BindOnce(&Receiver::Add, cr::Unretained(raw), 1);
+  }));
+  PrintResult("BindOnce+Run/scoped_refptr", kIterations,
+              BindAndRun([&receiver] {
+    return cr::BindOnce(&Receiver::Increment, receiver);
+  }));
+  PrintResult("BindOnce+Run/WeakPtr", kIterations, BindAndRun([raw] {
+    return cr::BindOnce(&Receiver::Increment, raw->GetWeakPtr());
+  }));
+  PrintResult("BindRepeating+Run/Unretained", kIterations, BindAndRun([raw] {
+    return cr::BindRepeating(&Receiver::Increment, cr::Unretained(raw));
+  }));
+
+  PrintResult("OnceClosure move/Unretained", kIterations,
+              MoveOnce(cr::BindOnce(&Receiver::Increment,
+                                    cr::Unretained(raw))));
+  PrintResult("OnceClosure move/scoped_refptr", kIterations,
+              MoveOnce(cr::BindOnce(&Receiver::Increment, receiver)));
+  PrintResult("OnceClosure move/WeakPtr", kIterations,
+              MoveOnce(cr::BindOnce(&Receiver::Increment,
+                                    raw->GetWeakPtr())));
+}
+
+}  // namespace benchmarks
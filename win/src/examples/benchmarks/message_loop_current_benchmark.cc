@@ -0,0 +1,107 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Lookups of the current thread's MessageLoop and task runner, which go
+// through ThreadLocalPointer, against a ThreadLocalStorage::Slot.  Also times
+// creating and deleting ThreadLocalPointers, then reads one created after
+// that churn, which should still get a fast slot.
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "crbase/message_loop/message_loop.h"
+#include "crbase/threading/thread_local.h"
+#include "crbase/threading/thread_local_storage.h"
+#include "crbase/threading/thread_task_runner_handle.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kLookups = 1 << 24;
+const int kSlotChurn = 1 << 12;
+
+// Sums the lookups so that they are not optimized away.
+volatile uintptr_t g_sink;
+
+cr::TimeDelta MessageLoopCurrent() {
+  uintptr_t sum = 0;
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kLookups; ++i)
+    sum += reinterpret_cast<uintptr_t>(cr::MessageLoop::current());
+  cr::TimeDelta elapsed = cr::TimeTicks::Now() - start;
+  g_sink = sum;
+  return elapsed;
+}
+
+cr::TimeDelta TaskRunnerHandleIsSet() {
+  uintptr_t sum = 0;
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kLookups; ++i)
+    sum += cr::ThreadTaskRunnerHandle::IsSet();
+  cr::TimeDelta elapsed = cr::TimeTicks::Now() - start;
+  g_sink = sum;
+  return elapsed;
+}
+
+cr::TimeDelta StorageSlotGet() {
+  cr::ThreadLocalStorage::Slot slot;
+  slot.Set(&slot);
+  uintptr_t sum = 0;
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kLookups; ++i)
+    sum += reinterpret_cast<uintptr_t>(slot.Get());
+  cr::TimeDelta elapsed = cr::TimeTicks::Now() - start;
+  g_sink = sum;
+  return elapsed;
+}
+
+// Read through a volatile pointer so the load is not hoisted out of the loop.
+cr::TimeDelta PointerGet(cr::ThreadLocalPointer<int>* pointer) {
+  int value = 0;
+  pointer->Set(&value);
+  cr::ThreadLocalPointer<int>* volatile volatile_pointer = pointer;
+  uintptr_t sum = 0;
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kLookups; ++i)
+    sum += reinterpret_cast<uintptr_t>(volatile_pointer->Get());
+  cr::TimeDelta elapsed = cr::TimeTicks::Now() - start;
+  g_sink = sum;
+  pointer->Set(nullptr);
+  return elapsed;
+}
+
+cr::TimeDelta PointerChurn() {
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kSlotChurn; ++i)
+    std::unique_ptr<cr::ThreadLocalPointer<int>>(
+        new cr::ThreadLocalPointer<int>);
+  return cr::TimeTicks::Now() - start;
+}
+
+}  // namespace
+
+void RunMessageLoopCurrentBenchmarks() {
+  cr::MessageLoop message_loop;
+
+  PrintResult("MessageLoop::current()", kLookups, MessageLoopCurrent());
+  PrintResult("ThreadTaskRunnerHandle::IsSet()", kLookups,
+              TaskRunnerHandleIsSet());
+  PrintResult("ThreadLocalStorage::Slot::Get()", kLookups, StorageSlotGet());
+
+  {
+    cr::ThreadLocalPointer<int> pointer;
+    PrintResult("ThreadLocalPointer::Get()", kLookups, PointerGet(&pointer));
+  }
+  PrintResult("ThreadLocalPointer create+delete", kSlotChurn, PointerChurn());
+  {
+    cr::ThreadLocalPointer<int> pointer;
+    PrintResult("ThreadLocalPointer::Get()/after churn", kLookups,
+                PointerGet(&pointer));
+  }
+}
+
+}  // namespace benchmarks
@@ -0,0 +1,133 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Fan-in of several producer threads into one consumer, through cr::MpscQueue
+// and through the std::queue + Lock pair IncomingTaskQueue used before it.
+// The consumer drains like ReloadWorkQueue(): the locked variant swaps the
+// whole queue out under the lock, the MPSC variant pops until empty.
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "crbase/containers/mpsc_queue.h"
+#include "crbase/functional/bind.h"
+#include "crbase/strings/string_number_conversions.h"
+#include "crbase/synchronization/lock.h"
+#include "crbase/threading/platform_thread.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kItemsPerProducer = 200000;
+
+struct Item : public cr::MpscQueueNode {
+  int producer;
+};
+
+class LockedQueue {
+ public:
+  void Push(Item* item) {
+    cr::AutoLock lock(lock_);
+    queue_.push(item);
+  }
+
+  // Moves everything posted so far to |work_queue|, like ReloadWorkQueue().
+  void Reload(std::queue<Item*>* work_queue) {
+    cr::AutoLock lock(lock_);
+    queue_.swap(*work_queue);
+  }
+
+ private:
+  cr::Lock lock_;
+  std::queue<Item*> queue_;
+};
+
+class FanInBenchmark {
+ public:
+  explicit FanInBenchmark(int producers)
+      : producers_(producers),
+        items_(producers * kItemsPerProducer) {
+    for (size_t i = 0; i < items_.size(); ++i)
+      items_[i].producer = static_cast<int>(i / kItemsPerProducer);
+  }
+
+  cr::TimeDelta RunMpsc() {
+    return RunOnThreads(producers_ + 1,
+        cr::BindRepeating(&FanInBenchmark::MpscThread,
+                          cr::Unretained(this)));
+  }
+
+  cr::TimeDelta RunLocked() {
+    return RunOnThreads(producers_ + 1,
+        cr::BindRepeating(&FanInBenchmark::LockedThread,
+                          cr::Unretained(this)));
+  }
+
+  int64_t operations() const { return static_cast<int64_t>(items_.size()); }
+
+ private:
+  // Thread 0 consumes, the others produce.
+  void MpscThread(int index) {
+    if (index) {
+      Item* items = &items_[(index - 1) * kItemsPerProducer];
+      for (int i = 0; i < kItemsPerProducer; ++i)
+        mpsc_queue_.Push(&items[i]);
+      return;
+    }
+    size_t drained = 0;
+    while (drained < items_.size()) {
+      if (!mpsc_queue_.Pop()) {
+        cr::PlatformThread::YieldCurrentThread();
+        continue;
+      }
+      ++drained;
+    }
+  }
+
+  void LockedThread(int index) {
+    if (index) {
+      Item* items = &items_[(index - 1) * kItemsPerProducer];
+      for (int i = 0; i < kItemsPerProducer; ++i)
+        locked_queue_.Push(&items[i]);
+      return;
+    }
+    size_t drained = 0;
+    std::queue<Item*> work_queue;
+    while (drained < items_.size()) {
+      locked_queue_.Reload(&work_queue);
+      if (work_queue.empty()) {
+        cr::PlatformThread::YieldCurrentThread();
+        continue;
+      }
+      while (!work_queue.empty()) {
+        work_queue.pop();
+        ++drained;
+      }
+    }
+  }
+
+  const int producers_;
+  std::vector<Item> items_;
+  cr::MpscQueue<Item> mpsc_queue_;
+  LockedQueue locked_queue_;
+};
+
+}  // namespace
+
+void RunMpscQueueBenchmarks() {
+  const int kProducerCounts[] = {1, 4, 16};
+  for (int producers : kProducerCounts) {
+    FanInBenchmark benchmark(producers);
+    std::string suffix = "/" + cr::IntToString(producers) + " producers";
+    PrintResult("MpscQueue post+drain" + suffix, benchmark.operations(),
+                benchmark.RunMpsc());
+    PrintResult("Lock+std::queue post+drain" + suffix,
+                benchmark.operations(), benchmark.RunLocked());
+  }
+}
+
+}  // namespace benchmarks
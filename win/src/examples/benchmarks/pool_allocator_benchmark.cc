@@ -0,0 +1,193 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Heap allocations per posted task, and the cost of PoolAlloc()/PoolFree()
+// against operator new/delete, with the block freed on the allocating thread
+// and on another thread.
+//
+// The allocations are counted by replacing the global operator new of this
+// executable.  The slabs the pools carve their blocks from come from malloc()
+// and are not counted; after the warm-up round there are none left to carve.
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "crbase/containers/mpsc_queue.h"
+#include "crbase/functional/bind.h"
+#include "crbase/memory/pool_allocator.h"
+#include "crbase/strings/string_number_conversions.h"
+#include "crbase/synchronization/waitable_event.h"
+#include "crbase/threading/platform_thread.h"
+#include "crbase/threading/thread.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace {
+
+std::atomic<int64_t> g_heap_allocations(0);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+namespace benchmarks {
+
+namespace {
+
+const int kTaskCount = 1 << 16;
+const int kBlockCount = 1 << 20;
+const int kLiveBlocks = 64;
+
+int64_t HeapAllocations() {
+  return g_heap_allocations.load(std::memory_order_relaxed);
+}
+
+class PostTaskAllocations {
+ public:
+  PostTaskAllocations()
+      : thread_("benchmark"), remaining_(0), done_(true, false) {
+    thread_.Start();
+  }
+
+  ~PostTaskAllocations() {
+    thread_.Stop();
+  }
+
+  // Returns the heap allocations made while posting and running
+  // kTaskCount tasks.
+  int64_t Run() {
+    cr::scoped_refptr<cr::SingleThreadTaskRunner> task_runner =
+        thread_.task_runner();
+    remaining_.store(kTaskCount);
+    done_.Reset();
+
+    int64_t start = HeapAllocations();
+    for (int i = 0; i < kTaskCount; ++i) {
+      task_runner->PostTask(CR_FROM_HERE,
+                            cr::BindOnce(&PostTaskAllocations::RunTask,
+                                         cr::Unretained(this), i));
+    }
+    done_.Wait();
+    return HeapAllocations() - start;
+  }
+
+ private:
+  void RunTask(int value) {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      done_.Signal();
+  }
+
+  cr::Thread thread_;
+  std::atomic<int> remaining_;
+  cr::WaitableEvent done_;
+};
+
+void* NewBlock(size_t size) { return ::operator new(size); }
+void DeleteBlock(void* block, size_t size) { ::operator delete(block); }
+
+typedef void* (*AllocFunction)(size_t size);
+typedef void (*FreeFunction)(void* block, size_t size);
+
+// Allocates kLiveBlocks blocks of |size| bytes and frees them, until
+// kBlockCount blocks have gone through.
+cr::TimeDelta AllocSameThread(AllocFunction alloc_function,
+                              FreeFunction free_function,
+                              size_t size) {
+  void* blocks[kLiveBlocks];
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int round = 0; round < kBlockCount / kLiveBlocks; ++round) {
+    for (int i = 0; i < kLiveBlocks; ++i)
+      blocks[i] = alloc_function(size);
+    for (int i = 0; i < kLiveBlocks; ++i)
+      free_function(blocks[i], size);
+  }
+  return cr::TimeTicks::Now() - start;
+}
+
+struct Block : public cr::MpscQueueNode {};
+
+// One thread allocates blocks and hands them to another, which frees them,
+// like a task posted on one thread and run on another.
+class CrossThreadBenchmark {
+ public:
+  CrossThreadBenchmark(AllocFunction alloc_function,
+                       FreeFunction free_function,
+                       size_t size)
+      : alloc_function_(alloc_function),
+        free_function_(free_function),
+        size_(size) {}
+
+  cr::TimeDelta Run() {
+    return RunOnThreads(2, cr::BindRepeating(&CrossThreadBenchmark::Thread,
+                                             cr::Unretained(this)));
+  }
+
+ private:
+  void Thread(int index) {
+    if (index) {
+      for (int i = 0; i < kBlockCount; ++i)
+        queue_.Push(new (alloc_function_(size_)) Block);
+      return;
+    }
+    for (int freed = 0; freed < kBlockCount;) {
+      Block* block = queue_.Pop();
+      if (!block) {
+        cr::PlatformThread::YieldCurrentThread();
+        continue;
+      }
+      free_function_(block, size_);
+      ++freed;
+    }
+  }
+
+  const AllocFunction alloc_function_;
+  const FreeFunction free_function_;
+  const size_t size_;
+  cr::MpscQueue<Block> queue_;
+};
+
+}  // namespace
+
+void RunPoolAllocatorBenchmarks() {
+  {
+    PostTaskAllocations benchmark;
+    benchmark.Run();  // Warm up the pools.
+    PrintCount("PostTask heap allocations", "allocs", kTaskCount,
+               benchmark.Run());
+  }
+
+  const size_t kSizes[] = {32, 128, 256};
+  for (size_t size : kSizes) {
+    std::string suffix = "/" + cr::IntToString(static_cast<int>(size)) + " B";
+    PrintResult("PoolAlloc+PoolFree" + suffix, kBlockCount,
+                AllocSameThread(&cr::PoolAlloc, &cr::PoolFree, size));
+    PrintResult("operator new+delete" + suffix, kBlockCount,
+                AllocSameThread(&NewBlock, &DeleteBlock, size));
+  }
+
+  for (size_t size : kSizes) {
+    std::string suffix = "/" + cr::IntToString(static_cast<int>(size)) +
+                         " B cross-thread";
+    PrintResult("PoolAlloc+PoolFree" + suffix, kBlockCount,
+                CrossThreadBenchmark(&cr::PoolAlloc, &cr::PoolFree, size)
+                    .Run());
+    PrintResult("operator new+delete" + suffix, kBlockCount,
+                CrossThreadBenchmark(&NewBlock, &DeleteBlock, size).Run());
+  }
+}
+
+}  // namespace benchmarks
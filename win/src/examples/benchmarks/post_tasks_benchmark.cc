@@ -0,0 +1,90 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Per-task cost of posting to another thread's MessageLoop, one PostTask()
+// at a time and with PostTasks() batches of 1 to 1024 tasks.  The time runs
+// until the last task has run on the target thread.
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "crbase/functional/bind.h"
+#include "crbase/strings/string_number_conversions.h"
+#include "crbase/synchronization/waitable_event.h"
+#include "crbase/threading/thread.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kTaskCount = 1 << 18;
+
+class PostTasksBenchmark {
+ public:
+  PostTasksBenchmark()
+      : thread_("benchmark"), remaining_(0), done_(true, false) {
+    thread_.Start();
+  }
+
+  ~PostTasksBenchmark() {
+    thread_.Stop();
+  }
+
+  // |batch_size| 0 posts with PostTask().
+  cr::TimeDelta Run(size_t batch_size) {
+    cr::scoped_refptr<cr::SingleThreadTaskRunner> task_runner =
+        thread_.task_runner();
+    remaining_.store(kTaskCount);
+    done_.Reset();
+
+    cr::TimeTicks start = cr::TimeTicks::Now();
+    if (!batch_size) {
+      for (int i = 0; i < kTaskCount; ++i) {
+        task_runner->PostTask(CR_FROM_HERE,
+                              cr::BindOnce(&PostTasksBenchmark::RunTask,
+                                           cr::Unretained(this)));
+      }
+    } else {
+      for (int posted = 0; posted < kTaskCount;) {
+        std::vector<cr::OnceClosure> tasks;
+        tasks.reserve(batch_size);
+        for (size_t i = 0; i < batch_size && posted < kTaskCount;
+             ++i, ++posted) {
+          tasks.push_back(cr::BindOnce(&PostTasksBenchmark::RunTask,
+                                       cr::Unretained(this)));
+        }
+        task_runner->PostTasks(CR_FROM_HERE, std::move(tasks));
+      }
+    }
+    done_.Wait();
+    return cr::TimeTicks::Now() - start;
+  }
+
+ private:
+  void RunTask() {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      done_.Signal();
+  }
+
+  cr::Thread thread_;
+  std::atomic<int> remaining_;
+  cr::WaitableEvent done_;
+};
+
+}  // namespace
+
+void RunPostTasksBenchmarks() {
+  PostTasksBenchmark benchmark;
+  PrintResult("PostTask", kTaskCount, benchmark.Run(0));
+  for (size_t batch_size = 1; batch_size <= 1024; batch_size *= 4) {
+    PrintResult(
+        "PostTasks/batch of " + cr::IntToString(static_cast<int>(batch_size)),
+        kTaskCount, benchmark.Run(batch_size));
+  }
+}
+
+}  // namespace benchmarks
@@ -0,0 +1,107 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// AddRef()+Release() pairs on RefCountedThreadSafe and RefCountedBiased
+// objects: on the creating thread, which is the case biased counting is for,
+// and from 1 to 16 other threads at once on one shared object, which take
+// the atomic path of both.  Also times creating and deleting an object, which
+// for RefCountedBiased looks up the creating thread's task runner.
+
+#include <string>
+
+#include "crbase/functional/bind.h"
+#include "crbase/memory/ref_counted.h"
+#include "crbase/memory/ref_counted_biased.h"
+#include "crbase/message_loop/message_loop.h"
+#include "crbase/run_loop.h"
+#include "crbase/strings/string_number_conversions.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kPairs = 1 << 22;
+const int kPairsPerThread = 1 << 20;
+const int kObjects = 1 << 20;
+
+class ThreadSafeObject : public cr::RefCountedThreadSafe<ThreadSafeObject> {
+ private:
+  friend class cr::RefCountedThreadSafe<ThreadSafeObject>;
+  ~ThreadSafeObject() {}
+};
+
+class BiasedObject : public cr::RefCountedBiased<BiasedObject> {
+ private:
+  friend class cr::RefCountedBiased<BiasedObject>;
+  ~BiasedObject() {}
+};
+
+template <typename T>
+void AddRefRelease(const T* object, int pairs) {
+  for (int i = 0; i < pairs; ++i) {
+    object->AddRef();
+    object->Release();
+  }
+}
+
+template <typename T>
+cr::TimeDelta OwnerThreadPairs() {
+  cr::scoped_refptr<T> object = cr::MakeRefCounted<T>();
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  AddRefRelease(object.get(), kPairs);
+  return cr::TimeTicks::Now() - start;
+}
+
+template <typename T>
+cr::TimeDelta CreateAndDelete() {
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int i = 0; i < kObjects; ++i)
+    cr::MakeRefCounted<T>();
+  return cr::TimeTicks::Now() - start;
+}
+
+template <typename T>
+void OtherThreadPairs(const T* object, int index) {
+  AddRefRelease(object, kPairsPerThread);
+}
+
+template <typename T>
+cr::TimeDelta OtherThreadsPairs(int threads) {
+  cr::scoped_refptr<T> object = cr::MakeRefCounted<T>();
+  cr::TimeDelta elapsed = RunOnThreads(
+      threads, cr::BindRepeating(&OtherThreadPairs<T>,
+                                 cr::Unretained(object.get())));
+  // Runs the merge the other threads may have posted.
+  cr::RunLoop().RunUntilIdle();
+  return elapsed;
+}
+
+}  // namespace
+
+void RunRefCountedBiasedBenchmarks() {
+  // RefCountedBiased objects are only biased on threads with a task runner.
+  cr::MessageLoop message_loop;
+
+  PrintResult("ThreadSafe AddRef+Release/owner", kPairs,
+              OwnerThreadPairs<ThreadSafeObject>());
+  PrintResult("Biased AddRef+Release/owner", kPairs,
+              OwnerThreadPairs<BiasedObject>());
+  PrintResult("ThreadSafe create+delete", kObjects,
+              CreateAndDelete<ThreadSafeObject>());
+  PrintResult("Biased create+delete", kObjects,
+              CreateAndDelete<BiasedObject>());
+
+  const int kThreadCounts[] = {1, 4, 16};
+  for (int threads : kThreadCounts) {
+    std::string suffix = "/" + cr::IntToString(threads) + " threads";
+    int64_t pairs = static_cast<int64_t>(threads) * kPairsPerThread;
+    PrintResult("ThreadSafe AddRef+Release" + suffix, pairs,
+                OtherThreadsPairs<ThreadSafeObject>(threads));
+    PrintResult("Biased AddRef+Release" + suffix, pairs,
+                OtherThreadsPairs<BiasedObject>(threads));
+  }
+}
+
+}  // namespace benchmarks
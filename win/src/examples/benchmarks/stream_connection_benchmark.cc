@@ -0,0 +1,149 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Queuing responses on a StreamConnection and flushing them to a socket that
+// takes at most kSocketWriteSize bytes per call, against the queue of copied
+// strings it replaced, which wrote one string per call.  A response is a few
+// small copied pieces, plus in the large variant a 64 KB body appended as an
+// IOBuffer.  Reports the time per response and the write calls it took.
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <string>
+
+#include "crbase/memory/ref_counted.h"
+#include "crnet/base/io_buffer.h"
+#include "crnet/server/stream_connection.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kResponses = 1 << 14;
+// Responses queued while the socket is busy, before it is drained.
+const int kResponsesPerFlush = 32;
+const int kPiecesPerResponse = 8;
+const size_t kPieceSize = 48;
+const size_t kBodySize = 64 * 1024;
+const size_t kSocketWriteSize = 64 * 1024;
+
+typedef crnet::StreamConnection::QueuedWriteIOBuffer QueuedWriteIOBuffer;
+
+// Stands in for the socket: copies what one write call sends.
+class FakeSocket {
+ public:
+  FakeSocket() : writes_(0) {}
+
+  size_t Write(const char* data, size_t size) {
+    size = std::min(size, kSocketWriteSize);
+    memcpy(sink_, data, size);
+    ++writes_;
+    return size;
+  }
+
+  size_t Writev(const crnet::IOBufferSlice* slices, int slice_count) {
+    size_t written = 0;
+    for (int i = 0; i < slice_count && written < kSocketWriteSize; ++i) {
+      size_t size = std::min(static_cast<size_t>(slices[i].length),
+                             kSocketWriteSize - written);
+      memcpy(sink_ + written, slices[i].data(), size);
+      written += size;
+    }
+    ++writes_;
+    return written;
+  }
+
+  int64_t writes() const { return writes_; }
+
+ private:
+  int64_t writes_;
+  char sink_[kSocketWriteSize];
+};
+
+// Returns the time for all responses; |*writes| is set to the write calls.
+cr::TimeDelta RunChunkChain(bool large, int64_t* writes) {
+  cr::scoped_refptr<QueuedWriteIOBuffer> write_buf =
+      cr::MakeRefCounted<QueuedWriteIOBuffer>();
+  write_buf->set_max_buffer_size(64 * 1024 * 1024);
+  cr::scoped_refptr<crnet::IOBuffer> body =
+      cr::MakeRefCounted<crnet::IOBufferWithSize>(kBodySize);
+  memset(body->data(), 'b', kBodySize);
+  const std::string piece(kPieceSize, 'h');
+  std::unique_ptr<FakeSocket> socket(new FakeSocket);
+
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int response = 0; response < kResponses; ++response) {
+    for (int i = 0; i < kPiecesPerResponse; ++i)
+      write_buf->Append(piece);
+    if (large)
+      write_buf->Append(body, kBodySize);
+    if (response % kResponsesPerFlush != kResponsesPerFlush - 1)
+      continue;
+    crnet::IOBufferSlice slices[crnet::kMaxIOBufferSlices];
+    while (!write_buf->IsEmpty()) {
+      int slice_count =
+          write_buf->GetSlicesToWrite(slices, crnet::kMaxIOBufferSlices);
+      write_buf->DidConsume(socket->Writev(slices, slice_count));
+    }
+  }
+  cr::TimeDelta elapsed = cr::TimeTicks::Now() - start;
+  *writes = socket->writes();
+  return elapsed;
+}
+
+// The pending data as it was kept before the chunk chain: every append
+// copied into a string of its own, and a write sent the front string.
+cr::TimeDelta RunStringQueue(bool large, int64_t* writes) {
+  std::string body(kBodySize, 'b');
+  const std::string piece(kPieceSize, 'h');
+  std::queue<std::string> pending;
+  size_t front_offset = 0;
+  std::unique_ptr<FakeSocket> socket(new FakeSocket);
+
+  cr::TimeTicks start = cr::TimeTicks::Now();
+  for (int response = 0; response < kResponses; ++response) {
+    for (int i = 0; i < kPiecesPerResponse; ++i)
+      pending.push(piece);
+    if (large)
+      pending.push(body);
+    if (response % kResponsesPerFlush != kResponsesPerFlush - 1)
+      continue;
+    while (!pending.empty()) {
+      const std::string& front = pending.front();
+      front_offset += socket->Write(front.data() + front_offset,
+                                    front.size() - front_offset);
+      if (front_offset == front.size()) {
+        pending.pop();
+        front_offset = 0;
+      }
+    }
+  }
+  cr::TimeDelta elapsed = cr::TimeTicks::Now() - start;
+  *writes = socket->writes();
+  return elapsed;
+}
+
+}  // namespace
+
+void RunStreamConnectionBenchmarks() {
+  for (int large = 0; large < 2; ++large) {
+    std::string suffix = large ? "/64 KB body" : "/small";
+    int64_t chain_writes = 0;
+    int64_t queue_writes = 0;
+    PrintResult("Chunk chain queue+Writev" + suffix, kResponses,
+                RunChunkChain(large != 0, &chain_writes));
+    PrintResult("String queue+Write" + suffix, kResponses,
+                RunStringQueue(large != 0, &queue_writes));
+    PrintCount("Chunk chain write calls" + suffix, "writes", kResponses,
+               chain_writes);
+    PrintCount("String queue write calls" + suffix, "writes", kResponses,
+               queue_writes);
+  }
+}
+
+}  // namespace benchmarks
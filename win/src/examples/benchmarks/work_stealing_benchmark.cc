@@ -0,0 +1,113 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Throughput of SequencedWorkerPool with the shared queue and with work
+// stealing.  Several threads post short tasks, either unsequenced or spread
+// over a set of sequence tokens, and the time runs until the last task has
+// run on the pool.
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "crbase/functional/bind.h"
+#include "crbase/message_loop/message_loop.h"
+#include "crbase/run_loop.h"
+#include "crbase/strings/string_number_conversions.h"
+#include "crbase/synchronization/waitable_event.h"
+#include "crbase/threading/sequenced_worker_pool.h"
+#include "examples/benchmarks/benchmark.h"
+
+namespace benchmarks {
+
+namespace {
+
+const int kPosters = 4;
+const int kTasksPerPoster = 50000;
+const int kSequences = 64;
+
+class PoolBenchmark {
+ public:
+  PoolBenchmark(size_t workers,
+                cr::SequencedWorkerPool::SchedulingMode mode,
+                bool sequenced)
+      : pool_(new cr::SequencedWorkerPool(workers, "benchmark", mode)),
+        sequenced_(sequenced),
+        remaining_(kPosters * kTasksPerPoster),
+        done_(true, false) {
+    for (int i = 0; i < kSequences; ++i)
+      tokens_.push_back(cr::SequencedWorkerPool::GetSequenceToken());
+  }
+
+  ~PoolBenchmark() {
+    pool_->Shutdown();
+  }
+
+  cr::TimeDelta Run() {
+    cr::TimeTicks start = cr::TimeTicks::Now();
+    RunOnThreads(kPosters, cr::BindRepeating(&PoolBenchmark::PostTasks,
+                                             cr::Unretained(this)));
+    done_.Wait();
+    return cr::TimeTicks::Now() - start;
+  }
+
+  static int64_t operations() { return kPosters * kTasksPerPoster; }
+
+ private:
+  void PostTasks(int poster) {
+    for (int i = 0; i < kTasksPerPoster; ++i) {
+      cr::OnceClosure task =
+          cr::BindOnce(&PoolBenchmark::RunTask, cr::Unretained(this));
+      if (sequenced_) {
+        pool_->PostSequencedWorkerTask(
+            tokens_[(poster + i) % kSequences], CR_FROM_HERE, std::move(task));
+      } else {
+        pool_->PostWorkerTask(CR_FROM_HERE, std::move(task));
+      }
+    }
+  }
+
+  void RunTask() {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      done_.Signal();
+  }
+
+  cr::scoped_refptr<cr::SequencedWorkerPool> pool_;
+  const bool sequenced_;
+  std::vector<cr::SequencedWorkerPool::SequenceToken> tokens_;
+  std::atomic<int> remaining_;
+  cr::WaitableEvent done_;
+};
+
+}  // namespace
+
+void RunWorkStealingBenchmarks() {
+  // The pool posts its own destruction back to the constructing thread.
+  cr::MessageLoop message_loop;
+
+  const size_t kWorkerCounts[] = {4, 8, 16};
+  for (size_t workers : kWorkerCounts) {
+    for (int sequenced = 0; sequenced < 2; ++sequenced) {
+      std::string suffix = sequenced ? "sequenced" : "unsequenced";
+      suffix += "/" + cr::IntToString(static_cast<int>(workers)) + " workers";
+      {
+        PoolBenchmark benchmark(
+            workers, cr::SequencedWorkerPool::SCHEDULING_SHARED_QUEUE,
+            sequenced != 0);
+        PrintResult("Pool shared queue " + suffix,
+                    PoolBenchmark::operations(), benchmark.Run());
+      }
+      {
+        PoolBenchmark benchmark(
+            workers, cr::SequencedWorkerPool::SCHEDULING_WORK_STEALING,
+            sequenced != 0);
+        PrintResult("Pool work stealing " + suffix,
+                    PoolBenchmark::operations(), benchmark.Run());
+      }
+      cr::RunLoop().RunUntilIdle();
+    }
+  }
+}
+
+}  // namespace benchmarks
@@ -1,4 +1,7 @@
+#include <vector>
+
 #include "crbase/at_exit.h"
+#include "crbase/command_line.h"
 #include "crbase/memory/ref_counted.h"
 #include "crbase/memory/weak_ptr.h"
 #include "crbase/message_loop/message_loop.h"
@@ -28,10 +31,16 @@ void InitLogging() {
 constexpr uint32_t kReadBufferSize = 1024;
 constexpr uint32_t kDefaultSocketReceiveBuffer = 64 * 1024;
 
+// The number of datagrams read per call in batch mode.
+constexpr int kReadBatchSize = 32;
+
+// Switch to read with RecvFromBatch() instead of RecvFrom().
+const char kBatchSwitch[] = "batch";
+
 class UDPSimpleServer {
  public:
 
-  UDPSimpleServer();
+  explicit UDPSimpleServer(bool batch_mode);
   virtual ~UDPSimpleServer();
 
   int SetUp(const cr::StringPiece& address, uint16_t port);
@@ -40,6 +49,13 @@ class UDPSimpleServer {
   void Shutdown();
 
  private:
+  void OnMessage(const char* data,
+                 int length,
+                 const crnet::IPEndPoint& client_address);
+
+  // Whether reads go through RecvFromBatch() into |read_batch_|.
+  const bool batch_mode_;
+
   // Keeps track of whether a read is currently in flight, after which
   // OnReadComplete will be called.
   bool read_pending_ = false;
@@ -56,6 +72,10 @@ class UDPSimpleServer {
   // The target buffer of the current read.
   cr::scoped_refptr<crnet::IOBufferWithSize> read_buffer_;
 
+  // The target datagrams of the current batch read, and their buffers.
+  std::vector<crnet::DatagramBuffer> read_batch_;
+  std::vector<cr::scoped_refptr<crnet::IOBufferWithSize>> read_batch_buffers_;
+
   // The number of iterations of the read loop that have completed synchronously
   // and without posting a new task to the message loop.
   int synchronous_read_count_;
@@ -63,12 +83,20 @@ class UDPSimpleServer {
   cr::WeakPtrFactory<UDPSimpleServer> weak_factory_;
 };
 
-UDPSimpleServer::UDPSimpleServer()
-    : read_pending_(false), 
+UDPSimpleServer::UDPSimpleServer(bool batch_mode)
+    : batch_mode_(batch_mode),
+      read_pending_(false), 
       synchronous_read_count_(0),
       read_buffer_(new crnet::IOBufferWithSize(kReadBufferSize)),
       weak_factory_(this) {
-
+  if (batch_mode_) {
+    for (int i = 0; i < kReadBatchSize; ++i) {
+      read_batch_buffers_.push_back(
+          cr::MakeRefCounted<crnet::IOBufferWithSize>(kReadBufferSize));
+      read_batch_.push_back(crnet::DatagramBuffer(
+          read_batch_buffers_.back().get(), kReadBufferSize));
+    }
+  }
 }
 
 UDPSimpleServer::~UDPSimpleServer() {
@@ -77,6 +105,10 @@ UDPSimpleServer::~UDPSimpleServer() {
 
 int UDPSimpleServer::SetUp(const cr::StringPiece& address, uint16_t port) {
   std::unique_ptr<crnet::UDPServerSocket> socket(new crnet::UDPServerSocket);
+  // Without recvmmsg(), a batch read on Windows goes past the first datagram
+  // with non-blocking IO only.
+  if (batch_mode_)
+    socket->UseNonBlockingIO();
   socket->AllowAddressReuse();
 
   int net_err = socket->ListenWithAddressAndPort(address.as_string(), port);
@@ -120,10 +152,17 @@ void UDPSimpleServer::StartReading() {
 
   read_pending_ = true;
 
-  int result = socket_->RecvFrom(
-      read_buffer_.get(), static_cast<int>(read_buffer_->size()), 
-      &client_address_,
-      cr::BindOnce(&UDPSimpleServer::OnReadComplete, cr::Unretained(this)));
+  int result;
+  if (batch_mode_) {
+    result = socket_->RecvFromBatch(
+        read_batch_.data(), static_cast<int>(read_batch_.size()),
+        cr::BindOnce(&UDPSimpleServer::OnReadComplete, cr::Unretained(this)));
+  } else {
+    result = socket_->RecvFrom(
+        read_buffer_.get(), static_cast<int>(read_buffer_->size()), 
+        &client_address_,
+        cr::BindOnce(&UDPSimpleServer::OnReadComplete, cr::Unretained(this)));
+  }
   if (result == crnet::ERR_IO_PENDING) {
     synchronous_read_count_ = 0;
     return;
@@ -155,14 +194,34 @@ void UDPSimpleServer::OnReadComplete(int result) {
     return;
   }
 
-  std::string msg;
-  msg.assign(read_buffer_->data(), result);
-  CR_LOG(INFO) << "GotUDPMessage[:" << client_address_.ToString() << "]:" 
-               << msg;
+  if (batch_mode_) {
+    // |result| is the number of datagrams received.
+    for (int i = 0; i < result; ++i) {
+      const crnet::DatagramBuffer& datagram = read_batch_[i];
+      if (datagram.result < 0) {
+        CR_LOG(WARNING) << "Dropped datagram from "
+                        << datagram.address.ToString() << ": "
+                        << crnet::ErrorToString(datagram.result);
+        continue;
+      }
+      OnMessage(datagram.buffer->data(), datagram.result, datagram.address);
+    }
+  } else {
+    OnMessage(read_buffer_->data(), result, client_address_);
+  }
 
   StartReading();
 }
 
+void UDPSimpleServer::OnMessage(const char* data,
+                                int length,
+                                const crnet::IPEndPoint& client_address) {
+  std::string msg;
+  msg.assign(data, length);
+  CR_LOG(INFO) << "GotUDPMessage[:" << client_address.ToString() << "]:" 
+               << msg;
+}
+
 void UDPSimpleServer::Shutdown() {
   socket_->Close();
   socket_.reset();
@@ -180,9 +239,12 @@ int main(int argc, char* argv[]) {
   InitLogging();
 
   cr::AtExitManager at_exit_manager;
+  cr::CommandLine::Init(argc, argv);
   cr::MessageLoop message_loop(cr::MessageLoop::TYPE_IO);
 
-  UDPSimpleServer server;
+  // Run with --batch to read up to kReadBatchSize datagrams per call.
+  UDPSimpleServer server(
+      cr::CommandLine::ForCurrentProcess()->HasSwitch(kBatchSwitch));
   if (server.SetUp("127.0.0.1", 3939) < 0)
     return -1;
 